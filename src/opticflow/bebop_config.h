@@ -17,3 +17,4 @@
 
 #define CAMERA_ID 0
 #define UDP_TARGET "192.168.42.9"
+#define FLOW_PORT 5001
@@ -17,3 +17,4 @@
 
 #define CAMERA_ID 0
 #define UDP_TARGET "127.0.0.1"
+#define FLOW_PORT 5001
@@ -19,13 +19,11 @@
 #include PLATFORM_CONFIG
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <fcntl.h>
 #include <unistd.h>
 #include <iostream>
 #include <fstream>
-#include <opencv2/opencv.hpp>
-
-using namespace cv;
 
 int main(int argc, char *argv[])
 {
@@ -37,11 +35,20 @@ int main(int argc, char *argv[])
 #endif
   UDPSocket::Ptr udp = std::make_shared<UDPSocket>(UDP_TARGET, 5000);
   EncoderRTP rtp(udp);
+  UDPSocket::Ptr flow_udp = std::make_shared<UDPSocket>(UDP_TARGET, FLOW_PORT);
 
   Cam::Ptr cam = target.getCamera(CAMERA_ID);
   cam->setOutput(Image::FMT_YUYV, 320, 240);
   cam->setCrop(0, 0, 240, 240);
 
+  // Capture on a separate thread, so the processing always gets the newest frame, and restart
+  // the stream after three timeouts of 500ms
+  std::shared_ptr<CamLinux> cam_linux = std::dynamic_pointer_cast<CamLinux>(cam);
+  if (cam_linux) {
+    cam_linux->setThreaded(true);
+    cam_linux->setWatchdog(3, 500);
+  }
+
 #if defined(PLATFORM_Bebop)
   encoder.setInput(cam);
   encoder.start();
@@ -54,20 +61,75 @@ int main(int argc, char *argv[])
 
   cam->start();
   uint32_t i = 0;
+  ImageBufferPool::Ptr pool;
+  Pyramid::Ptr prev_pyramid = std::make_shared<Pyramid>(3);
+  Pyramid::Ptr pyramid = std::make_shared<Pyramid>(3);
+  LucasKanade lk(15, 3, 10);
+  std::vector<LucasKanade::point_t> points;
+  std::vector<LucasKanade::flow_t> flow;
+
+  // Detect FAST corners spread over a grid and adapt the threshold to find enough of them
+  FastDetector fast(FastDetector::FAST_9, 20);
+  fast.setGrid(40, 40, 4);
+  fast.setMaxCorners(150);
+  fast.setTarget(300);
+  std::vector<FastDetector::corner_t> corners;
+  corners.reserve(150);
+  points.reserve(150);
+
+  // Cheap edge histogram flow published every frame
+  EdgeFlow edge_flow;
+  EdgeFlow::result_t edge_result;
+  std::vector<uint8_t> flow_packet(sizeof(uint32_t) + sizeof(edge_result));
+  uint32_t frame_nr = 0;
   while(true) {
     Image::Ptr img = cam->getImage();
 
-    // Convert to OpenCV matrix
-    Mat M(img->getHeight(), img->getWidth(), CV_8UC2, img->getData());
-    Mat image;
-    cvtColor(M, image, CV_YUV2BGR_Y422); // cvtColor(M, image, CV_YUV2GRAY_Y422);
+    // Blur directly on YUV422 into a pool buffer, since the previous frame is still used for tracking
+    if (!pool || pool->getWidth() != img->getWidth() || pool->getHeight() != img->getHeight()) {
+      pool = std::make_shared<ImageBufferPool>(img->getPixelFormat(), img->getWidth(), img->getHeight(), 3);
+      prev_pyramid = std::make_shared<Pyramid>(3);
+      pyramid = std::make_shared<Pyramid>(3);
+    }
+    Image::Ptr filtered = pool->getImage();
+    img->blur(filtered, 5, Image::BLUR_BOX);
+
+    // Publish the edge flow as the frame number followed by the result in host byte order
+    if (edge_flow.calculate(filtered, edge_result)) {
+      memcpy(flow_packet.data(), &frame_nr, sizeof(uint32_t));
+      memcpy(flow_packet.data() + sizeof(uint32_t), &edge_result, sizeof(edge_result));
+      flow_udp->transmit(flow_packet);
+    }
+    ++frame_nr;
+
+    // Calculate the optical flow from the previous frame
+    std::swap(prev_pyramid, pyramid);
+    pyramid->setImage(filtered);
+    if (prev_pyramid->getFrameCount() > 0) {
+      lk.track(*prev_pyramid, *pyramid, points, flow);
 
-    // Blur for now
-    blur(image, image, Size(5, 5));
+      float flow_x = 0, flow_y = 0;
+      uint32_t tracked = 0;
+      for (auto &f : flow) {
+        if (f.status == LucasKanade::STATUS_TRACKED) {
+          flow_x += f.flow.x;
+          flow_y += f.flow.y;
+          tracked++;
+        }
+      }
+      if (tracked > 0 && i == 0) {
+        printf("Flow (%.2f, %.2f) from %d of %d points\n", flow_x / tracked, flow_y / tracked, tracked, (uint32_t)points.size());
+      }
+    }
 
+    // Detect the points to track into the next frame
+    fast.detect(filtered, corners);
+    points.clear();
+    for (auto &c : corners) {
+      points.push_back({(float)c.x, (float)c.y});
+    }
 
     // Start encoding
-    //colorrgb_opencv_to_yuv422(image, img->getData(), img->getWidth(), img->getHeight());
     Image::Ptr enc_img = encoder.encode(img);
     rtp.encode(enc_img);
 
@@ -21,6 +21,8 @@
 #include <stdlib.h>
 #include <fcntl.h>
 #include <unistd.h>
+#include <time.h>
+#include <chrono>
 #include <iostream>
 #include <fstream>
 #include <string>
@@ -36,7 +38,7 @@ int main(int argc, char *argv[])
 
   // determine target from number of cmdline arguments
   std::string udp_target = UDP_TARGET;
-  if (argc == 2) {
+  if (argc >= 2) {
     udp_target = std::string(argv[1]);
   }
   std::cout << "Target: " << udp_target << std::endl;
@@ -44,9 +46,19 @@ int main(int argc, char *argv[])
   UDPSocket::Ptr udp = std::make_shared<UDPSocket>(udp_target, 5000);
   EncoderRTP rtp(udp);
 
-  Cam::Ptr cam = target.getCamera(CAMERA_ID);
-  cam->setOutput(Image::FMT_YUYV, 1088, 1920);
-  cam->setCrop(114 + 2300, 106 + 500, 1088, 1920);
+  // Replay a raw recording as fast as possible instead of using the camera
+  Cam::Ptr cam;
+  if (argc >= 3) {
+    std::shared_ptr<CamFile> file_cam = std::make_shared<CamFile>(argv[2]);
+    file_cam->setPacing(CamFile::PACING_FAST);
+    cam = file_cam;
+    cam->setOutput(Image::FMT_YUYV, 1088, 1920);
+    std::cout << "Replaying: " << argv[2] << std::endl;
+  } else {
+    cam = target.getCamera(CAMERA_ID);
+    cam->setOutput(Image::FMT_YUYV, 1088, 1920);
+    cam->setCrop(114 + 2300, 106 + 500, 1088, 1920);
+  }
 
 #if defined(PLATFORM_Bebop)
   encoder.setInput(cam, EncoderH264::ROTATE_90L);
@@ -60,11 +72,28 @@ int main(int argc, char *argv[])
 
   cam->start();
   uint32_t i = 0;
+  auto period_start = std::chrono::steady_clock::now();
   while(true) {
     Image::Ptr img = cam->getImage();
     Image::Ptr enc_img = encoder.encode(img);
     rtp.encode(enc_img);
 
+    // Report the latency from capture until the frame is sent and the capture health
+    if (i == 0 && img->getTimestamp() != 0) {
+      struct timespec now;
+      clock_gettime(CLOCK_MONOTONIC, &now);
+      uint64_t now_us = (uint64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+      struct CamMetrics::statistics_t stats = cam->getStatistics();
+      printf("Frame %u latency %.1f ms (capture p50 %.1f ms, p99 %.1f ms), %u dropped, %u timeouts, %u starved, %u restarts, %u/%u buffers held\n",
+             img->getSequence(), (now_us - img->getTimestamp()) / 1000.0, stats.getLatencyPercentile(50) / 1000.0,
+             stats.getLatencyPercentile(99) / 1000.0, stats.dropped, stats.timeouts, stats.starvation, stats.restarts, stats.in_use, stats.in_use_max);
+    }
+    if (i == 19) {
+      auto period_end = std::chrono::steady_clock::now();
+      printf("Throughput %.1f fps\n", 20 / std::chrono::duration<double>(period_end - period_start).count());
+      period_start = period_end;
+    }
+
 #if defined(PLATFORM_Bebop)
     fwrite(sps.data(), sps.size(), 1, fp);
     fwrite(pps.data(), pps.size(), 1, fp);
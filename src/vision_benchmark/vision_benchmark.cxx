@@ -0,0 +1,261 @@
+/*
+ * This file is part of the TU Delft Vision programs (https://github.com/tudelft/tudelft_vision).
+ * Copyright (c) 2016 Freek van Tienen <freek.v.tienen@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <tuv/tuv.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#define IMG_WIDTH 1088
+#define IMG_HEIGHT 1920
+
+/* Result of a single benchmark run */
+struct result_t {
+  double time_us;               ///< Average time per iteration in microseconds
+  std::vector<uint8_t> output;  ///< Output bytes of the last iteration
+};
+
+/* Run a kernel on a fresh copy of the input and measure the average time */
+static struct result_t run(std::vector<uint8_t> &input, Image::pixel_formats format, uint32_t iterations,
+                           std::function<Image::Ptr(Image::Ptr)> kernel)
+{
+  struct result_t res;
+  std::chrono::duration<double, std::micro> total(0);
+
+  for (uint32_t i = 0; i < iterations; ++i) {
+    Image::Ptr img = std::make_shared<ImageBuffer>(format, IMG_WIDTH, IMG_HEIGHT, input);
+    auto start = std::chrono::steady_clock::now();
+    Image::Ptr out = kernel(img);
+    total += std::chrono::steady_clock::now() - start;
+
+    if (i == iterations - 1) {
+      uint8_t *data = (uint8_t *)out->getData();
+      res.output.assign(data, data + out->getSize());
+    }
+  }
+
+  res.time_us = total.count() / iterations;
+  return res;
+}
+
+/* Compare a kernel between the scalar and the selected instruction set */
+static bool compare(const std::string &name, std::vector<uint8_t> &input, Image::pixel_formats format, uint32_t iterations,
+                    SIMD::instruction_sets isa, std::function<Image::Ptr(Image::Ptr)> kernel)
+{
+  SIMD::setInstructionSet(SIMD::ISA_SCALAR);
+  struct result_t ref = run(input, format, iterations, kernel);
+  SIMD::setInstructionSet(isa);
+  struct result_t vec = run(input, format, iterations, kernel);
+
+  bool equal = (ref.output == vec.output);
+  printf("%-28s %10.1f us %10.1f us %7.2fx  %s\n", name.c_str(), ref.time_us, vec.time_us,
+         ref.time_us / vec.time_us, equal ? "ok" : "MISMATCH");
+  return equal;
+}
+
+/* The point sampling loop of Image::downsample before the vectorized kernels */
+static void downsample_original(uint8_t *data, uint32_t width, uint32_t height, uint16_t downsample)
+{
+  uint8_t *src = data;
+  uint8_t *dst = data;
+  uint32_t new_width = width / downsample;
+  uint32_t new_height = height / downsample;
+  uint32_t pixel_skip = (downsample - 1) * 2;
+
+  for (uint32_t y = 0; y < new_height; y++) {
+    for (uint32_t x = 0; x < new_width; x += 2) {
+      *dst++ = *src++;
+      *dst++ = *src++;
+      *dst++ = *src++;
+      src += pixel_skip;
+      *dst++ = *src++;
+      src += pixel_skip;
+    }
+    src += pixel_skip * width;
+  }
+}
+
+/* Compare a downsample method with the selected instruction set against the original loop */
+static void compare_original(const std::string &name, std::vector<uint8_t> &input, Image::pixel_formats format, uint32_t iterations,
+                             uint16_t factor, Image::downsample_methods method)
+{
+  struct result_t orig = run(input, format, iterations, [factor](Image::Ptr img) {
+    downsample_original((uint8_t *)img->getData(), img->getWidth(), img->getHeight(), factor);
+    return img;
+  });
+  struct result_t vec = run(input, format, iterations, [factor, method](Image::Ptr img) {
+    img->downsample(factor, method);
+    return img;
+  });
+
+  printf("%-28s %10.1f us %10.1f us %7.2fx\n", name.c_str(), orig.time_us, vec.time_us, orig.time_us / vec.time_us);
+}
+
+int main(int argc, char *argv[])
+{
+  uint32_t iterations = 50;
+  if (argc == 2) {
+    iterations = atoi(argv[1]);
+  }
+
+  // Generate pseudo random YUV422 and RGB input images
+  std::vector<uint8_t> input(IMG_WIDTH * IMG_HEIGHT * 2);
+  std::vector<uint8_t> rgb_input(IMG_WIDTH * IMG_HEIGHT * 3);
+  srand(42);
+  for (auto &byte : input) {
+    byte = rand() & 0xFF;
+  }
+  for (auto &byte : rgb_input) {
+    byte = rand() & 0xFF;
+  }
+
+  SIMD::instruction_sets isa = SIMD::getInstructionSet();
+  printf("Image %dx%d, %d iterations, scalar vs %s\n\n", IMG_WIDTH, IMG_HEIGHT, iterations, SIMD::toString(isa));
+  printf("%-28s %13s %13s %8s\n", "kernel", "scalar", SIMD::toString(isa), "speedup");
+
+  bool ok = true;
+  const Image::pixel_formats formats[] = {Image::FMT_YUYV, Image::FMT_UYVY};
+  const uint16_t factors[] = {2, 3, 4};
+  for (auto format : formats) {
+    std::string fmt_name = (format == Image::FMT_YUYV) ? "YUYV" : "UYVY";
+
+    for (auto factor : factors) {
+      std::string suffix = " " + fmt_name + " /" + std::to_string(factor);
+      ok &= compare("downsample point" + suffix, input, format, iterations, isa, [factor](Image::Ptr img) {
+        img->downsample(factor, Image::DOWNSAMPLE_POINT);
+        return img;
+      });
+      ok &= compare("downsample box" + suffix, input, format, iterations, isa, [factor](Image::Ptr img) {
+        img->downsample(factor, Image::DOWNSAMPLE_BOX);
+        return img;
+      });
+    }
+
+    // Conversions into preallocated outputs
+    const std::pair<Image::pixel_formats, std::string> outputs[] = {
+      {Image::FMT_GRAY8, "gray8"}, {Image::FMT_NV12, "nv12"}, {Image::FMT_I420, "i420"}, {Image::FMT_RGB24, "rgb24"},
+      {Image::FMT_BGR24, "bgr24"}
+    };
+    for (auto output : outputs) {
+      Image::Ptr out = std::make_shared<ImageBuffer>(output.first, IMG_WIDTH, IMG_HEIGHT);
+      ok &= compare("convert " + fmt_name + " to " + output.second, input, format, iterations, isa, [out](Image::Ptr img) {
+        img->convert(out);
+        return out;
+      });
+    }
+
+    // Pyramid of 4 levels from pooled buffers
+    Pyramid::Ptr pyramid = std::make_shared<Pyramid>(4);
+    ok &= compare("pyramid 4 levels " + fmt_name, input, format, iterations, isa, [pyramid](Image::Ptr img) {
+      pyramid->setImage(img);
+      return pyramid->getLevel(3);
+    });
+
+    // Blurring in place and into a preallocated output
+    ok &= compare("blur box 5x5 " + fmt_name, input, format, iterations, isa, [](Image::Ptr img) {
+      img->blur(5, Image::BLUR_BOX);
+      return img;
+    });
+    Image::Ptr blurred = std::make_shared<ImageBuffer>(format, IMG_WIDTH, IMG_HEIGHT);
+    ok &= compare("blur gaussian 5x5 " + fmt_name, input, format, iterations, isa, [blurred](Image::Ptr img) {
+      img->blur(blurred, 5, Image::BLUR_GAUSSIAN);
+      return blurred;
+    });
+
+    // Conversions back from RGB and BGR
+    Image::Ptr out = std::make_shared<ImageBuffer>(format, IMG_WIDTH, IMG_HEIGHT);
+    ok &= compare("convert rgb24 to " + fmt_name, rgb_input, Image::FMT_RGB24, iterations, isa, [out](Image::Ptr img) {
+      img->convert(out);
+      return out;
+    });
+    ok &= compare("convert bgr24 to " + fmt_name, rgb_input, Image::FMT_BGR24, iterations, isa, [out](Image::Ptr img) {
+      img->convert(out);
+      return out;
+    });
+  }
+
+  // Luma only images
+  std::vector<uint8_t> gray_input(input.begin(), input.begin() + IMG_WIDTH * IMG_HEIGHT);
+  ok &= compare("downsample box GRAY8 /2", gray_input, Image::FMT_GRAY8, iterations, isa, [](Image::Ptr img) {
+    img->downsample(2, Image::DOWNSAMPLE_BOX);
+    return img;
+  });
+  ok &= compare("blur box 9x9 GRAY8", gray_input, Image::FMT_GRAY8, iterations, isa, [](Image::Ptr img) {
+    img->blur(9, Image::BLUR_BOX);
+    return img;
+  });
+  ok &= compare("blur gaussian 9x9 GRAY8", gray_input, Image::FMT_GRAY8, iterations, isa, [](Image::Ptr img) {
+    img->blur(9, Image::BLUR_GAUSSIAN);
+    return img;
+  });
+
+  // FAST corners drawn into a mask, so the detected corners can be compared
+  FastDetector fast(FastDetector::FAST_9, 40);
+  std::vector<FastDetector::corner_t> corners;
+  Image::Ptr mask = std::make_shared<ImageBuffer>(Image::FMT_GRAY8, IMG_WIDTH, IMG_HEIGHT);
+  ok &= compare("fast9 corners GRAY8", gray_input, Image::FMT_GRAY8, iterations, isa, [&fast, &corners, mask](Image::Ptr img) {
+    fast.detect(img, corners);
+    uint8_t *data = (uint8_t *)mask->getData();
+    memset(data, 0, mask->getSize());
+    for (auto &c : corners) {
+      data[c.y * IMG_WIDTH + c.x] = 255;
+    }
+    return mask;
+  });
+
+  // Edge histogram flow written into a buffer, so the result can be compared
+  EdgeFlow edge_flow;
+  Image::Ptr flow_out = std::make_shared<ImageBuffer>(Image::FMT_GRAY8, sizeof(EdgeFlow::result_t), 1);
+  ok &= compare("edge flow GRAY8", gray_input, Image::FMT_GRAY8, iterations, isa, [&edge_flow, flow_out](Image::Ptr img) {
+    EdgeFlow::result_t result;
+    edge_flow.calculate(img, result);
+    memcpy(flow_out->getData(), &result, sizeof(result));
+    return flow_out;
+  });
+
+  // Block matching against a shifted copy, with the vectors written into a buffer
+  std::vector<uint8_t> shifted_input(gray_input.begin() + 3 * IMG_WIDTH + 5, gray_input.end());
+  shifted_input.resize(gray_input.size(), 0);
+  Image::Ptr shifted = std::make_shared<ImageBuffer>(Image::FMT_GRAY8, IMG_WIDTH, IMG_HEIGHT, shifted_input);
+  BlockMatcher matcher(16, 16, BlockMatcher::SEARCH_DIAMOND, 0);
+  std::vector<BlockMatcher::vector_t> vectors;
+  Image::Ptr field = std::make_shared<ImageBuffer>(Image::FMT_GRAY8, (IMG_WIDTH / 16) * (IMG_HEIGHT / 16) * sizeof(BlockMatcher::vector_t), 1);
+  ok &= compare("block matching 16x16 GRAY8", gray_input, Image::FMT_GRAY8, iterations, isa, [&matcher, &vectors, shifted, field](Image::Ptr img) {
+    matcher.estimate(img, shifted, vectors);
+    memcpy(field->getData(), vectors.data(), vectors.size() * sizeof(BlockMatcher::vector_t));
+    return field;
+  });
+
+  // Downsampling against the original point sampling loop (which took the wrong chroma for even factors)
+  printf("\n%-28s %13s %13s %8s\n", "kernel", "original", SIMD::toString(isa), "speedup");
+  for (auto factor : factors) {
+    std::string suffix = " YUYV /" + std::to_string(factor);
+    compare_original("downsample point" + suffix, input, Image::FMT_YUYV, iterations, factor, Image::DOWNSAMPLE_POINT);
+    compare_original("downsample box" + suffix, input, Image::FMT_YUYV, iterations, factor, Image::DOWNSAMPLE_BOX);
+  }
+
+  if (!ok) {
+    printf("\nVectorized output differs from the scalar reference\n");
+    return 1;
+  }
+  return 0;
+}
@@ -18,6 +18,7 @@
 #ifndef CAM_CAM_H_
 #define CAM_CAM_H_
 
+#include <tuv/cam/cam_metrics.h>
 #include <tuv/vision/image.h>
 
 /**
@@ -34,11 +35,13 @@ class Cam {
     uint32_t width;                             ///< The output width in pixels
     uint32_t height;                            ///< The output height in pixels
     enum Image::pixel_formats pixel_format;     ///< The output pixel format
+    CamMetrics metrics;                         ///< The capture health metrics
 
   public:
     virtual void start(void) = 0;
     virtual void stop(void) = 0;
     virtual Image::Ptr getImage(void) = 0;
+    virtual int getFd(void);
 
     /* Settings */
     virtual void setOutput(enum Image::pixel_formats format, uint32_t width, uint32_t height) = 0;
@@ -48,6 +51,10 @@ class Cam {
     unsigned int getWidth(void);
     unsigned int getHeight(void);
     enum Image::pixel_formats getFormat(void);
+
+    /* Capture health */
+    struct CamMetrics::statistics_t getStatistics(void);
+    void resetStatistics(void);
 };
 
 #endif /* CAM_CAM_H_ */
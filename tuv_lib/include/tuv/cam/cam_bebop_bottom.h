@@ -35,6 +35,8 @@ class CamBebopBottom: public CamLinux {
     I2CBus i2c_bus;                             ///< The I2C bus connection on which the MT9F002 is connected
     MT9V117 mt9v117;                            ///< MT9V117 driver
 
+    void resetSensor(void);
+
   public:
     CamBebopBottom(void);
 
@@ -36,6 +36,7 @@ class CamBebopFront: public CamLinux {
     struct MT9F002::pll_config_t pll_config;    ///< PLL configuration for the MT9F002
     MT9F002 mt9f002;                            ///< MT9F002 driver
     ISP isp;                                    ///< ISP driver
+    struct ISP::statistics_t stats;             ///< The latest ISP statistics
     uint32_t crop_left;                         ///< Cropping left offset
     uint32_t crop_top;                          ///< Cropping top offset
     uint32_t crop_width;                        ///< Cropping width
@@ -44,11 +45,13 @@ class CamBebopFront: public CamLinux {
     /* Helper functions */
     void autoExposure(struct ISP::statistics_t &stats);
     void autoWhiteBalance(struct ISP::statistics_t &stats);
+    void resetSensor(void);
 
   public:
     CamBebopFront(void);
 
     void start(void);
+    void stop(void);
     Image::Ptr getImage(void);
     void setOutput(enum Image::pixel_formats format, uint32_t width, uint32_t height);
     void setCrop(uint32_t left, uint32_t top, uint32_t width, uint32_t height);
@@ -0,0 +1,102 @@
+/*
+ * This file is part of the TUV library (https://github.com/tudelft/tudelft_vision).
+ * Copyright (c) 2016 Freek van Tienen <freek.v.tienen@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CAM_FILE_H_
+#define CAM_FILE_H_
+
+#include <tuv/cam/cam.h>
+#include <tuv/vision/image_ptr.h>
+#include <string>
+#include <mutex>
+
+/**
+ * @brief A camera replaying a recording
+ *
+ * This replays a raw recording from a file, so the pipeline can be benchmarked without camera
+ * hardware. Raw files (.yuv) contain the frames back to back in the format and size set with
+ * setOutput. YUV4MPEG2 files (.y4m) describe the size and frame rate in their header and
+ * contain mono (GRAY8) or 4:2:0 (I420) frames. The file is memory mapped privately and
+ * the images point directly into the mapping, so no frame is copied. Images which are modified
+ * in place get private copies of the touched pages, which are discarded again once no image is
+ * in use anymore, so every replay of a frame is identical.
+ */
+class CamFile: public Cam, public ImagePtr::Handler {
+  public:
+    /** The replay pacing modes */
+    enum pacing_modes {
+        PACING_REALTIME,        ///< Deliver the frames at the recorded frame rate
+        PACING_FAST,            ///< Deliver the frames as fast as they are requested
+    };
+
+  private:
+    std::string file_name;          ///< The file name including path
+    int fd;                         ///< The file descriptor of the recording
+    uint8_t *map;                   ///< The memory mapped file
+    size_t map_size;                ///< The size of the file in bytes
+
+    /* Recording layout */
+    bool is_y4m;                    ///< Whether the file is a YUV4MPEG2 file
+    size_t data_offset;             ///< The offset of the first frame in bytes
+    size_t frame_header;            ///< The size of the frame header in bytes (y4m only)
+    size_t frame_size;              ///< The size of the frame data in bytes
+    uint32_t frame_count;           ///< The amount of frames in the file
+    uint32_t fps_num;               ///< The numerator of the frame rate
+    uint32_t fps_den;               ///< The denominator of the frame rate
+
+    /* Replay state */
+    enum pacing_modes pacing;       ///< The pacing mode
+    bool loop;                      ///< Whether the replay restarts at the end of the file
+    bool streaming;                 ///< Whether the camera is started
+    uint32_t frame_nr;              ///< The index of the next frame in the file
+    uint32_t sequence;              ///< The sequence number of the next frame
+    uint64_t start_time;            ///< The time of the first frame in microseconds (CLOCK_MONOTONIC)
+
+    /* Images in use */
+    std::mutex mutex;               ///< Protects the images in use and the dirty range
+    uint32_t in_use;                ///< The amount of images in use
+    size_t dirty_begin;             ///< Start of the range given out since the last restore
+    size_t dirty_end;               ///< End of the range given out since the last restore
+
+    void openFile(void);
+    void parseY4M(void);
+    void updateLayout(void);
+    void restorePages(void);
+
+  public:
+    CamFile(std::string file_name);
+    ~CamFile(void);
+
+    void start(void);
+    void stop(void);
+
+    Image::Ptr getImage(void);
+    void freeImage(uint16_t identifier);
+
+    /* Replay */
+    void setPacing(enum pacing_modes pacing);
+    void setLoop(bool loop);
+    void setFrameRate(uint32_t num, uint32_t den = 1);
+    enum pacing_modes getPacing(void);
+    uint32_t getFrameCount(void);
+    bool isFinished(void);
+
+    /* Settings */
+    void setOutput(enum Image::pixel_formats format, uint32_t width, uint32_t height);
+    void setCrop(uint32_t left, uint32_t top, uint32_t width, uint32_t height);
+};
+
+#endif /* CAM_FILE_H_ */
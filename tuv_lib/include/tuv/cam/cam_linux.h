@@ -22,37 +22,84 @@
 #include <tuv/vision/image_ptr.h>
 #include <string>
 #include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <memory>
 #include <linux/videodev2.h>
 
 /**
  * @brief A linux based camera
  *
- * This will setup a Linux based V4L2 camera.
+ * This will setup a Linux based V4L2 camera. By default getImage waits for and dequeues a
+ * buffer on the calling thread. In threaded mode a capture thread dequeues the buffers and
+ * hands the newest one over through an atomic slot, where a frame that is replaced before it
+ * was taken is directly enqueued again. This keeps the driver supplied with buffers when the
+ * processing is slower than the frame rate and getImage returns the newest frame without a
+ * system call. Every image keeps a reference to the camera, so its buffer can always be
+ * returned. Therefore the camera must be created as shared pointer.
  */
-class CamLinux: public Cam, public ImagePtr::Handler {
+class CamLinux: public Cam, public ImagePtr::Handler, public std::enable_shared_from_this<CamLinux> {
+  public:
+    /** The V4L2 memory types of the buffers */
+    enum memory_types {
+        MEMORY_MMAP,              ///< Driver buffers mapped into memory
+        MEMORY_USERPTR,           ///< User allocated buffers (internal or set with setUserBuffers)
+        MEMORY_DMABUF,            ///< Imported DMA buffers set with setDmabufBuffers
+    };
+
   protected:
     /** The buffer state */
     enum buffer_state_t {
         BUFFER_ENQUEUED,          ///< The Buffer is enqueued
-        BUFFER_DEQUEUED           ///< The buffer is dequeued
+        BUFFER_DEQUEUED,          ///< The buffer is dequeued
+        BUFFER_IN_USE,            ///< The buffer is used by an image
+        BUFFER_ORPHANED           ///< The buffers are released while this one is used by an image
     };
 
     /** Specific V4L2 buffer */
     struct buffer_t {
         uint16_t index;             ///< The index of the buffer
-        enum buffer_state_t state;  ///< The current buffer state
+        enum buffer_state_t state;  ///< The current buffer state (guarded by buffer_mutex)
 
         size_t length;              ///< The size of the buffer
         void *buf;                  ///< Pointer to the memory mapped buffer
+        int dmabuf_fd;              ///< The imported DMA buffer file descriptor (-1 otherwise)
+        bool allocated;             ///< Whether the buffer memory is allocated by the camera
+        uint64_t timestamp;         ///< The capture time of the last frame in microseconds (CLOCK_MONOTONIC)
+        uint32_t sequence;          ///< The sequence number of the last frame
     };
 
     std::string device_name;                  ///< The device name including file path
     int fd;                                   ///< File pointer to the linux device
-    fd_set fds;                               ///< Set of file pointers
 
     struct v4l2_capability cap;                 ///< The V4L2 capabilities of the device
     std::vector<struct v4l2_fmtdesc> formats;   ///< Possible V4L2 formats for the device
     std::vector<struct buffer_t> buffers;       ///< The V4L2 buffers
+    std::mutex buffer_mutex;                    ///< Guards the buffer states and the driver queue
+    uint16_t buffer_count;                      ///< The amount of buffers to request
+    enum memory_types memory;                   ///< The memory type of the buffers
+    std::vector<void *> user_buffers;           ///< User buffers for MEMORY_USERPTR
+    size_t user_length;                         ///< The size of every user buffer
+    std::vector<int> dmabuf_fds;                ///< DMA buffers for MEMORY_DMABUF
+    bool streaming;                             ///< Whether the stream is started
+
+    /* Frame sequence */
+    bool has_sequence;                          ///< Whether a frame was delivered since the start
+    uint32_t last_sequence;                     ///< The sequence number of the last delivered frame
+
+    /* Threaded capture */
+    bool threaded;                              ///< Whether a capture thread dequeues the buffers
+    std::thread capture_thread;                 ///< The capture thread
+    std::atomic<bool> capturing;                ///< Whether the capture thread should keep running
+    std::atomic<int32_t> latest_buffer;         ///< Index of the newest captured buffer (-1 when taken)
+    std::mutex frame_mutex;                     ///< Mutex for waiting on a new frame
+    std::condition_variable frame_cond;         ///< Signals a new frame from the capture thread
+
+    /* Stall watchdog */
+    uint16_t watchdog_timeouts;                 ///< The amount of timeouts before a restart (0 when disabled)
+    uint32_t frame_timeout;                     ///< The timeout while waiting for a frame in milliseconds
 
     /* Internal functions */
     std::string formatToString(uint32_t format);
@@ -61,8 +108,17 @@ class CamLinux: public Cam, public ImagePtr::Handler {
     void getCapabilities(void);
     void getFormats(void);
     void initBuffers(void);
-    void enqueueBuffer(struct buffer_t buffer);
+    void releaseBuffers(void);
+    void releaseMemory(struct buffer_t &buffer);
+    uint32_t getV4L2Memory(void);
+    void enqueueBuffer(struct buffer_t &buffer);
     struct buffer_t *dequeueBuffer(void);
+    bool waitForFrame(uint32_t timeout_ms);
+    void captureLoop(void);
+    void stopCapture(void);
+    bool handleTimeout(uint16_t &timeouts, uint64_t &stall_start);
+    void restartStream(void);
+    virtual void resetSensor(void);
 
   public:
     CamLinux(std::string device_name);
@@ -74,8 +130,22 @@ class CamLinux: public Cam, public ImagePtr::Handler {
     void stop(void);
 
     Image::Ptr getImage(void);
+    int getFd(void);
     void freeImage(uint16_t identifier);
 
+    void setThreaded(bool threaded);
+    bool isThreaded(void);
+    void setWatchdog(uint16_t timeouts, uint32_t timeout_ms = 2000);
+
+    /* Buffers */
+    void setBuffers(uint16_t count, enum memory_types memory = MEMORY_MMAP);
+    void setUserBuffers(const std::vector<void *> &buffers, size_t length);
+    void setDmabufBuffers(const std::vector<int> &fds);
+    int exportBuffer(uint16_t index);
+    uint16_t getBufferCount(void);
+    enum memory_types getMemoryType(void);
+    uint32_t getDroppedFrames(void);
+
     /* Settings */
     void setOutput(enum Image::pixel_formats format, uint32_t width, uint32_t height);
     void setCrop(uint32_t left, uint32_t top, uint32_t width, uint32_t height);
@@ -0,0 +1,89 @@
+/*
+ * This file is part of the TUV library (https://github.com/tudelft/tudelft_vision).
+ * Copyright (c) 2016 Freek van Tienen <freek.v.tienen@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CAM_METRICS_H_
+#define CAM_METRICS_H_
+
+#include <stdint.h>
+#include <atomic>
+
+#define CAM_METRICS_BUCKETS 64     ///< The amount of latency histogram buckets
+
+/**
+ * @brief Capture health metrics of a camera
+ *
+ * This counts the delivered, dropped and timed out frames, buffer starvation, watchdog restarts
+ * and the buffers held by consumers, and keeps a histogram of the latency from the capture timestamp until the
+ * frame is returned by getImage. All updates are lock-free atomic operations, so the metrics
+ * can be read at runtime from any thread without stalling the capture. The histogram has four
+ * buckets per power of two, starting at 64 microseconds.
+ */
+class CamMetrics {
+  public:
+    /** A snapshot of the metrics */
+    struct statistics_t {
+        uint32_t delivered;                 ///< The amount of frames returned by getImage
+        uint32_t dropped;                   ///< The amount of frames lost according to the sequence numbers
+        uint32_t timeouts;                  ///< The amount of timeouts while waiting for a frame
+        uint32_t starvation;                ///< The amount of times no buffer was available to the driver
+        uint32_t in_use;                    ///< The amount of buffers currently held by consumers
+        uint32_t in_use_max;                ///< The maximum amount of buffers held by consumers
+        uint64_t latency_sum;               ///< The sum of all latencies in microseconds
+        uint32_t latency_max;               ///< The maximum latency in microseconds
+        uint32_t latency[CAM_METRICS_BUCKETS];  ///< The latency histogram
+        uint32_t restarts;                  ///< The amount of stream restarts by the watchdog
+        uint32_t recovery_last;             ///< The last time from a stall until a new frame in microseconds
+        uint32_t recovery_max;              ///< The maximum time from a stall until a new frame in microseconds
+
+        uint32_t getLatencyMean(void) const;
+        uint32_t getLatencyPercentile(float percentile) const;
+    };
+
+  private:
+    std::atomic<uint32_t> delivered;        ///< The amount of frames returned by getImage
+    std::atomic<uint32_t> dropped;          ///< The amount of frames lost according to the sequence numbers
+    std::atomic<uint32_t> timeouts;         ///< The amount of timeouts while waiting for a frame
+    std::atomic<uint32_t> starvation;       ///< The amount of times no buffer was available to the driver
+    std::atomic<uint32_t> in_use;           ///< The amount of buffers currently held by consumers
+    std::atomic<uint32_t> in_use_max;       ///< The maximum amount of buffers held by consumers
+    std::atomic<uint64_t> latency_sum;      ///< The sum of all latencies in microseconds
+    std::atomic<uint32_t> latency_max;      ///< The maximum latency in microseconds
+    std::atomic<uint32_t> latency[CAM_METRICS_BUCKETS]; ///< The latency histogram
+    std::atomic<uint32_t> restarts;         ///< The amount of stream restarts by the watchdog
+    std::atomic<uint32_t> recovery_last;    ///< The last time from a stall until a new frame in microseconds
+    std::atomic<uint32_t> recovery_max;     ///< The maximum time from a stall until a new frame in microseconds
+
+  public:
+    CamMetrics(void);
+
+    /* Recording */
+    void addFrame(uint64_t timestamp, uint32_t dropped);
+    void addTimeout(void);
+    void addStarvation(void);
+    void acquireBuffer(void);
+    void releaseBuffer(void);
+    void addRestart(void);
+    void addRecovery(uint32_t recovery);
+
+    /* Reading */
+    struct statistics_t getStatistics(void);
+    void reset(void);
+    static uint8_t getBucket(uint32_t latency);
+    static uint32_t getBucketLimit(uint8_t bucket);
+};
+
+#endif /* CAM_METRICS_H_ */
@@ -0,0 +1,96 @@
+/*
+ * This file is part of the TUV library (https://github.com/tudelft/tudelft_vision).
+ * Copyright (c) 2016 Freek van Tienen <freek.v.tienen@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CAM_MULTIPLEXER_H_
+#define CAM_MULTIPLEXER_H_
+
+#include <tuv/cam/cam.h>
+#include <stdint.h>
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <sys/epoll.h>
+
+/**
+ * @brief Multi-camera capture multiplexer
+ *
+ * This waits on the file descriptors of several cameras with a single epoll, so one thread can
+ * service all cameras at their full rate. All cameras which are ready after a wakeup are
+ * dequeued first and only then delivered, which keeps the latency skew between the cameras
+ * small. Frames are delivered to a per-camera callback or kept in a per-camera queue, where the
+ * oldest frame is released when the queue is full. The cameras must be started before polling
+ * and must support getFd (for CamLinux this means the threaded mode must be disabled).
+ */
+class CamMultiplexer {
+  public:
+    typedef std::shared_ptr<CamMultiplexer> Ptr;                        ///< Shared pointer representation of the multiplexer
+    typedef std::function<void(uint32_t id, Image::Ptr img)> callback_t; ///< Frame callback with the camera id
+
+  private:
+    /** A registered camera */
+    struct camera_t {
+        uint32_t id;                    ///< The camera id given by the user
+        Cam::Ptr cam;                   ///< The camera
+        int fd;                         ///< The file descriptor registered at the epoll
+        callback_t callback;            ///< The frame callback (empty in queue mode)
+        std::deque<Image::Ptr> queue;   ///< The queued frames in queue mode
+        uint16_t queue_size;            ///< The maximum amount of queued frames
+        uint32_t frames;                ///< The amount of delivered frames
+        uint32_t overflows;             ///< The amount of frames released because the queue was full
+    };
+
+    int epoll_fd;                               ///< The epoll file descriptor
+    std::list<struct camera_t> cameras;         ///< The registered cameras (stable addresses for epoll)
+    std::vector<struct epoll_event> events;     ///< The preallocated epoll events
+    std::vector<std::pair<struct camera_t *, Image::Ptr>> ready;   ///< The frames dequeued after a wakeup
+    std::mutex mutex;                           ///< Protects the queues and the counters
+
+    std::thread thread;                         ///< The optional service thread
+    std::atomic<bool> running;                  ///< Whether the service thread should keep running
+
+    struct camera_t *findCamera(uint32_t id);
+    void registerCamera(struct camera_t &camera);
+    void serviceLoop(void);
+
+  public:
+    CamMultiplexer(void);
+    ~CamMultiplexer(void);
+
+    /* Cameras */
+    void addCamera(uint32_t id, Cam::Ptr cam, callback_t callback);
+    void addCamera(uint32_t id, Cam::Ptr cam, uint16_t queue_size = 1);
+    void removeCamera(uint32_t id);
+
+    /* Servicing */
+    uint32_t poll(int32_t timeout_ms);
+    void start(void);
+    void stop(void);
+    bool isRunning(void);
+
+    /* Queue mode */
+    Image::Ptr getImage(uint32_t id);
+
+    /* Information */
+    uint32_t getFrameCount(uint32_t id);
+    uint32_t getOverflowCount(uint32_t id);
+};
+
+#endif /* CAM_MULTIPLEXER_H_ */
@@ -0,0 +1,89 @@
+/*
+ * This file is part of the TUV library (https://github.com/tudelft/tudelft_vision).
+ * Copyright (c) 2016 Freek van Tienen <freek.v.tienen@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CAM_SYNTHETIC_H_
+#define CAM_SYNTHETIC_H_
+
+#include <tuv/cam/cam.h>
+#include <tuv/vision/image_buffer_pool.h>
+#include <stdint.h>
+#include <vector>
+
+/**
+ * @brief A camera generating synthetic frames
+ *
+ * This generates test patterns at any resolution and frame rate, so the encoders and vision
+ * algorithms can be loaded without camera hardware or disk access. The frames are rendered into
+ * a ring of preallocated buffers from a small tile which is generated once, so rendering is
+ * mostly copying rows. Moving patterns translate with a constant velocity and the exact integer
+ * offset of every frame is known, which serves as ground truth for optical flow. The GRAY8,
+ * YUYV and UYVY formats are supported.
+ */
+class CamSynthetic: public Cam {
+  public:
+    /** The generated patterns */
+    enum pattern_types {
+        PATTERN_BARS,           ///< Vertical colour bars, only moving horizontally in steps of whole macropixels
+        PATTERN_CHECKER,        ///< Grey checkerboard with squares of 32 pixels
+        PATTERN_TEXTURE,        ///< Smooth random grey texture with fine detail (trackable)
+        PATTERN_NOISE,          ///< New uniform random noise every frame (no motion)
+    };
+
+  private:
+    enum pattern_types pattern;     ///< The generated pattern
+    float velocity_x;               ///< The horizontal motion in pixels per frame
+    float velocity_y;               ///< The vertical motion in pixels per frame
+    uint32_t fps_num;               ///< The numerator of the frame rate (0 for unpaced)
+    uint32_t fps_den;               ///< The denominator of the frame rate
+    uint16_t buffer_count;          ///< The amount of preallocated buffers
+
+    ImageBufferPool::Ptr pool;      ///< The ring of preallocated frames
+    std::vector<uint8_t> tile;      ///< The pattern tile in the output format
+    uint32_t tile_width;            ///< The width of the tile in pixels
+    uint32_t tile_height;           ///< The height of the tile in pixels
+    uint64_t noise_state;           ///< The state of the noise generator
+
+    bool streaming;                 ///< Whether the camera is started
+    uint32_t sequence;              ///< The sequence number of the next frame
+    uint64_t start_time;            ///< The time of the first frame in microseconds (CLOCK_MONOTONIC)
+
+    void generateTile(void);
+    void renderPattern(uint8_t *dst, int32_t offset_x, int32_t offset_y);
+    void renderNoise(uint8_t *dst, uint32_t size);
+    void setPixel(uint8_t *dst, uint32_t x, uint8_t y, uint8_t u, uint8_t v);
+
+  public:
+    CamSynthetic(enum pattern_types pattern = PATTERN_TEXTURE);
+
+    void start(void);
+    void stop(void);
+    Image::Ptr getImage(void);
+
+    /* Generator */
+    void setPattern(enum pattern_types pattern);
+    void setMotion(float velocity_x, float velocity_y);
+    void setFrameRate(uint32_t num, uint32_t den = 1);
+    void setBuffers(uint16_t count);
+    void getOffset(uint32_t sequence, int32_t &offset_x, int32_t &offset_y);
+    ImageBufferPool::Ptr getPool(void);
+
+    /* Settings */
+    void setOutput(enum Image::pixel_formats format, uint32_t width, uint32_t height);
+    void setCrop(uint32_t left, uint32_t top, uint32_t width, uint32_t height);
+};
+
+#endif /* CAM_SYNTHETIC_H_ */
@@ -19,10 +19,19 @@
 #define DRIVERS_ISP_H_
 
 #include <tuv/drivers/isp/reg_avi.h>
+#include <tuv/drivers/isp_registers.h>
+#include <tuv/vision/image.h>
 
+#include <atomic>
+#include <condition_variable>
 #include <cstring>
+#include <mutex>
+#include <thread>
 #include <vector>
 
+#define ISP_GRID_COEFFS 221     ///< Amount of coefficients per channel in the 17 x 13 correction grids
+#define ISP_DEAD_PIXELS 256     ///< Maximum amount of entries in the dead pixel list
+
 /**
  * @brief ISP driver for Parrot
  *
@@ -34,10 +43,51 @@ class ISP {
     struct statistics_t {
         bool done;                      ///< When we got valid measurement
         bool error;                     ///< When we received an error
-        std::vector<uint32_t> awb_sum;  ///< per channel sum of the pixels (YUV channels)
+        uint32_t awb_sum[3];            ///< per channel sum of the pixels (YUV channels)
         uint32_t nb_y;                  ///< Amount of valid Y pixels used in the sum
         uint32_t nb_grey;               ///< Amount of grey pixels (counted with the threshold)
-        std::vector<uint32_t> hist_y;   ///< Histogram of the Y values
+        uint32_t hist_y[256];           ///< Histogram of the Y values
+    };
+
+    /**
+     * Bayer statistics of a single window
+     *
+     * The register map only describes the configuration of the Bayer statistics, not the frame
+     * they are written to. This window layout and the row stride of BAYERSTATS_STATX windows are
+     * assumed, modelled by ISPRegistersMemory::measureBayerStatistics and not yet verified
+     * against a statistics frame captured from the hardware.
+     */
+    struct bayer_window_t {
+        uint32_t sum_r;                 ///< Sum of the red pixels
+        uint32_t sum_g;                 ///< Sum of the green pixels (both green channels)
+        uint32_t sum_b;                 ///< Sum of the blue pixels
+        uint32_t saturated;             ///< Amount of pixels above the saturation threshold
+    };
+
+    /** Bayer statistics outputs */
+    struct bayer_statistics_t {
+        uint8_t windows_x;              ///< Amount of valid windows in the horizontal direction
+        uint8_t windows_y;              ///< Amount of valid windows in the vertical direction
+        uint64_t sum_r;                 ///< Sum of the red pixels of all windows
+        uint64_t sum_g;                 ///< Sum of the green pixels of all windows
+        uint64_t sum_b;                 ///< Sum of the blue pixels of all windows
+        uint32_t saturated;             ///< Amount of saturated pixels of all windows
+        struct bayer_window_t windows[BAYERSTATS_STATY][BAYERSTATS_STATX];  ///< The windows row by row
+    };
+
+    /** Dead pixel list entry */
+    struct dead_pixel_t {
+        uint16_t x;                     ///< The x coordinate in sensor pixels from the capture window
+        uint16_t y;                     ///< The y coordinate in sensor pixels from the capture window
+        uint8_t op_code;                ///< The correction operation of the hardware list
+    };
+
+    /** Register access counters */
+    struct io_statistics_t {
+        uint64_t writes;                ///< Amount of 32 bit register writes
+        uint64_t reads;                 ///< Amount of 32 bit register reads
+        uint64_t skipped;               ///< Amount of register writes skipped because the value didn't change
+        uint32_t commits;               ///< Amount of committed batches
     };
 
   private:
@@ -47,16 +97,48 @@ class ISP {
         ISP_NODE_NR,
     };
 
-    int           devmem;               ///< Device memory pointer
-    unsigned long avi_base;             ///< Base address
-    unsigned      offsets[ISP_NODE_NR]; ///< Register offsets from base
+    /** Shadow of the register values of a single node */
+    struct shadow_t {
+        std::vector<uint32_t> words;    ///< The register values as written (or queued to be written)
+        std::vector<bool> dirty;        ///< Words which still need to be written to the hardware
+        uint32_t dirty_first;           ///< First dirty word (UINT32_MAX when clean)
+        uint32_t dirty_last;            ///< One past the last dirty word
+        bool valid;                     ///< Whether the hardware matches the shadow
+        bool queued;                    ///< Whether the node is in the list of dirty nodes
+    };
+
+    ISPRegisters::Ptr registers;        ///< The register file
+    uint32_t offsets[ISP_NODE_NR];      ///< Register addresses of all nodes from the AVI base
+
+    struct shadow_t shadow[ISP_NODE_NR];    ///< Shadow registers of all nodes
+    std::vector<uint8_t> dirty_nodes;       ///< Nodes with dirty words in the order they were changed
+    uint16_t batch_depth;                   ///< Amount of nested batches (writes are only queued when non zero)
+    struct io_statistics_t io_stats;        ///< Register access counters
+    std::mutex io_mutex;                    ///< Protects the register file and the counters
+
+    std::thread stats_thread;               ///< The statistics harvesting thread
+    std::atomic<bool> stats_running;        ///< Whether the statistics thread should keep running
+    uint32_t stats_poll_us;                 ///< Polling period of the statistics thread in microseconds
+    std::mutex stats_mutex;                 ///< Protects the harvested statistics
+    std::condition_variable stats_cond;     ///< Wakes up the statistics thread when stopping
+    struct statistics_t stats_latest;       ///< The latest harvested statistics
+    bool stats_fresh;                       ///< Whether the latest statistics were not taken yet
 
     /** ISP registers and the values */
     struct avi_isp_registers {
         struct avi_isp_vlformat_32to40_regs vlformat_32to40;    ///< 32 bit to 40 bit converter registers
         struct avi_isp_chain_bayer_inter_regs bayer_inter;      ///< Bayer chain registers
         struct avi_isp_pedestal_regs pedestal;                  ///< Pedestal registers
+        struct avi_isp_green_imbalance_regs grim;               ///< Green imbalance registers
+        struct avi_isp_green_imbalance_green_red_coeff_mem_regs grim_gr;    ///< Green imbalance green-red coefficients
+        struct avi_isp_green_imbalance_green_blue_coeff_mem_regs grim_gb;   ///< Green imbalance green-blue coefficients
+        struct avi_isp_dead_pixel_correction_regs dpc;          ///< Dead pixel correction registers
+        struct avi_isp_dead_pixel_correction_list_mem_regs dpc_list;        ///< Dead pixel correction list
         struct avi_isp_denoising_regs denoising;                ///< Denoising registers
+        struct avi_isp_lens_shading_correction_regs lsc;        ///< Lens shading correction registers
+        struct avi_isp_lens_shading_correction_red_coeff_mem_regs lsc_red;      ///< Lens shading correction red coefficients
+        struct avi_isp_lens_shading_correction_green_coeff_mem_regs lsc_green;  ///< Lens shading correction green coefficients
+        struct avi_isp_lens_shading_correction_blue_coeff_mem_regs lsc_blue;    ///< Lens shading correction blue coefficients
         struct avi_isp_bayer_regs bayer;                        ///< Debayering registers
         struct avi_isp_color_correction_regs color_correction;  ///< Color correction registers
         struct avi_isp_vlformat_40to32_regs vlformat_40to32;    ///< 40 bit to 32 bit converver registers
@@ -67,6 +149,7 @@ class ISP {
         struct avi_isp_chroma_regs chroma;                      ///< Chroma registers
         struct avi_isp_chain_yuv_inter_regs yuv_inter;          ///< YUV chain registers
         struct avi_isp_statistics_yuv_regs yuv_stats;           ///< YUV statistics registers
+        struct avi_isp_statistics_bayer_regs bayer_stats;       ///< Bayer statistics registers
     };
     struct avi_isp_registers reg;   ///< ISP register values
 
@@ -90,11 +173,31 @@ class ISP {
         uint16_t pedestal_gr;   ///< Pedestal value for the Green-Red channel
         uint16_t pedestal_b;    ///< Pedestal value for the Blue channel
 
+        // Green imbalance
+        uint16_t grim_cell_w;           ///< Green imbalance grid cell width in pixels
+        uint16_t grim_cell_h;           ///< Green imbalance grid cell height in pixels
+        std::vector<uint8_t> grim_gr;   ///< Green imbalance green-red coefficients of the grid
+        std::vector<uint8_t> grim_gb;   ///< Green imbalance green-blue coefficients of the grid
+
+        // Dead pixel correction
+        std::vector<struct dead_pixel_t> dpc_list;  ///< Dead pixel correction list of known defects
+        bool dpc_auto;                  ///< Dead pixel correction automatic detection enabling
+        uint16_t dpc_threshold;         ///< Dead pixel correction automatic detection threshold
+
         // Denoising
         std::vector<uint8_t> denoise_red;   ///< Denoising Red channel vector
         std::vector<uint8_t> denoise_green; ///< Denoising Green channel vector
         std::vector<uint8_t> denoise_blue;  ///< Denoising Blue channel vector
 
+        // Lens shading correction
+        uint16_t lsc_cell_w;            ///< Lens shading correction grid cell width in pixels
+        uint16_t lsc_cell_h;            ///< Lens shading correction grid cell height in pixels
+        std::vector<uint8_t> lsc_red;   ///< Lens shading correction red coefficients of the grid
+        std::vector<uint8_t> lsc_green; ///< Lens shading correction green coefficients of the grid
+        std::vector<uint8_t> lsc_blue;  ///< Lens shading correction blue coefficients of the grid
+        std::vector<uint16_t> lsc_threshold;    ///< Lens shading correction per channel threshold
+        std::vector<uint16_t> lsc_gain;         ///< Lens shading correction per channel gain
+
         // Demosaicking
         uint16_t demos_threshold_low;   ///< Demosaicking lower threshold
         uint16_t demos_threshold_high;  ///< Demosaicking upper threshold
@@ -136,12 +239,30 @@ class ISP {
         uint32_t stat_radius;   ///< YUV statistics circle radius in pixels (sensor pixels, without binning etc.)
         std::vector<uint8_t> stat_incr_log2;    ///< YUV statistics increment in x and y direction (should be the same as sensor binning)
         uint8_t stat_awb_threshold;             ///< YUV AWB threshold for |U| + |V| < threshod x V (for the number of grey pixels)
+
+        // Bayer Statistics
+        uint32_t bstat_left;        ///< Bayer statistics window left offset in pixels (sensor pixels from capture window)
+        uint32_t bstat_top;         ///< Bayer statistics window top offset in pixels (sensor pixels from capture window)
+        uint32_t bstat_width;       ///< Bayer statistics window width in pixels (sensor pixels, thus without binning etc.)
+        uint32_t bstat_height;      ///< Bayer statistics window height in pixels (sensor pixels, thus without binning etc.)
+        uint8_t bstat_windows_x;    ///< Bayer statistics amount of windows in the horizontal direction
+        uint8_t bstat_windows_y;    ///< Bayer statistics amount of windows in the vertical direction
+        uint32_t bstat_center_x;    ///< Bayer statistics circle center x position in pixels (sensor pixels from full sensor size)
+        uint32_t bstat_center_y;    ///< Bayer statistics circle center y position in pixels (sensor pixels from full sensor size)
+        uint32_t bstat_radius;      ///< Bayer statistics circle radius in pixels (sensor pixels, without binning etc.)
+        std::vector<uint8_t> bstat_incr_log2;   ///< Bayer statistics increment in x and y direction
+        uint16_t bstat_sat_threshold;           ///< Bayer statistics threshold above which pixels are saturated (10 bit)
     };
     struct avi_isp_config config;   ///< ISP configuration values
 
     /* Register access functions */
-    void memcpy_to_registers(unsigned long addr, const void *reg_base, size_t s);
-    void memcpy_from_registers(void *reg_base, unsigned long addr, size_t s);
+    void memcpy_to_registers(uint32_t addr, const void *reg_base, size_t s);
+    void memcpy_from_registers(void *reg_base, uint32_t addr, size_t s);
+    void writeRegisters(uint8_t node, const void *regs, size_t s);
+    void markRegister(uint8_t node, uint32_t offset);
+    void flushRegisters(uint8_t node);
+    void setOffsets(const struct avi_isp_offsets &off);
+    void loadDefaults(void);
     AVI_DEFINE_NODE(EXPAND_AS_PROTOTYPE); ///< Expand all ISP register functions
 
     /* Internal conversion functions */
@@ -151,7 +272,10 @@ class ISP {
     /* Internal setting functions */
     void sendBayerChain(void);
     void sendPedestal(void);
+    void sendGreenImbalance(void);
+    void sendDeadPixelCorrection(void);
     void sendDenoising(void);
+    void sendLensShading(void);
     void sendDemosaicking(void);
     void sendColorCorrection(void);
     void sendGammaCorrector(void);
@@ -159,24 +283,49 @@ class ISP {
     void sendColorSpaceConversion(void);
     void sendYUVChain(void);
     void sendYUVStatistics(bool request = false, bool clear = false);
+    void statisticsLoop(void);
+    void sendBayerStatistics(void);
 
   public:
     ISP(void);
+    ~ISP(void);
 
     void configure(int fd);
+    void configure(ISPRegisters::Ptr registers);
+    bool isConfigured(void);
     void reset(void);
+    void sendConfiguration(void);
+
+    /* Register shadowing */
+    void beginBatch(void);
+    void commit(void);
+    void invalidateRegisters(void);
+    struct io_statistics_t getIOStatistics(void);
 
     /* Usefull function access */
     void requestYUVStatistics(bool clear = true);
+    bool getYUVStatistics(struct statistics_t &stats);
     struct statistics_t getYUVStatistics(void);
 
+    /* Asynchronous statistics */
+    void startStatisticsThread(uint32_t poll_us = 2000);
+    void stopStatisticsThread(void);
+    bool getLatestYUVStatistics(struct statistics_t &stats);
+
+    /* Bayer statistics */
+    void clearBayerStatistics(void);
+    bool getBayerStatistics(Image::Ptr frame, struct bayer_statistics_t &stats);
+
     /* Configuration functions */
     void setResolution(uint32_t width, uint32_t height);
     void setCrop(uint32_t left, uint32_t top, uint32_t width, uint32_t height);
     void setBayerChain(bool ped, bool grim, bool rip, bool denoise, bool lsc, bool ca, bool demos, bool conv);
     void setPedestal(uint16_t val_r, uint16_t val_gb, uint16_t val_gr, uint16_t val_b);
     void setPedestal(uint16_t val);
+    void setGreenImbalance(uint16_t cell_w, uint16_t cell_h, std::vector<uint8_t> &gr_coeffs, std::vector<uint8_t> &gb_coeffs);
+    void setDeadPixelCorrection(std::vector<struct dead_pixel_t> &list, bool auto_detection = false, uint16_t threshold = 0);
     void setDenoising(std::vector<uint8_t> &red, std::vector<uint8_t> &green, std::vector<uint8_t> &blue);
+    void setLensShading(uint16_t cell_w, uint16_t cell_h, std::vector<uint8_t> &r_coeffs, std::vector<uint8_t> &g_coeffs, std::vector<uint8_t> &b_coeffs, std::vector<uint16_t> &threshold, std::vector<uint16_t> &gain);
     void setDemosaicking(uint16_t low, uint16_t high);
     void setColorCorrection(std::vector<std::vector<float>> &matrix, std::vector<uint32_t> &offin, std::vector<uint32_t> &offout, std::vector<uint32_t> &clipmin, std::vector<uint32_t> &clipmax);
     void setGammaCorrector(bool enable, bool palette, bool bit10);
@@ -184,6 +333,7 @@ class ISP {
     void setColorSpaceConversion(std::vector<std::vector<float>> &matrix, std::vector<uint32_t> &offin, std::vector<uint32_t> &offout, std::vector<uint32_t> &clipmin, std::vector<uint32_t> &clipmax);
     void setYUVChain(bool ee_crf, bool i3d_lut, bool drop);
     void setStatisticsYUV(uint32_t left, uint32_t top, uint32_t width, uint32_t height, uint32_t center_x, uint32_t center_y, uint32_t radius, std::vector<uint8_t> &incr_log2, uint16_t awb_threshold = 33);
+    void setStatisticsBayer(uint32_t left, uint32_t top, uint32_t width, uint32_t height, uint8_t windows_x, uint8_t windows_y, uint32_t center_x, uint32_t center_y, uint32_t radius, std::vector<uint8_t> &incr_log2, uint16_t sat_threshold = 1000);
 };
 
 #endif /* DRIVERS_ISP_H_ */
@@ -0,0 +1,43 @@
+/*
+ * This file is part of the TUV library (https://github.com/tudelft/tudelft_vision).
+ * Copyright (c) 2016 Freek van Tienen <freek.v.tienen@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DRIVERS_ISP_REGISTERS_H_
+#define DRIVERS_ISP_REGISTERS_H_
+
+#include <tuv/drivers/isp/reg_avi.h>
+
+#include <memory>
+
+/**
+ * @brief Abstract ISP register file
+ *
+ * This is the register backend of the ISP driver. It gives access to the 32 bit registers of
+ * the AVI block and provides the offsets of the ISP blocks within it. All addresses are in
+ * bytes from the start of the AVI block.
+ */
+class ISPRegisters {
+  public:
+    typedef std::shared_ptr<ISPRegisters> Ptr;  ///< Shared pointer representation of the register file
+
+    virtual ~ISPRegisters(void) {}
+
+    virtual struct avi_isp_offsets getOffsets(void) = 0;
+    virtual void write(uint32_t addr, const uint32_t *words, uint32_t count) = 0;
+    virtual void read(uint32_t addr, uint32_t *words, uint32_t count) = 0;
+};
+
+#endif /* DRIVERS_ISP_REGISTERS_H_ */
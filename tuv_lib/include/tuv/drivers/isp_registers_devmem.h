@@ -0,0 +1,43 @@
+/*
+ * This file is part of the TUV library (https://github.com/tudelft/tudelft_vision).
+ * Copyright (c) 2016 Freek van Tienen <freek.v.tienen@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DRIVERS_ISP_REGISTERS_DEVMEM_H_
+#define DRIVERS_ISP_REGISTERS_DEVMEM_H_
+
+#include <tuv/drivers/isp_registers.h>
+
+/**
+ * @brief ISP registers of the hardware
+ *
+ * This maps the AVI block through /dev/mem and gets the ISP offsets from the video driver.
+ */
+class ISPRegistersDevMem: public ISPRegisters {
+  private:
+    int devmem;                     ///< Device memory file descriptor
+    volatile uint8_t *avi_base;     ///< Start of the mapped AVI block
+    struct avi_isp_offsets offsets; ///< ISP offsets from the video driver
+
+  public:
+    ISPRegistersDevMem(int fd);
+    ~ISPRegistersDevMem(void);
+
+    struct avi_isp_offsets getOffsets(void);
+    void write(uint32_t addr, const uint32_t *words, uint32_t count);
+    void read(uint32_t addr, uint32_t *words, uint32_t count);
+};
+
+#endif /* DRIVERS_ISP_REGISTERS_DEVMEM_H_ */
@@ -0,0 +1,56 @@
+/*
+ * This file is part of the TUV library (https://github.com/tudelft/tudelft_vision).
+ * Copyright (c) 2016 Freek van Tienen <freek.v.tienen@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DRIVERS_ISP_REGISTERS_MEMORY_H_
+#define DRIVERS_ISP_REGISTERS_MEMORY_H_
+
+#include <tuv/drivers/isp_registers.h>
+#include <tuv/vision/image.h>
+
+/**
+ * @brief ISP registers in memory
+ *
+ * This is a register file in anonymous memory with the same layout as the AVI block, so the
+ * ISP driver can run without the hardware. This is used to verify the register programming
+ * and measure the register traffic on a workstation. Optionally the YUV statistics block is
+ * modelled, which calculates the statistics of a source image when a measurement is requested.
+ * The Bayer statistics can be modelled by creating the statistics frame of a raw image.
+ */
+class ISPRegistersMemory: public ISPRegisters {
+  private:
+    uint8_t *data;                  ///< The register file of AVI_SIZE bytes
+    struct avi_isp_offsets offsets; ///< ISP offsets within the register file
+    Image::Ptr stats_image;         ///< Source image of the modelled YUV statistics
+
+    void measureYUVStatistics(void);
+
+  public:
+    ISPRegistersMemory(void);
+    ISPRegistersMemory(const struct avi_isp_offsets &offsets);
+    ~ISPRegistersMemory(void);
+
+    struct avi_isp_offsets getOffsets(void);
+    void write(uint32_t addr, const uint32_t *words, uint32_t count);
+    void read(uint32_t addr, uint32_t *words, uint32_t count);
+
+    /* Simulation */
+    void *getData(void);
+    void setStatisticsImage(Image::Ptr img);
+    Image::Ptr measureBayerStatistics(Image::Ptr raw);
+};
+
+#endif /* DRIVERS_ISP_REGISTERS_MEMORY_H_ */
@@ -121,6 +121,7 @@ class MT9F002 {
 
   public:
     MT9F002(I2CBus *i2c_bus, enum interfaces interface, struct pll_config_t pll_config);
+    void initialize(void);
 
     /* Set size, crop and binning */
     void setOutput(uint16_t width, uint16_t height);
@@ -40,6 +40,7 @@ class MT9V117 {
 
   public:
     MT9V117(I2CBus *i2c_bus);
+    void initialize(void);
 
 };
 
@@ -79,6 +79,8 @@ class EncoderH264: public ImagePtr::Handler {
     /* Encoding information */
     uint32_t frame_cnt;                 ///< Frame counter
     uint32_t intra_cnt;                 ///< Intra frame counter for determining when intra frame must be generated
+    uint64_t first_timestamp;           ///< Capture time of the first frame in microseconds (0 when unknown)
+    uint64_t time_ticks;                ///< Frame periods from the first frame to the previous frame
     std::vector<uint8_t> sps_nalu;      ///< SPS NALU
     std::vector<uint8_t> pps_nalu;      ///< PPS NALU
     EWLLinearMem_t sps_pps_nalu;        ///< SPS + PPS NALU buffer
@@ -96,6 +98,7 @@ class EncoderH264: public ImagePtr::Handler {
     H264EncPictureType getEncPictureType(Image::pixel_formats format);
     H264EncPictureRotation getEncPictureRotation(enum rotation_t rot);
     struct output_buf_t *getFreeBuffer(void);
+    uint32_t getTimeIncrement(Image::Ptr img);
 
   public:
     EncoderH264(uint32_t width, uint32_t height, float frame_rate = 15, uint32_t bit_rate = 2000000);
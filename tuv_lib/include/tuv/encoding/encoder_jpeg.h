@@ -19,6 +19,7 @@
 #define ENCODING_ENCODER_JPEG_H_
 
 #include <tuv/vision/image_buffer.h>
+#include <tuv/vision/image_buffer_pool.h>
 #include <cstddef>
 #include <cstdint>
 #include <stdio.h>
@@ -29,20 +30,27 @@
  * @brief JPEG encoder based on libjpeg
  *
  * This is a simple JPEG encoder and uses the libjpeg for encoding. It needs an YUV422 image as input
- * and will convert this into a JPEG buffered image. This encoder will create a new image based on a buffer.
+ * and will convert this into a JPEG buffered image. The output is written directly into a recycled buffer of
+ * an image buffer pool, so no memory is allocated per frame. Only when the output doesn't fit in a pool buffer
+ * a new image based on a buffer is created.
  */
 class EncoderJPEG {
   private:
-    /** New jpeg destination memory based on uint8_t vector */
+    /** New jpeg destination memory based on a pool buffer with an uint8_t vector as overflow */
     typedef struct _jpeg_destination_mem_mgr {
         jpeg_destination_mgr mgr;   ///< Manager which holds the function points
-        std::vector<uint8_t> data;  ///< The byte data
+        uint8_t *buf;               ///< The pool buffer
+        uint32_t buf_size;          ///< The size of the pool buffer
+        uint32_t size;              ///< The amount of bytes written
+        bool overflow;              ///< Whether the output didn't fit in the pool buffer
+        std::vector<uint8_t> data;  ///< The overflow byte data
     } jpeg_destination_mem_mgr;
 
     struct jpeg_compress_struct cinfo;      ///< Compression information
     struct jpeg_error_mgr jerr;             ///< Error function manager
     _jpeg_destination_mem_mgr dmgr;         ///< Destination manager
     uint8_t quality;                        ///< The output quality of the JPEG encoding
+    ImageBufferPool::Ptr pool;              ///< Pool with the output buffers
 
     static void initDestination(j_compress_ptr cinfo);
     static boolean emptyOutputBuffer(j_compress_ptr cinfo);
@@ -54,6 +62,7 @@ class EncoderJPEG {
     Image::Ptr encode(Image::Ptr img);
     void setQuality(uint8_t quality);
     uint8_t getQuality(void);
+    ImageBufferPool::Ptr getPool(void);
 };
 
 #endif /* ENCODING_ENCODER_JPEG_H_ */
@@ -43,10 +43,11 @@ class EncoderRTP {
     void createJPEGHeader(uint32_t offset, uint8_t quality, uint8_t format, uint32_t width, uint32_t height);
     void createH264FragmentAHeader(bool start, bool end, uint8_t nal_hdr);
     void appendBytes(uint8_t *bytes, uint32_t length);
+    uint32_t getTimestamp(Image::Ptr img);
 
     /* Different encodings */
-    void encodeJPEG(uint8_t *img_buf, uint32_t img_size, uint32_t width, uint32_t height);
-    void encodeH264(uint8_t *img_buf, uint32_t img_size);
+    void encodeJPEG(uint8_t *img_buf, uint32_t img_size, uint32_t width, uint32_t height, uint32_t timestamp);
+    void encodeH264(uint8_t *img_buf, uint32_t img_size, uint32_t timestamp);
 
   public:
     EncoderRTP(UDPSocket::Ptr socket);
@@ -1,7 +1,11 @@
 #include <tuv/cam/cam.h>
 #include <tuv/cam/cam_bebop_bottom.h>
 #include <tuv/cam/cam_bebop_front.h>
+#include <tuv/cam/cam_file.h>
 #include <tuv/cam/cam_linux.h>
+#include <tuv/cam/cam_metrics.h>
+#include <tuv/cam/cam_multiplexer.h>
+#include <tuv/cam/cam_synthetic.h>
 #include <tuv/drivers/clogger.h>
 #include <tuv/drivers/i2cbus.h>
 #include <tuv/drivers/isp.h>
@@ -25,6 +29,9 @@
 #include <tuv/drivers/isp/regmap/avi_isp_statistics_yuv.h>
 #include <tuv/drivers/isp/regmap/avi_isp_vlformat_32to40.h>
 #include <tuv/drivers/isp/regmap/avi_isp_vlformat_40to32.h>
+#include <tuv/drivers/isp_registers.h>
+#include <tuv/drivers/isp_registers_devmem.h>
+#include <tuv/drivers/isp_registers_memory.h>
 #include <tuv/drivers/mt9f002.h>
 #include <tuv/drivers/mt9f002_regs.h>
 #include <tuv/drivers/mt9v117.h>
@@ -41,6 +48,14 @@
 #include <tuv/targets/bebop.h>
 #include <tuv/targets/linux.h>
 #include <tuv/targets/target.h>
+#include <tuv/vision/block_matcher.h>
+#include <tuv/vision/edge_flow.h>
+#include <tuv/vision/fast_detector.h>
 #include <tuv/vision/image.h>
 #include <tuv/vision/image_buffer.h>
+#include <tuv/vision/image_buffer_pool.h>
 #include <tuv/vision/image_ptr.h>
+#include <tuv/vision/image_view.h>
+#include <tuv/vision/lucas_kanade.h>
+#include <tuv/vision/pyramid.h>
+#include <tuv/vision/simd.h>
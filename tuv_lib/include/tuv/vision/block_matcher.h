@@ -0,0 +1,109 @@
+/*
+ * This file is part of the TUV library (https://github.com/tudelft/tudelft_vision).
+ * Copyright (c) 2016 Freek van Tienen <freek.v.tienen@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef VISION_BLOCK_MATCHER_H_
+#define VISION_BLOCK_MATCHER_H_
+
+#include <tuv/vision/image.h>
+#include <stdint.h>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+/**
+ * @brief Block-matching motion estimator
+ *
+ * This divides the previous frame into square blocks and searches every block in the current
+ * frame with a diamond or hexagon pattern, starting from the best of the zero vector, the
+ * vector of the left block and the vector of the same block in the previous field. The sum of
+ * absolute differences is calculated by the vectorized kernels selected by the SIMD class and
+ * the amount of search steps is bounded, so the cost per block is bounded as well. The rows of
+ * blocks are distributed over a fixed set of worker threads. Both GRAY8 and YUV422 images are
+ * supported, where only the luma is used.
+ */
+class BlockMatcher {
+  public:
+    /** The supported search patterns */
+    enum search_patterns {
+        SEARCH_DIAMOND,         ///< Large diamond steps followed by a small diamond
+        SEARCH_HEXAGON,         ///< Large hexagon steps followed by a small diamond
+    };
+
+    /** The motion vector of a block */
+    struct vector_t {
+        int8_t x;               ///< The horizontal displacement in pixels
+        int8_t y;               ///< The vertical displacement in pixels
+        uint16_t sad;           ///< The sum of absolute differences (saturated)
+    };
+
+  private:
+    uint16_t block_size;        ///< The width and height of a block in pixels
+    uint8_t range;              ///< The maximum displacement in pixels
+    enum search_patterns pattern;   ///< The search pattern
+    uint32_t cols;              ///< The amount of blocks in a row
+    uint32_t rows;              ///< The amount of blocks in a column
+
+    Image::Ptr prev_luma;       ///< Luma of a YUV422 previous frame
+    Image::Ptr cur_luma;        ///< Luma of a YUV422 current frame
+    std::vector<struct vector_t> last_field;    ///< The previous field used for prediction
+
+    /* The current job shared with the workers */
+    const uint8_t *prev_data;   ///< The luma of the previous frame
+    uint32_t prev_stride;       ///< The row stride of the previous frame
+    const uint8_t *cur_data;    ///< The luma of the current frame
+    uint32_t cur_stride;        ///< The row stride of the current frame
+    uint32_t width;             ///< The width of the frames
+    uint32_t height;            ///< The height of the frames
+    struct vector_t *field;     ///< The output field
+    std::atomic<uint32_t> next_row; ///< The next row of blocks to process
+
+    /* Worker threads */
+    std::vector<std::thread> workers;   ///< The worker threads
+    std::mutex mutex;                   ///< Protects the job generation and the busy count
+    std::condition_variable start_cond; ///< Signals the workers to start a job
+    std::condition_variable done_cond;  ///< Signals that all workers are done
+    uint32_t generation;        ///< The current job generation
+    uint32_t busy;              ///< The amount of workers still working on the job
+    bool stopping;              ///< Whether the workers should stop
+
+    /* Vectorized kernel selected at estimation */
+    uint32_t (*sad)(const uint8_t *, uint32_t, const uint8_t *, uint32_t, uint32_t, uint32_t);
+
+    void selectKernels(void);
+    void worker(void);
+    void processRows(void);
+    void matchBlock(uint32_t col, uint32_t row);
+    uint32_t blockCost(uint32_t x, uint32_t y, int32_t dx, int32_t dy);
+    const uint8_t *getLuma(Image::Ptr img, Image::Ptr &luma, uint32_t &stride);
+
+  public:
+    BlockMatcher(uint16_t block_size = 16, uint8_t range = 16, enum search_patterns pattern = SEARCH_DIAMOND, uint8_t threads = 1);
+    ~BlockMatcher(void);
+
+    /* Estimation */
+    void estimate(Image::Ptr prev, Image::Ptr cur, std::vector<struct vector_t> &result);
+
+    /* Information */
+    uint32_t getCols(void);
+    uint32_t getRows(void);
+    uint16_t getBlockSize(void);
+    uint8_t getThreads(void);
+};
+
+#endif /* VISION_BLOCK_MATCHER_H_ */
@@ -0,0 +1,85 @@
+/*
+ * This file is part of the TUV library (https://github.com/tudelft/tudelft_vision).
+ * Copyright (c) 2016 Freek van Tienen <freek.v.tienen@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef VISION_EDGE_FLOW_H_
+#define VISION_EDGE_FLOW_H_
+
+#include <tuv/vision/image.h>
+#include <stdint.h>
+#include <vector>
+
+/**
+ * @brief Edge histogram optical flow
+ *
+ * This is a very cheap dense optical flow estimate based on EdgeFlow. The absolute gradients
+ * of the image are summed along the columns and along the rows into two edge histograms. Every
+ * histogram position is matched with the histogram of the previous frame by the sum of absolute
+ * differences over a window, and a line is fitted through the displacements. The offset of the
+ * line is the translation at the image center and the slope is the divergence along the axis.
+ * Both GRAY8 and YUV422 images are supported, where only the luma is used. All buffers are
+ * allocated when the image geometry changes, so calculating the flow doesn't allocate memory.
+ */
+class EdgeFlow {
+  public:
+    /** The flow estimate of a frame */
+    struct result_t {
+        float flow_x;           ///< Horizontal translation at the image center (pixels per frame)
+        float flow_y;           ///< Vertical translation at the image center (pixels per frame)
+        float div_x;            ///< Change of the horizontal flow per pixel (1 per frame)
+        float div_y;            ///< Change of the vertical flow per pixel (1 per frame)
+        float divergence;       ///< Divergence of the flow field (div_x + div_y)
+        float quality;          ///< Part of the histogram positions with a reliable match (0 to 1)
+    };
+
+  private:
+    uint16_t window;            ///< Half the size of the matching window in histogram positions
+    uint16_t max_disp;          ///< The maximum displacement searched in pixels
+    float min_texture;          ///< The minimum mean absolute gradient of a matching window
+    uint32_t width;             ///< The width of the previous frame
+    uint32_t height;            ///< The height of the previous frame
+    uint32_t frame_cnt;         ///< The amount of frames since the geometry changed
+
+    Image::Ptr luma;                    ///< Luma of YUV422 images
+    std::vector<uint32_t> prev_x;       ///< Horizontal histogram of the previous frame
+    std::vector<uint32_t> prev_y;       ///< Vertical histogram of the previous frame
+    std::vector<uint32_t> cur_x;        ///< Horizontal histogram of the current frame
+    std::vector<uint32_t> cur_y;        ///< Vertical histogram of the current frame
+    std::vector<uint32_t> diffs;        ///< Absolute differences for a single displacement
+    std::vector<uint32_t> costs;        ///< Window costs for every displacement and position
+
+    /* Vectorized kernel selected at calculation */
+    void (*edge_histogram)(const uint8_t *, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t *, uint32_t *);
+
+    void selectKernels(void);
+    void resize(uint32_t width, uint32_t height);
+    void fitHistograms(const std::vector<uint32_t> &prev, const std::vector<uint32_t> &cur, uint32_t length, uint32_t depth,
+                       float &flow, float &slope, uint32_t &valid_cnt, uint32_t &total_cnt);
+
+  public:
+    EdgeFlow(uint16_t window = 6, uint16_t max_disp = 8);
+
+    /* Calculation */
+    bool calculate(Image::Ptr img, struct result_t &result);
+    void reset(void);
+
+    /* Settings */
+    void setMinTexture(float min_texture);
+    uint16_t getWindow(void);
+    uint16_t getMaxDisplacement(void);
+};
+
+#endif /* VISION_EDGE_FLOW_H_ */
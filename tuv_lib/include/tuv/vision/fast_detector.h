@@ -0,0 +1,99 @@
+/*
+ * This file is part of the TUV library (https://github.com/tudelft/tudelft_vision).
+ * Copyright (c) 2016 Freek van Tienen <freek.v.tienen@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef VISION_FAST_DETECTOR_H_
+#define VISION_FAST_DETECTOR_H_
+
+#include <tuv/vision/image.h>
+#include <stdint.h>
+#include <vector>
+
+/**
+ * @brief FAST corner detector
+ *
+ * This detects FAST-9 or FAST-12 corners on GRAY8 images or the luma of YUV422 images. The
+ * pixel ring test is done by the vectorized kernels selected by the SIMD class. Corners are
+ * scored by the sum of absolute differences of the ring pixels passing the threshold and can be
+ * suppressed when a neighbour has a higher score. To spread the corners over the image, the
+ * image can be divided into a grid where every cell keeps at most a fixed amount of the
+ * strongest corners. The threshold can adapt to the amount of detected corners to reach a
+ * target amount. The buffers are only reallocated when the image geometry changes, so
+ * detection doesn't allocate any memory once the output vector has reached its capacity.
+ */
+class FastDetector {
+  public:
+    /** The supported FAST variants */
+    enum fast_types {
+        FAST_9,                 ///< At least 9 contiguous pixels of the ring
+        FAST_12,                ///< At least 12 contiguous pixels of the ring
+    };
+
+    /** A detected corner */
+    struct corner_t {
+        uint16_t x;             ///< The horizontal position in pixels
+        uint16_t y;             ///< The vertical position in pixels
+        uint16_t score;         ///< The corner score (higher is stronger)
+    };
+
+  private:
+    enum fast_types type;       ///< The FAST variant
+    uint8_t threshold;          ///< The current threshold
+    bool non_max_suppression;   ///< Whether to suppress corners with a stronger neighbour
+    uint32_t max_corners;       ///< The maximum amount of corners returned (0 is unlimited)
+
+    uint16_t cell_width;        ///< The width of a grid cell in pixels (0 disables the grid)
+    uint16_t cell_height;       ///< The height of a grid cell in pixels
+    uint16_t cell_cap;          ///< The maximum amount of corners per grid cell
+
+    uint32_t target;            ///< The target amount of corners (0 disables adapting)
+    uint8_t min_threshold;      ///< The minimum adaptive threshold
+    uint8_t max_threshold;      ///< The maximum adaptive threshold
+
+    uint32_t width;             ///< The width of the buffers
+    uint32_t height;            ///< The height of the buffers
+    Image::Ptr luma;                    ///< Luma of YUV422 images
+    std::vector<uint16_t> row_corners;  ///< Positions of the corners in the last 3 rows
+    std::vector<uint16_t> row_scores;   ///< Scores of the last 3 rows (0 is no corner)
+    std::vector<struct corner_t> candidates;    ///< All corners before the grid and limits
+    std::vector<uint16_t> cell_counts;  ///< Amount of corners in every grid cell
+
+    /* Vectorized kernel selected at detection */
+    uint32_t (*fast_row)(const uint8_t *, uint32_t, uint32_t, uint32_t, uint8_t, uint8_t, uint16_t *);
+
+    void selectKernels(void);
+    void resize(uint32_t width, uint32_t height);
+    uint16_t score(const uint8_t *p, const int32_t *offsets);
+    void detectCandidates(const uint8_t *src, uint32_t stride);
+    void adaptThreshold(void);
+
+  public:
+    FastDetector(enum fast_types type = FAST_9, uint8_t threshold = 20);
+
+    /* Detection */
+    void detect(Image::Ptr img, std::vector<struct corner_t> &corners);
+
+    /* Settings */
+    void setThreshold(uint8_t threshold);
+    void setNonMaxSuppression(bool enable);
+    void setMaxCorners(uint32_t max_corners);
+    void setGrid(uint16_t cell_width, uint16_t cell_height, uint16_t cell_cap);
+    void setTarget(uint32_t target, uint8_t min_threshold = 5, uint8_t max_threshold = 100);
+    uint8_t getThreshold(void);
+    uint32_t getCandidateCount(void);
+};
+
+#endif /* VISION_FAST_DETECTOR_H_ */
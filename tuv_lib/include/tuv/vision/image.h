@@ -36,6 +36,23 @@ class Image {
         FMT_YUYV,       ///< YUYV with 2 bytes per pixel
         FMT_JPEG,       ///< A JPEG encoded image
         FMT_H264,       ///< A H264 encoded image
+        FMT_GRAY8,      ///< Only luma with 1 byte per pixel
+        FMT_NV12,       ///< YUV420 with a luma plane followed by an interleaved UV plane
+        FMT_I420,       ///< YUV420 with a luma plane followed by a U and a V plane
+        FMT_RGB24,      ///< RGB with 3 bytes per pixel
+        FMT_BGR24,      ///< BGR with 3 bytes per pixel
+    };
+
+    /** The supported downsample methods */
+    enum downsample_methods {
+        DOWNSAMPLE_POINT,   ///< Take the top left pixel of every block (fastest)
+        DOWNSAMPLE_BOX,     ///< Average all pixels of every block (area averaging)
+    };
+
+    /** The supported blur methods */
+    enum blur_methods {
+        BLUR_BOX,           ///< Average all pixels in the window (sliding window sums)
+        BLUR_GAUSSIAN,      ///< Gaussian weighted average of the pixels in the window
     };
 
     typedef std::shared_ptr<Image> Ptr; ///< Shared pointer representation of the image
@@ -46,9 +63,20 @@ class Image {
     enum pixel_formats pixel_format;	///< The image pixel format
     void *data;							///< The image data
     uint32_t size;                      ///< The image size in bytes
+    uint32_t stride;                    ///< The row stride in bytes (of the luma plane for planar images, 0 for encoded images)
+    uint64_t timestamp;                 ///< The capture time in microseconds on CLOCK_MONOTONIC (0 when unknown)
+    uint32_t sequence;                  ///< The capture sequence number
+    uint32_t dropped;                   ///< The amount of frames dropped right before this frame
 
     Image(enum pixel_formats pixel_format, uint32_t width, uint32_t height, uint32_t size = 0);
 
+    static void downsampleYUV422Point(const uint8_t *src, uint32_t src_stride, uint8_t *dst, uint32_t dst_stride, uint32_t dst_width, uint32_t dst_height, uint16_t factor, bool uyvy);
+    static void convertYUV422(const uint8_t *src, uint32_t src_stride, bool uyvy, Image *output);
+    static void convertRGB24(const uint8_t *src, uint32_t src_stride, bool bgr, Image *output);
+    static void blurSeparable(const uint8_t *src, uint32_t src_stride, Image *output, uint16_t size, enum blur_methods method);
+    static void downsampleYUV422Box(const uint8_t *src, uint32_t src_stride, uint8_t *dst, uint32_t dst_stride, uint32_t dst_width, uint32_t dst_height, uint16_t factor, bool uyvy);
+    static void downsampleGray(const uint8_t *src, uint32_t src_stride, uint8_t *dst, uint32_t dst_stride, uint32_t dst_width, uint32_t dst_height, uint16_t factor, enum downsample_methods method);
+
   public:
 
     /* Get usefull information */
@@ -57,10 +85,26 @@ class Image {
     uint32_t getWidth(void);
     uint32_t getHeight(void);
     uint16_t getPixelSize(void);
+    static uint16_t getPixelSize(enum pixel_formats pixel_format);
+    static uint32_t getBufferSize(enum pixel_formats pixel_format, uint32_t width, uint32_t height);
+    static bool isPlanar(enum pixel_formats pixel_format);
     uint32_t getSize(void);
+    uint32_t getStride(void);
+    bool isContiguous(void);
+
+    /* Capture information */
+    uint64_t getTimestamp(void);
+    uint32_t getSequence(void);
+    uint32_t getDropped(void);
+    void setCaptureInfo(uint64_t timestamp, uint32_t sequence, uint32_t dropped);
+    void copyCaptureInfo(Ptr src);
 
     /* Operations on images */
-    void downsample(uint16_t downsample);
+    void downsample(uint16_t downsample, enum downsample_methods method = DOWNSAMPLE_POINT);
+    void downsample(Ptr output, uint16_t downsample, enum downsample_methods method = DOWNSAMPLE_POINT);
+    void convert(Ptr output);
+    void blur(uint16_t size, enum blur_methods method = BLUR_BOX);
+    void blur(Ptr output, uint16_t size, enum blur_methods method = BLUR_BOX);
 };
 
 #endif /* VISION_IMAGE_H_ */
@@ -0,0 +1,144 @@
+/*
+ * This file is part of the TUV library (https://github.com/tudelft/tudelft_vision).
+ * Copyright (c) 2016 Freek van Tienen <freek.v.tienen@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef VISION_IMAGE_BUFFER_POOL_H_
+#define VISION_IMAGE_BUFFER_POOL_H_
+
+#include <tuv/vision/image_ptr.h>
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+
+#define IMAGE_BUFFER_POOL_ALIGN 64      ///< Alignment of the pool buffers in bytes
+#define IMAGE_BUFFER_POOL_SLOT 256      ///< Size of the preallocated image object slot in bytes
+
+/**
+ * @brief Pool of recycled image buffers
+ *
+ * This pool hands out images of a fixed geometry which are backed by preallocated and aligned
+ * buffers. When the last pointer to an image is dropped, the buffer is returned to the pool
+ * through the ImagePtr handler. The image object itself is also constructed in memory owned
+ * by the buffer, so getting an image from the pool doesn't allocate any memory once enough
+ * buffers are created. When no free buffer is available, a new one is created and counted as
+ * a miss. Every image keeps a reference to the pool, so the owner can replace or destroy its
+ * pool while images are still in use. Therefore the pool must be created as shared pointer.
+ */
+class ImageBufferPool: public ImagePtr::Handler, public std::enable_shared_from_this<ImageBufferPool> {
+  public:
+    /** Pool statistics */
+    struct statistics_t {
+        uint32_t buffers;               ///< Amount of created buffers
+        uint32_t in_use;                ///< Amount of buffers currently in use
+        uint32_t high_water;            ///< Maximum amount of buffers in use at the same time
+        uint32_t requests;              ///< Amount of buffer requests
+        uint32_t misses;                ///< Amount of requests which needed a new buffer
+        uint32_t heap_allocations;      ///< Amount of image objects which didn't fit the slot
+    };
+
+    typedef std::shared_ptr<ImageBufferPool> Ptr;  ///< Shared pointer representation of the pool
+
+  private:
+    /** Preallocated pool buffer */
+    struct buffer_t {
+        uint16_t index;                 ///< Index of the buffer (identification for freeing)
+        void *data;                     ///< The aligned image data
+        bool is_free;                   ///< Whether the buffer is free
+        std::atomic<bool> slot_used;    ///< Whether the image object slot is used
+        alignas(std::max_align_t) uint8_t slot[IMAGE_BUFFER_POOL_SLOT];  ///< Image object memory
+    };
+
+    /**
+     * @brief Allocator for the image object of a buffer
+     *
+     * This is used to construct the shared image object (including the reference counters)
+     * inside the slot of the pool buffer. When the slot is still in use or too small, it falls
+     * back to the heap. The allocator holds a reference to the pool, which keeps the pool (and
+     * the slot) alive until the image object is deallocated.
+     */
+    template <typename T>
+    struct SlotAllocator {
+        typedef T value_type;           ///< Allocated type
+
+        std::shared_ptr<ImageBufferPool> pool;  ///< Pool owning the buffer
+        struct buffer_t *buffer;        ///< Buffer containing the slot
+        std::atomic<uint32_t> *heap_cnt;    ///< Counter for heap fallbacks
+
+        SlotAllocator(std::shared_ptr<ImageBufferPool> pool, struct buffer_t *buffer, std::atomic<uint32_t> *heap_cnt): pool(pool), buffer(buffer), heap_cnt(heap_cnt) {}
+        template <typename U>
+        SlotAllocator(const SlotAllocator<U> &other): pool(other.pool), buffer(other.buffer), heap_cnt(other.heap_cnt) {}
+
+        T *allocate(std::size_t n) {
+            if(n * sizeof(T) <= sizeof(buffer->slot) && !buffer->slot_used.exchange(true))
+                return reinterpret_cast<T *>(buffer->slot);
+
+            heap_cnt->fetch_add(1);
+            return static_cast<T *>(::operator new(n * sizeof(T)));
+        }
+
+        void deallocate(T *p, std::size_t) {
+            if(reinterpret_cast<uint8_t *>(p) == buffer->slot)
+                buffer->slot_used.store(false);
+            else
+                ::operator delete(p);
+        }
+
+        template <typename U>
+        bool operator==(const SlotAllocator<U> &other) const {
+            return buffer == other.buffer;
+        }
+        template <typename U>
+        bool operator!=(const SlotAllocator<U> &other) const {
+            return buffer != other.buffer;
+        }
+    };
+
+    enum Image::pixel_formats pixel_format; ///< The pixel format of the images
+    uint32_t width;                     ///< The width of the images in pixels
+    uint32_t height;                    ///< The height of the images in pixels
+    uint32_t buffer_size;               ///< The size of a buffer in bytes
+
+    std::mutex mutex;                   ///< Protects the buffers and statistics
+    std::deque<struct buffer_t> buffers;    ///< The buffers (deque to keep the addresses stable)
+    struct statistics_t stats;          ///< The pool statistics
+    std::atomic<uint32_t> heap_cnt;     ///< Amount of image objects allocated on the heap
+
+    struct buffer_t *createBuffer(void);
+    struct buffer_t *getFreeBuffer(void);
+
+  public:
+    ImageBufferPool(enum Image::pixel_formats pixel_format, uint32_t width, uint32_t height, uint16_t count = 2);
+    ImageBufferPool(enum Image::pixel_formats pixel_format, uint32_t width, uint32_t height, uint32_t size, uint16_t count);
+    ~ImageBufferPool(void);
+
+    /* Getting images */
+    Image::Ptr getImage(void);
+    uint16_t acquire(void);
+    void *getData(uint16_t index);
+    Image::Ptr getImage(uint16_t index, uint32_t size);
+    void freeImage(uint16_t identifier);
+
+    /* Pool information */
+    enum Image::pixel_formats getPixelFormat(void);
+    uint32_t getWidth(void);
+    uint32_t getHeight(void);
+    uint32_t getBufferSize(void);
+    struct statistics_t getStatistics(void);
+};
+
+#endif /* VISION_IMAGE_BUFFER_POOL_H_ */
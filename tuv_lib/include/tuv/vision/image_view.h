@@ -0,0 +1,45 @@
+/*
+ * This file is part of the TUV library (https://github.com/tudelft/tudelft_vision).
+ * Copyright (c) 2016 Freek van Tienen <freek.v.tienen@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef VISION_IMAGE_VIEW_H_
+#define VISION_IMAGE_VIEW_H_
+
+#include <tuv/vision/image.h>
+
+/**
+ * @brief Image based on a region of another image
+ *
+ * This is a view on a rectangular region (region of interest) of a parent image. The view
+ * doesn't copy any data, but points inside the parent buffer and uses the stride of the
+ * parent. The parent is kept alive as long as the view exists, so a view on a camera or pool
+ * image also keeps the underlying buffer. Modifying the view modifies the parent image.
+ */
+class ImageView: public Image {
+  private:
+    Image::Ptr parent;      ///< The parent image which owns the data
+    uint32_t left;          ///< Left offset in the parent in pixels
+    uint32_t top;           ///< Top offset in the parent in pixels
+
+  public:
+    ImageView(Image::Ptr parent, uint32_t left, uint32_t top, uint32_t width, uint32_t height);
+
+    Image::Ptr getParent(void);
+    uint32_t getLeft(void);
+    uint32_t getTop(void);
+};
+
+#endif /* VISION_IMAGE_VIEW_H_ */
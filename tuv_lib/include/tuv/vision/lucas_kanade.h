@@ -0,0 +1,101 @@
+/*
+ * This file is part of the TUV library (https://github.com/tudelft/tudelft_vision).
+ * Copyright (c) 2016 Freek van Tienen <freek.v.tienen@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef VISION_LUCAS_KANADE_H_
+#define VISION_LUCAS_KANADE_H_
+
+#include <tuv/vision/image.h>
+#include <tuv/vision/pyramid.h>
+#include <stdint.h>
+#include <vector>
+
+/**
+ * @brief Pyramidal Lucas-Kanade sparse optical flow
+ *
+ * This tracks points from the pyramid of the previous frame to the pyramid of the current
+ * frame, starting at the coarsest level. The patches are interpolated with fixed-point weights
+ * and the gradient and mismatch sums are calculated with the vectorized kernels selected by the
+ * SIMD class. The amount of iterations per level is bounded, so the cost per point is bounded
+ * as well. Both GRAY8 and YUV422 pyramids are supported, where only the luma is used. All
+ * buffers are allocated at construction, so tracking doesn't allocate any memory once the
+ * output vector has grown to the amount of points.
+ */
+class LucasKanade {
+  public:
+    /** The status of a tracked point */
+    enum track_statuses {
+        STATUS_TRACKED,         ///< The point is tracked successfully
+        STATUS_OUT_OF_BOUNDS,   ///< The window left the image
+        STATUS_SMALL_EIGENVALUE,    ///< The window doesn't contain enough texture
+        STATUS_LARGE_ERROR,     ///< The final error is larger then the maximum error
+    };
+
+    /** A point in the image in pixels */
+    struct point_t {
+        float x;                ///< The horizontal position
+        float y;                ///< The vertical position
+    };
+
+    /** The result of a tracked point */
+    struct flow_t {
+        struct point_t pos;     ///< The position in the previous frame
+        struct point_t flow;    ///< The displacement to the current frame
+        enum track_statuses status; ///< The tracking status
+        float error;            ///< The mean absolute luma difference of the window
+        uint8_t iterations;     ///< The total amount of iterations over all levels
+    };
+
+  private:
+    uint16_t window_size;       ///< The width and height of the window in pixels (odd)
+    uint8_t levels;             ///< The maximum amount of pyramid levels to use
+    uint8_t max_iterations;     ///< The maximum amount of iterations per level
+    float epsilon;              ///< Stop iterating when the update is smaller (in pixels)
+    float min_eigenvalue;       ///< The minimum eigenvalue of the normalized gradient matrix
+    float max_error;            ///< The maximum mean absolute error of a tracked point
+
+    std::vector<int16_t> patch;     ///< Interpolated previous window with a 1 pixel border
+    std::vector<int16_t> prev_win;  ///< Interpolated previous window
+    std::vector<int16_t> grad_x;    ///< Horizontal gradients of the previous window
+    std::vector<int16_t> grad_y;    ///< Vertical gradients of the previous window
+    std::vector<int16_t> cur_win;   ///< Interpolated current window (and the difference)
+    std::vector<Image::Ptr> prev_levels;    ///< Pyramid levels of the previous frame while tracking
+    std::vector<Image::Ptr> cur_levels;     ///< Pyramid levels of the current frame while tracking
+
+    /* Vectorized kernels selected at tracking */
+    void (*interpolate)(const uint8_t *, uint32_t, uint8_t, const int16_t *, int16_t *, uint32_t, uint32_t);
+    void (*dot2)(const int16_t *, const int16_t *, const int16_t *, uint32_t, int64_t *);
+
+    void selectKernels(void);
+    bool interpolateWindow(Image::Ptr img, float x, float y, uint16_t size, int16_t *dst);
+    void trackPoint(uint8_t level_cnt, struct flow_t &result);
+
+  public:
+    LucasKanade(uint16_t window_size = 15, uint8_t levels = 3, uint8_t max_iterations = 10);
+
+    /* Tracking */
+    void track(Pyramid &prev, Pyramid &cur, const std::vector<struct point_t> &points, std::vector<struct flow_t> &result);
+
+    /* Settings */
+    void setEpsilon(float epsilon);
+    void setMinEigenvalue(float min_eigenvalue);
+    void setMaxError(float max_error);
+    uint16_t getWindowSize(void);
+    uint8_t getLevels(void);
+    uint8_t getMaxIterations(void);
+};
+
+#endif /* VISION_LUCAS_KANADE_H_ */
@@ -0,0 +1,63 @@
+/*
+ * This file is part of the TUV library (https://github.com/tudelft/tudelft_vision).
+ * Copyright (c) 2016 Freek van Tienen <freek.v.tienen@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef VISION_PYRAMID_H_
+#define VISION_PYRAMID_H_
+
+#include <tuv/vision/image.h>
+#include <tuv/vision/image_buffer_pool.h>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/**
+ * @brief Image pyramid of a frame
+ *
+ * This is a multi-level pyramid where level 0 is the frame itself and every next level is
+ * reduced by a factor of 2 in both directions. Levels are only calculated when they are
+ * requested and are cached until the next frame is set, so several algorithms can share the
+ * same pyramid without rebuilding it. The levels are taken from a pool per level, so in steady
+ * state building a pyramid doesn't allocate any memory. Consumers can keep the level images of
+ * a previous frame, for which the pools create extra buffers when needed.
+ */
+class Pyramid {
+  public:
+    typedef std::shared_ptr<Pyramid> Ptr;   ///< Shared pointer representation of the pyramid
+
+  private:
+    uint8_t levels;                         ///< The maximum amount of levels
+    enum Image::downsample_methods method;  ///< The method to reduce a level
+    uint32_t frame_cnt;                     ///< The amount of frames set
+
+    std::mutex mutex;                       ///< Protects the cached levels and pools
+    std::vector<Image::Ptr> images;         ///< The cached levels of the current frame
+    std::vector<ImageBufferPool::Ptr> pools;    ///< The pools for every level (except the first)
+
+    Image::Ptr createLevel(uint8_t level);
+
+  public:
+    Pyramid(uint8_t levels, enum Image::downsample_methods method = Image::DOWNSAMPLE_BOX);
+    Pyramid(Image::Ptr img, uint8_t levels, enum Image::downsample_methods method = Image::DOWNSAMPLE_BOX);
+
+    void setImage(Image::Ptr img);
+    Image::Ptr getLevel(uint8_t level);
+    uint8_t getLevels(void);
+    uint8_t getAvailableLevels(void);
+    uint32_t getFrameCount(void);
+};
+
+#endif /* VISION_PYRAMID_H_ */
@@ -0,0 +1,56 @@
+/*
+ * This file is part of the TUV library (https://github.com/tudelft/tudelft_vision).
+ * Copyright (c) 2016 Freek van Tienen <freek.v.tienen@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef VISION_SIMD_H_
+#define VISION_SIMD_H_
+
+#include <stdint.h>
+#include <atomic>
+#include <mutex>
+
+/**
+ * @brief SIMD instruction set selection
+ *
+ * This detects at runtime which vector instruction sets are supported by the CPU and compiled
+ * into the library. The vision kernels use this to select the fastest implementation. The
+ * selection can be forced to a lower instruction set, for example to run the scalar reference
+ * implementation while benchmarking or debugging.
+ */
+class SIMD {
+  public:
+    /** The supported instruction sets */
+    enum instruction_sets {
+        ISA_SCALAR,     ///< Plain C++ reference implementation
+        ISA_SSE2,       ///< Intel SSE2 (128 bit)
+        ISA_AVX2,       ///< Intel AVX2 (256 bit)
+        ISA_NEON,       ///< ARM NEON (128 bit)
+    };
+
+  private:
+    static std::atomic<enum instruction_sets> isa;  ///< The currently selected instruction set
+    static std::once_flag detected;                 ///< Whether the CPU features are detected
+
+    static enum instruction_sets detect(void);
+
+  public:
+    static enum instruction_sets getInstructionSet(void);
+    static void setInstructionSet(enum instruction_sets isa);
+    static bool isSupported(enum instruction_sets isa);
+    static const char *toString(enum instruction_sets isa);
+};
+
+#endif /* VISION_SIMD_H_ */
@@ -46,3 +46,33 @@ unsigned int Cam::getHeight(void) {
 enum Image::pixel_formats Cam::getFormat(void) {
     return pixel_format;
 }
+
+/**
+ * @brief Get the capture health metrics
+ *
+ * This returns the frame counters, the buffers held by consumers and the latency histogram
+ * from capture until getImage returns. It can be called from any thread while capturing.
+ * @return A snapshot of the metrics
+ */
+struct CamMetrics::statistics_t Cam::getStatistics(void) {
+    return metrics.getStatistics();
+}
+
+/**
+ * @brief Reset the capture health metrics
+ */
+void Cam::resetStatistics(void) {
+    metrics.reset();
+}
+
+/**
+ * @brief Get the file descriptor to wait on
+ *
+ * This returns a file descriptor which becomes readable when getImage can return a frame
+ * without blocking. It is used to wait on several cameras at once. Cameras which don't
+ * support this return -1.
+ * @return The file descriptor or -1 when not supported
+ */
+int Cam::getFd(void) {
+    return -1;
+}
@@ -17,6 +17,7 @@
 
 #include "cam/cam_bebop_bottom.h"
 
+#include "drivers/clogger.h"
 #include "drivers/mt9v117.h"
 #include <linux/v4l2-mediabus.h>
 
@@ -48,3 +49,13 @@ void CamBebopBottom::setOutput(enum Image::pixel_formats format, uint32_t width,
     // Call the super function
     CamLinux::setOutput(format, width, height);
 }
+
+/**
+ * @brief Reset the sensor after a stall
+ *
+ * This reinitializes the MT9V117 over I2C.
+ */
+void CamBebopBottom::resetSensor(void) {
+    CLOGGER_WARN("Reinitializing the MT9V117");
+    mt9v117.initialize();
+}
@@ -38,34 +38,50 @@ CamBebopFront::CamBebopFront(void) : CamLinux("/dev/video1"),
 /**
  * @brief Start the Bebop camera
  *
- * First this will start the V4L2 linux camera and then it will configure the ISP.
+ * First this will start the V4L2 linux camera and then it will configure the ISP and start
+ * harvesting its statistics. The ISP is only set to its defaults at the first start, when the
+ * stream is started again (for example by the watchdog) the current ISP configuration is
+ * restored.
  */
 void CamBebopFront::start(void) {
     // Start the camera
     CamLinux::start();
 
     // Configure the ISP
-    isp.configure(fd);
+    if(!isp.isConfigured())
+        isp.configure(fd);
+    else
+        isp.sendConfiguration();
     isp.setCrop(0, 0, crop_width, crop_height);
+    isp.startStatisticsThread();
+}
+
+/**
+ * @brief Stop the Bebop camera
+ *
+ * This stops harvesting the ISP statistics and then stops the V4L2 linux camera.
+ */
+void CamBebopFront::stop(void) {
+    isp.stopStatisticsThread();
+    CamLinux::stop();
 }
 
 /**
  * @brief Get a new image
  *
- * Get a new image from the front camera.
+ * Get a new image from the front camera. The ISP statistics are harvested in a separate
+ * thread, so this doesn't wait for the ISP registers.
  * @return The image
  */
 Image::Ptr CamBebopFront::getImage(void) {
     Image::Ptr img = CamLinux::getImage();
-    struct ISP::statistics_t stats = isp.getYUVStatistics();
 
-    // When statistics are valid calculate AE and AWB
-    if(stats.done && !stats.error) {
+    // When new statistics are valid calculate AE and AWB
+    if(isp.getLatestYUVStatistics(stats) && stats.done && !stats.error) {
         autoExposure(stats);
         autoWhiteBalance(stats);
     }
 
-    isp.requestYUVStatistics();
     return img;
 }
 
@@ -115,6 +131,17 @@ void CamBebopFront::setCrop(uint32_t left, uint32_t top, uint32_t width, uint32_
     crop_height = height;
 }
 
+/**
+ * @brief Reset the sensor after a stall
+ *
+ * This reinitializes the MT9F002 over I2C with the current resolution, exposure and gains. The
+ * current ISP configuration is restored when the stream is started again.
+ */
+void CamBebopFront::resetSensor(void) {
+    CLOGGER_WARN("Reinitializing the MT9F002");
+    mt9f002.initialize();
+}
+
 /**
  * @brief Execute Auto Exposure
  *
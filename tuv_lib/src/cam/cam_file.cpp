@@ -0,0 +1,415 @@
+/*
+ * This file is part of the TUV library (https://github.com/tudelft/tudelft_vision).
+ * Copyright (c) 2016 Freek van Tienen <freek.v.tienen@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "cam/cam_file.h"
+
+#include "drivers/clogger.h"
+#include <cstring>
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <stdexcept>
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define Y4M_MAGIC "YUV4MPEG2 "
+#define Y4M_FRAME "FRAME"
+
+/**
+ * @brief Open a recording
+ *
+ * This will map the recording into memory. For YUV4MPEG2 files the output format, size and
+ * frame rate are read from the header. For raw files the output must be set with setOutput
+ * and the frame rate defaults to 30 frames per second.
+ * @param[in] file_name The file name including path (for example: recording.y4m)
+ */
+CamFile::CamFile(std::string file_name) : file_name(file_name),
+    fd(-1),
+    map(NULL),
+    map_size(0),
+    is_y4m(false),
+    data_offset(0),
+    frame_header(0),
+    frame_size(0),
+    frame_count(0),
+    fps_num(30),
+    fps_den(1),
+    pacing(PACING_REALTIME),
+    loop(true),
+    streaming(false),
+    frame_nr(0),
+    sequence(0),
+    start_time(0),
+    in_use(0),
+    dirty_begin(0),
+    dirty_end(0) {
+    width = 0;
+    height = 0;
+    pixel_format = Image::FMT_YUYV;
+
+    openFile();
+    if(is_y4m)
+        parseY4M();
+}
+
+/**
+ * @brief Close the recording
+ *
+ * All images of the camera must be freed before.
+ */
+CamFile::~CamFile(void) {
+    assert(in_use == 0);
+
+    munmap(map, map_size);
+    close(fd);
+    CLOGGER_INFO("Closed " << file_name);
+}
+
+/**
+ * @brief Start the replay
+ *
+ * This restarts the replay at the first frame of the recording.
+ */
+void CamFile::start(void) {
+    updateLayout();
+    if(frame_count == 0) {
+        throw std::runtime_error("Recording " + file_name + " doesn't contain a complete frame of " + std::to_string(frame_size) + " bytes");
+    }
+
+    // Hint the kernel to read ahead
+    madvise(map, map_size, MADV_SEQUENTIAL);
+
+    frame_nr = 0;
+    sequence = 0;
+    start_time = 0;
+    streaming = true;
+    CLOGGER_INFO("Replaying " << frame_count << " frames of " << width << "x" << height << " from " << file_name);
+}
+
+/**
+ * @brief Stop the replay
+ */
+void CamFile::stop(void) {
+    streaming = false;
+}
+
+/**
+ * @brief Get the next frame of the recording
+ *
+ * In realtime pacing this waits until the frame is due at the recorded frame rate. The image
+ * points directly into the mapped file. The capture time is the time the frame was delivered.
+ * @return The next frame
+ */
+Image::Ptr CamFile::getImage(void) {
+    if(!streaming) {
+        throw std::runtime_error("Recording " + file_name + " isn't started");
+    }
+
+    if(frame_nr >= frame_count) {
+        if(!loop) {
+            throw std::runtime_error("Recording " + file_name + " reached the end after " + std::to_string(frame_count) + " frames");
+        }
+        frame_nr = 0;
+    }
+
+    // Wait until the frame is due
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    uint64_t now = (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+    if(start_time == 0)
+        start_time = now;
+
+    if(pacing == PACING_REALTIME) {
+        uint64_t due = start_time + (uint64_t)sequence * 1000000 * fps_den / fps_num;
+        if(due > now) {
+            ts.tv_sec = due / 1000000;
+            ts.tv_nsec = (due % 1000000) * 1000;
+            while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR);
+            now = due;
+        }
+    }
+
+    // Find the frame in the mapping
+    size_t offset = data_offset + (size_t)frame_nr * (frame_header + frame_size);
+    if(is_y4m && memcmp(map + offset, Y4M_FRAME, strlen(Y4M_FRAME)) != 0) {
+        throw std::runtime_error("Recording " + file_name + " has an invalid header at frame " + std::to_string(frame_nr));
+    }
+    offset += frame_header;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if(in_use == 0 || offset < dirty_begin)
+            dirty_begin = offset;
+        if(in_use == 0 || offset + frame_size > dirty_end)
+            dirty_end = offset + frame_size;
+        in_use++;
+    }
+
+    Image::Ptr img = std::make_shared<ImagePtr>(this, 0, pixel_format, width, height, map + offset, frame_size);
+    img->setCaptureInfo(now, sequence, 0);
+    metrics.acquireBuffer();
+    metrics.addFrame(now, 0);
+    frame_nr++;
+    sequence++;
+    return img;
+}
+
+/**
+ * @brief Free an image
+ *
+ * When no image is in use anymore, the pages given out since the last restore are discarded,
+ * so modifications made in place are undone and the next read comes from the file again.
+ * @param[in] identifier The identifier of the image (unused)
+ */
+void CamFile::freeImage(uint16_t identifier) {
+    (void)identifier;
+    metrics.releaseBuffer();
+    std::lock_guard<std::mutex> lock(mutex);
+    assert(in_use > 0);
+
+    if(--in_use == 0)
+        restorePages();
+}
+
+/**
+ * @brief Set the pacing mode
+ *
+ * @param[in] pacing The pacing mode
+ */
+void CamFile::setPacing(enum pacing_modes pacing) {
+    this->pacing = pacing;
+    start_time = 0;
+}
+
+/**
+ * @brief Set whether the replay restarts at the end of the recording
+ *
+ * Without looping getImage throws an exception at the end of the recording.
+ * @param[in] loop Whether the replay restarts at the end
+ */
+void CamFile::setLoop(bool loop) {
+    this->loop = loop;
+}
+
+/**
+ * @brief Set the frame rate used for realtime pacing
+ *
+ * This overrides the frame rate of a YUV4MPEG2 header.
+ * @param[in] num The numerator of the frame rate
+ * @param[in] den The denominator of the frame rate
+ */
+void CamFile::setFrameRate(uint32_t num, uint32_t den) {
+    if(num == 0 || den == 0) {
+        throw std::runtime_error("Recording " + file_name + " can't be replayed at " + std::to_string(num) + "/" + std::to_string(den) + " fps");
+    }
+
+    fps_num = num;
+    fps_den = den;
+    start_time = 0;
+}
+
+/**
+ * @brief Get the pacing mode
+ *
+ * @return The pacing mode
+ */
+enum CamFile::pacing_modes CamFile::getPacing(void) {
+    return pacing;
+}
+
+/**
+ * @brief Get the amount of frames in the recording
+ *
+ * @return The amount of complete frames with the current output settings
+ */
+uint32_t CamFile::getFrameCount(void) {
+    updateLayout();
+    return frame_count;
+}
+
+/**
+ * @brief Whether all frames are delivered
+ *
+ * @return True when the replay doesn't loop and the last frame was delivered
+ */
+bool CamFile::isFinished(void) {
+    return !loop && frame_nr >= frame_count;
+}
+
+/**
+ * @brief Set the output format and resolution
+ *
+ * For raw recordings this sets the layout of the frames. YUV4MPEG2 recordings only accept the
+ * format and resolution from their header.
+ * @param[in] format The pixel format of the frames
+ * @param[in] width The width of the frames in pixels
+ * @param[in] height The height of the frames in pixels
+ */
+void CamFile::setOutput(enum Image::pixel_formats format, uint32_t width, uint32_t height) {
+    if(format == Image::FMT_JPEG || format == Image::FMT_H264) {
+        throw std::runtime_error("Recording " + file_name + " can only contain raw frames");
+    }
+
+    if(is_y4m && (format != pixel_format || width != this->width || height != this->height)) {
+        throw std::runtime_error("Recording " + file_name + " contains " + std::to_string(this->width) + "x" + std::to_string(this->height) + " frames, requested " + std::to_string(width) + "x" + std::to_string(height));
+    }
+
+    this->pixel_format = format;
+    this->width = width;
+    this->height = height;
+    updateLayout();
+}
+
+/**
+ * @brief Set the camera crop
+ *
+ * Cropping isn't supported, the full frames of the recording are always replayed. Only a crop
+ * of the full output frame is accepted.
+ * @param[in] left The left offset of the crop
+ * @param[in] top The top offset of the crop
+ * @param[in] width The width of the crop
+ * @param[in] height The height of the crop
+ */
+void CamFile::setCrop(uint32_t left, uint32_t top, uint32_t width, uint32_t height) {
+    if(left != 0 || top != 0 || width != this->width || height != this->height) {
+        throw std::runtime_error("Recording " + file_name + " can't be cropped to (" + std::to_string(left) + ", " + std::to_string(top) + ", " + std::to_string(width) + ", " + std::to_string(height) + ")");
+    }
+}
+
+/**
+ * @brief Open and map the recording
+ *
+ * The mapping is private and writable, so images can be modified in place without changing
+ * the file.
+ */
+void CamFile::openFile(void) {
+    fd = open(file_name.c_str(), O_RDONLY, 0);
+    if(fd < 0) {
+        throw std::runtime_error("Could not open " + file_name + " (" + strerror(errno) + ")");
+    }
+
+    struct stat st;
+    if(fstat(fd, &st) < 0 || st.st_size == 0) {
+        close(fd);
+        throw std::runtime_error("Recording " + file_name + " is empty or can't be read");
+    }
+    map_size = st.st_size;
+
+    void *addr = mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    if(addr == MAP_FAILED) {
+        close(fd);
+        throw std::runtime_error("Could not map " + file_name + " (" + strerror(errno) + ")");
+    }
+    map = (uint8_t *)addr;
+
+    is_y4m = (map_size > strlen(Y4M_MAGIC) && memcmp(map, Y4M_MAGIC, strlen(Y4M_MAGIC)) == 0);
+    CLOGGER_DEBUG("Mapped " << map_size << " bytes of " << file_name);
+}
+
+/**
+ * @brief Parse the YUV4MPEG2 header
+ *
+ * This reads the resolution, frame rate and colour space of the stream and the size of the
+ * first frame header. Every frame header is expected to have the same size.
+ */
+void CamFile::parseY4M(void) {
+    const uint8_t *end = (const uint8_t *)memchr(map, '\n', map_size);
+    if(end == NULL) {
+        throw std::runtime_error("Recording " + file_name + " has an incomplete YUV4MPEG2 header");
+    }
+
+    std::string header((const char *)map + strlen(Y4M_MAGIC), (const char *)end);
+    std::string colour = "420jpeg";
+    size_t pos = 0;
+    while(pos < header.size()) {
+        size_t next = header.find(' ', pos);
+        if(next == std::string::npos)
+            next = header.size();
+        std::string token = header.substr(pos, next - pos);
+        pos = next + 1;
+        if(token.empty())
+            continue;
+
+        switch(token[0]) {
+        case 'W':
+            width = strtoul(token.c_str() + 1, NULL, 10);
+            break;
+        case 'H':
+            height = strtoul(token.c_str() + 1, NULL, 10);
+            break;
+        case 'F':
+            if(sscanf(token.c_str() + 1, "%u:%u", &fps_num, &fps_den) != 2 || fps_num == 0 || fps_den == 0) {
+                throw std::runtime_error("Recording " + file_name + " has an invalid frame rate " + token);
+            }
+            break;
+        case 'C':
+            colour = token.substr(1);
+            break;
+        default:
+            break;
+        }
+    }
+
+    // Only the colour spaces which can be used without conversion are supported
+    if(colour.compare(0, 3, "420") == 0) {
+        pixel_format = Image::FMT_I420;
+    } else if(colour == "mono") {
+        pixel_format = Image::FMT_GRAY8;
+    } else {
+        throw std::runtime_error("Recording " + file_name + " has an unsupported colour space " + colour);
+    }
+
+    if(width == 0 || height == 0) {
+        throw std::runtime_error("Recording " + file_name + " has no valid resolution");
+    }
+
+    // Determine the size of the frame headers from the first frame
+    data_offset = end - map + 1;
+    const uint8_t *frame_end = (const uint8_t *)memchr(map + data_offset, '\n', map_size - data_offset);
+    if(frame_end == NULL || memcmp(map + data_offset, Y4M_FRAME, strlen(Y4M_FRAME)) != 0) {
+        throw std::runtime_error("Recording " + file_name + " doesn't contain any frame");
+    }
+    frame_header = frame_end - (map + data_offset) + 1;
+    updateLayout();
+}
+
+/**
+ * @brief Update the frame size and frame count
+ */
+void CamFile::updateLayout(void) {
+    frame_size = Image::getBufferSize(pixel_format, width, height);
+    frame_count = (frame_size == 0) ? 0 : (map_size - data_offset) / (frame_header + frame_size);
+}
+
+/**
+ * @brief Restore the pages given out since the last restore
+ *
+ * This is only done when no image is in use, so the pages at the edges of the range can be
+ * discarded as well. The mutex must be locked.
+ */
+void CamFile::restorePages(void) {
+    static const size_t page_size = sysconf(_SC_PAGESIZE);
+    size_t begin = dirty_begin / page_size * page_size;
+    size_t end = std::min((dirty_end + page_size - 1) / page_size * page_size, map_size);
+    if(end > begin)
+        madvise(map + begin, end - begin, MADV_DONTNEED);
+}
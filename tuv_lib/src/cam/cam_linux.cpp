@@ -19,14 +19,33 @@
 
 #include "drivers/clogger.h"
 #include <cstring>
+#include <stdlib.h>
+#include <algorithm>
+#include <chrono>
 #include <stdexcept>
 #include <assert.h>
 #include <fcntl.h>
 #include <unistd.h>
 #include <sys/ioctl.h>
 #include <sys/mman.h>
+#include <sys/select.h>
+#include <time.h>
 #include <linux/v4l2-subdev.h>
 
+/**
+ * @brief Image of a camera buffer
+ *
+ * The image is destroyed (and its buffer returned) before the reference to the camera, so the
+ * camera stays alive until all of its buffers are returned.
+ */
+struct CamLinuxImage {
+    std::shared_ptr<CamLinux> owner;    ///< The camera owning the buffer
+    ImagePtr image;                     ///< The image of the buffer
+
+    CamLinuxImage(std::shared_ptr<CamLinux> owner, uint16_t index, enum Image::pixel_formats pixel_format, uint32_t width, uint32_t height, void *buf) :
+        owner(owner), image(owner.get(), index, pixel_format, width, height, buf) {}
+};
+
 /**
  * @brief Initialize a linux camera device
  *
@@ -34,7 +53,18 @@
  * output formats.
  * @param device_name The linux device name including path (for example: /dev/video1)
  */
-CamLinux::CamLinux(std::string device_name) : device_name(device_name) {
+CamLinux::CamLinux(std::string device_name) : device_name(device_name),
+    buffer_count(10),
+    memory(MEMORY_MMAP),
+    user_length(0),
+    streaming(false),
+    has_sequence(false),
+    last_sequence(0),
+    threaded(false),
+    capturing(false),
+    latest_buffer(-1),
+    watchdog_timeouts(0),
+    frame_timeout(2000) {
     // Try to open the device
     this->openDevice();
 
@@ -43,22 +73,27 @@ CamLinux::CamLinux(std::string device_name) : device_name(device_name) {
 
     // Fetch the possible video formats
     this->getFormats();
-
-    // Set fds properties
-    FD_ZERO(&fds);
-    FD_SET(fd, &fds);
 }
 
 /**
  * @brief Close the Linux camera
  *
- * This will close the connection to the Linux camera. Make sure you stop streaming
- * before destroying the Linux camera.
+ * This will stop the stream when it is still running and close the connection to the Linux
+ * camera. All images of the camera must be freed before, buffers which are still held by an
+ * image are not released.
  */
 CamLinux::~CamLinux(void) {
     assert(fd >= 0);
 
-    //TODO: stop streaming
+    // Stop the stream, so the driver doesn't write into released buffers
+    if(streaming) {
+        try {
+            CamLinux::stop();
+        } catch(const std::runtime_error &e) {
+            CLOGGER_WARN("Could not stop " << device_name << ": " << e.what());
+        }
+    }
+    releaseBuffers();
     close(fd);
     CLOGGER_INFO("Closed " << device_name);
 }
@@ -82,9 +117,12 @@ void CamLinux::start(void) {
         initBuffers();
 
     // Enqueue all buffers
-    for(auto const &buffer: buffers) {
-        if(buffer.state == BUFFER_DEQUEUED)
-            enqueueBuffer(buffer);
+    {
+        std::lock_guard<std::mutex> lock(buffer_mutex);
+        for(auto &buffer: buffers) {
+            if(buffer.state == BUFFER_DEQUEUED)
+                enqueueBuffer(buffer);
+        }
     }
 
     // Start the stream
@@ -92,6 +130,16 @@ void CamLinux::start(void) {
     if(ioctl(fd, VIDIOC_STREAMON, &type) < 0) {
         throw std::runtime_error("Device " + device_name + " couldn't start stream (VIDIOC_STREAMON)");
     }
+    streaming = true;
+
+    // Sequence numbers restart with the stream
+    has_sequence = false;
+
+    // Start the capture thread
+    if(threaded) {
+        capturing = true;
+        capture_thread = std::thread(&CamLinux::captureLoop, this);
+    }
 }
 
 /**
@@ -101,12 +149,21 @@ void CamLinux::start(void) {
  */
 void CamLinux::stop(void) {
     assert(fd >= 0);
+    stopCapture();
 
-    // Stop the streaming
+    // Stop the streaming, while no image can enqueue its buffer
+    std::lock_guard<std::mutex> lock(buffer_mutex);
     enum v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
     if(ioctl(fd, VIDIOC_STREAMOFF, &type) < 0) {
         throw std::runtime_error("Device " + device_name + " couldn't stop stream (VIDIOC_STREAMOFF)");
     }
+    streaming = false;
+
+    // Stopping the stream removes all buffers from the driver queues
+    for(auto &buffer: buffers) {
+        if(buffer.state == BUFFER_ENQUEUED)
+            buffer.state = BUFFER_DEQUEUED;
+    }
 }
 
 /**
@@ -117,35 +174,123 @@ void CamLinux::stop(void) {
  * the pointer in the V4L2 image, thus preventing a buffer copy.
  * Because it is actually an ImageV4L2 it will automatically enqueue the buffer when
  * the image isn't used anymore.
+ * In threaded mode this takes the newest frame of the capture thread, or waits for the next
+ * frame when the newest frame was already taken.
+ * When the watchdog is enabled the stream is restarted after a set amount of timeouts.
  * @return The image from the camera
  */
 Image::Ptr CamLinux::getImage(void) {
     assert(fd >= 0);
-
-    // Wait until an image was taken, with a timeout of 2 seconds
-    int sr = 0;
-    while(sr <= 0) {
-        // Set image timeout
-        struct timeval tv = {};
-        tv.tv_sec = 2;
-        tv.tv_usec = 0;
-
-        // Wait for an image
-        sr = select(fd + 1, &fds, NULL, NULL, &tv);
-        if(sr < 0 && errno != EINTR) {
-            throw std::runtime_error("Device " + device_name + " could not take a shot (" + strerror(errno) + ")");
-        } else if(sr == 0) {
-            printf("Timeout\r\n");
+    struct buffer_t *buffer;
+    uint16_t timeouts = 0;
+    uint64_t stall_start = 0;
+    bool restarted = false;
+
+    if(capture_thread.joinable()) {
+        // Take the newest frame or wait until the capture thread has a new one
+        int32_t index = latest_buffer.exchange(-1);
+        while(index < 0) {
+            bool received;
+            {
+                std::unique_lock<std::mutex> lock(frame_mutex);
+                received = frame_cond.wait_for(lock, std::chrono::milliseconds(frame_timeout), [this, &index] { return (index = latest_buffer.exchange(-1)) >= 0; });
+            }
+
+            // Restarting stops the capture thread, so the lock must be released
+            if(!received)
+                restarted |= handleTimeout(timeouts, stall_start);
         }
+        buffer = &buffers[index];
+    } else {
+        // Wait until an image was taken
+        while(!waitForFrame(frame_timeout))
+            restarted |= handleTimeout(timeouts, stall_start);
+
+        // Dequeue a buffer
+        buffer = dequeueBuffer();
     }
+    {
+        std::lock_guard<std::mutex> lock(buffer_mutex);
+        buffer->state = BUFFER_IN_USE;
+    }
+    CLOGGER_INFO("Got new image from " << device_name);
 
+    // Report the time from the start of the stall until the first new frame
+    if(restarted) {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        uint64_t now = (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+        metrics.addRecovery(now - stall_start);
+        CLOGGER_WARN("Device " << device_name << " recovered after " << (now - stall_start) / 1000 << " ms");
+    }
 
-    // Dequeue a buffer
-    struct buffer_t *buffer = dequeueBuffer();
-    CLOGGER_INFO("Got new image from " << device_name);
+    // Count the frames dropped by the driver or replaced in threaded mode
+    uint32_t dropped = 0;
+    if(has_sequence && buffer->sequence > last_sequence)
+        dropped = buffer->sequence - last_sequence - 1;
+    has_sequence = true;
+    last_sequence = buffer->sequence;
+
+    // Create an image, which keeps the camera alive until the buffer is returned
+    std::shared_ptr<CamLinuxImage> cam_img = std::make_shared<CamLinuxImage>(shared_from_this(), buffer->index, pixel_format, width, height, buffer->buf);
+    Image::Ptr img(cam_img, &cam_img->image);
+    img->setCaptureInfo(buffer->timestamp, buffer->sequence, dropped);
+    metrics.acquireBuffer();
+    metrics.addFrame(buffer->timestamp, dropped);
+    return img;
+}
 
-    // Create an image
-    return std::make_shared<ImagePtr>(this, buffer->index, pixel_format, width, height, buffer->buf);
+/**
+ * @brief Configure the stall watchdog
+ *
+ * When enabled, getImage restarts the stream after the set amount of consecutive timeouts. The
+ * stream is stopped, all buffers which aren't held by images are enqueued again, the sensor is
+ * reset when the camera supports it and the stream is started again. This bounds the outage of
+ * a stuck sensor or ISP instead of waiting forever.
+ * @param[in] timeouts The amount of timeouts before a restart (0 disables the watchdog)
+ * @param[in] timeout_ms The timeout while waiting for a frame in milliseconds
+ */
+void CamLinux::setWatchdog(uint16_t timeouts, uint32_t timeout_ms) {
+    if(timeout_ms == 0) {
+        throw std::runtime_error("Device " + device_name + " needs a frame timeout of at least 1 ms");
+    }
+
+    watchdog_timeouts = timeouts;
+    frame_timeout = timeout_ms;
+}
+
+/**
+ * @brief Get the file descriptor to wait on
+ *
+ * The device becomes readable when a frame can be dequeued. In threaded mode the capture
+ * thread dequeues the frames, so there is no file descriptor to wait on.
+ * @return The device file descriptor or -1 in threaded mode
+ */
+int CamLinux::getFd(void) {
+    return threaded ? -1 : fd;
+}
+
+/**
+ * @brief Enable or disable the capture thread
+ *
+ * This can only be changed while the camera isn't streaming.
+ * @param[in] threaded Whether a capture thread should dequeue the buffers
+ */
+void CamLinux::setThreaded(bool threaded) {
+    if(capture_thread.joinable()) {
+        throw std::runtime_error("Device " + device_name + " can't change the threaded mode while streaming");
+    }
+
+    this->threaded = threaded;
+}
+
+/**
+ * @brief Whether the capture thread is enabled
+ *
+ * @return True when a capture thread dequeues the buffers
+ */
+bool CamLinux::isThreaded(void) {
+    return threaded;
 }
 
 /**
@@ -367,17 +512,51 @@ uint32_t CamLinux::toV4L2Format(enum Image::pixel_formats format) {
 /**
  * @brief Initialize the v4l2 buffers
  *
- * This will use memory mapping to initialize V4L2 buffers which are used to
- * store the images. Currently it will request 10 buffers.
+ * This will request the configured amount of buffers with the configured memory type. Driver
+ * buffers are memory mapped, user pointer buffers are either the buffers set by the user or
+ * page aligned buffers allocated here, and imported DMA buffers are memory mapped for CPU
+ * access. The driver can return less buffers than requested.
  */
 void CamLinux::initBuffers(void) {
-    // Request MMAP buffers
+    // Use all user or DMA buffers when they are set
+    uint32_t count = buffer_count;
+    if(memory == MEMORY_USERPTR && !user_buffers.empty())
+        count = user_buffers.size();
+    else if(memory == MEMORY_DMABUF)
+        count = dmabuf_fds.size();
+    if(count == 0) {
+        throw std::runtime_error("No buffers set for " + device_name);
+    }
+
+    // Request the buffers
     struct v4l2_requestbuffers req = {};
-    req.count = 10; //FIXME: variable amount of buffers
+    req.count = count;
     req.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-    req.memory = V4L2_MEMORY_MMAP;
+    req.memory = getV4L2Memory();
     if (ioctl(fd, VIDIOC_REQBUFS, &req) < 0) {
-        throw std::runtime_error("Could not request MMAP buffers for " + device_name);
+        throw std::runtime_error("Could not request " + std::to_string(count) + " buffers of memory type " + std::to_string(memory) + " for " + device_name + " (" + strerror(errno) + ")");
+    }
+    // User and DMA buffers can't be added or left out, so the driver must accept all of them
+    bool external = (memory == MEMORY_USERPTR && !user_buffers.empty()) || memory == MEMORY_DMABUF;
+    if (external && req.count != count) {
+        uint32_t got = req.count;
+        req.count = 0;
+        ioctl(fd, VIDIOC_REQBUFS, &req);
+        throw std::runtime_error("Device " + device_name + " needs " + std::to_string(got) + " buffers of memory type " + std::to_string(memory) + " instead of the " + std::to_string(count) + " given buffers");
+    }
+    if (req.count < count) {
+        CLOGGER_WARN("Requested " << count << " buffers for " << device_name << " but got " << req.count);
+    }
+
+    // Get the image size for user allocated buffers
+    size_t image_size = 0;
+    if (memory != MEMORY_MMAP) {
+        struct v4l2_format fmt = {};
+        fmt.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        if (ioctl(fd, VIDIOC_G_FMT, &fmt) < 0) {
+            throw std::runtime_error("Device " + device_name + " couldn't get the image size VIDIOC_G_FMT (" + strerror(errno) + ")");
+        }
+        image_size = fmt.fmt.pix.sizeimage;
     }
 
     // Go trough the buffers and initialize them
@@ -386,52 +565,267 @@ void CamLinux::initBuffers(void) {
 
         // Request the buffer information
         buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-        buf.memory = V4L2_MEMORY_MMAP;
+        buf.memory = req.memory;
         buf.index = i;
         if (ioctl(fd, VIDIOC_QUERYBUF, &buf) < 0) {
-            throw std::runtime_error("Could not query MMAP buffer " + std::to_string(i) + " for " + device_name);
+            throw std::runtime_error("Could not query buffer " + std::to_string(i) + " for " + device_name);
         }
 
-        //  Map the buffer
         struct buffer_t buffer;
         buffer.index = i;
         buffer.state = BUFFER_DEQUEUED;
         buffer.length = buf.length;
-        buffer.buf = mmap(NULL, buf.length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, buf.m.offset);
-        if (MAP_FAILED == buffer.buf) {
-            throw std::runtime_error("Could not MMAP buffer " + std::to_string(i) + " for " + device_name);
+        buffer.dmabuf_fd = -1;
+        buffer.allocated = false;
+        buffer.timestamp = 0;
+        buffer.sequence = 0;
+
+        switch(memory) {
+        case MEMORY_MMAP:
+            //  Map the buffer
+            buffer.buf = mmap(NULL, buf.length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, buf.m.offset);
+            if (MAP_FAILED == buffer.buf) {
+                throw std::runtime_error("Could not MMAP buffer " + std::to_string(i) + " for " + device_name);
+            }
+            break;
+
+        case MEMORY_USERPTR:
+            // Use the user buffer or allocate a page aligned buffer
+            if (!user_buffers.empty()) {
+                buffer.buf = user_buffers[i];
+                buffer.length = user_length;
+            } else {
+                size_t page_size = sysconf(_SC_PAGESIZE);
+                buffer.length = (image_size + page_size - 1) / page_size * page_size;
+                if (posix_memalign(&buffer.buf, page_size, buffer.length) != 0) {
+                    throw std::runtime_error("Could not allocate user buffer " + std::to_string(i) + " of size " + std::to_string(buffer.length) + " for " + device_name);
+                }
+                buffer.allocated = true;
+            }
+
+            if (buffer.length < image_size) {
+                throw std::runtime_error("User buffer " + std::to_string(i) + " of size " + std::to_string(buffer.length) + " is too small for images of size " + std::to_string(image_size) + " from " + device_name);
+            }
+            break;
+
+        case MEMORY_DMABUF:
+            // Map the imported buffer for CPU access
+            buffer.dmabuf_fd = dmabuf_fds[i];
+            buffer.length = image_size;
+            buffer.buf = mmap(NULL, image_size, PROT_READ | PROT_WRITE, MAP_SHARED, buffer.dmabuf_fd, 0);
+            if (MAP_FAILED == buffer.buf) {
+                throw std::runtime_error("Could not MMAP DMA buffer " + std::to_string(i) + " for " + device_name + " (" + strerror(errno) + ")");
+            }
+            break;
         }
 
-        /*if(checkcontiguity((unsigned long)buffers[i].buf,
-                            getpid(),
-                            &pmem,
-                            buf.length)) {
-          printf("[v4l2] Physical memory %d is not contiguous with length %d from %s\n", i, buf.length, device_name);
-        }*/
-
-        //buffer.physp = pmem.paddr;
-        CLOGGER_DEBUG("MMAP buffer " << i << " generated");
+        CLOGGER_DEBUG("Buffer " << i << " of memory type " << memory << " generated");
         buffers.push_back(buffer);
     }
 }
 
+/**
+ * @brief Release the v4l2 buffers
+ *
+ * This will unmap or free the buffers and release the buffers of the driver. This can only be
+ * done when the stream is stopped. Buffers which are still held by an image are orphaned: they
+ * are kept until the image is freed, in which case the driver buffers can't be released.
+ */
+void CamLinux::releaseBuffers(void) {
+    std::lock_guard<std::mutex> lock(buffer_mutex);
+    if(buffers.empty())
+        return;
+
+    bool orphaned = false;
+    for(auto &buffer: buffers) {
+        if(buffer.state == BUFFER_IN_USE) {
+            CLOGGER_WARN("Buffer " << buffer.index << " of " << device_name << " is still used by an image");
+            orphaned = true;
+        } else {
+            releaseMemory(buffer);
+        }
+        buffer.state = BUFFER_ORPHANED;
+    }
+
+    // The entries of the orphaned buffers are needed when their images are freed
+    if(orphaned)
+        return;
+    buffers.clear();
+
+    // Release the driver buffers
+    struct v4l2_requestbuffers req = {};
+    req.count = 0;
+    req.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    req.memory = getV4L2Memory();
+    if (ioctl(fd, VIDIOC_REQBUFS, &req) < 0) {
+        CLOGGER_WARN("Could not release the buffers of " << device_name << " (" << strerror(errno) << ")");
+    }
+}
+
+/**
+ * @brief Unmap or free the memory of a buffer
+ *
+ * @param[in] buffer The buffer to release
+ */
+void CamLinux::releaseMemory(struct buffer_t &buffer) {
+    if(buffer.buf == NULL)
+        return;
+
+    if(buffer.allocated)
+        free(buffer.buf);
+    else if(memory != MEMORY_USERPTR)
+        munmap(buffer.buf, buffer.length);
+    buffer.buf = NULL;
+}
+
+/**
+ * @brief Get the V4L2 memory type
+ *
+ * @return The V4L2 memory type of the configured memory type
+ */
+uint32_t CamLinux::getV4L2Memory(void) {
+    switch(memory) {
+    case MEMORY_USERPTR:
+        return V4L2_MEMORY_USERPTR;
+    case MEMORY_DMABUF:
+        return V4L2_MEMORY_DMABUF;
+    default:
+        return V4L2_MEMORY_MMAP;
+    }
+}
+
+/**
+ * @brief Set the amount of buffers and the memory type
+ *
+ * This releases the current buffers and forgets the user and DMA buffers, so it can only be
+ * called when the stream is stopped and no images are in use. The buffers are initialized again at the next start. More buffers
+ * allow longer processing before the driver runs out of buffers, at the cost of memory.
+ * @param[in] count The amount of buffers to request
+ * @param[in] memory The memory type of the buffers
+ */
+void CamLinux::setBuffers(uint16_t count, enum memory_types memory) {
+    {
+        std::lock_guard<std::mutex> lock(buffer_mutex);
+        for(auto &buffer: buffers) {
+            if(buffer.state != BUFFER_DEQUEUED) {
+                throw std::runtime_error("Device " + device_name + " can't change the buffers while streaming or while images are in use");
+            }
+        }
+    }
+
+    releaseBuffers();
+    buffer_count = count;
+    this->memory = memory;
+    user_buffers.clear();
+    dmabuf_fds.clear();
+}
+
+/**
+ * @brief Set the user buffers
+ *
+ * The images are captured directly into these buffers when the memory type is MEMORY_USERPTR,
+ * for example into pool or encoder buffers. The buffers must stay valid until the buffers are
+ * released. When no user buffers are set, page aligned buffers are allocated.
+ * @param[in] buffers The user buffers (the amount of buffers overrides the buffer count)
+ * @param[in] length The size of every buffer in bytes
+ */
+void CamLinux::setUserBuffers(const std::vector<void *> &buffers, size_t length) {
+    setBuffers(buffers.size(), MEMORY_USERPTR);
+    user_buffers = buffers;
+    user_length = length;
+}
+
+/**
+ * @brief Set the DMA buffers to import
+ *
+ * The images are captured directly into these DMA buffers, for example buffers exported by
+ * another device or process. The file descriptors must stay open until the buffers are
+ * released.
+ * @param[in] fds The DMA buffer file descriptors (the amount overrides the buffer count)
+ */
+void CamLinux::setDmabufBuffers(const std::vector<int> &fds) {
+    setBuffers(fds.size(), MEMORY_DMABUF);
+    dmabuf_fds = fds;
+}
+
+/**
+ * @brief Export a buffer as DMA buffer
+ *
+ * This exports a driver buffer (VIDIOC_EXPBUF), so it can be shared with another device or
+ * process without a copy. Only MEMORY_MMAP buffers can be exported and the buffers must be
+ * initialized, which is done when the stream is started.
+ * @param[in] index The index of the buffer (the identifier of the image)
+ * @return The DMA buffer file descriptor, which must be closed by the caller
+ */
+int CamLinux::exportBuffer(uint16_t index) {
+    if(memory != MEMORY_MMAP || index >= buffers.size()) {
+        throw std::runtime_error("Device " + device_name + " can only export initialized MMAP buffers and not " + std::to_string(index));
+    }
+
+    struct v4l2_exportbuffer expbuf = {};
+    expbuf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    expbuf.index = index;
+    expbuf.flags = O_CLOEXEC | O_RDWR;
+    if (ioctl(fd, VIDIOC_EXPBUF, &expbuf) < 0) {
+        throw std::runtime_error("Could not export buffer " + std::to_string(index) + " of " + device_name + " VIDIOC_EXPBUF (" + strerror(errno) + ")");
+    }
+    return expbuf.fd;
+}
+
+/**
+ * @brief Get the amount of buffers
+ *
+ * @return The amount of initialized buffers or the amount to request when not initialized
+ */
+uint16_t CamLinux::getBufferCount(void) {
+    return buffers.empty()? buffer_count : buffers.size();
+}
+
+/**
+ * @brief Get the total amount of dropped frames
+ *
+ * These are the frames which were captured but never returned by getImage, because the driver
+ * ran out of buffers or a newer frame replaced them in threaded mode.
+ * @return The amount of dropped frames since the camera was created or the statistics were reset
+ */
+uint32_t CamLinux::getDroppedFrames(void) {
+    return metrics.getStatistics().dropped;
+}
+
+/**
+ * @brief Get the memory type of the buffers
+ *
+ * @return The memory type
+ */
+enum CamLinux::memory_types CamLinux::getMemoryType(void) {
+    return memory;
+}
+
 /**
  * @brief Enqueue a v4l2 buffer
  *
  * This will enqueue a buffer using the id. This needs to be done when the
  * buffer isn't needed anymore such that the video device can use this buffer to
- * generate a new image.
+ * generate a new image. The buffer mutex must be locked by the caller, so the state can't
+ * change between the check of the caller and the enqueue (for example during a restart).
  * @param[in] buffer The buffer to enqueue
  */
-void CamLinux::enqueueBuffer(struct buffer_t buffer) {
+void CamLinux::enqueueBuffer(struct buffer_t &buffer) {
     assert(fd >= 0);
-    assert(buffer.state == BUFFER_DEQUEUED);
+    assert(buffer.state != BUFFER_ENQUEUED);
 
     // Enqueue the buffer
     struct v4l2_buffer buf = {};
     buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-    buf.memory = V4L2_MEMORY_MMAP;
+    buf.memory = getV4L2Memory();
     buf.index = buffer.index;
+    if (memory == MEMORY_USERPTR) {
+        buf.m.userptr = (unsigned long)buffer.buf;
+        buf.length = buffer.length;
+    } else if (memory == MEMORY_DMABUF) {
+        buf.m.fd = buffer.dmabuf_fd;
+        buf.length = buffer.length;
+    }
     if (ioctl(fd, VIDIOC_QBUF, &buf) < 0) {
         throw std::runtime_error("Could not enqueue buffer " + std::to_string(buffer.index) + " for " + device_name);
     }
@@ -446,12 +840,30 @@ void CamLinux::enqueueBuffer(struct buffer_t buffer) {
  * This will enqueue a buffer with a specific ID. This needs to be done when the
  * buffer isn't needed anymore such that the video device can use this buffer to
  * generate a new image. This is called by the deletion of the generated image
- * pointer.
+ * pointer, so it never throws. The memory of an orphaned buffer is released instead.
  * @param[in] identifier The buffer id to enqueue
  */
 void CamLinux::freeImage(uint16_t identifier) {
     CLOGGER_DEBUG("Freeing V4L2: " << identifier << " Size: " << buffers.size());
-    enqueueBuffer(buffers.at(identifier));
+    metrics.releaseBuffer();
+
+    std::lock_guard<std::mutex> lock(buffer_mutex);
+    if(identifier >= buffers.size()) {
+        CLOGGER_WARN("Freed unknown buffer " << identifier << " of " << device_name);
+        return;
+    }
+
+    struct buffer_t &buffer = buffers[identifier];
+    if(buffer.state == BUFFER_ORPHANED) {
+        releaseMemory(buffer);
+        return;
+    }
+
+    try {
+        enqueueBuffer(buffer);
+    } catch(const std::runtime_error &e) {
+        CLOGGER_WARN(e.what());
+    }
 }
 
 /**
@@ -467,7 +879,7 @@ struct CamLinux::buffer_t *CamLinux::dequeueBuffer(void) {
     // Dequeue the buffer
     struct v4l2_buffer buf = {};
     buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-    buf.memory = V4L2_MEMORY_MMAP;
+    buf.memory = getV4L2Memory();
     if (ioctl(fd, VIDIOC_DQBUF, &buf) < 0) {
         throw std::runtime_error("Could not dequeue a buffer for " + device_name + " (" + strerror(errno) + ")");
     }
@@ -475,6 +887,148 @@ struct CamLinux::buffer_t *CamLinux::dequeueBuffer(void) {
     CLOGGER_DEBUG("Dequeue buffer " << buf.index);
 
     struct buffer_t *buffer = &buffers[buf.index];
-    buffer->state = BUFFER_DEQUEUED;
+    {
+        std::lock_guard<std::mutex> lock(buffer_mutex);
+        buffer->state = BUFFER_DEQUEUED;
+
+        // The driver can't capture when all other buffers are held
+        if(std::none_of(buffers.begin(), buffers.end(), [](const struct buffer_t &b) { return b.state == BUFFER_ENQUEUED; }))
+            metrics.addStarvation();
+    }
+    buffer->sequence = buf.sequence;
+
+    // Use the driver timestamp when it is monotonic, otherwise the dequeue time
+    if((buf.flags & V4L2_BUF_FLAG_TIMESTAMP_MASK) == V4L2_BUF_FLAG_TIMESTAMP_MONOTONIC) {
+        buffer->timestamp = (uint64_t)buf.timestamp.tv_sec * 1000000 + buf.timestamp.tv_usec;
+    } else {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        buffer->timestamp = (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+    }
     return buffer;
 }
+
+/**
+ * @brief Wait until a buffer can be dequeued
+ *
+ * @param[in] timeout_ms The timeout in milliseconds
+ * @return True when a buffer can be dequeued, false on a timeout or interrupt
+ */
+bool CamLinux::waitForFrame(uint32_t timeout_ms) {
+    fd_set fds;
+    FD_ZERO(&fds);
+    FD_SET(fd, &fds);
+
+    struct timeval tv = {};
+    tv.tv_sec = timeout_ms / 1000;
+    tv.tv_usec = (timeout_ms % 1000) * 1000;
+
+    int sr = select(fd + 1, &fds, NULL, NULL, &tv);
+    if(sr < 0 && errno != EINTR) {
+        throw std::runtime_error("Device " + device_name + " could not take a shot (" + strerror(errno) + ")");
+    }
+    return (sr > 0);
+}
+
+/**
+ * @brief Capture thread
+ *
+ * This dequeues every frame and publishes it as the newest frame. When the previous newest
+ * frame wasn't taken yet, it is enqueued again directly. The select timeout is short, so the
+ * thread stops quickly.
+ */
+void CamLinux::captureLoop(void) {
+    while(capturing) {
+        try {
+            if(!waitForFrame(100))
+                continue;
+
+            // Publish the new frame and return the replaced frame to the driver
+            struct buffer_t *buffer = dequeueBuffer();
+            int32_t stale = latest_buffer.exchange(buffer->index);
+            if(stale >= 0) {
+                std::lock_guard<std::mutex> lock(buffer_mutex);
+                enqueueBuffer(buffers[stale]);
+            }
+
+            // Lock before notifying, so a waiting getImage can't miss the frame
+            {
+                std::lock_guard<std::mutex> lock(frame_mutex);
+            }
+            frame_cond.notify_one();
+        } catch(const std::runtime_error &e) {
+            CLOGGER_WARN("Capture thread of " << device_name << ": " << e.what());
+        }
+    }
+}
+
+/**
+ * @brief Handle a timeout while waiting for a frame
+ *
+ * This counts the timeout and restarts the stream when the watchdog limit is reached. A failed
+ * restart is retried after the next series of timeouts.
+ * @param[in,out] timeouts The amount of consecutive timeouts
+ * @param[in,out] stall_start The start of the stall in microseconds (set at the first timeout)
+ * @return True when the stream was restarted
+ */
+bool CamLinux::handleTimeout(uint16_t &timeouts, uint64_t &stall_start) {
+    CLOGGER_WARN("Timeout while waiting for an image from " << device_name);
+    metrics.addTimeout();
+
+    if(stall_start == 0) {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        stall_start = (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000 - (uint64_t)frame_timeout * 1000;
+    }
+
+    if(watchdog_timeouts == 0 || ++timeouts < watchdog_timeouts)
+        return false;
+
+    timeouts = 0;
+    try {
+        restartStream();
+    } catch(const std::runtime_error &e) {
+        CLOGGER_WARN("Could not restart " << device_name << ": " << e.what());
+    }
+    return true;
+}
+
+/**
+ * @brief Restart the stream
+ *
+ * This stops the stream, which returns all buffers from the driver, resets the sensor and
+ * starts the stream again, which enqueues all buffers not held by images.
+ */
+void CamLinux::restartStream(void) {
+    CLOGGER_WARN("Restarting stalled stream of " << device_name);
+    metrics.addRestart();
+
+    stop();
+    resetSensor();
+    start();
+}
+
+/**
+ * @brief Reset the sensor after a stall
+ *
+ * Plain V4L2 devices have no separate sensor control, so nothing is done. Cameras with a
+ * sensor driver reinitialize the sensor here.
+ */
+void CamLinux::resetSensor(void) {
+
+}
+
+/**
+ * @brief Stop the capture thread
+ *
+ * This waits for the capture thread to finish. A frame that wasn't taken yet stays dequeued
+ * and is enqueued again when the stream is started.
+ */
+void CamLinux::stopCapture(void) {
+    if(!capture_thread.joinable())
+        return;
+
+    capturing = false;
+    capture_thread.join();
+    latest_buffer = -1;
+}
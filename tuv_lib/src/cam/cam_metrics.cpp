@@ -0,0 +1,220 @@
+/*
+ * This file is part of the TUV library (https://github.com/tudelft/tudelft_vision).
+ * Copyright (c) 2016 Freek van Tienen <freek.v.tienen@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "cam/cam_metrics.h"
+
+#include <time.h>
+
+/**
+ * @brief Create empty metrics
+ */
+CamMetrics::CamMetrics(void) {
+    reset();
+}
+
+/**
+ * @brief Record a delivered frame
+ *
+ * The latency is measured from the capture timestamp until now. Frames without a timestamp
+ * are counted, but not added to the histogram.
+ * @param[in] timestamp The capture time in microseconds (CLOCK_MONOTONIC, 0 when unknown)
+ * @param[in] dropped The amount of frames lost right before this frame
+ */
+void CamMetrics::addFrame(uint64_t timestamp, uint32_t dropped) {
+    delivered.fetch_add(1, std::memory_order_relaxed);
+    if(dropped > 0)
+        this->dropped.fetch_add(dropped, std::memory_order_relaxed);
+
+    if(timestamp == 0)
+        return;
+
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    uint64_t now = (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+    uint32_t lat = (now > timestamp) ? now - timestamp : 0;
+
+    latency[getBucket(lat)].fetch_add(1, std::memory_order_relaxed);
+    latency_sum.fetch_add(lat, std::memory_order_relaxed);
+
+    uint32_t max = latency_max.load(std::memory_order_relaxed);
+    while(lat > max && !latency_max.compare_exchange_weak(max, lat, std::memory_order_relaxed));
+}
+
+/**
+ * @brief Record a timeout while waiting for a frame
+ */
+void CamMetrics::addTimeout(void) {
+    timeouts.fetch_add(1, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Record that the driver had no buffer to capture into
+ */
+void CamMetrics::addStarvation(void) {
+    starvation.fetch_add(1, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Record that a consumer took a buffer
+ */
+void CamMetrics::acquireBuffer(void) {
+    uint32_t cnt = in_use.fetch_add(1, std::memory_order_relaxed) + 1;
+    uint32_t max = in_use_max.load(std::memory_order_relaxed);
+    while(cnt > max && !in_use_max.compare_exchange_weak(max, cnt, std::memory_order_relaxed));
+}
+
+/**
+ * @brief Record that a consumer returned a buffer
+ */
+void CamMetrics::releaseBuffer(void) {
+    in_use.fetch_sub(1, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Record a stream restart by the watchdog
+ */
+void CamMetrics::addRestart(void) {
+    restarts.fetch_add(1, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Record the recovery from a stall
+ *
+ * @param[in] recovery The time from the start of the stall until a new frame in microseconds
+ */
+void CamMetrics::addRecovery(uint32_t recovery) {
+    recovery_last.store(recovery, std::memory_order_relaxed);
+    uint32_t max = recovery_max.load(std::memory_order_relaxed);
+    while(recovery > max && !recovery_max.compare_exchange_weak(max, recovery, std::memory_order_relaxed));
+}
+
+/**
+ * @brief Get a snapshot of the metrics
+ *
+ * The counters are read one by one, so a frame recorded at the same time can be partly
+ * included.
+ * @return A copy of the metrics
+ */
+struct CamMetrics::statistics_t CamMetrics::getStatistics(void) {
+    struct statistics_t res;
+    res.delivered = delivered.load(std::memory_order_relaxed);
+    res.dropped = dropped.load(std::memory_order_relaxed);
+    res.timeouts = timeouts.load(std::memory_order_relaxed);
+    res.starvation = starvation.load(std::memory_order_relaxed);
+    res.in_use = in_use.load(std::memory_order_relaxed);
+    res.in_use_max = in_use_max.load(std::memory_order_relaxed);
+    res.latency_sum = latency_sum.load(std::memory_order_relaxed);
+    res.latency_max = latency_max.load(std::memory_order_relaxed);
+    for(uint8_t i = 0; i < CAM_METRICS_BUCKETS; ++i)
+        res.latency[i] = latency[i].load(std::memory_order_relaxed);
+    res.restarts = restarts.load(std::memory_order_relaxed);
+    res.recovery_last = recovery_last.load(std::memory_order_relaxed);
+    res.recovery_max = recovery_max.load(std::memory_order_relaxed);
+    return res;
+}
+
+/**
+ * @brief Reset the metrics
+ *
+ * The buffers currently held by consumers are kept, since they are still returned later.
+ */
+void CamMetrics::reset(void) {
+    delivered = 0;
+    dropped = 0;
+    timeouts = 0;
+    starvation = 0;
+    in_use_max = in_use.load();
+    latency_sum = 0;
+    latency_max = 0;
+    for(auto &bucket : latency)
+        bucket = 0;
+    restarts = 0;
+    recovery_last = 0;
+    recovery_max = 0;
+}
+
+/**
+ * @brief Get the histogram bucket of a latency
+ *
+ * Bucket 0 contains everything below 64 microseconds. Above that every power of two is split
+ * in four buckets and the last bucket contains everything beyond the histogram.
+ * @param[in] latency The latency in microseconds
+ * @return The bucket index
+ */
+uint8_t CamMetrics::getBucket(uint32_t latency) {
+    if(latency < 64)
+        return 0;
+
+    uint8_t msb = 31 - __builtin_clz(latency);
+    uint8_t sub = (latency >> (msb - 2)) & 3;
+    uint32_t bucket = 1 + (msb - 6) * 4 + sub;
+    return (bucket < CAM_METRICS_BUCKETS) ? bucket : CAM_METRICS_BUCKETS - 1;
+}
+
+/**
+ * @brief Get the upper limit of a histogram bucket
+ *
+ * @param[in] bucket The bucket index
+ * @return The exclusive upper limit of the bucket in microseconds (UINT32_MAX for the last bucket)
+ */
+uint32_t CamMetrics::getBucketLimit(uint8_t bucket) {
+    if(bucket == 0)
+        return 64;
+    if(bucket >= CAM_METRICS_BUCKETS - 1)
+        return UINT32_MAX;
+
+    uint8_t octave = (bucket - 1) / 4;
+    uint8_t sub = (bucket - 1) % 4;
+    return (uint32_t)(5 + sub) << (octave + 4);
+}
+
+/**
+ * @brief Get the mean latency
+ *
+ * @return The mean latency in microseconds
+ */
+uint32_t CamMetrics::statistics_t::getLatencyMean(void) const {
+    uint64_t cnt = 0;
+    for(uint8_t i = 0; i < CAM_METRICS_BUCKETS; ++i)
+        cnt += latency[i];
+    return (cnt == 0) ? 0 : latency_sum / cnt;
+}
+
+/**
+ * @brief Get a latency percentile
+ *
+ * This is the upper limit of the bucket containing the percentile, limited to the maximum
+ * latency.
+ * @param[in] percentile The percentile between 0 and 100
+ * @return The latency in microseconds
+ */
+uint32_t CamMetrics::statistics_t::getLatencyPercentile(float percentile) const {
+    uint64_t cnt = 0;
+    for(uint8_t i = 0; i < CAM_METRICS_BUCKETS; ++i)
+        cnt += latency[i];
+    if(cnt == 0)
+        return 0;
+
+    uint64_t target = (uint64_t)(cnt * percentile / 100.0f + 0.5f);
+    uint64_t sum = 0;
+    for(uint8_t i = 0; i < CAM_METRICS_BUCKETS; ++i) {
+        sum += latency[i];
+        if(sum >= target && sum > 0)
+            return (getBucketLimit(i) < latency_max) ? getBucketLimit(i) : latency_max;
+    }
+    return latency_max;
+}
@@ -0,0 +1,325 @@
+/*
+ * This file is part of the TUV library (https://github.com/tudelft/tudelft_vision).
+ * Copyright (c) 2016 Freek van Tienen <freek.v.tienen@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "cam/cam_multiplexer.h"
+
+#include "drivers/clogger.h"
+#include <cstring>
+#include <string>
+#include <stdexcept>
+#include <errno.h>
+#include <unistd.h>
+
+/**
+ * @brief Create a new multiplexer
+ *
+ * This creates the epoll instance without any cameras.
+ */
+CamMultiplexer::CamMultiplexer(void) :
+    running(false) {
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if(epoll_fd < 0) {
+        throw std::runtime_error(std::string("Could not create epoll instance (") + strerror(errno) + ")");
+    }
+}
+
+/**
+ * @brief Destroy the multiplexer
+ *
+ * This stops the service thread and releases all queued frames.
+ */
+CamMultiplexer::~CamMultiplexer(void) {
+    stop();
+    cameras.clear();
+    close(epoll_fd);
+}
+
+/**
+ * @brief Add a camera with a callback
+ *
+ * Every frame of the camera is delivered to the callback from the thread which calls poll. The
+ * callback should return quickly, since the other cameras are serviced by the same thread.
+ * @param[in] id The identifier of the camera which is passed to the callback
+ * @param[in] cam The camera to add
+ * @param[in] callback The callback which receives the frames
+ */
+void CamMultiplexer::addCamera(uint32_t id, Cam::Ptr cam, callback_t callback) {
+    if(!callback) {
+        throw std::runtime_error("Camera " + std::to_string(id) + " needs a valid callback");
+    }
+
+    struct camera_t camera = {};
+    camera.id = id;
+    camera.cam = cam;
+    camera.callback = callback;
+    camera.queue_size = 0;
+    cameras.push_back(camera);
+    registerCamera(cameras.back());
+}
+
+/**
+ * @brief Add a camera with a queue
+ *
+ * The frames of the camera are kept in a queue and can be taken with getImage. When the queue
+ * is full the oldest frame is released, so the camera never runs out of buffers. A queue size
+ * of 1 always keeps only the newest frame.
+ * @param[in] id The identifier of the camera
+ * @param[in] cam The camera to add
+ * @param[in] queue_size The maximum amount of queued frames
+ */
+void CamMultiplexer::addCamera(uint32_t id, Cam::Ptr cam, uint16_t queue_size) {
+    if(queue_size == 0) {
+        throw std::runtime_error("Camera " + std::to_string(id) + " needs a queue of at least one frame");
+    }
+
+    struct camera_t camera = {};
+    camera.id = id;
+    camera.cam = cam;
+    camera.queue_size = queue_size;
+    cameras.push_back(camera);
+    registerCamera(cameras.back());
+}
+
+/**
+ * @brief Remove a camera
+ *
+ * This removes the camera from the epoll and releases all its queued frames.
+ * @param[in] id The identifier of the camera
+ */
+void CamMultiplexer::removeCamera(uint32_t id) {
+    if(thread.joinable()) {
+        throw std::runtime_error("Camera " + std::to_string(id) + " can't be removed while the multiplexer is running");
+    }
+
+    for(auto it = cameras.begin(); it != cameras.end(); ++it) {
+        if(it->id != id)
+            continue;
+
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, it->fd, NULL);
+        cameras.erase(it);
+        events.resize(cameras.size());
+        return;
+    }
+
+    throw std::runtime_error("Camera " + std::to_string(id) + " is not added to the multiplexer");
+}
+
+/**
+ * @brief Wait for frames of all cameras
+ *
+ * This waits until at least one camera is ready or the timeout expires. All ready cameras are
+ * dequeued before any frame is delivered, so the cameras are dequeued as close together as
+ * possible.
+ * @param[in] timeout_ms The timeout in milliseconds (-1 waits forever)
+ * @return The amount of delivered frames
+ */
+uint32_t CamMultiplexer::poll(int32_t timeout_ms) {
+    if(cameras.empty()) {
+        throw std::runtime_error("The multiplexer has no cameras to poll");
+    }
+
+    int cnt = epoll_wait(epoll_fd, events.data(), events.size(), timeout_ms);
+    if(cnt < 0) {
+        if(errno == EINTR)
+            return 0;
+        throw std::runtime_error(std::string("Could not wait for cameras (") + strerror(errno) + ")");
+    }
+
+    // First dequeue all ready cameras
+    ready.clear();
+    for(int i = 0; i < cnt; ++i) {
+        struct camera_t *camera = (struct camera_t *)events[i].data.ptr;
+        ready.emplace_back(camera, camera->cam->getImage());
+    }
+
+    // Deliver the frames
+    for(auto &frame : ready) {
+        struct camera_t *camera = frame.first;
+        if(camera->callback) {
+            camera->callback(camera->id, frame.second);
+
+            std::lock_guard<std::mutex> lock(mutex);
+            camera->frames++;
+        } else {
+            std::lock_guard<std::mutex> lock(mutex);
+            if(camera->queue.size() >= camera->queue_size) {
+                camera->queue.pop_front();
+                camera->overflows++;
+            }
+            camera->queue.push_back(frame.second);
+            camera->frames++;
+        }
+    }
+
+    // Release our references, so the buffers return to the drivers
+    uint32_t delivered = ready.size();
+    ready.clear();
+    return delivered;
+}
+
+/**
+ * @brief Start the service thread
+ *
+ * This starts a thread which keeps polling all cameras until stop is called. Cameras can't be
+ * added or removed while the thread is running.
+ */
+void CamMultiplexer::start(void) {
+    if(thread.joinable())
+        return;
+
+    running = true;
+    thread = std::thread(&CamMultiplexer::serviceLoop, this);
+}
+
+/**
+ * @brief Stop the service thread
+ *
+ * This waits for the service thread to finish. The queued frames are kept.
+ */
+void CamMultiplexer::stop(void) {
+    if(!thread.joinable())
+        return;
+
+    running = false;
+    thread.join();
+}
+
+/**
+ * @brief Whether the service thread is running
+ *
+ * @return True when the service thread is running
+ */
+bool CamMultiplexer::isRunning(void) {
+    return thread.joinable();
+}
+
+/**
+ * @brief Take the oldest queued frame of a camera
+ *
+ * This doesn't block and can be called from any thread.
+ * @param[in] id The identifier of the camera
+ * @return The oldest queued frame or an empty pointer when the queue is empty
+ */
+Image::Ptr CamMultiplexer::getImage(uint32_t id) {
+    struct camera_t *camera = findCamera(id);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if(camera->queue.empty())
+        return Image::Ptr();
+
+    Image::Ptr img = camera->queue.front();
+    camera->queue.pop_front();
+    return img;
+}
+
+/**
+ * @brief Get the amount of delivered frames of a camera
+ *
+ * @param[in] id The identifier of the camera
+ * @return The amount of frames delivered to the callback or the queue
+ */
+uint32_t CamMultiplexer::getFrameCount(uint32_t id) {
+    struct camera_t *camera = findCamera(id);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    return camera->frames;
+}
+
+/**
+ * @brief Get the amount of released frames of a camera
+ *
+ * @param[in] id The identifier of the camera
+ * @return The amount of frames released because the queue was full
+ */
+uint32_t CamMultiplexer::getOverflowCount(uint32_t id) {
+    struct camera_t *camera = findCamera(id);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    return camera->overflows;
+}
+
+/**
+ * @brief Find a registered camera
+ *
+ * @param[in] id The identifier of the camera
+ * @return The registered camera
+ */
+struct CamMultiplexer::camera_t *CamMultiplexer::findCamera(uint32_t id) {
+    for(auto &camera : cameras) {
+        if(camera.id == id)
+            return &camera;
+    }
+
+    throw std::runtime_error("Camera " + std::to_string(id) + " is not added to the multiplexer");
+}
+
+/**
+ * @brief Register a camera at the epoll
+ *
+ * This is called with the camera already added to the list, so the epoll can point to its
+ * final address. On failure the camera is removed from the list again.
+ * @param[in] camera The added camera
+ */
+void CamMultiplexer::registerCamera(struct camera_t &camera) {
+    std::string error;
+    if(thread.joinable()) {
+        error = "can't be added while the multiplexer is running";
+    } else {
+        for(auto &other : cameras) {
+            if(&other != &camera && other.id == camera.id)
+                error = "is already added to the multiplexer";
+        }
+    }
+
+    camera.fd = camera.cam->getFd();
+    if(error.empty() && camera.fd < 0) {
+        error = "doesn't support waiting on a file descriptor";
+    }
+
+    if(error.empty()) {
+        struct epoll_event ev = {};
+        ev.events = EPOLLIN;
+        ev.data.ptr = &camera;
+        if(epoll_ctl(epoll_fd, EPOLL_CTL_ADD, camera.fd, &ev) < 0)
+            error = std::string("could not be added to the epoll (") + strerror(errno) + ")";
+    }
+
+    if(!error.empty()) {
+        uint32_t id = camera.id;
+        cameras.pop_back();
+        throw std::runtime_error("Camera " + std::to_string(id) + " " + error);
+    }
+
+    events.resize(cameras.size());
+    ready.reserve(cameras.size());
+    CLOGGER_INFO("Added camera " << camera.id << " to the multiplexer");
+}
+
+/**
+ * @brief Service thread
+ *
+ * This keeps polling the cameras. The timeout is short, so the thread stops quickly.
+ */
+void CamMultiplexer::serviceLoop(void) {
+    while(running) {
+        try {
+            poll(100);
+        } catch(const std::runtime_error &e) {
+            CLOGGER_WARN("Multiplexer thread: " << e.what());
+        }
+    }
+}
@@ -0,0 +1,418 @@
+/*
+ * This file is part of the TUV library (https://github.com/tudelft/tudelft_vision).
+ * Copyright (c) 2016 Freek van Tienen <freek.v.tienen@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "cam/cam_synthetic.h"
+
+#include "drivers/clogger.h"
+#include <cstring>
+#include <math.h>
+#include <string>
+#include <stdexcept>
+#include <algorithm>
+#include <errno.h>
+#include <time.h>
+
+/** The colour bars as YUV (75% intensity, BT.601) */
+static const uint8_t bar_colours[8][3] = {
+    {180, 128, 128},    // White
+    {162, 44, 142},     // Yellow
+    {131, 156, 44},     // Cyan
+    {112, 72, 58},      // Green
+    {84, 184, 198},     // Magenta
+    {65, 100, 212},     // Red
+    {35, 212, 114},     // Blue
+    {16, 128, 128},     // Black
+};
+
+/**
+ * @brief Create a synthetic camera
+ *
+ * By default this generates static 640x480 YUYV frames at 30 frames per second from 4 buffers.
+ * @param[in] pattern The pattern to generate
+ */
+CamSynthetic::CamSynthetic(enum pattern_types pattern) :
+    pattern(pattern),
+    velocity_x(0),
+    velocity_y(0),
+    fps_num(30),
+    fps_den(1),
+    buffer_count(4),
+    tile_width(0),
+    tile_height(0),
+    noise_state(0x9E3779B97F4A7C15ULL),
+    streaming(false),
+    sequence(0),
+    start_time(0) {
+    width = 640;
+    height = 480;
+    pixel_format = Image::FMT_YUYV;
+}
+
+/**
+ * @brief Start generating frames
+ *
+ * This allocates the ring of buffers and generates the pattern tile. The sequence restarts
+ * at zero.
+ */
+void CamSynthetic::start(void) {
+    if(!pool || pool->getPixelFormat() != pixel_format || pool->getWidth() != width || pool->getHeight() != height)
+        pool = std::make_shared<ImageBufferPool>(pixel_format, width, height, buffer_count);
+    generateTile();
+
+    sequence = 0;
+    start_time = 0;
+    streaming = true;
+    CLOGGER_INFO("Generating " << width << "x" << height << " frames from " << buffer_count << " buffers");
+}
+
+/**
+ * @brief Stop generating frames
+ */
+void CamSynthetic::stop(void) {
+    streaming = false;
+}
+
+/**
+ * @brief Generate the next frame
+ *
+ * When a frame rate is set this waits until the frame is due. The capture time is the time
+ * the frame was delivered.
+ * @return The next frame from the ring of buffers
+ */
+Image::Ptr CamSynthetic::getImage(void) {
+    if(!streaming) {
+        throw std::runtime_error("Synthetic camera isn't started");
+    }
+
+    // Wait until the frame is due
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    uint64_t now = (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+    if(start_time == 0)
+        start_time = now;
+
+    if(fps_num != 0) {
+        uint64_t due = start_time + (uint64_t)sequence * 1000000 * fps_den / fps_num;
+        if(due > now) {
+            ts.tv_sec = due / 1000000;
+            ts.tv_nsec = (due % 1000000) * 1000;
+            while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR);
+            now = due;
+        }
+    }
+
+    // Render the frame
+    Image::Ptr img = pool->getImage();
+    if(pattern == PATTERN_NOISE) {
+        renderNoise((uint8_t *)img->getData(), img->getSize());
+    } else {
+        int32_t offset_x, offset_y;
+        getOffset(sequence, offset_x, offset_y);
+        renderPattern((uint8_t *)img->getData(), offset_x, offset_y);
+    }
+
+    img->setCaptureInfo(now, sequence, 0);
+    metrics.addFrame(now, 0);
+    sequence++;
+    return img;
+}
+
+/**
+ * @brief Set the generated pattern
+ *
+ * @param[in] pattern The pattern to generate
+ */
+void CamSynthetic::setPattern(enum pattern_types pattern) {
+    this->pattern = pattern;
+    if(streaming)
+        generateTile();
+}
+
+/**
+ * @brief Set the motion of the pattern
+ *
+ * The pattern moves with a constant velocity, where the offset of every frame is rounded to
+ * whole pixels. Use getOffset for the exact offsets.
+ * @param[in] velocity_x The horizontal motion in pixels per frame
+ * @param[in] velocity_y The vertical motion in pixels per frame
+ */
+void CamSynthetic::setMotion(float velocity_x, float velocity_y) {
+    this->velocity_x = velocity_x;
+    this->velocity_y = velocity_y;
+}
+
+/**
+ * @brief Set the frame rate
+ *
+ * @param[in] num The numerator of the frame rate (0 generates frames as fast as requested)
+ * @param[in] den The denominator of the frame rate
+ */
+void CamSynthetic::setFrameRate(uint32_t num, uint32_t den) {
+    if(den == 0) {
+        throw std::runtime_error("Synthetic camera can't run at " + std::to_string(num) + "/0 fps");
+    }
+
+    fps_num = num;
+    fps_den = den;
+    start_time = 0;
+}
+
+/**
+ * @brief Set the amount of preallocated buffers
+ *
+ * When more images are in use, the ring grows and the misses are counted in the statistics
+ * of the pool.
+ * @param[in] count The amount of buffers
+ */
+void CamSynthetic::setBuffers(uint16_t count) {
+    if(streaming) {
+        throw std::runtime_error("Synthetic camera can't change the buffers while streaming");
+    }
+
+    buffer_count = count;
+    pool.reset();
+}
+
+/**
+ * @brief Get the ground truth offset of a frame
+ *
+ * This is the translation of the pattern in pixels compared to the first frame, so the image
+ * motion between two frames is the difference of their offsets. The noise pattern doesn't
+ * move and the colour bars only move horizontally.
+ * @param[in] sequence The sequence number of the frame
+ * @param[out] offset_x The horizontal offset in pixels
+ * @param[out] offset_y The vertical offset in pixels
+ */
+void CamSynthetic::getOffset(uint32_t sequence, int32_t &offset_x, int32_t &offset_y) {
+    offset_x = 0;
+    offset_y = 0;
+
+    if(pattern == PATTERN_NOISE)
+        return;
+
+    offset_x = lround((double)velocity_x * sequence);
+    if(pattern == PATTERN_BARS) {
+        // Coloured chroma can only move in whole macropixels
+        if(pixel_format != Image::FMT_GRAY8)
+            offset_x = 2 * lround((double)velocity_x * sequence / 2);
+        return;
+    }
+    offset_y = lround((double)velocity_y * sequence);
+}
+
+/**
+ * @brief Get the pool of frame buffers
+ *
+ * @return The pool of the ring of buffers (empty before the first start)
+ */
+ImageBufferPool::Ptr CamSynthetic::getPool(void) {
+    return pool;
+}
+
+/**
+ * @brief Set the output format and resolution
+ *
+ * @param[in] format The pixel format (GRAY8, YUYV or UYVY)
+ * @param[in] width The width of the frames in pixels
+ * @param[in] height The height of the frames in pixels
+ */
+void CamSynthetic::setOutput(enum Image::pixel_formats format, uint32_t width, uint32_t height) {
+    if(format != Image::FMT_GRAY8 && format != Image::FMT_YUYV && format != Image::FMT_UYVY) {
+        throw std::runtime_error("Synthetic camera can't generate pixel format " + std::to_string(format));
+    }
+
+    if(width == 0 || height == 0 || (format != Image::FMT_GRAY8 && width % 2 != 0)) {
+        throw std::runtime_error("Synthetic camera can't generate " + std::to_string(width) + "x" + std::to_string(height) + " frames");
+    }
+
+    if(streaming) {
+        throw std::runtime_error("Synthetic camera can't change the output while streaming");
+    }
+
+    this->pixel_format = format;
+    this->width = width;
+    this->height = height;
+}
+
+/**
+ * @brief Set the camera crop
+ *
+ * There is no sensor behind the generated frames, so they can't be cropped. Only a crop of
+ * the full output frame is accepted.
+ * @param[in] left The left offset of the crop
+ * @param[in] top The top offset of the crop
+ * @param[in] width The width of the crop
+ * @param[in] height The height of the crop
+ */
+void CamSynthetic::setCrop(uint32_t left, uint32_t top, uint32_t width, uint32_t height) {
+    if(left != 0 || top != 0 || width != this->width || height != this->height) {
+        throw std::runtime_error("Synthetic camera can't crop to (" + std::to_string(left) + ", " + std::to_string(top) + ", " + std::to_string(width) + ", " + std::to_string(height) + ")");
+    }
+}
+
+/**
+ * @brief Generate the pattern tile
+ *
+ * The tile is stored in the output format and repeats seamlessly in both directions. Except
+ * for the colour bars the chroma is neutral, so the tile can be shifted by any amount of
+ * pixels.
+ */
+void CamSynthetic::generateTile(void) {
+    switch(pattern) {
+    case PATTERN_BARS:
+        // Eight bars with an even width spanning the whole frame
+        tile_width = (width + 15) / 16 * 16;
+        tile_height = 1;
+        break;
+    case PATTERN_CHECKER:
+        tile_width = 64;
+        tile_height = 64;
+        break;
+    case PATTERN_TEXTURE:
+        tile_width = 256;
+        tile_height = 256;
+        break;
+    case PATTERN_NOISE:
+        tile.clear();
+        return;
+    }
+
+    tile.resize(tile_width * tile_height * Image::getPixelSize(pixel_format));
+    uint8_t *row = tile.data();
+    uint32_t row_size = tile_width * Image::getPixelSize(pixel_format);
+
+    // Random values on a coarse grid for the texture
+    const uint32_t grid = 8;
+    std::vector<uint8_t> coarse((tile_width / grid) * (tile_height / grid));
+    for(auto &val : coarse) {
+        noise_state ^= noise_state << 13;
+        noise_state ^= noise_state >> 7;
+        noise_state ^= noise_state << 17;
+        val = noise_state & 0xFF;
+    }
+
+    for(uint32_t y = 0; y < tile_height; ++y, row += row_size) {
+        for(uint32_t x = 0; x < tile_width; ++x) {
+            if(pattern == PATTERN_BARS) {
+                const uint8_t *c = bar_colours[x * 8 / tile_width];
+                setPixel(row, x, c[0], c[1], c[2]);
+            } else if(pattern == PATTERN_CHECKER) {
+                setPixel(row, x, (((x / 32) ^ (y / 32)) & 1) ? 200 : 50, 128, 128);
+            } else {
+                // Bilinear interpolation of the coarse grid with wrapping plus fine detail
+                uint32_t cols = tile_width / grid;
+                uint32_t rows = tile_height / grid;
+                uint32_t gx = x / grid, gy = y / grid;
+                uint32_t fx = x % grid, fy = y % grid;
+                uint32_t v00 = coarse[gy * cols + gx];
+                uint32_t v01 = coarse[gy * cols + (gx + 1) % cols];
+                uint32_t v10 = coarse[((gy + 1) % rows) * cols + gx];
+                uint32_t v11 = coarse[((gy + 1) % rows) * cols + (gx + 1) % cols];
+                uint32_t top = v00 * (grid - fx) + v01 * fx;
+                uint32_t bottom = v10 * (grid - fx) + v11 * fx;
+                int32_t val = (top * (grid - fy) + bottom * fy) / (grid * grid);
+
+                noise_state ^= noise_state << 13;
+                noise_state ^= noise_state >> 7;
+                noise_state ^= noise_state << 17;
+                val += (int32_t)(noise_state & 0x1F) - 16;
+                setPixel(row, x, std::min(std::max(val, 0), 255), 128, 128);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Render the pattern tile at an offset
+ *
+ * Every row is copied from the tile in at most a few pieces because the tile wraps around.
+ * @param[out] dst The frame buffer
+ * @param[in] offset_x The horizontal offset of the pattern in pixels
+ * @param[in] offset_y The vertical offset of the pattern in pixels
+ */
+void CamSynthetic::renderPattern(uint8_t *dst, int32_t offset_x, int32_t offset_y) {
+    uint32_t pixel_size = Image::getPixelSize(pixel_format);
+    uint32_t row_size = width * pixel_size;
+    uint32_t tile_row_size = tile_width * pixel_size;
+
+    // The content at pixel x comes from x - offset in the tile
+    uint32_t start_x = ((-(int64_t)offset_x) % tile_width + tile_width) % tile_width;
+    uint32_t start_y = ((-(int64_t)offset_y) % tile_height + tile_height) % tile_height;
+
+    for(uint32_t y = 0; y < height; ++y, dst += row_size) {
+        const uint8_t *src = tile.data() + ((start_y + y) % tile_height) * tile_row_size;
+        uint32_t pos = start_x * pixel_size;
+        uint32_t done = 0;
+        while(done < row_size) {
+            uint32_t cnt = std::min(row_size - done, tile_row_size - pos);
+            memcpy(dst + done, src + pos, cnt);
+            done += cnt;
+            pos = 0;
+        }
+    }
+}
+
+/**
+ * @brief Render uniform random noise
+ *
+ * This uses a xorshift generator producing 8 bytes at a time.
+ * @param[out] dst The frame buffer
+ * @param[in] size The size of the frame in bytes
+ */
+void CamSynthetic::renderNoise(uint8_t *dst, uint32_t size) {
+    uint64_t state = noise_state;
+    uint32_t i = 0;
+    for(; i + 8 <= size; i += 8) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        memcpy(dst + i, &state, 8);
+    }
+    for(; i < size; ++i) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        dst[i] = state & 0xFF;
+    }
+    noise_state = state;
+}
+
+/**
+ * @brief Write a pixel in the output format
+ *
+ * For YUV422 the U value is written at even and the V value at odd pixels.
+ * @param[out] dst The row to write to
+ * @param[in] x The pixel column
+ * @param[in] y The luma value
+ * @param[in] u The U value
+ * @param[in] v The V value
+ */
+void CamSynthetic::setPixel(uint8_t *dst, uint32_t x, uint8_t y, uint8_t u, uint8_t v) {
+    switch(pixel_format) {
+    case Image::FMT_YUYV:
+        dst[2 * x] = y;
+        dst[2 * x + 1] = (x % 2 == 0) ? u : v;
+        break;
+    case Image::FMT_UYVY:
+        dst[2 * x] = (x % 2 == 0) ? u : v;
+        dst[2 * x + 1] = y;
+        break;
+    default:
+        dst[x] = y;
+        break;
+    }
+}
@@ -17,20 +17,38 @@
 
 #include "drivers/isp.h"
 
+#include "drivers/isp_registers_devmem.h"
 #include <string>
 #include <stdexcept>
-#include <fcntl.h>
-#include <sys/mman.h>
-#include <sys/ioctl.h>
+#include <algorithm>
 #include <assert.h>
-#include <unistd.h>
 #include "drivers/clogger.h"
 
 /**
  * @brief ISP initialization
  */
-ISP::ISP(void) {
+ISP::ISP(void) :
+    offsets(),
+    shadow(),
+    batch_depth(0),
+    io_stats(),
+    stats_running(false),
+    stats_poll_us(0),
+    stats_latest(),
+    stats_fresh(false),
+    reg() {
+    dirty_nodes.reserve(ISP_NODE_NR);
+    invalidateRegisters();
+    loadDefaults();
+}
 
+/**
+ * @brief Stop the ISP driver
+ *
+ * This stops the statistics thread when it is still running.
+ */
+ISP::~ISP(void) {
+    stopStatisticsThread();
 }
 
 /**
@@ -38,6 +56,43 @@ ISP::ISP(void) {
  * @param[in] fd The video device connected to the ISP
  */
 void ISP::configure(int fd) {
+    configure(std::make_shared<ISPRegistersDevMem>(fd));
+}
+
+/**
+ * @brief Initialize the ISP on a register file
+ *
+ * This makes it possible to run the ISP on a different register backend, like a register
+ * file in memory to verify the register programming and measure the register traffic
+ * without a Bebop. The current configuration (including the calibration tables) is kept and
+ * written completely, so this can also be used to restore the ISP after a restart of the
+ * stream. Use reset() to go back to the default settings.
+ * @param[in] registers The register file
+ */
+void ISP::configure(ISPRegisters::Ptr registers) {
+    stopStatisticsThread();
+    this->registers = registers;
+
+    /* Configure basics */
+    setOffsets(registers->getOffsets());
+    sendConfiguration();
+}
+
+/**
+ * @brief Whether a register backend is attached
+ *
+ * @return True when the ISP is configured
+ */
+bool ISP::isConfigured(void) {
+    return (registers != nullptr);
+}
+
+/**
+ * @brief Compute the addresses of all register nodes
+ *
+ * @param[in] off The offsets of the ISP blocks from the AVI base
+ */
+void ISP::setOffsets(const struct avi_isp_offsets &off) {
     /* Define the ISP bases */
     static const unsigned isp_bases[] = {
         AVI_ISP_CHAIN_BAYER_INTER,
@@ -74,63 +129,41 @@ void ISP::configure(int fd) {
         AVI_ISP_DROP,
     };
 
-    // Open memory device
-    devmem = open("/dev/mem", O_RDWR);
-    if (devmem < 0) {
-        throw std::runtime_error(std::string("Could not open /dev/mem (") + strerror(errno) + ")");
-    }
-
-    // Get the base
-    avi_base = (unsigned long) mmap(NULL, AVI_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, devmem, AVI_BASE & ~AVI_MASK);
-    if (avi_base == (unsigned long) MAP_FAILED) {
-        close(devmem);
-        throw std::runtime_error(std::string("Could not mmap /dev/mem (") + strerror(errno) + ")");
-    }
-
-    // Try to get the ISP offsets
-    struct avi_isp_offsets off;
-    if (ioctl(fd, AVI_ISP_IOGET_OFFSETS, &off) < 0) {
-        munmap((void *) avi_base, AVI_SIZE);
-        close(devmem);
-        throw std::runtime_error(std::string("Could not get ISP offsets AVI_ISP_IOGET_OFFSETS (") + strerror(errno) + ")");
-    }
-
-
     /* Compute all the sub-modules offsets */
     /* Chain Bayer */
     uint16_t i = 0;
     for (i = chain_bayer_inter ; i < gamma_corrector ; i++)
-        offsets[i] = avi_base + isp_bases[i] + off.chain_bayer;
+        offsets[i] = isp_bases[i] + off.chain_bayer;
 
-    offsets[gamma_corrector]        = avi_base + isp_bases[i++] + off.gamma_corrector;
-    offsets[gamma_corrector_ry_lut] = avi_base + isp_bases[i++] + off.gamma_corrector;
-    offsets[gamma_corrector_gu_lut] = avi_base + isp_bases[i++] + off.gamma_corrector;
-    offsets[gamma_corrector_bv_lut] = avi_base + isp_bases[i++] + off.gamma_corrector;
-    offsets[chroma]                 = avi_base + isp_bases[i++] + off.chroma;
-    offsets[statistics_yuv]         = avi_base + isp_bases[i++] + off.statistics_yuv;
-    offsets[statistics_yuv_ae_histogram_y] = avi_base + isp_bases[i++] + off.statistics_yuv;
+    offsets[gamma_corrector]        = isp_bases[i++] + off.gamma_corrector;
+    offsets[gamma_corrector_ry_lut] = isp_bases[i++] + off.gamma_corrector;
+    offsets[gamma_corrector_gu_lut] = isp_bases[i++] + off.gamma_corrector;
+    offsets[gamma_corrector_bv_lut] = isp_bases[i++] + off.gamma_corrector;
+    offsets[chroma]                 = isp_bases[i++] + off.chroma;
+    offsets[statistics_yuv]         = isp_bases[i++] + off.statistics_yuv;
+    offsets[statistics_yuv_ae_histogram_y] = isp_bases[i++] + off.statistics_yuv;
 
     /* Chain YUV */
     for (i = chain_yuv_inter ; i < ISP_NODE_NR ; i++)
-        offsets[i] = avi_base + isp_bases[i] + off.chain_yuv;
-
-    /* Configure basics */
-    reset();
+        offsets[i] = isp_bases[i] + off.chain_yuv;
 }
 
 /**
  * Reset the ISP with the default settings
+ *
+ * This also removes the calibration tables.
  */
 void ISP::reset(void) {
-    /*
-    • 0x0: RAW10 to RAW10
-    • 0x1: RAW8 to RAW10
-    • 0x2: RAW3x10 to RAW10
-    • 0x3: RGB3x10 to RGB3x10
-    */
-    reg.vlformat_32to40.format.format = 0x0;
-    avi_isp_vlformat_32to40_set_registers(&reg.vlformat_32to40);
+    loadDefaults();
+    sendConfiguration();
+}
 
+/**
+ * @brief Load the default configuration
+ *
+ * This only changes the configuration, which is written by sendConfiguration.
+ */
+void ISP::loadDefaults(void) {
     // Set default CFA (pixel order)
     config.cfa = 2;
 
@@ -150,21 +183,30 @@ void ISP::reset(void) {
     config.pedestal_gr = 42;
     config.pedestal_b  = 42;
 
-    // avi_isp_green_imbalance_set_registers(&isp_reg.green_imbalance);
-    // avi_isp_green_imbalance_green_red_coeff_mem_set_registers(&isp_reg.grim_gr);
-    // avi_isp_green_imbalance_green_blue_coeff_mem_set_registers(&isp_reg.grim_gb);
-    // avi_isp_dead_pixel_correction_set_registers(&isp_reg.dead_pixel_correction);
+    // No green imbalance calibration by default
+    config.grim_cell_w = 0;
+    config.grim_cell_h = 0;
+    config.grim_gr.clear();
+    config.grim_gb.clear();
+
+    // No dead pixel correction by default
+    config.dpc_list.clear();
+    config.dpc_auto       = false;
+    config.dpc_threshold  = 0;
 
     // Set default denoise vectors
     config.denoise_red    = {0, 0, 1, 2, 4, 6, 9, 13, 16, 18, 21, 23, 25, 26};
     config.denoise_green  = {0, 1, 1, 2, 4, 6, 8, 12, 15, 18, 20, 22, 24, 26};
     config.denoise_blue   = {0, 0, 1, 2, 4, 6, 9, 13, 16, 18, 21, 23, 25, 27};
 
-    // avi_isp_statistics_bayer_set_registers(&isp_reg.statistics_bayer);
-    // avi_isp_lens_shading_correction_set_registers(&isp_reg.lens_shading_correction);
-    // avi_isp_lens_shading_correction_red_coeff_mem_set_registers(&isp_reg.lsc_red_coeffs);
-    // avi_isp_lens_shading_correction_green_coeff_mem_set_registers(&isp_reg.lsc_green_coeffs);
-    // avi_isp_lens_shading_correction_blue_coeff_mem_set_registers(&isp_reg.lsc_blue_coeffs);
+    // No lens shading calibration by default
+    config.lsc_cell_w = 0;
+    config.lsc_cell_h = 0;
+    config.lsc_red.clear();
+    config.lsc_green.clear();
+    config.lsc_blue.clear();
+    config.lsc_threshold.clear();
+    config.lsc_gain.clear();
 
     // Set default demosaicking parameters (Bayer to RGB)
     config.demos_threshold_low    = 25;
@@ -386,13 +428,49 @@ void ISP::reset(void) {
     config.stat_incr_log2       = {0,0};
     config.stat_awb_threshold   = 33;
 
+    // Set the default Bayer statistics (all windows over the same area as the YUV statistics)
+    config.bstat_left           = 0;
+    config.bstat_top            = 0;
+    config.bstat_width          = 1080;
+    config.bstat_height         = 1920;
+    config.bstat_windows_x      = BAYERSTATS_STATX;
+    config.bstat_windows_y      = BAYERSTATS_STATY;
+    config.bstat_center_x       = 1088;
+    config.bstat_center_y       = 1078;
+    config.bstat_radius         = 1911;
+    config.bstat_incr_log2      = {0,0};
+    config.bstat_sat_threshold  = 1000;
+}
+
+/**
+ * @brief Write the complete configuration
+ *
+ * The hardware state is unknown, for example after a restart of the stream, so every block is
+ * written completely in a single batch. Without a register backend nothing is written.
+ */
+void ISP::sendConfiguration(void) {
+    invalidateRegisters();
+    beginBatch();
+
+    /*
+    • 0x0: RAW10 to RAW10
+    • 0x1: RAW8 to RAW10
+    • 0x2: RAW3x10 to RAW10
+    • 0x3: RGB3x10 to RGB3x10
+    */
+    reg.vlformat_32to40.format.format = 0x0;
+    avi_isp_vlformat_32to40_set_registers(&reg.vlformat_32to40);
+
     // avi_isp_edge_enhancement_color_reduction_filter_set_registers(&isp_reg.eecrf);
     // avi_isp_edge_enhancement_color_reduction_filter_ee_lut_set_registers(&isp_reg.eecrf_lut);
 
     /* Send all configurations */
     sendBayerChain();
     sendPedestal();
+    sendGreenImbalance();
+    sendDeadPixelCorrection();
     sendDenoising();
+    sendLensShading();
     sendDemosaicking();
     sendColorCorrection();
     sendGammaCorrector();
@@ -400,7 +478,11 @@ void ISP::reset(void) {
     sendColorSpaceConversion();
     sendYUVChain();
     sendYUVStatistics();
-    CLOGGER_INFO("Configured ISP");
+    sendBayerStatistics();
+    commit();
+
+    if(registers)
+        CLOGGER_INFO("Configured ISP");
 }
 
 /**
@@ -427,8 +509,15 @@ void ISP::setCrop(uint32_t left, uint32_t top, uint32_t width, uint32_t height)
     config.stat_top = top;
     config.stat_width = width;
     config.stat_height = height;
+    config.bstat_left = left;
+    config.bstat_top = top;
+    config.bstat_width = width;
+    config.bstat_height = height;
 
+    beginBatch();
     sendYUVStatistics();
+    sendBayerStatistics();
+    commit();
 }
 
 /**
@@ -512,6 +601,117 @@ void ISP::sendPedestal(void) {
     avi_isp_pedestal_set_registers(&reg.pedestal);
 }
 
+/**
+ * @brief Set the green imbalance calibration
+ *
+ * This uploads the green imbalance correction grid, which corrects the difference between the
+ * green pixels on the red and the blue rows. The grid has 17 x 13 coefficients with the given
+ * cell size, starting at the top left of the capture window. The correction still has to be
+ * enabled in the bayer chain.
+ * @param[in] cell_w The width of a grid cell in pixels
+ * @param[in] cell_h The height of a grid cell in pixels
+ * @param[in] gr_coeffs The ISP_GRID_COEFFS green-red coefficients row by row
+ * @param[in] gb_coeffs The ISP_GRID_COEFFS green-blue coefficients row by row
+ */
+void ISP::setGreenImbalance(uint16_t cell_w, uint16_t cell_h, std::vector<uint8_t> &gr_coeffs, std::vector<uint8_t> &gb_coeffs) {
+    if(cell_w == 0 || cell_w > 511 || cell_h == 0 || cell_h > 1023)
+        throw std::runtime_error("Green imbalance cell size " + std::to_string(cell_w) + "x" + std::to_string(cell_h) + " is not supported");
+    if(gr_coeffs.size() != ISP_GRID_COEFFS || gb_coeffs.size() != ISP_GRID_COEFFS)
+        throw std::runtime_error("Green imbalance needs " + std::to_string(ISP_GRID_COEFFS) + " coefficients per channel");
+
+    config.grim_cell_w = cell_w;
+    config.grim_cell_h = cell_h;
+    config.grim_gr = gr_coeffs;
+    config.grim_gb = gb_coeffs;
+    sendGreenImbalance();
+}
+
+/**
+ * @brief Send the green imbalance configuration
+ *
+ * The configuration and both coefficient memories are written in a single batch. Nothing is
+ * written when no calibration was set.
+ */
+void ISP::sendGreenImbalance(void) {
+    if(config.grim_gr.empty())
+        return;
+
+    // Set the registers
+    reg.grim.bayer_cfa.cfa = config.cfa;
+    reg.grim.offset_x_y._register = 0;
+    reg.grim.cell_id_x_y._register = 0;
+    reg.grim.cell_w.cell_w = config.grim_cell_w;
+    reg.grim.cell_h.cell_h = config.grim_cell_h;
+    reg.grim.cell_w_inv.w_inv = (1 << 16) / config.grim_cell_w;
+    reg.grim.cell_h_inv.h_inv = (1 << 16) / config.grim_cell_h;
+
+    for(uint16_t i = 0; i < ISP_GRID_COEFFS; ++i) {
+        reg.grim_gr.red_coeff_mem[i].gr_coeff_value = config.grim_gr[i];
+        reg.grim_gb.green_coeff_mem[i].gb_coeff_value = config.grim_gb[i];
+    }
+
+    // Send the registers
+    beginBatch();
+    avi_isp_green_imbalance_set_registers(&reg.grim);
+    avi_isp_green_imbalance_green_red_coeff_mem_set_registers(&reg.grim_gr);
+    avi_isp_green_imbalance_green_blue_coeff_mem_set_registers(&reg.grim_gb);
+    commit();
+}
+
+/**
+ * @brief Set the dead pixel correction
+ *
+ * This uploads a list of known defect pixels, which are replaced by the hardware. Next to the
+ * list the hardware can also detect dead pixels automatically using a threshold. The
+ * correction still has to be enabled in the bayer chain.
+ * @param[in] list The known dead pixels (at most ISP_DEAD_PIXELS)
+ * @param[in] auto_detection Enable the automatic detection
+ * @param[in] threshold The 10 bit threshold for the automatic detection
+ */
+void ISP::setDeadPixelCorrection(std::vector<struct dead_pixel_t> &list, bool auto_detection, uint16_t threshold) {
+    if(list.size() > ISP_DEAD_PIXELS)
+        throw std::runtime_error("Dead pixel list of " + std::to_string(list.size()) + " entries is too long");
+    for(auto &pixel : list) {
+        if(pixel.x >= (1 << 11) || pixel.y >= (1 << 12) || pixel.op_code >= (1 << 3))
+            throw std::runtime_error("Dead pixel at " + std::to_string(pixel.x) + "x" + std::to_string(pixel.y) + " is out of range");
+    }
+
+    config.dpc_list = list;
+    config.dpc_auto = auto_detection;
+    config.dpc_threshold = threshold;
+    sendDeadPixelCorrection();
+}
+
+/**
+ * @brief Send the dead pixel correction configuration
+ *
+ * The list memory is only written when a list was set, the unused entries are cleared.
+ */
+void ISP::sendDeadPixelCorrection(void) {
+    // Set the registers
+    reg.dpc.cfa.cfa = config.cfa;
+    reg.dpc.bypass.list = config.dpc_list.empty()? 1:0;
+    reg.dpc.bypass.auto_detection = config.dpc_auto? 0:1;
+    reg.dpc.bypass.rgrim = 1;
+    reg.dpc.threshold.threshold = config.dpc_threshold;
+
+    for(uint16_t i = 0; i < ISP_DEAD_PIXELS; ++i) {
+        reg.dpc_list.list_mem[i]._register = 0;
+        if(i < config.dpc_list.size()) {
+            reg.dpc_list.list_mem[i].op_code = config.dpc_list[i].op_code;
+            reg.dpc_list.list_mem[i].coord_x = config.dpc_list[i].x;
+            reg.dpc_list.list_mem[i].coord_y = config.dpc_list[i].y;
+        }
+    }
+
+    // Send the registers
+    beginBatch();
+    if(!config.dpc_list.empty())
+        avi_isp_dead_pixel_correction_list_mem_set_registers(&reg.dpc_list);
+    avi_isp_dead_pixel_correction_set_registers(&reg.dpc);
+    commit();
+}
+
 /**
  * Set the denoising coefficients
  * It applies a 7x7 sigma filter on each channel (note that the green imbalance is done before,
@@ -592,6 +792,79 @@ void ISP::sendDenoising(void) {
     avi_isp_denoising_set_registers(&reg.denoising);
 }
 
+/**
+ * @brief Set the lens shading calibration
+ *
+ * This uploads the lens shading correction grid, which corrects the vignetting of the lens by
+ * a per channel gain. The grid has 17 x 13 coefficients with the given cell size, starting at
+ * the top left of the capture window. The correction still has to be enabled in the bayer
+ * chain.
+ * @param[in] cell_w The width of a grid cell in pixels
+ * @param[in] cell_h The height of a grid cell in pixels
+ * @param[in] r_coeffs The ISP_GRID_COEFFS red coefficients row by row
+ * @param[in] g_coeffs The ISP_GRID_COEFFS green coefficients row by row
+ * @param[in] b_coeffs The ISP_GRID_COEFFS blue coefficients row by row
+ * @param[in] threshold The 10 bit threshold for the red, green and blue channel
+ * @param[in] gain The 10 bit gain for the red, green and blue channel
+ */
+void ISP::setLensShading(uint16_t cell_w, uint16_t cell_h, std::vector<uint8_t> &r_coeffs, std::vector<uint8_t> &g_coeffs, std::vector<uint8_t> &b_coeffs, std::vector<uint16_t> &threshold, std::vector<uint16_t> &gain) {
+    if(cell_w == 0 || cell_w > 511 || cell_h == 0 || cell_h > 1023)
+        throw std::runtime_error("Lens shading cell size " + std::to_string(cell_w) + "x" + std::to_string(cell_h) + " is not supported");
+    if(r_coeffs.size() != ISP_GRID_COEFFS || g_coeffs.size() != ISP_GRID_COEFFS || b_coeffs.size() != ISP_GRID_COEFFS)
+        throw std::runtime_error("Lens shading needs " + std::to_string(ISP_GRID_COEFFS) + " coefficients per channel");
+    if(threshold.size() != 3 || gain.size() != 3)
+        throw std::runtime_error("Lens shading needs a threshold and gain for every channel");
+
+    config.lsc_cell_w = cell_w;
+    config.lsc_cell_h = cell_h;
+    config.lsc_red = r_coeffs;
+    config.lsc_green = g_coeffs;
+    config.lsc_blue = b_coeffs;
+    config.lsc_threshold = threshold;
+    config.lsc_gain = gain;
+    sendLensShading();
+}
+
+/**
+ * @brief Send the lens shading configuration
+ *
+ * The configuration and the three coefficient memories are written in a single batch. Nothing
+ * is written when no calibration was set.
+ */
+void ISP::sendLensShading(void) {
+    if(config.lsc_red.empty())
+        return;
+
+    // Set the registers
+    reg.lsc.bayer_cfa.cfa = config.cfa;
+    reg.lsc.offset_x_y._register = 0;
+    reg.lsc.cell_id_x_y._register = 0;
+    reg.lsc.cell_w.cell_w = config.lsc_cell_w;
+    reg.lsc.cell_h.cell_h = config.lsc_cell_h;
+    reg.lsc.cell_w_inv.w_inv = (1 << 16) / config.lsc_cell_w;
+    reg.lsc.cell_h_inv.h_inv = (1 << 16) / config.lsc_cell_h;
+    reg.lsc.threshold.threshold_r = config.lsc_threshold[0];
+    reg.lsc.threshold.threshold_g = config.lsc_threshold[1];
+    reg.lsc.threshold.threshold_b = config.lsc_threshold[2];
+    reg.lsc.gain.gain_r = config.lsc_gain[0];
+    reg.lsc.gain.gain_g = config.lsc_gain[1];
+    reg.lsc.gain.gain_b = config.lsc_gain[2];
+
+    for(uint16_t i = 0; i < ISP_GRID_COEFFS; ++i) {
+        reg.lsc_red.red_coeff_mem[i].r_coeff_value = config.lsc_red[i];
+        reg.lsc_green.green_coeff_mem[i].g_coeff_value = config.lsc_green[i];
+        reg.lsc_blue.blue_coeff_mem[i].b_coeff_value = config.lsc_blue[i];
+    }
+
+    // Send the registers
+    beginBatch();
+    avi_isp_lens_shading_correction_set_registers(&reg.lsc);
+    avi_isp_lens_shading_correction_red_coeff_mem_set_registers(&reg.lsc_red);
+    avi_isp_lens_shading_correction_green_coeff_mem_set_registers(&reg.lsc_green);
+    avi_isp_lens_shading_correction_blue_coeff_mem_set_registers(&reg.lsc_blue);
+    commit();
+}
+
 /**
  * Set the demosaicking thresholds
  * Demosaicking is done with the Hamilton-Adams algorithm and it reconstructs
@@ -904,6 +1177,10 @@ void ISP::sendYUVStatistics(bool request, bool clear) {
     reg.yuv_stats.increments_log2.y_log2_inc = config.stat_incr_log2[1];
     reg.yuv_stats.awb_threshold.awb_threshold = config.stat_awb_threshold;
 
+    // The request and status are changed by the hardware, so always write them
+    markRegister(statistics_yuv, AVI_ISP_STATISTICS_YUV_MEASURE_REQ);
+    markRegister(statistics_yuv, AVI_ISP_STATISTICS_YUV_MEASURE_STATUS);
+
     // Send the register
     avi_isp_statistics_yuv_set_registers(&reg.yuv_stats);
 }
@@ -911,78 +1188,482 @@ void ISP::sendYUVStatistics(bool request, bool clear) {
 /**
  * @brief Request new YUV statistics
  *
- * This will request new YUV statistics when the new image arrives
+ * This will request new YUV statistics when the new image arrives. Only the request and
+ * status registers are written, the configuration is written when it changes.
  * @param clear Clear the previous results
  */
 void ISP::requestYUVStatistics(bool clear) {
-    sendYUVStatistics(true, clear);
+    union {
+        struct {
+            union avi_isp_statistics_yuv_measure_req req;
+            union avi_isp_statistics_yuv_measure_status status;
+        };
+        uint32_t words[2];
+    } regs = {};
+    regs.req.measure_req = 1;
+    regs.req.clear = (clear)? 1:0;
+
+    memcpy_to_registers(offsets[statistics_yuv] + AVI_ISP_STATISTICS_YUV_MEASURE_REQ, regs.words, sizeof(regs.words));
+}
+
+/**
+ * @brief Get the current YUV statistics
+ *
+ * Get the YUV statistics of the current image into a caller owned structure, which is used for
+ * Auto Exposure and Auto White Balancing. The status is read first and the results and the
+ * histogram are only read when the measurement is done, each in a single burst.
+ * @param[out] stats The YUV statistics (only the status is valid when not done)
+ * @return True when the statistics are done without an error
+ */
+bool ISP::getYUVStatistics(struct statistics_t &stats) {
+    uint32_t base = offsets[statistics_yuv];
+
+    // Check the status first
+    struct avi_isp_statistics_yuv_regs stats_yuv;
+    memcpy_from_registers(&stats_yuv.measure_status, base + AVI_ISP_STATISTICS_YUV_MEASURE_STATUS, sizeof(stats_yuv.measure_status));
+    stats.done = stats_yuv.measure_status.done;
+    stats.error = stats_yuv.measure_status.error;
+    if(!stats.done)
+        return false;
+
+    // Read the results from the valid Y count up to the grey pixel count
+    memcpy_from_registers(&stats_yuv.ae_nb_valid_y, base + AVI_ISP_STATISTICS_YUV_AE_NB_VALID_Y,
+                          AVI_ISP_STATISTICS_YUV_AWB_NB_GREY_PIXELS + sizeof(uint32_t) - AVI_ISP_STATISTICS_YUV_AE_NB_VALID_Y);
+    stats.awb_sum[0] = stats_yuv.awb_sum_y.awb_sum_y;
+    stats.awb_sum[1] = stats_yuv.awb_sum_u.awb_sum_u;
+    stats.awb_sum[2] = stats_yuv.awb_sum_v.awb_sum_v;
+    stats.nb_y = stats_yuv.ae_nb_valid_y.nb_valid_y;
+    stats.nb_grey = stats_yuv.awb_nb_grey_pixels.nb_grey_pixels;
+
+    // Read the histogram directly into the output and strip the unused bits
+    static_assert(sizeof(stats.hist_y) == sizeof(struct avi_isp_statistics_yuv_ae_histogram_y_regs), "Histogram size mismatch");
+    memcpy_from_registers(stats.hist_y, offsets[statistics_yuv_ae_histogram_y], sizeof(stats.hist_y));
+    for(uint16_t i = 0; i < 256; ++i) {
+        union avi_isp_statistics_yuv_ae_histogram_y bin;
+        bin._register = stats.hist_y[i];
+        stats.hist_y[i] = bin.histogram_y;
+    }
+
+    return !stats.error;
 }
 
 /**
  * @brief Get the current YUV statistics
  *
- * Get the YUV statistics of the current image. Used for Auto White Balancing.
  * @return The YUV statistics
  */
 struct ISP::statistics_t ISP::getYUVStatistics(void) {
-    // Request basic statistics
-    struct avi_isp_statistics_yuv_regs stats_yuv;
-    avi_isp_statistics_yuv_get_registers(&stats_yuv);
+    struct statistics_t stats = {};
+    getYUVStatistics(stats);
+    return stats;
+}
+
+/**
+ * @brief Start harvesting the YUV statistics in a thread
+ *
+ * The thread requests the statistics, polls the status and reads the results as soon as
+ * they are done, after which it requests new statistics. The capture path then only takes
+ * the latest results with getLatestYUVStatistics and never waits for the registers.
+ * @param[in] poll_us The polling period of the status in microseconds
+ */
+void ISP::startStatisticsThread(uint32_t poll_us) {
+    if(stats_thread.joinable())
+        return;
+    if(!registers) {
+        throw std::runtime_error("ISP can't harvest statistics before it is configured");
+    }
+
+    stats_poll_us = poll_us;
+    stats_fresh = false;
+    stats_running = true;
+    stats_thread = std::thread(&ISP::statisticsLoop, this);
+}
+
+/**
+ * @brief Stop harvesting the YUV statistics
+ *
+ * This waits for the statistics thread to finish.
+ */
+void ISP::stopStatisticsThread(void) {
+    if(!stats_thread.joinable())
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(stats_mutex);
+        stats_running = false;
+    }
+    stats_cond.notify_all();
+    stats_thread.join();
+}
+
+/**
+ * @brief Take the latest harvested YUV statistics
+ *
+ * This doesn't access the registers, so it is cheap enough to call for every frame.
+ * @param[out] stats The latest YUV statistics
+ * @return True when new statistics were harvested since the last call
+ */
+bool ISP::getLatestYUVStatistics(struct statistics_t &stats) {
+    std::lock_guard<std::mutex> lock(stats_mutex);
+    if(!stats_fresh)
+        return false;
+
+    stats = stats_latest;
+    stats_fresh = false;
+    return true;
+}
+
+/**
+ * @brief Harvest the YUV statistics
+ *
+ * When a measurement doesn't finish within 100ms, for example because the configuration was
+ * rewritten in between, it is requested again.
+ */
+void ISP::statisticsLoop(void) {
+    struct statistics_t stats;
+    uint32_t waited_us = 0;
+    requestYUVStatistics(true);
+
+    std::unique_lock<std::mutex> lock(stats_mutex);
+    while(stats_running) {
+        stats_cond.wait_for(lock, std::chrono::microseconds(stats_poll_us));
+        if(!stats_running)
+            break;
+
+        // Read the statistics without blocking the consumer
+        lock.unlock();
+        getYUVStatistics(stats);
+        lock.lock();
+
+        if(stats.done) {
+            stats_latest = stats;
+            stats_fresh = true;
+        } else if(waited_us < 100000) {
+            waited_us += stats_poll_us;
+            continue;
+        }
+
+        waited_us = 0;
+        lock.unlock();
+        requestYUVStatistics(true);
+        lock.lock();
+    }
+}
+
+/**
+ * @brief Set the Bayer statistics settings
+ *
+ * The Bayer statistics divide a rectangle into a grid of equally sized windows and measure
+ * every window on the linear Bayer data, before the gamma correction. Only pixels inside the
+ * circle are used. Note that all parameters are in pixels from the sensor without any binning!
+ * @param left The left offset from the camera output window in sensor pixels
+ * @param top The top offset from the camera output window in sensor pixels
+ * @param width The width of the statistics area in sensor pixels
+ * @param height The height of the statistics area in sensor pixels
+ * @param windows_x The amount of windows in the horizontal direction (at most BAYERSTATS_STATX)
+ * @param windows_y The amount of windows in the vertical direction (at most BAYERSTATS_STATY)
+ * @param center_x The center x coordinate of the circle in sensor pixels from the sensor coordinates
+ * @param center_y The center y coordinate of the circle in sensor pixels from the sensor coordinates
+ * @param radius The circle radius in sensor pixels for the intersection with the rectangle
+ * @param incr_log2 The increment used for binning
+ * @param sat_threshold The 10 bit value above which pixels are counted as saturated
+ */
+void ISP::setStatisticsBayer(uint32_t left, uint32_t top, uint32_t width, uint32_t height, uint8_t windows_x, uint8_t windows_y, uint32_t center_x, uint32_t center_y, uint32_t radius, std::vector<uint8_t> &incr_log2, uint16_t sat_threshold) {
+    if(windows_x == 0 || windows_x > BAYERSTATS_STATX || windows_y == 0 || windows_y > BAYERSTATS_STATY)
+        throw std::runtime_error("Bayer statistics grid of " + std::to_string(windows_x) + "x" + std::to_string(windows_y) + " windows is not supported");
+    if(width / windows_x > 2047 || height / windows_y > 2047)
+        throw std::runtime_error("Bayer statistics windows of " + std::to_string(width / windows_x) + "x" + std::to_string(height / windows_y) + " pixels are too large");
+
+    config.bstat_left = left;
+    config.bstat_top = top;
+    config.bstat_width = width;
+    config.bstat_height = height;
+    config.bstat_windows_x = windows_x;
+    config.bstat_windows_y = windows_y;
+    config.bstat_center_x = center_x;
+    config.bstat_center_y = center_y;
+    config.bstat_radius = radius;
+    config.bstat_incr_log2 = incr_log2;
+    config.bstat_sat_threshold = sat_threshold;
+    sendBayerStatistics();
+}
+
+/**
+ * @brief Send the Bayer statistics configuration
+ */
+void ISP::sendBayerStatistics(void) {
+    assert(config.bstat_incr_log2.size() == 2);
+
+    // Set the registers
+    reg.bayer_stats.measure_req.clear = 0;
+    reg.bayer_stats.window_x.x_offset = config.bstat_left;
+    reg.bayer_stats.window_x.x_width = config.bstat_width / config.bstat_windows_x;
+    reg.bayer_stats.window_y.y_offset = config.bstat_top;
+    reg.bayer_stats.window_y.y_width = config.bstat_height / config.bstat_windows_y;
+    reg.bayer_stats.circle_pos_x_center.x_center = config.bstat_center_x;
+    reg.bayer_stats.circle_pos_x_squared.x_squared = config.bstat_center_x * config.bstat_center_x;
+    reg.bayer_stats.circle_pos_y_center.y_center = config.bstat_center_y;
+    reg.bayer_stats.circle_pos_y_squared.y_squared = config.bstat_center_y * config.bstat_center_y;
+    reg.bayer_stats.circle_radius_squared.radius_squared = config.bstat_radius * config.bstat_radius;
+    reg.bayer_stats.increments_log2.x_log2_inc = config.bstat_incr_log2[0];
+    reg.bayer_stats.increments_log2.y_log2_inc = config.bstat_incr_log2[1];
+    reg.bayer_stats.sat_threshold.threshold = config.bstat_sat_threshold;
+    reg.bayer_stats.cfa.cfa = config.cfa;
+    reg.bayer_stats.max_nb_windows.x_window_count = config.bstat_windows_x;
+    reg.bayer_stats.max_nb_windows.y_window_count = config.bstat_windows_y;
+
+    // Send the register
+    avi_isp_statistics_bayer_set_registers(&reg.bayer_stats);
+}
+
+/**
+ * @brief Clear the Bayer statistics
+ *
+ * This only writes the clear request, the configuration is written when it changes.
+ */
+void ISP::clearBayerStatistics(void) {
+    union avi_isp_statistics_bayer_measure_req req;
+    req._register = 0;
+    req.clear = 1;
+
+    memcpy_to_registers(offsets[statistics_bayer] + AVI_ISP_STATISTICS_BAYER_MEASURE_REQ, &req, sizeof(req));
+}
+
+/**
+ * @brief Parse the Bayer statistics
+ *
+ * The Bayer statistics are not available in registers, but are written by the AVI as a
+ * thumbnail of BAYERSTATS_STATX x BAYERSTATS_STATY windows to the statistics capture node.
+ * Every window consists of four 32 bit words: the red, green and blue sums and the amount of
+ * saturated pixels. Only the configured grid of windows is valid and copied, together with
+ * the totals over all windows. This layout is an assumption (see bayer_window_t), which can be
+ * checked against the model of ISPRegistersMemory::measureBayerStatistics.
+ * @param[in] frame The captured statistics frame
+ * @param[out] stats The Bayer statistics
+ * @return True when the frame contains the configured grid
+ */
+bool ISP::getBayerStatistics(Image::Ptr frame, struct bayer_statistics_t &stats) {
+    uint32_t windows_x = config.bstat_windows_x;
+    uint32_t windows_y = config.bstat_windows_y;
+    if(frame->getSize() < windows_y * BAYERSTATS_STATX * sizeof(struct bayer_window_t))
+        return false;
+
+    stats.windows_x = windows_x;
+    stats.windows_y = windows_y;
+    stats.sum_r = 0;
+    stats.sum_g = 0;
+    stats.sum_b = 0;
+    stats.saturated = 0;
+
+    const struct bayer_window_t *src = (const struct bayer_window_t *)frame->getData();
+    for(uint32_t y = 0; y < windows_y; ++y) {
+        memcpy(stats.windows[y], &src[y * BAYERSTATS_STATX], windows_x * sizeof(struct bayer_window_t));
+
+        for(uint32_t x = 0; x < windows_x; ++x) {
+            stats.sum_r += stats.windows[y][x].sum_r;
+            stats.sum_g += stats.windows[y][x].sum_g;
+            stats.sum_b += stats.windows[y][x].sum_b;
+            stats.saturated += stats.windows[y][x].saturated;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * @brief Start a batch of register writes
+ *
+ * All register changes after this call are only recorded in the shadow registers until the
+ * matching commit(). This makes it possible to change several blocks, like the gamma LUTs
+ * and the color space conversion, in one go. Batches can be nested, the registers are
+ * written when the outer batch is committed.
+ */
+void ISP::beginBatch(void) {
+    ++batch_depth;
+}
+
+/**
+ * @brief Commit a batch of register writes
+ *
+ * This will write all changed register words of the batch to the hardware, in the order the
+ * blocks were first changed.
+ */
+void ISP::commit(void) {
+    assert(batch_depth > 0);
+    if(--batch_depth > 0)
+        return;
+
+    for(uint8_t node : dirty_nodes) {
+        flushRegisters(node);
+        shadow[node].queued = false;
+    }
+    dirty_nodes.clear();
+
+    std::lock_guard<std::mutex> lock(io_mutex);
+    io_stats.commits++;
+}
+
+/**
+ * @brief Invalidate the shadow registers
+ *
+ * This should be called when the hardware registers could have been changed outside of this
+ * driver, for example after a reset of the ISP. The next write of every block will then write
+ * all of its words.
+ */
+void ISP::invalidateRegisters(void) {
+    for(uint16_t i = 0; i < ISP_NODE_NR; ++i) {
+        shadow[i].dirty.assign(shadow[i].dirty.size(), false);
+        shadow[i].dirty_first = UINT32_MAX;
+        shadow[i].dirty_last = 0;
+        shadow[i].valid = false;
+    }
+}
 
-    // Request Y histogram
-    struct avi_isp_statistics_yuv_ae_histogram_y_regs hist;
-    avi_isp_statistics_yuv_ae_histogram_y_get_registers(&hist);
+/**
+ * @brief Get the register access counters
+ *
+ * This returns the amount of register reads and writes, and the amount of writes which were
+ * skipped because the value in the hardware was already correct.
+ * @return A copy of the counters
+ */
+struct ISP::io_statistics_t ISP::getIOStatistics(void) {
+    std::lock_guard<std::mutex> lock(io_mutex);
+    return io_stats;
+}
 
-    // Set the statistics
-    struct statistics_t stat;
-    stat.done = stats_yuv.measure_status.done;
-    stat.error = stats_yuv.measure_status.error;
-    stat.awb_sum = {stats_yuv.awb_sum_y.awb_sum_y, stats_yuv.awb_sum_u.awb_sum_u, stats_yuv.awb_sum_v.awb_sum_v};
-    stat.nb_y = stats_yuv.ae_nb_valid_y.nb_valid_y;
-    stat.nb_grey = stats_yuv.awb_nb_grey_pixels.nb_grey_pixels;
+/**
+ * @brief Write a register block through the shadow registers
+ *
+ * This compares the new values with the shadow of the block and only marks the words which
+ * changed as dirty. Outside of a batch the dirty words are written immediately. Without a
+ * register backend only the configuration is stored, which is written completely by configure.
+ * @param[in] node The register node
+ * @param[in] regs The new register values
+ * @param[in] s The size of the register block in bytes
+ */
+void ISP::writeRegisters(uint8_t node, const void *regs, size_t s) {
+    if(!registers)
+        return;
+
+    struct shadow_t &sh = shadow[node];
+    const uint32_t *words = (const uint32_t *)regs;
+    uint32_t count = s / sizeof(uint32_t);
+    uint32_t skipped = 0;
+
+    if(!sh.valid) {
+        // Unknown hardware state so write everything
+        sh.words.assign(words, words + count);
+        sh.dirty.assign(count, true);
+        sh.dirty_first = 0;
+        sh.dirty_last = count;
+        sh.valid = true;
+    } else {
+        assert(sh.words.size() == count);
+        for(uint32_t i = 0; i < count; ++i) {
+            if(words[i] != sh.words[i]) {
+                sh.words[i] = words[i];
+                sh.dirty[i] = true;
+                sh.dirty_first = std::min(sh.dirty_first, i);
+                sh.dirty_last = std::max(sh.dirty_last, i + 1);
+            } else if(!sh.dirty[i]) {
+                skipped++;
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(io_mutex);
+        io_stats.skipped += skipped;
+    }
 
-    // Fill the histogram
-    stat.hist_y.resize(256);
-    for(uint16_t i = 0; i < 256; ++i)
-        stat.hist_y[i] = hist.ae_histogram_y[i].histogram_y;
+    // Write directly or queue for the commit
+    if(batch_depth == 0) {
+        flushRegisters(node);
+    } else if(!sh.queued) {
+        sh.queued = true;
+        dirty_nodes.push_back(node);
+    }
+}
 
-    return stat;
+/**
+ * @brief Mark a register as dirty
+ *
+ * The register will be written at the next write of the block, even when the value did not
+ * change. This is needed for registers which are modified by the hardware, like requests and
+ * status bits.
+ * @param[in] node The register node
+ * @param[in] offset The offset of the register within the block in bytes
+ */
+void ISP::markRegister(uint8_t node, uint32_t offset) {
+    struct shadow_t &sh = shadow[node];
+    uint32_t i = offset / sizeof(uint32_t);
+
+    // An invalid shadow is written completely anyway
+    if(!sh.valid)
+        return;
+
+    assert(i < sh.words.size());
+    sh.dirty[i] = true;
+    sh.dirty_first = std::min(sh.dirty_first, i);
+    sh.dirty_last = std::max(sh.dirty_last, i + 1);
+}
+
+/**
+ * @brief Write the dirty words of a block
+ *
+ * Consecutive dirty words are written as a single run.
+ * @param[in] node The register node
+ */
+void ISP::flushRegisters(uint8_t node) {
+    struct shadow_t &sh = shadow[node];
+
+    uint32_t i = sh.dirty_first;
+    while(i < sh.dirty_last) {
+        if(!sh.dirty[i]) {
+            ++i;
+            continue;
+        }
+
+        uint32_t start = i;
+        while(i < sh.dirty_last && sh.dirty[i])
+            sh.dirty[i++] = false;
+        memcpy_to_registers(offsets[node] + start * sizeof(uint32_t), &sh.words[start], (i - start) * sizeof(uint32_t));
+    }
+
+    sh.dirty_first = UINT32_MAX;
+    sh.dirty_last = 0;
 }
 
 /**
  * Copy to registers
- * Note that this functions is really unsafe as it does no checking at all!
- * Do not run this on your own computer!
- * @param[in] addr The register start address
+ * @param[in] addr The register start address from the AVI base
  * @param[in] reg_base The register values starting pointer
  * @param[in] s The size to write
  */
-void ISP::memcpy_to_registers(unsigned long addr, const void *reg_base, size_t s) {
-    const uint32_t *reg = (const uint32_t *)reg_base;
-    unsigned i;
+void ISP::memcpy_to_registers(uint32_t addr, const void *reg_base, size_t s) {
+    if(!registers) {
+        throw std::runtime_error("ISP can't write registers before it is configured");
+    }
 
+    std::lock_guard<std::mutex> lock(io_mutex);
     s /= sizeof(uint32_t); /* we write one register at a time */
-
-    for (i = 0; i < s; i++)
-        *((volatile uint32_t *)(addr + i * sizeof(uint32_t))) = reg[i];
+    io_stats.writes += s;
+    registers->write(addr, (const uint32_t *)reg_base, s);
 }
 
 /**
  * Copy from registers
- * Note that this functions is really unsafe as it does no checking at all!
- * Do not run this on your own computer!
  * @param[in] reg_base The output pointer where the registers should be written to
- * @param[in] addr The register start address
+ * @param[in] addr The register start address from the AVI base
  * @param[in] s The size to read
  */
-void ISP::memcpy_from_registers(void *reg_base, unsigned long addr, size_t s) {
-    uint32_t *reg = (uint32_t *)reg_base;
-    unsigned i;
+void ISP::memcpy_from_registers(void *reg_base, uint32_t addr, size_t s) {
+    if(!registers) {
+        throw std::runtime_error("ISP can't read registers before it is configured");
+    }
 
+    std::lock_guard<std::mutex> lock(io_mutex);
     s /= sizeof(uint32_t); /* we read one register at a time */
-
-    for (i = 0; i < s; i++)
-        reg[i] = *((volatile uint32_t *)(addr + i * sizeof(uint32_t)));
+    io_stats.reads += s;
+    registers->read(addr, (uint32_t *)reg_base, s);
 }
 
 /**
@@ -1013,7 +1694,7 @@ float ISP::Q2_11ToFloat(uint16_t var) {
 
 #define EXPAND_AS_FUNCTION(_node)                                                                \
   void ISP::avi_isp_ ## _node ## _set_registers(struct avi_isp_ ## _node ## _regs const *regs) { \
-    memcpy_to_registers(offsets[_node], regs, sizeof(*regs));                                    \
+    writeRegisters(_node, regs, sizeof(*regs));                                                  \
   }                                                                                              \
                                                                                                  \
   void ISP::avi_isp_ ## _node ## _get_registers(struct avi_isp_ ## _node ## _regs *regs) {       \
@@ -0,0 +1,107 @@
+/*
+ * This file is part of the TUV library (https://github.com/tudelft/tudelft_vision).
+ * Copyright (c) 2016 Freek van Tienen <freek.v.tienen@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "drivers/isp_registers_devmem.h"
+
+#include <string>
+#include <cstring>
+#include <stdexcept>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/ioctl.h>
+#include <assert.h>
+#include <unistd.h>
+
+/**
+ * @brief Map the ISP registers of the hardware
+ *
+ * This will map the AVI block from /dev/mem and request the offsets of the ISP blocks from the
+ * video driver.
+ * @param[in] fd The video device connected to the ISP
+ */
+ISPRegistersDevMem::ISPRegistersDevMem(int fd) {
+    // Open memory device
+    devmem = open("/dev/mem", O_RDWR);
+    if (devmem < 0) {
+        throw std::runtime_error(std::string("Could not open /dev/mem (") + strerror(errno) + ")");
+    }
+
+    // Get the base
+    void *base = mmap(NULL, AVI_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, devmem, AVI_BASE & ~AVI_MASK);
+    if (base == MAP_FAILED) {
+        close(devmem);
+        throw std::runtime_error(std::string("Could not mmap /dev/mem (") + strerror(errno) + ")");
+    }
+    avi_base = (volatile uint8_t *) base;
+
+    // Try to get the ISP offsets
+    if (ioctl(fd, AVI_ISP_IOGET_OFFSETS, &offsets) < 0) {
+        munmap(base, AVI_SIZE);
+        close(devmem);
+        throw std::runtime_error(std::string("Could not get ISP offsets AVI_ISP_IOGET_OFFSETS (") + strerror(errno) + ")");
+    }
+}
+
+/**
+ * @brief Unmap the ISP registers
+ */
+ISPRegistersDevMem::~ISPRegistersDevMem(void) {
+    munmap((void *) avi_base, AVI_SIZE);
+    close(devmem);
+}
+
+/**
+ * @brief Get the ISP offsets
+ *
+ * @return The offsets of the ISP blocks as reported by the video driver
+ */
+struct avi_isp_offsets ISPRegistersDevMem::getOffsets(void) {
+    return offsets;
+}
+
+/**
+ * @brief Write to the registers
+ *
+ * This writes one register at a time, since the hardware only supports 32 bit accesses.
+ * @param[in] addr The address of the first register from the AVI base
+ * @param[in] words The register values
+ * @param[in] count The amount of registers to write
+ */
+void ISPRegistersDevMem::write(uint32_t addr, const uint32_t *words, uint32_t count) {
+    assert(addr + count * sizeof(uint32_t) <= AVI_SIZE);
+    volatile uint32_t *reg = (volatile uint32_t *)(avi_base + addr);
+
+    for (uint32_t i = 0; i < count; i++)
+        reg[i] = words[i];
+}
+
+/**
+ * @brief Read from the registers
+ *
+ * This reads one register at a time, since the hardware only supports 32 bit accesses.
+ * @param[in] addr The address of the first register from the AVI base
+ * @param[out] words The register values
+ * @param[in] count The amount of registers to read
+ */
+void ISPRegistersDevMem::read(uint32_t addr, uint32_t *words, uint32_t count) {
+    assert(addr + count * sizeof(uint32_t) <= AVI_SIZE);
+    volatile uint32_t *reg = (volatile uint32_t *)(avi_base + addr);
+
+    for (uint32_t i = 0; i < count; i++)
+        words[i] = reg[i];
+}
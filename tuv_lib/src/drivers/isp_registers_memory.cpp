@@ -0,0 +1,301 @@
+/*
+ * This file is part of the TUV library (https://github.com/tudelft/tudelft_vision).
+ * Copyright (c) 2016 Freek van Tienen <freek.v.tienen@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "drivers/isp_registers_memory.h"
+
+#include "vision/image_buffer.h"
+
+#include <string>
+#include <cstring>
+#include <stdexcept>
+#include <algorithm>
+#include <stdlib.h>
+#include <sys/mman.h>
+
+/**
+ * @brief Create a register file with a default layout
+ *
+ * The ISP blocks are placed 64KiB apart, so they don't overlap.
+ */
+ISPRegistersMemory::ISPRegistersMemory(void) :
+    ISPRegistersMemory({0x10000, 0x20000, 0x30000, 0x40000, 0x50000}) {
+
+}
+
+/**
+ * @brief Create a register file
+ *
+ * This allocates AVI_SIZE bytes of zeroed anonymous memory as register file.
+ * @param[in] offsets The offsets of the ISP blocks from the AVI base
+ */
+ISPRegistersMemory::ISPRegistersMemory(const struct avi_isp_offsets &offsets) :
+    offsets(offsets) {
+    void *base = mmap(NULL, AVI_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) {
+        throw std::runtime_error(std::string("Could not allocate the ISP register file (") + strerror(errno) + ")");
+    }
+    data = (uint8_t *) base;
+}
+
+/**
+ * @brief Free the register file
+ */
+ISPRegistersMemory::~ISPRegistersMemory(void) {
+    munmap(data, AVI_SIZE);
+}
+
+/**
+ * @brief Get the ISP offsets
+ *
+ * @return The offsets of the ISP blocks within the register file
+ */
+struct avi_isp_offsets ISPRegistersMemory::getOffsets(void) {
+    return offsets;
+}
+
+/**
+ * @brief Write to the registers
+ *
+ * When a statistics image is set and the YUV statistics measurement is requested, the
+ * statistics are calculated directly and the request is cleared like the hardware does.
+ * @param[in] addr The address of the first register from the AVI base
+ * @param[in] words The register values
+ * @param[in] count The amount of registers to write
+ */
+void ISPRegistersMemory::write(uint32_t addr, const uint32_t *words, uint32_t count) {
+    if(addr + count * sizeof(uint32_t) > AVI_SIZE)
+        throw std::runtime_error("ISP register write at " + std::to_string(addr) + " is outside the register file");
+
+    memcpy(data + addr, words, count * sizeof(uint32_t));
+
+    // Model the YUV statistics when the request was written
+    uint32_t req_addr = offsets.statistics_yuv + AVI_ISP_STATISTICS_YUV + AVI_ISP_STATISTICS_YUV_MEASURE_REQ;
+    if(stats_image != nullptr && addr <= req_addr && req_addr < addr + count * sizeof(uint32_t))
+        measureYUVStatistics();
+}
+
+/**
+ * @brief Read from the registers
+ *
+ * @param[in] addr The address of the first register from the AVI base
+ * @param[out] words The register values
+ * @param[in] count The amount of registers to read
+ */
+void ISPRegistersMemory::read(uint32_t addr, uint32_t *words, uint32_t count) {
+    if(addr + count * sizeof(uint32_t) > AVI_SIZE)
+        throw std::runtime_error("ISP register read at " + std::to_string(addr) + " is outside the register file");
+
+    memcpy(words, data + addr, count * sizeof(uint32_t));
+}
+
+/**
+ * @brief Get the register file
+ *
+ * This can be used to inspect or modify the registers directly, for example to simulate
+ * status changes of the hardware.
+ * @return The start of the register file of AVI_SIZE bytes
+ */
+void *ISPRegistersMemory::getData(void) {
+    return data;
+}
+
+/**
+ * @brief Set the source image of the YUV statistics
+ *
+ * Every requested measurement is calculated over this image, in image pixels instead of
+ * sensor pixels. When no image is set the statistics registers are left untouched.
+ * @param[in] img The source image (UYVY, YUYV or GRAY8) or nullptr to disable the model
+ */
+void ISPRegistersMemory::setStatisticsImage(Image::Ptr img) {
+    if(img != nullptr && img->getPixelFormat() != Image::FMT_UYVY && img->getPixelFormat() != Image::FMT_YUYV
+            && img->getPixelFormat() != Image::FMT_GRAY8)
+        throw std::runtime_error("Statistics image pixel format " + std::to_string(img->getPixelFormat()) + " is not supported");
+
+    stats_image = img;
+}
+
+/**
+ * @brief Calculate the YUV statistics
+ *
+ * This follows the configuration in the statistics registers: the window, the circle, the
+ * increments and the AWB threshold. A pixel is counted as grey when |U| + |V| (around 128)
+ * is below threshold x Y / 256.
+ */
+void ISPRegistersMemory::measureYUVStatistics(void) {
+    struct avi_isp_statistics_yuv_regs *regs = (struct avi_isp_statistics_yuv_regs *)
+            (data + offsets.statistics_yuv + AVI_ISP_STATISTICS_YUV);
+    struct avi_isp_statistics_yuv_ae_histogram_y_regs *hist = (struct avi_isp_statistics_yuv_ae_histogram_y_regs *)
+            (data + offsets.statistics_yuv + AVI_ISP_STATISTICS_YUV_AE_HISTOGRAM_Y);
+
+    if(regs->measure_req.clear) {
+        memset(hist, 0, sizeof(*hist));
+        regs->ae_nb_valid_y._register = 0;
+        regs->awb_sum_y._register = 0;
+        regs->awb_sum_u._register = 0;
+        regs->awb_sum_v._register = 0;
+        regs->awb_nb_grey_pixels._register = 0;
+        regs->measure_status._register = 0;
+    }
+
+    if(!regs->measure_req.measure_req)
+        return;
+
+    // Parse the image layout
+    const uint8_t *buf = (const uint8_t *)stats_image->getData();
+    uint32_t stride = stats_image->getStride();
+    uint32_t width = stats_image->getWidth();
+    uint32_t height = stats_image->getHeight();
+    bool gray = (stats_image->getPixelFormat() == Image::FMT_GRAY8);
+    uint8_t y_off = (stats_image->getPixelFormat() == Image::FMT_UYVY)? 1 : 0;
+
+    // Get the configuration
+    uint32_t x_end = std::min((uint32_t)regs->window_pos_x.window_x_end, width);
+    uint32_t y_end = std::min((uint32_t)regs->window_pos_y.window_y_end, height);
+    uint32_t x_step = 1 << regs->increments_log2.x_log2_inc;
+    uint32_t y_step = 1 << regs->increments_log2.y_log2_inc;
+    int64_t x_center = regs->circle_pos_x_center.x_center;
+    int64_t y_center = regs->circle_pos_y_center.y_center;
+    int64_t radius_squared = regs->circle_radius_squared.radius_squared;
+    uint32_t threshold = regs->awb_threshold.awb_threshold;
+
+    // Accumulate the statistics
+    uint32_t nb_y = 0, nb_grey = 0;
+    uint64_t sum_y = 0, sum_u = 0, sum_v = 0;
+    uint32_t histogram[256] = {0};
+    for(uint32_t y = regs->window_pos_y.window_y_start; y < y_end; y += y_step) {
+        const uint8_t *row = buf + y * stride;
+        for(uint32_t x = regs->window_pos_x.window_x_start; x < x_end; x += x_step) {
+            int64_t dx = x - x_center;
+            int64_t dy = y - y_center;
+            if(dx * dx + dy * dy > radius_squared)
+                continue;
+
+            uint8_t val_y, val_u, val_v;
+            if(gray) {
+                val_y = row[x];
+                val_u = 128;
+                val_v = 128;
+            } else {
+                const uint8_t *pair = row + (x & ~1) * 2;
+                val_y = row[x * 2 + y_off];
+                val_u = pair[1 - y_off];
+                val_v = pair[3 - y_off];
+            }
+
+            histogram[val_y]++;
+            nb_y++;
+            if((uint32_t)(abs(val_u - 128) + abs(val_v - 128)) * 256 < threshold * val_y) {
+                sum_y += val_y;
+                sum_u += val_u;
+                sum_v += val_v;
+                nb_grey++;
+            }
+        }
+    }
+
+    // Write the results and finish the request like the hardware
+    for(uint16_t i = 0; i < 256; ++i)
+        hist->ae_histogram_y[i].histogram_y = hist->ae_histogram_y[i].histogram_y + histogram[i];
+    regs->ae_nb_valid_y.nb_valid_y = regs->ae_nb_valid_y.nb_valid_y + nb_y;
+    regs->awb_sum_y.awb_sum_y = regs->awb_sum_y.awb_sum_y + sum_y;
+    regs->awb_sum_u.awb_sum_u = regs->awb_sum_u.awb_sum_u + sum_u;
+    regs->awb_sum_v.awb_sum_v = regs->awb_sum_v.awb_sum_v + sum_v;
+    regs->awb_nb_grey_pixels.nb_grey_pixels = regs->awb_nb_grey_pixels.nb_grey_pixels + nb_grey;
+    regs->measure_status.done = 1;
+    regs->measure_status.error = 0;
+    regs->measure_req._register = 0;
+}
+
+/**
+ * @brief Create the Bayer statistics frame of a raw image
+ *
+ * This follows the configuration in the Bayer statistics registers: the window offsets and
+ * sizes, the amount of windows, the circle, the increments and the saturation threshold. The
+ * 8 bit values of the raw image are scaled to 10 bit. Within every 2x2 quad the red pixel is
+ * at (cfa & 1, cfa >> 1), the blue pixel diagonal to it and the other two pixels are green.
+ * The frame has the layout which ISP::getBayerStatistics expects: BAYERSTATS_STATY rows of
+ * BAYERSTATS_STATX windows, where every window consists of the red, green and blue sums and
+ * the amount of saturated pixels as 32 bit words. Windows outside the configured grid are
+ * zero.
+ * @param[in] raw The raw Bayer image (GRAY8) in sensor pixels
+ * @return The statistics frame
+ */
+Image::Ptr ISPRegistersMemory::measureBayerStatistics(Image::Ptr raw) {
+    if(raw->getPixelFormat() != Image::FMT_GRAY8)
+        throw std::runtime_error("Raw image pixel format " + std::to_string(raw->getPixelFormat()) + " is not supported");
+
+    struct avi_isp_statistics_bayer_regs *regs = (struct avi_isp_statistics_bayer_regs *)
+            (data + offsets.chain_bayer + AVI_ISP_STATISTICS_BAYER);
+
+    // Parse the image layout
+    const uint8_t *buf = (const uint8_t *)raw->getData();
+    uint32_t stride = raw->getStride();
+    uint32_t width = raw->getWidth();
+    uint32_t height = raw->getHeight();
+
+    // Get the configuration
+    uint32_t windows_x = std::min((uint32_t)regs->max_nb_windows.x_window_count, (uint32_t)BAYERSTATS_STATX);
+    uint32_t windows_y = std::min((uint32_t)regs->max_nb_windows.y_window_count, (uint32_t)BAYERSTATS_STATY);
+    uint32_t x_offset = regs->window_x.x_offset;
+    uint32_t y_offset = regs->window_y.y_offset;
+    uint32_t x_width = regs->window_x.x_width;
+    uint32_t y_width = regs->window_y.y_width;
+    uint32_t x_step = 1 << regs->increments_log2.x_log2_inc;
+    uint32_t y_step = 1 << regs->increments_log2.y_log2_inc;
+    int64_t x_center = regs->circle_pos_x_center.x_center;
+    int64_t y_center = regs->circle_pos_y_center.y_center;
+    int64_t radius_squared = regs->circle_radius_squared.radius_squared;
+    uint32_t threshold = regs->sat_threshold.threshold;
+    uint32_t red_x = regs->cfa.cfa & 1;
+    uint32_t red_y = regs->cfa.cfa >> 1;
+
+    // Accumulate every window
+    Image::Ptr frame = std::make_shared<ImageBuffer>(Image::FMT_GRAY8, BAYERSTATS_STATX * 4 * sizeof(uint32_t), BAYERSTATS_STATY);
+    uint32_t *out = (uint32_t *)frame->getData();
+    memset(out, 0, frame->getSize());
+    for(uint32_t wy = 0; wy < windows_y; ++wy) {
+        for(uint32_t wx = 0; wx < windows_x; ++wx) {
+            uint32_t *window = out + (wy * BAYERSTATS_STATX + wx) * 4;
+            uint32_t x_end = std::min(x_offset + (wx + 1) * x_width, width);
+            uint32_t y_end = std::min(y_offset + (wy + 1) * y_width, height);
+
+            for(uint32_t y = y_offset + wy * y_width; y < y_end; y += y_step) {
+                for(uint32_t x = x_offset + wx * x_width; x < x_end; x += x_step) {
+                    int64_t dx = x - x_center;
+                    int64_t dy = y - y_center;
+                    if(dx * dx + dy * dy > radius_squared)
+                        continue;
+
+                    uint32_t val = buf[y * stride + x] << 2;
+                    bool red_row = ((y & 1) == red_y);
+                    bool red_col = ((x & 1) == red_x);
+                    if(red_row && red_col)
+                        window[0] += val;
+                    else if(!red_row && !red_col)
+                        window[2] += val;
+                    else
+                        window[1] += val;
+
+                    if(val > threshold)
+                        window[3]++;
+                }
+            }
+        }
+    }
+
+    return frame;
+}
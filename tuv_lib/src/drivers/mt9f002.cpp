@@ -57,6 +57,16 @@ MT9F002::MT9F002(I2CBus *i2c_bus, enum interfaces interface, struct pll_config_t
     gain_config.blue       = 4.0;
     gain_config.green2     = 3.0;
 
+    initialize();
+}
+
+/**
+ * @brief Initialize the MT9F002 CMOS chip
+ *
+ * This resets the chip and writes the complete current configuration, after which the stream
+ * is turned on. It is used at construction and to recover a stalled sensor.
+ */
+void MT9F002::initialize(void) {
     // Calculate configuration
     calculateResolution();
     calculateBlanking();
@@ -781,8 +791,8 @@ void MT9F002::writeExposure(void) {
         // Both are good
         else {
             // Calculate error to decide which is better
-            int32_t upper_error = abs((line_length * upper_coarse_integration + upper_fine_integration) - integration);
-            int32_t lower_error = abs((line_length * lower_coarse_integration + lower_fine_integration) - integration);
+            int32_t upper_error = abs((int32_t)(line_length * upper_coarse_integration + upper_fine_integration) - (int32_t)integration);
+            int32_t lower_error = abs((int32_t)(line_length * lower_coarse_integration + lower_fine_integration) - (int32_t)integration);
 
             if(upper_error < lower_error) {
                 coarse_integration = upper_coarse_integration;
@@ -38,6 +38,16 @@ MT9V117::MT9V117(I2CBus *i2c_bus) {
     // Save the i2c bus
     this->i2c_bus = i2c_bus;
 
+    initialize();
+}
+
+/**
+ * @brief Initialize the MT9V117 CMOS chip
+ *
+ * This resets the chip through the GPIO and software, applies the patch and writes the
+ * configuration. It is used at construction and to recover a stalled sensor.
+ */
+void MT9V117::initialize(void) {
     /* Reset the device */
     int gpio129 = open("/sys/class/gpio/gpio129/value", O_WRONLY | O_CREAT | O_TRUNC, 0666);
     int wc = write(gpio129, "0", 1);
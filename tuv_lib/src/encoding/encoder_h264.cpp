@@ -119,6 +119,8 @@ void EncoderH264::start(void) {
     // Reset variables
     frame_cnt = 0;
     intra_cnt = 0;
+    first_timestamp = 0;
+    time_ticks = 0;
 
     // First apply the input settings
     configurePreProcessing();
@@ -140,6 +142,9 @@ void EncoderH264::start(void) {
  */
 Image::Ptr EncoderH264::encode(Image::Ptr img) {
     assert(img->getPixelFormat() == Image::FMT_UYVY || img->getPixelFormat() == Image::FMT_YUYV);
+    if(!img->isContiguous()) {
+        throw std::runtime_error("Input image rows must be packed in the Hantro H264 encoder");
+    }
 
     // Check cache only for V4L2 images due to limiting amount of image buffers
     bool check_cache = false;
@@ -166,7 +171,7 @@ Image::Ptr EncoderH264::encode(Image::Ptr img) {
 
     // Setup input buffer settings
     encoder_input.busLuma = phys_addr;
-    encoder_input.timeIncrement = (frame_cnt == 0)? 0 : 1; // FIXME: Use the real image time to calculate the increment
+    encoder_input.timeIncrement = getTimeIncrement(img);
     encoder_input.codingType = (intra_cnt == 0)? H264ENC_INTRA_FRAME : H264ENC_PREDICTED_FRAME;
 
     // Encode the frame
@@ -187,7 +192,41 @@ Image::Ptr EncoderH264::encode(Image::Ptr img) {
     intra_cnt = (intra_cnt + 1) % (uint32_t)output_cfg.frame_rate;
 
     // Create a new pointer image
-    return std::make_shared<ImagePtr>(this, output_buffer->index, Image::FMT_H264, output_cfg.width, output_cfg.height, (void*)output_buffer->mem.virtualAddress, encoder_output.streamSize);
+    Image::Ptr output = std::make_shared<ImagePtr>(this, output_buffer->index, Image::FMT_H264, output_cfg.width, output_cfg.height, (void*)output_buffer->mem.virtualAddress, encoder_output.streamSize);
+    output->copyCaptureInfo(img);
+    return output;
+}
+
+/**
+ * @brief Calculate the time increment of an image
+ *
+ * The time increment is the amount of frame periods since the previous frame. It is
+ * calculated from the capture times relative to the first frame, so rounding errors don't
+ * accumulate and dropped frames result in larger increments. When the capture time is unknown
+ * every frame is one period.
+ * @param img The image to encode
+ * @return The time increment in frame periods
+ */
+uint32_t EncoderH264::getTimeIncrement(Image::Ptr img) {
+    uint64_t timestamp = img->getTimestamp();
+    if(frame_cnt == 0) {
+        first_timestamp = timestamp;
+        time_ticks = 0;
+        return 0;
+    }
+
+    // Without capture times count every frame
+    if(timestamp == 0 || first_timestamp == 0 || timestamp <= first_timestamp) {
+        time_ticks++;
+        return 1;
+    }
+
+    // Round the time since the first frame to frame periods of the configured frame rate
+    uint32_t rate = cfg.frameRateNum / cfg.frameRateDenom;
+    uint64_t ticks = ((timestamp - first_timestamp) * rate + 500000) / 1000000;
+    uint32_t increment = (ticks > time_ticks)? ticks - time_ticks : 1;
+    time_ticks += increment;
+    return increment;
 }
 
 /**
@@ -18,6 +18,7 @@
 #include "encoding/encoder_jpeg.h"
 
 #include "vision/image_buffer.h"
+#include "drivers/clogger.h"
 #include <assert.h>
 
 #define BLOCK_SIZE 16384    ///< Default memory size
@@ -25,26 +26,32 @@
 /**
  * @brief Called to initialize the buffer
  *
- * This resizes the output buffer to the BLOCK_SIZE and sets the next byte to
- * the first byte of the data vector.
+ * This sets the next byte to the first byte of the pool buffer.
  * @param[in] cinfo The compression information
  */
 void EncoderJPEG::initDestination(j_compress_ptr cinfo) {
     jpeg_destination_mem_mgr* dst = (jpeg_destination_mem_mgr*)cinfo->dest;
-    dst->data.resize(BLOCK_SIZE);
-    cinfo->dest->next_output_byte = &dst->data[0];
-    cinfo->dest->free_in_buffer = dst->data.size();
+    dst->overflow = false;
+    dst->size = 0;
+    cinfo->dest->next_output_byte = dst->buf;
+    cinfo->dest->free_in_buffer = dst->buf_size;
 }
 
 /**
  * @brief Called when the output buffer is empty
  *
- * This will resize the output buffer by adding another BLOCK_SIZE amount of bytes.
+ * When the pool buffer is full, the bytes are moved to the overflow vector. Afterwards this
+ * will resize the overflow vector by adding another BLOCK_SIZE amount of bytes.
  * @param[in] cinfo The compression information
  * @return If the buffer has new free bytes
  */
 boolean EncoderJPEG::emptyOutputBuffer(j_compress_ptr cinfo) {
     jpeg_destination_mem_mgr* dst = (jpeg_destination_mem_mgr*)cinfo->dest;
+    if(!dst->overflow) {
+        dst->overflow = true;
+        dst->data.assign(dst->buf, dst->buf + dst->buf_size);
+    }
+
     size_t oldsize = dst->data.size();
     dst->data.resize(oldsize + BLOCK_SIZE);
     cinfo->dest->next_output_byte = &dst->data[oldsize];
@@ -55,14 +62,18 @@ boolean EncoderJPEG::emptyOutputBuffer(j_compress_ptr cinfo) {
 /**
  * @brief Called when done writing to buffer
  *
- * This will resize the output buffer by removing the free bytes. This is done
- * to make sure that the size of the output buffer matches the amount of bytes
- * that are compressed.
+ * This will calculate the amount of bytes that are compressed. When the output overflowed
+ * the overflow vector is resized by removing the free bytes.
  * @param cinfo The compression information
  */
 void EncoderJPEG::termDestination(j_compress_ptr cinfo) {
     jpeg_destination_mem_mgr* dst = (jpeg_destination_mem_mgr*)cinfo->dest;
-    dst->data.resize(dst->data.size() - cinfo->dest->free_in_buffer);
+    if(dst->overflow) {
+        dst->data.resize(dst->data.size() - cinfo->dest->free_in_buffer);
+        dst->size = dst->data.size();
+    } else {
+        dst->size = dst->buf_size - cinfo->dest->free_in_buffer;
+    }
 }
 
 /**
@@ -98,6 +109,16 @@ EncoderJPEG::EncoderJPEG(uint8_t quality) {
  * @return The compressed output image
  */
 Image::Ptr EncoderJPEG::encode(Image::Ptr img) {
+    // Create a new output pool when the resolution changes (outputs still in use keep the old pool)
+    if(pool == nullptr || pool->getWidth() != img->getWidth() || pool->getHeight() != img->getHeight()) {
+        pool = std::make_shared<ImageBufferPool>(Image::FMT_JPEG, img->getWidth(), img->getHeight(), img->getWidth() * img->getHeight() * 2, 2);
+    }
+
+    // Acquire an output buffer
+    uint16_t buf_index = pool->acquire();
+    dmgr.buf = (uint8_t *)pool->getData(buf_index);
+    dmgr.buf_size = pool->getBufferSize();
+
     uint8_t *img_buf = (uint8_t *)img->getData();
     cinfo.image_width = img->getWidth();
     cinfo.image_height = img->getHeight();
@@ -112,7 +133,7 @@ Image::Ptr EncoderJPEG::encode(Image::Ptr img) {
     uint8_t tmprowbuf[img->getWidth() * 3];
     while (cinfo.next_scanline < cinfo.image_height) {
         uint32_t i, j;
-        uint32_t offset = cinfo.next_scanline * cinfo.image_width * 2; //offset to the correct row
+        uint32_t offset = cinfo.next_scanline * img->getStride(); //offset to the correct row
         for (i = 0, j = 0; i < cinfo.image_width * 2; i += 4, j += 6) { //input strides by 4 bytes, output strides by 6 (2 pixels)
             tmprowbuf[j + 0] = img_buf[offset + i + 0]; // Y (unique to this pixel)
             tmprowbuf[j + 1] = img_buf[offset + i + 1]; // U (shared between pixels)
@@ -127,7 +148,19 @@ Image::Ptr EncoderJPEG::encode(Image::Ptr img) {
     }
 
     jpeg_finish_compress(&cinfo);
-    return std::make_shared<ImageBuffer>(Image::FMT_JPEG, img->getWidth(), img->getHeight(), dmgr.data);
+
+    // Return the pool buffer or create a new image from the overflow data
+    Image::Ptr output;
+    if(!dmgr.overflow) {
+        output = pool->getImage(buf_index, dmgr.size);
+    } else {
+        pool->freeImage(buf_index);
+        CLOGGER_WARN("JPEG output of " << dmgr.size << " bytes doesn't fit in the pool buffer");
+        output = std::make_shared<ImageBuffer>(Image::FMT_JPEG, img->getWidth(), img->getHeight(), dmgr.data);
+    }
+
+    output->copyCaptureInfo(img);
+    return output;
 }
 
 /**
@@ -154,3 +187,14 @@ void EncoderJPEG::setQuality(uint8_t quality) {
 uint8_t EncoderJPEG::getQuality(void) {
     return this->quality;
 }
+
+/**
+ * @brief Get the output buffer pool
+ *
+ * This returns the pool which contains the output images, which can be used to check the
+ * pool statistics. The pool is created at the first encode.
+ * @return The output buffer pool
+ */
+ImageBufferPool::Ptr EncoderJPEG::getPool(void) {
+    return pool;
+}
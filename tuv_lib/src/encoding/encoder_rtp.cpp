@@ -18,7 +18,7 @@
 #include "encoding/encoder_rtp.h"
 
 #include <assert.h>
-#include <sys/time.h>
+#include <time.h>
 #include <stdexcept>
 
 /**
@@ -114,6 +114,26 @@ void EncoderRTP::appendBytes(uint8_t *bytes, uint32_t length) {
         data[idx++] = bytes[i];
 }
 
+/**
+ * @brief Get the RTP timestamp of an image
+ *
+ * This converts the capture time of the image to the 90kHz RTP clock. When the capture time is
+ * unknown the current time of the same monotonic clock is used, so the timestamps don't jump
+ * when the wall clock is changed.
+ * @param img The image
+ * @return The RTP timestamp
+ */
+uint32_t EncoderRTP::getTimestamp(Image::Ptr img) {
+    if(img->getTimestamp() != 0)
+        return (uint32_t)(img->getTimestamp() * 9 / 100);
+
+    // Get the current time
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    uint64_t now = (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+    return (uint32_t)(now * 9 / 100);
+}
+
 /**
  * @brief Encode an JPEG image
  *
@@ -122,15 +142,11 @@ void EncoderRTP::appendBytes(uint8_t *bytes, uint32_t length) {
  * @param img_size The image buffer size in bytes
  * @param width The image width in pixels
  * @param height The image height in pixels
+ * @param timestamp The RTP timestamp of the image
  */
-void EncoderRTP::encodeJPEG(uint8_t *img_buf, uint32_t img_size, uint32_t width, uint32_t height) {
+void EncoderRTP::encodeJPEG(uint8_t *img_buf, uint32_t img_size, uint32_t width, uint32_t height, uint32_t timestamp) {
     uint32_t packet_size = socket->getMaxPacketSize() - 12 - 8; // Account for the RTP + JPEG header
 
-    // Get the current time
-    struct timeval tv;
-    gettimeofday(&tv, 0);
-    uint32_t t = (tv.tv_sec % (256 * 256)) * 90000 + tv.tv_usec * 9 / 100;
-
     // Fragment the JPEG image with the max packet size
     for(uint32_t offset = 0; (int32_t)(img_size - offset) > 0; offset += packet_size) {
         uint32_t curr_size = ((img_size - offset) > packet_size)? packet_size : (img_size - offset);
@@ -140,7 +156,7 @@ void EncoderRTP::encodeJPEG(uint8_t *img_buf, uint32_t img_size, uint32_t width,
         data.resize(curr_size + 12 + 8);
         idx = 0;
 
-        createHeader(0x1A, end, sequence++, t);
+        createHeader(0x1A, end, sequence++, timestamp);
         createJPEGHeader(offset, 80, 0, width, height);
         appendBytes(&img_buf[offset], curr_size);
 
@@ -154,24 +170,20 @@ void EncoderRTP::encodeJPEG(uint8_t *img_buf, uint32_t img_size, uint32_t width,
  * This will encode the H264 image using RTP and will send the output over the output socket.
  * @param img_buf The H264 image buffer to encode
  * @param img_size The image buffer size in bytes
+ * @param timestamp The RTP timestamp of the image
  */
-void EncoderRTP::encodeH264(uint8_t *img_buf, uint32_t img_size) {
+void EncoderRTP::encodeH264(uint8_t *img_buf, uint32_t img_size, uint32_t timestamp) {
     assert(img_size >= 4);
     img_size -= 4; // Minus the NALU Start
     uint32_t packet_size = socket->getMaxPacketSize() - 12; // Account for the RTP header
 
-    // Get the current time
-    struct timeval tv;
-    gettimeofday(&tv, 0);
-    uint32_t t = (tv.tv_sec % (256 * 256)) * 90000 + tv.tv_usec * 9 / 100;
-
     // No packaging is needed (only remove starting zeros)
     if(packet_size >= img_size) {
         data.clear();
         data.resize(img_size + 12);
         idx = 0;
 
-        createHeader(0x60, true, sequence++, t);
+        createHeader(0x60, true, sequence++, timestamp);
         appendBytes(&img_buf[4], img_size);
 
         socket->transmit(data);
@@ -189,7 +201,7 @@ void EncoderRTP::encodeH264(uint8_t *img_buf, uint32_t img_size) {
             data.resize(curr_size + 12 + 2);
             idx = 0;
 
-            createHeader(0x60, end, sequence++, t);
+            createHeader(0x60, end, sequence++, timestamp);
             createH264FragmentAHeader(start, end, img_buf[4]);
             appendBytes(&img_buf[offset + 5], curr_size);
 
@@ -206,9 +218,11 @@ void EncoderRTP::encodeH264(uint8_t *img_buf, uint32_t img_size) {
  * @param img The image to encode (JPEG or H264)
  */
 void EncoderRTP::encode(Image::Ptr img) {
+    uint32_t timestamp = getTimestamp(img);
+
     switch(img->getPixelFormat()) {
     case Image::FMT_JPEG: {
-        encodeJPEG((uint8_t*)img->getData(), img->getSize(), img->getWidth(), img->getHeight());
+        encodeJPEG((uint8_t*)img->getData(), img->getSize(), img->getWidth(), img->getHeight(), timestamp);
         break;
     }
 
@@ -219,12 +233,12 @@ void EncoderRTP::encode(Image::Ptr img) {
         if((data[4] & 0x1F) == 0x05) {
             assert(sps_data.size() > 0);
             assert(pps_data.size() > 0);
-            encodeH264(sps_data.data(), sps_data.size());
-            encodeH264(pps_data.data(), pps_data.size());
+            encodeH264(sps_data.data(), sps_data.size(), timestamp);
+            encodeH264(pps_data.data(), pps_data.size(), timestamp);
         }
 
         // Encode the frame self
-        encodeH264(data, data_size);
+        encodeH264(data, data_size, timestamp);
         break;
     }
 
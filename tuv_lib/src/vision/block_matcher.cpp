@@ -0,0 +1,345 @@
+/*
+ * This file is part of the TUV library (https://github.com/tudelft/tudelft_vision).
+ * Copyright (c) 2016 Freek van Tienen <freek.v.tienen@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "vision/block_matcher.h"
+
+#include "vision/image_buffer.h"
+#include "vision/simd.h"
+#include "vision/kernels/kernels.h"
+#include <string>
+#include <algorithm>
+#include <stdexcept>
+
+/** Large diamond search pattern */
+static const int8_t diamond_pattern[8][2] = {
+    {0, -2}, {1, -1}, {2, 0}, {1, 1}, {0, 2}, {-1, 1}, {-2, 0}, {-1, -1}
+};
+
+/** Large hexagon search pattern */
+static const int8_t hexagon_pattern[6][2] = {
+    {-2, 0}, {-1, -2}, {1, -2}, {2, 0}, {1, 2}, {-1, 2}
+};
+
+/** Small diamond refinement pattern */
+static const int8_t small_pattern[4][2] = {
+    {0, -1}, {1, 0}, {0, 1}, {-1, 0}
+};
+
+/**
+ * @brief Create a new block matcher
+ *
+ * This starts the worker threads, which wait until a field is estimated.
+ * @param[in] block_size The width and height of a block in pixels (for example 8 or 16)
+ * @param[in] range The maximum displacement in pixels (at most 127)
+ * @param[in] pattern The search pattern
+ * @param[in] threads The amount of threads including the calling thread (0 for all cores)
+ */
+BlockMatcher::BlockMatcher(uint16_t block_size, uint8_t range, enum search_patterns pattern, uint8_t threads):
+    block_size(block_size),
+    range(range),
+    pattern(pattern),
+    cols(0),
+    rows(0),
+    next_row(0),
+    generation(0),
+    busy(0),
+    stopping(false) {
+    if(block_size < 4) {
+        throw std::runtime_error("The block size must be at least 4 and not " + std::to_string(block_size));
+    }
+    if(range == 0 || range > 127) {
+        throw std::runtime_error("The block matching range must be between 1 and 127 and not " + std::to_string(range));
+    }
+
+    if(threads == 0)
+        threads = std::max(1U, std::thread::hardware_concurrency());
+    for(uint8_t i = 1; i < threads; ++i)
+        workers.emplace_back(&BlockMatcher::worker, this);
+    selectKernels();
+}
+
+/**
+ * @brief Stop the worker threads
+ */
+BlockMatcher::~BlockMatcher(void) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    start_cond.notify_all();
+
+    for(auto &w : workers)
+        w.join();
+}
+
+/**
+ * @brief Estimate the motion field between two frames
+ *
+ * Every complete block of the previous frame is searched in the current frame. The result is
+ * resized to the amount of blocks and contains the vectors row by row. The field is kept to
+ * predict the vectors of the next estimation.
+ * @param[in] prev The previous frame
+ * @param[in] cur The current frame
+ * @param[out] result The motion vector of every block
+ */
+void BlockMatcher::estimate(Image::Ptr prev, Image::Ptr cur, std::vector<struct vector_t> &result) {
+    if(prev->getWidth() != cur->getWidth() || prev->getHeight() != cur->getHeight()) {
+        throw std::runtime_error("Block matching needs two frames with the same size");
+    }
+
+    selectKernels();
+    prev_data = getLuma(prev, prev_luma, prev_stride);
+    cur_data = getLuma(cur, cur_luma, cur_stride);
+    width = cur->getWidth();
+    height = cur->getHeight();
+
+    // Forget the prediction when the grid changes
+    uint32_t new_cols = width / block_size;
+    uint32_t new_rows = height / block_size;
+    if(new_cols != cols || new_rows != rows)
+        last_field.clear();
+    cols = new_cols;
+    rows = new_rows;
+    result.resize(cols * rows);
+    field = result.data();
+    next_row = 0;
+
+    // Process the rows of blocks together with the workers
+    if(!workers.empty()) {
+        std::lock_guard<std::mutex> lock(mutex);
+        busy = workers.size();
+        generation++;
+    }
+    start_cond.notify_all();
+    processRows();
+
+    if(!workers.empty()) {
+        std::unique_lock<std::mutex> lock(mutex);
+        done_cond.wait(lock, [this] { return busy == 0; });
+    }
+
+    last_field.assign(result.begin(), result.end());
+}
+
+/**
+ * @brief Get the amount of blocks in a row
+ *
+ * @return The amount of columns of the last field
+ */
+uint32_t BlockMatcher::getCols(void) {
+    return cols;
+}
+
+/**
+ * @brief Get the amount of blocks in a column
+ *
+ * @return The amount of rows of the last field
+ */
+uint32_t BlockMatcher::getRows(void) {
+    return rows;
+}
+
+/**
+ * @brief Get the block size
+ *
+ * @return The width and height of a block in pixels
+ */
+uint16_t BlockMatcher::getBlockSize(void) {
+    return block_size;
+}
+
+/**
+ * @brief Get the amount of threads
+ *
+ * @return The amount of threads including the calling thread
+ */
+uint8_t BlockMatcher::getThreads(void) {
+    return workers.size() + 1;
+}
+
+/**
+ * @brief Select the kernel for the current instruction set
+ */
+void BlockMatcher::selectKernels(void) {
+    sad = sad_u8_scalar;
+
+    switch(SIMD::getInstructionSet()) {
+#if defined(TUV_HAVE_SSE2)
+    case SIMD::ISA_AVX2:
+    case SIMD::ISA_SSE2:
+        sad = sad_u8_sse2;
+        break;
+#endif
+
+#if defined(TUV_HAVE_NEON)
+    case SIMD::ISA_NEON:
+        sad = sad_u8_neon;
+        break;
+#endif
+
+    default:
+        break;
+    }
+}
+
+/**
+ * @brief Worker thread
+ *
+ * This waits for a new job generation, processes rows of blocks until all rows are taken and
+ * signals when it is done.
+ */
+void BlockMatcher::worker(void) {
+    uint32_t seen = 0;
+    while(true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            start_cond.wait(lock, [this, seen] { return stopping || generation != seen; });
+            if(stopping)
+                return;
+            seen = generation;
+        }
+
+        processRows();
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if(--busy == 0)
+                done_cond.notify_one();
+        }
+    }
+}
+
+/**
+ * @brief Process rows of blocks until all rows are taken
+ */
+void BlockMatcher::processRows(void) {
+    uint32_t row;
+    while((row = next_row.fetch_add(1)) < rows) {
+        for(uint32_t col = 0; col < cols; ++col)
+            matchBlock(col, row);
+    }
+}
+
+/**
+ * @brief Search a single block
+ *
+ * The search starts at the best predictor and takes large pattern steps until the center is
+ * the best, followed by a single small diamond refinement. The amount of large steps is
+ * limited by the range.
+ * @param[in] col The column of the block
+ * @param[in] row The row of the block
+ */
+void BlockMatcher::matchBlock(uint32_t col, uint32_t row) {
+    uint32_t idx = row * cols + col;
+    uint32_t x = col * block_size;
+    uint32_t y = row * block_size;
+    int32_t best_x = 0, best_y = 0;
+    uint32_t best_cost = blockCost(x, y, 0, 0);
+
+    // Start at the best predictor
+    struct vector_t predictors[2];
+    uint8_t predictor_cnt = 0;
+    if(col > 0)
+        predictors[predictor_cnt++] = field[idx - 1];
+    if(!last_field.empty())
+        predictors[predictor_cnt++] = last_field[idx];
+    for(uint8_t i = 0; i < predictor_cnt; ++i) {
+        uint32_t cost = blockCost(x, y, predictors[i].x, predictors[i].y);
+        if(cost < best_cost) {
+            best_cost = cost;
+            best_x = predictors[i].x;
+            best_y = predictors[i].y;
+        }
+    }
+
+    // Large pattern steps
+    const int8_t (*points)[2] = (pattern == SEARCH_HEXAGON)? hexagon_pattern : diamond_pattern;
+    uint8_t point_cnt = (pattern == SEARCH_HEXAGON)? 6 : 8;
+    for(uint8_t step = 0; step < range; ++step) {
+        int32_t center_x = best_x, center_y = best_y;
+        for(uint8_t i = 0; i < point_cnt; ++i) {
+            uint32_t cost = blockCost(x, y, center_x + points[i][0], center_y + points[i][1]);
+            if(cost < best_cost) {
+                best_cost = cost;
+                best_x = center_x + points[i][0];
+                best_y = center_y + points[i][1];
+            }
+        }
+
+        if(best_x == center_x && best_y == center_y)
+            break;
+    }
+
+    // Small diamond refinement
+    int32_t center_x = best_x, center_y = best_y;
+    for(uint8_t i = 0; i < 4; ++i) {
+        uint32_t cost = blockCost(x, y, center_x + small_pattern[i][0], center_y + small_pattern[i][1]);
+        if(cost < best_cost) {
+            best_cost = cost;
+            best_x = center_x + small_pattern[i][0];
+            best_y = center_y + small_pattern[i][1];
+        }
+    }
+
+    field[idx].x = best_x;
+    field[idx].y = best_y;
+    field[idx].sad = (best_cost > UINT16_MAX)? UINT16_MAX : best_cost;
+}
+
+/**
+ * @brief Calculate the cost of a displacement
+ *
+ * @param[in] x The left position of the block in the previous frame
+ * @param[in] y The top position of the block in the previous frame
+ * @param[in] dx The horizontal displacement
+ * @param[in] dy The vertical displacement
+ * @return The sum of absolute differences or UINT32_MAX when the displacement is not allowed
+ */
+uint32_t BlockMatcher::blockCost(uint32_t x, uint32_t y, int32_t dx, int32_t dy) {
+    int32_t cx = x + dx, cy = y + dy;
+    if(dx < -range || dx > range || dy < -range || dy > range ||
+            cx < 0 || cy < 0 || cx + block_size > (int32_t)width || cy + block_size > (int32_t)height)
+        return UINT32_MAX;
+
+    return sad(prev_data + y * prev_stride + x, prev_stride, cur_data + cy * cur_stride + cx, cur_stride, block_size, block_size);
+}
+
+/**
+ * @brief Get the luma of a frame
+ *
+ * GRAY8 frames are used directly and the luma of YUV422 frames is extracted into a buffer,
+ * which is only reallocated when the geometry changes.
+ * @param[in] img The frame
+ * @param[in,out] luma The buffer for the extracted luma
+ * @param[out] stride The row stride of the luma
+ * @return The luma of the frame
+ */
+const uint8_t *BlockMatcher::getLuma(Image::Ptr img, Image::Ptr &luma, uint32_t &stride) {
+    enum Image::pixel_formats fmt = img->getPixelFormat();
+    if(fmt == Image::FMT_GRAY8) {
+        stride = img->getStride();
+        return (const uint8_t *)img->getData();
+    } else if(fmt != Image::FMT_YUYV && fmt != Image::FMT_UYVY) {
+        throw std::runtime_error("Block matching is only supported on GRAY8 and YUV422 images and not " + std::to_string(fmt));
+    }
+
+    if(!luma || luma->getWidth() != img->getWidth() || luma->getHeight() != img->getHeight())
+        luma = std::make_shared<ImageBuffer>(Image::FMT_GRAY8, img->getWidth(), img->getHeight());
+    img->convert(luma);
+    stride = luma->getStride();
+    return (const uint8_t *)luma->getData();
+}
@@ -0,0 +1,280 @@
+/*
+ * This file is part of the TUV library (https://github.com/tudelft/tudelft_vision).
+ * Copyright (c) 2016 Freek van Tienen <freek.v.tienen@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "vision/edge_flow.h"
+
+#include "vision/image_buffer.h"
+#include "vision/simd.h"
+#include "vision/kernels/kernels.h"
+#include <string>
+#include <stdexcept>
+#include <algorithm>
+
+/**
+ * @brief Create a new edge histogram flow estimator
+ *
+ * @param[in] window Half the size of the matching window in histogram positions
+ * @param[in] max_disp The maximum displacement between two frames in pixels
+ */
+EdgeFlow::EdgeFlow(uint16_t window, uint16_t max_disp):
+    window(window),
+    max_disp(max_disp),
+    min_texture(1.0f),
+    width(0),
+    height(0),
+    frame_cnt(0) {
+    if(max_disp == 0) {
+        throw std::runtime_error("The EdgeFlow maximum displacement must be at least 1");
+    }
+    selectKernels();
+}
+
+/**
+ * @brief Calculate the flow from the previous frame
+ *
+ * This calculates the edge histograms of the image and matches them with the histograms of the
+ * previous frame. When there is no previous frame with the same geometry, only the histograms
+ * are stored and the result is cleared.
+ * @param[in] img The current frame
+ * @param[out] result The flow estimate from the previous to the current frame
+ * @return True when the flow is calculated
+ */
+bool EdgeFlow::calculate(Image::Ptr img, struct result_t &result) {
+    enum Image::pixel_formats fmt = img->getPixelFormat();
+    if(fmt != Image::FMT_GRAY8 && fmt != Image::FMT_YUYV && fmt != Image::FMT_UYVY) {
+        throw std::runtime_error("EdgeFlow is only supported on GRAY8 and YUV422 images and not " + std::to_string(fmt));
+    }
+    if(img->getWidth() < 3 || img->getHeight() < 3) {
+        throw std::runtime_error("EdgeFlow needs an image of at least 3x3 pixels");
+    }
+
+    if(img->getWidth() != width || img->getHeight() != height)
+        resize(img->getWidth(), img->getHeight());
+    selectKernels();
+
+    // Calculate the histograms on the luma
+    Image::Ptr src = img;
+    if(fmt != Image::FMT_GRAY8) {
+        if(!luma)
+            luma = std::make_shared<ImageBuffer>(Image::FMT_GRAY8, width, height);
+        img->convert(luma);
+        src = luma;
+    }
+    std::fill(cur_y.begin(), cur_y.end(), 0);
+    edge_histogram((const uint8_t *)src->getData(), src->getStride(), 1, width - 1, height, cur_x.data(), cur_y.data());
+    frame_cnt++;
+
+    result = {};
+    if(frame_cnt > 1) {
+        uint32_t valid_x, total_x, valid_y, total_y;
+        fitHistograms(prev_x, cur_x, width, height - 2, result.flow_x, result.div_x, valid_x, total_x);
+        fitHistograms(prev_y, cur_y, height, width - 2, result.flow_y, result.div_y, valid_y, total_y);
+        result.divergence = result.div_x + result.div_y;
+        if(total_x + total_y > 0)
+            result.quality = (float)(valid_x + valid_y) / (total_x + total_y);
+    }
+
+    std::swap(prev_x, cur_x);
+    std::swap(prev_y, cur_y);
+    return (frame_cnt > 1);
+}
+
+/**
+ * @brief Forget the previous frame
+ *
+ * This should be called when the frames are not consecutive, for example after dropping
+ * frames or changing the camera settings.
+ */
+void EdgeFlow::reset(void) {
+    frame_cnt = 0;
+}
+
+/**
+ * @brief Set the minimum texture of a matching window
+ *
+ * Windows of the previous histogram with less texture are not used for the line fit.
+ * @param[in] min_texture The minimum mean absolute gradient per pixel of a window
+ */
+void EdgeFlow::setMinTexture(float min_texture) {
+    this->min_texture = min_texture;
+}
+
+/**
+ * @brief Get the matching window
+ *
+ * @return Half the size of the matching window in histogram positions
+ */
+uint16_t EdgeFlow::getWindow(void) {
+    return window;
+}
+
+/**
+ * @brief Get the maximum displacement
+ *
+ * @return The maximum displacement between two frames in pixels
+ */
+uint16_t EdgeFlow::getMaxDisplacement(void) {
+    return max_disp;
+}
+
+/**
+ * @brief Select the kernel for the current instruction set
+ */
+void EdgeFlow::selectKernels(void) {
+    edge_histogram = edge_histogram_u8_scalar;
+
+    switch(SIMD::getInstructionSet()) {
+#if defined(TUV_HAVE_SSE2)
+    case SIMD::ISA_AVX2:
+    case SIMD::ISA_SSE2:
+        edge_histogram = edge_histogram_u8_sse2;
+        break;
+#endif
+
+#if defined(TUV_HAVE_NEON)
+    case SIMD::ISA_NEON:
+        edge_histogram = edge_histogram_u8_neon;
+        break;
+#endif
+
+    default:
+        break;
+    }
+}
+
+/**
+ * @brief Resize the buffers for a new image geometry
+ *
+ * This also forgets the previous frame.
+ * @param[in] width The width of the images
+ * @param[in] height The height of the images
+ */
+void EdgeFlow::resize(uint32_t width, uint32_t height) {
+    uint32_t length = std::max(width, height);
+    this->width = width;
+    this->height = height;
+    frame_cnt = 0;
+    luma.reset();
+
+    prev_x.assign(width, 0);
+    cur_x.assign(width, 0);
+    prev_y.assign(height, 0);
+    cur_y.assign(height, 0);
+    diffs.assign(length, 0);
+    costs.assign((2 * max_disp + 1) * length, 0);
+}
+
+/**
+ * @brief Match two histograms and fit a line through the displacements
+ *
+ * For every position with enough texture the displacement with the lowest sum of absolute
+ * differences is refined with a parabola through the neighbouring costs. Matches at the edge of
+ * the search range are rejected. The line is fitted with least squares around the center of
+ * the histogram.
+ * @param[in] prev The histogram of the previous frame
+ * @param[in] cur The histogram of the current frame
+ * @param[in] length The length of the histograms
+ * @param[in] depth The amount of pixels summed in every histogram position
+ * @param[out] flow The displacement at the center
+ * @param[out] slope The change of the displacement per position
+ * @param[out] valid_cnt The amount of positions used for the fit
+ * @param[out] total_cnt The amount of positions that could be matched
+ */
+void EdgeFlow::fitHistograms(const std::vector<uint32_t> &prev, const std::vector<uint32_t> &cur, uint32_t length, uint32_t depth,
+                             float &flow, float &slope, uint32_t &valid_cnt, uint32_t &total_cnt) {
+    int32_t reach = window + max_disp;
+    flow = 0;
+    slope = 0;
+    valid_cnt = 0;
+    total_cnt = 0;
+    if(length <= 2 * (uint32_t)(reach + 1))
+        return;
+
+    // Only positions where the window and the search range stay inside the histogram
+    uint32_t lo = 1 + reach;
+    uint32_t hi = length - 1 - reach;
+    total_cnt = hi - lo;
+
+    // Calculate the window costs for every displacement with a sliding sum
+    for(int32_t d = -max_disp; d <= max_disp; ++d) {
+        uint32_t *cost = &costs[(d + max_disp) * length];
+        for(uint32_t j = lo - window; j < hi + window; ++j) {
+            uint32_t a = prev[j], b = cur[j + d];
+            diffs[j] = (a > b)? a - b : b - a;
+        }
+
+        uint32_t sum = 0;
+        for(uint32_t j = lo - window; j <= lo + window; ++j)
+            sum += diffs[j];
+        cost[lo] = sum;
+        for(uint32_t i = lo + 1; i < hi; ++i) {
+            sum += diffs[i + window] - diffs[i - window - 1];
+            cost[i] = sum;
+        }
+    }
+
+    // Find the best displacements and accumulate the least squares sums
+    float min_sum = min_texture * (2 * window + 1) * depth;
+    float center = (length - 1) / 2.0f;
+    double n = 0, sx = 0, sy = 0, sxx = 0, sxy = 0;
+    uint32_t texture = 0;
+    for(uint32_t j = lo - window; j <= lo + window; ++j)
+        texture += prev[j];
+
+    for(uint32_t i = lo; i < hi; ++i) {
+        if(i > lo)
+            texture += prev[i + window] - prev[i - window - 1];
+        if(texture < min_sum)
+            continue;
+
+        int32_t best = 0;
+        uint32_t best_cost = UINT32_MAX;
+        for(int32_t d = 0; d <= 2 * max_disp; ++d) {
+            uint32_t c = costs[d * length + i];
+            if(c < best_cost) {
+                best_cost = c;
+                best = d;
+            }
+        }
+        if(best == 0 || best == 2 * max_disp)
+            continue;
+
+        // Sub-pixel refinement with a parabola
+        float c_min = costs[(best - 1) * length + i];
+        float c_plus = costs[(best + 1) * length + i];
+        float denom = c_min - 2.0f * best_cost + c_plus;
+        float disp = best - max_disp;
+        if(denom > 0)
+            disp += (c_min - c_plus) / (2.0f * denom);
+
+        float x = i - center;
+        n += 1;
+        sx += x;
+        sy += disp;
+        sxx += x * x;
+        sxy += x * disp;
+    }
+
+    valid_cnt = n;
+    double det = n * sxx - sx * sx;
+    if(n >= 2 && det > 0) {
+        slope = (n * sxy - sx * sy) / det;
+        flow = (sy - slope * sx) / n;
+    } else if(n >= 1) {
+        flow = sy / n;
+    }
+}
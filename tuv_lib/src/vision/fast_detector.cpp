@@ -0,0 +1,349 @@
+/*
+ * This file is part of the TUV library (https://github.com/tudelft/tudelft_vision).
+ * Copyright (c) 2016 Freek van Tienen <freek.v.tienen@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "vision/fast_detector.h"
+
+#include "vision/image_buffer.h"
+#include "vision/simd.h"
+#include "vision/kernels/kernels.h"
+#include <string>
+#include <stdexcept>
+#include <string.h>
+#include <algorithm>
+
+/**
+ * @brief Create a new FAST corner detector
+ *
+ * By default non-maximum suppression is enabled, the amount of corners is unlimited, the grid
+ * is disabled and the threshold is fixed.
+ * @param[in] type The FAST variant
+ * @param[in] threshold The minimum difference between the center and the ring pixels
+ */
+FastDetector::FastDetector(enum fast_types type, uint8_t threshold):
+    type(type),
+    threshold(threshold),
+    non_max_suppression(true),
+    max_corners(0),
+    cell_width(0),
+    cell_height(0),
+    cell_cap(0),
+    target(0),
+    min_threshold(5),
+    max_threshold(100),
+    width(0),
+    height(0) {
+    selectKernels();
+}
+
+/**
+ * @brief Detect the corners in an image
+ *
+ * This detects the corners in a GRAY8 or YUV422 image, where only the luma is used. The output
+ * vector is cleared and filled with the corners. Without a grid or limit the corners are in
+ * raster order, otherwise they are ordered from the strongest to the weakest. When adapting is
+ * enabled, the threshold for the next image is updated with the amount of candidates found.
+ * @param[in] img The image to detect the corners in
+ * @param[out] corners The detected corners (reserve the capacity to prevent allocations)
+ */
+void FastDetector::detect(Image::Ptr img, std::vector<struct corner_t> &corners) {
+    enum Image::pixel_formats fmt = img->getPixelFormat();
+    if(fmt != Image::FMT_GRAY8 && fmt != Image::FMT_YUYV && fmt != Image::FMT_UYVY) {
+        throw std::runtime_error("FAST detection is only supported on GRAY8 and YUV422 images and not " + std::to_string(fmt));
+    }
+
+    if(img->getWidth() != width || img->getHeight() != height)
+        resize(img->getWidth(), img->getHeight());
+    selectKernels();
+
+    // Extract the luma of YUV422 images
+    if(fmt == Image::FMT_GRAY8) {
+        detectCandidates((const uint8_t *)img->getData(), img->getStride());
+    } else {
+        if(!luma)
+            luma = std::make_shared<ImageBuffer>(Image::FMT_GRAY8, width, height);
+        img->convert(luma);
+        detectCandidates((const uint8_t *)luma->getData(), luma->getStride());
+    }
+    adaptThreshold();
+
+    // Order the candidates by strength when they need to be selected
+    uint32_t limit = (max_corners == 0)? candidates.size() : max_corners;
+    bool grid = (cell_width > 0 && cell_height > 0 && cell_cap > 0);
+    if(grid || candidates.size() > limit) {
+        std::sort(candidates.begin(), candidates.end(), [](const struct corner_t &a, const struct corner_t &b) {
+            if(a.score != b.score)
+                return a.score > b.score;
+            return (a.y != b.y)? a.y < b.y : a.x < b.x;
+        });
+    }
+
+    corners.clear();
+    if(!grid) {
+        uint32_t cnt = std::min<uint32_t>(limit, candidates.size());
+        corners.insert(corners.end(), candidates.begin(), candidates.begin() + cnt);
+        return;
+    }
+
+    // Keep the strongest corners of every grid cell
+    uint32_t cols = (width + cell_width - 1) / cell_width;
+    uint32_t rows = (height + cell_height - 1) / cell_height;
+    cell_counts.assign(cols * rows, 0);
+    for(auto &c : candidates) {
+        if(corners.size() >= limit)
+            break;
+
+        uint16_t &cell_cnt = cell_counts[(c.y / cell_height) * cols + c.x / cell_width];
+        if(cell_cnt < cell_cap) {
+            cell_cnt++;
+            corners.push_back(c);
+        }
+    }
+}
+
+/**
+ * @brief Set the threshold
+ *
+ * When adapting is enabled this is the starting point for the next image.
+ * @param[in] threshold The minimum difference between the center and the ring pixels
+ */
+void FastDetector::setThreshold(uint8_t threshold) {
+    this->threshold = threshold;
+}
+
+/**
+ * @brief Enable or disable non-maximum suppression
+ *
+ * With suppression enabled only corners with a higher score then their 8 neighbours are kept.
+ * Of neighbouring corners with the same score only the last one in scan order is kept.
+ * @param[in] enable Whether to enable the suppression
+ */
+void FastDetector::setNonMaxSuppression(bool enable) {
+    non_max_suppression = enable;
+}
+
+/**
+ * @brief Set the maximum amount of corners
+ *
+ * When more corners are found only the strongest are returned.
+ * @param[in] max_corners The maximum amount of corners (0 is unlimited)
+ */
+void FastDetector::setMaxCorners(uint32_t max_corners) {
+    this->max_corners = max_corners;
+}
+
+/**
+ * @brief Set the bucketing grid
+ *
+ * The image is divided into cells, where every cell keeps at most cell_cap of its strongest
+ * corners. This spreads the corners over the image instead of clustering them at the most
+ * textured part.
+ * @param[in] cell_width The width of a cell in pixels (0 disables the grid)
+ * @param[in] cell_height The height of a cell in pixels (0 disables the grid)
+ * @param[in] cell_cap The maximum amount of corners per cell (0 disables the grid)
+ */
+void FastDetector::setGrid(uint16_t cell_width, uint16_t cell_height, uint16_t cell_cap) {
+    this->cell_width = cell_width;
+    this->cell_height = cell_height;
+    this->cell_cap = cell_cap;
+}
+
+/**
+ * @brief Set the target amount of corners
+ *
+ * After every image the threshold is increased when more then 10% too many candidates are found
+ * and decreased when more then 10% too few are found. The step is larger when the amount is far
+ * off, so the threshold settles within a few images.
+ * @param[in] target The target amount of candidates (0 disables adapting)
+ * @param[in] min_threshold The minimum threshold
+ * @param[in] max_threshold The maximum threshold
+ */
+void FastDetector::setTarget(uint32_t target, uint8_t min_threshold, uint8_t max_threshold) {
+    if(min_threshold > max_threshold) {
+        throw std::runtime_error("The minimum FAST threshold " + std::to_string(min_threshold) + " is larger then the maximum " + std::to_string(max_threshold));
+    }
+
+    this->target = target;
+    this->min_threshold = min_threshold;
+    this->max_threshold = max_threshold;
+}
+
+/**
+ * @brief Get the current threshold
+ *
+ * @return The threshold used for the next image
+ */
+uint8_t FastDetector::getThreshold(void) {
+    return threshold;
+}
+
+/**
+ * @brief Get the amount of candidates of the last image
+ *
+ * This is the amount of corners after non-maximum suppression, but before the grid and the
+ * limit are applied.
+ * @return The amount of candidates
+ */
+uint32_t FastDetector::getCandidateCount(void) {
+    return candidates.size();
+}
+
+/**
+ * @brief Select the kernel for the current instruction set
+ */
+void FastDetector::selectKernels(void) {
+    fast_row = fast_row_u8_scalar;
+
+    switch(SIMD::getInstructionSet()) {
+#if defined(TUV_HAVE_SSE2)
+    case SIMD::ISA_AVX2:
+    case SIMD::ISA_SSE2:
+        fast_row = fast_row_u8_sse2;
+        break;
+#endif
+
+#if defined(TUV_HAVE_NEON)
+    case SIMD::ISA_NEON:
+        fast_row = fast_row_u8_neon;
+        break;
+#endif
+
+    default:
+        break;
+    }
+}
+
+/**
+ * @brief Resize the buffers for a new image geometry
+ *
+ * @param[in] width The width of the images
+ * @param[in] height The height of the images
+ */
+void FastDetector::resize(uint32_t width, uint32_t height) {
+    this->width = width;
+    this->height = height;
+    luma.reset();
+    row_corners.assign(3 * width, 0);
+    row_scores.assign(3 * width, 0);
+}
+
+/**
+ * @brief Calculate the score of a corner
+ *
+ * The score is the largest of the summed differences of the brighter and the darker ring
+ * pixels, beyond the threshold.
+ * @param[in] p The center pixel
+ * @param[in] offsets The offsets of the ring pixels
+ * @return The score of the corner (at least 1)
+ */
+uint16_t FastDetector::score(const uint8_t *p, const int32_t *offsets) {
+    int32_t bright = p[0] + threshold;
+    int32_t dark = p[0] - threshold;
+    uint16_t bright_sum = 0, dark_sum = 0;
+
+    for(uint8_t i = 0; i < 16; ++i) {
+        int32_t v = p[offsets[i]];
+        if(v > bright)
+            bright_sum += v - bright;
+        else if(v < dark)
+            dark_sum += dark - v;
+    }
+    return std::max(bright_sum, dark_sum);
+}
+
+/**
+ * @brief Detect and score the corner candidates
+ *
+ * The rows are tested with the vectorized kernel. With non-maximum suppression the scores of
+ * the last 3 rows are kept, so the middle row can be compared with its neighbours once the row
+ * below is scored. The rows outside the detection area have no corners.
+ * @param[in] src The luma of the image
+ * @param[in] stride The row stride in bytes
+ */
+void FastDetector::detectCandidates(const uint8_t *src, uint32_t stride) {
+    candidates.clear();
+    if(width < 7 || height < 7)
+        return;
+
+    uint8_t arc = (type == FAST_12)? 12 : 9;
+    int32_t offsets[16];
+    for(uint8_t i = 0; i < 16; ++i)
+        offsets[i] = fast_ring_offsets[i][0] + fast_ring_offsets[i][1] * (int32_t)stride;
+
+    uint32_t row_cnt[3] = {0, 0, 0};
+    memset(row_scores.data(), 0, row_scores.size() * sizeof(uint16_t));
+
+    // The last row is empty and only used to suppress the row above
+    for(uint32_t y = 3; y < height - 2; ++y) {
+        uint32_t slot = y % 3;
+        uint16_t *pos = &row_corners[slot * width];
+        uint16_t *scores = &row_scores[slot * width];
+
+        // Clear the scores of row y - 3
+        for(uint32_t i = 0; i < row_cnt[slot]; ++i)
+            scores[pos[i]] = 0;
+        row_cnt[slot] = 0;
+
+        if(y < height - 3) {
+            const uint8_t *row = src + y * stride;
+            row_cnt[slot] = fast_row(row, stride, 3, width - 3, threshold, arc, pos);
+            for(uint32_t i = 0; i < row_cnt[slot]; ++i)
+                scores[pos[i]] = score(row + pos[i], offsets);
+        }
+
+        if(!non_max_suppression) {
+            for(uint32_t i = 0; i < row_cnt[slot]; ++i)
+                candidates.push_back({pos[i], (uint16_t)y, scores[pos[i]]});
+            continue;
+        }
+
+        // Suppress the corners of the previous row with a stronger neighbour, where of equal
+        // neighbours only the last one in scan order is kept
+        uint32_t prev_slot = (y - 1) % 3;
+        const uint16_t *prev_pos = &row_corners[prev_slot * width];
+        const uint16_t *above = &row_scores[((y - 2) % 3) * width];
+        const uint16_t *middle = &row_scores[prev_slot * width];
+        const uint16_t *below = scores;
+        for(uint32_t i = 0; i < row_cnt[prev_slot]; ++i) {
+            uint16_t x = prev_pos[i];
+            uint16_t s = middle[x];
+            if(s >= middle[x - 1] && s > middle[x + 1] &&
+                    s >= above[x - 1] && s >= above[x] && s >= above[x + 1] &&
+                    s > below[x - 1] && s > below[x] && s > below[x + 1])
+                candidates.push_back({x, (uint16_t)(y - 1), s});
+        }
+    }
+}
+
+/**
+ * @brief Adapt the threshold to the amount of candidates
+ *
+ * @see setTarget
+ */
+void FastDetector::adaptThreshold(void) {
+    if(target == 0)
+        return;
+
+    uint32_t cnt = candidates.size();
+    int32_t step = std::max(1, threshold / 8);
+    int32_t thres = threshold;
+    if(cnt > target + target / 10)
+        thres += (cnt > 2 * target)? step : 1;
+    else if(cnt + target / 10 < target)
+        thres -= (2 * cnt < target)? step : 1;
+
+    threshold = std::min<int32_t>(std::max<int32_t>(thres, min_threshold), max_threshold);
+}
@@ -17,14 +17,21 @@
 
 #include "vision/image.h"
 
+#include "vision/simd.h"
+#include "vision/kernels/kernels.h"
 #include <string>
+#include <vector>
 #include <stdexcept>
+#include <string.h>
+#include <math.h>
 #include <assert.h>
 
 /**
  * @brief Create a new image
  *
- * This will create a new image with a specific pixel format, width and height.
+ * This will create a new image with a specific pixel format, width and height. The rows of
+ * raw images are packed, so the stride is the width times the pixel size. For planar images
+ * the chroma planes directly follow the luma plane.
  * @param pixel_format The image pixel format (ordering of channels per pixel)
  * @param width The image width in pixels
  * @param height The image height in pixels
@@ -34,8 +41,21 @@ Image::Image(enum pixel_formats pixel_format, uint32_t width, uint32_t height, u
     width(width),
     height(height),
     pixel_format(pixel_format),
-    size(size) {
+    size(size),
+    timestamp(0),
+    sequence(0),
+    dropped(0) {
 
+    switch(pixel_format) {
+    case FMT_JPEG:
+    case FMT_H264:
+        stride = 0;
+        break;
+
+    default:
+        stride = width * getPixelSize(pixel_format);
+        break;
+    }
 }
 
 /**
@@ -55,16 +75,68 @@ enum Image::pixel_formats Image::getPixelFormat(void) {
  * @return The size of one pixel
  */
 uint16_t Image::getPixelSize(void) {
+    return getPixelSize(pixel_format);
+}
+
+/**
+ * @brief Get the size in bytes of a single pixel of a pixel format
+ *
+ * This will return the size in bytes of 1 pixel if possible. For planar formats this is the
+ * size of a pixel in the luma plane.
+ * @param[in] pixel_format The pixel format
+ * @return The size of one pixel
+ */
+uint16_t Image::getPixelSize(enum pixel_formats pixel_format) {
     switch(pixel_format) {
+    case FMT_GRAY8:
+    case FMT_NV12:
+    case FMT_I420:
+        return sizeof(uint8_t);
+
     case FMT_UYVY:
     case FMT_YUYV:
         return (sizeof(uint8_t) * 2);
 
+    case FMT_RGB24:
+    case FMT_BGR24:
+        return (sizeof(uint8_t) * 3);
+
     default:
         throw std::runtime_error("Unknown pixel format " + std::to_string(pixel_format));
     }
 }
 
+/**
+ * @brief Get the size in bytes of a packed image
+ *
+ * This will calculate the amount of bytes needed for an image with packed rows, including the
+ * chroma planes for planar formats. The YUV420 formats need an even width and height.
+ * @param[in] pixel_format The pixel format
+ * @param[in] width The width in pixels
+ * @param[in] height The height in pixels
+ * @return The image size in bytes
+ */
+uint32_t Image::getBufferSize(enum pixel_formats pixel_format, uint32_t width, uint32_t height) {
+    switch(pixel_format) {
+    case FMT_NV12:
+    case FMT_I420:
+        return width * height + 2 * (width / 2) * (height / 2);
+
+    default:
+        return getPixelSize(pixel_format) * width * height;
+    }
+}
+
+/**
+ * @brief Check if a pixel format is planar
+ *
+ * @param[in] pixel_format The pixel format
+ * @return True when the chroma is stored in separate planes after the luma
+ */
+bool Image::isPlanar(enum pixel_formats pixel_format) {
+    return (pixel_format == FMT_NV12 || pixel_format == FMT_I420);
+}
+
 /**
  * @brief Get the image width
  *
@@ -96,6 +168,83 @@ uint32_t Image::getSize(void) {
     return size;
 }
 
+/**
+ * @brief Get the row stride
+ *
+ * This will return the amount of bytes between the start of two consecutive rows. This can
+ * be larger then the width times the pixel size, for example for a view on another image.
+ * For encoded images the stride is 0.
+ * @return The row stride in bytes
+ */
+uint32_t Image::getStride(void) {
+    return stride;
+}
+
+/**
+ * @brief Check if the rows are packed
+ *
+ * This checks if there is no padding between the rows, so the image can be processed as one
+ * continuous block of memory. Encoded images are never contiguous.
+ * @return True when the stride equals the width times the pixel size
+ */
+bool Image::isContiguous(void) {
+    return (stride != 0 && stride == width * getPixelSize());
+}
+
+/**
+ * @brief Get the capture time
+ *
+ * @return The capture time in microseconds on CLOCK_MONOTONIC (0 when unknown)
+ */
+uint64_t Image::getTimestamp(void) {
+    return timestamp;
+}
+
+/**
+ * @brief Get the capture sequence number
+ *
+ * @return The sequence number of the frame from the camera
+ */
+uint32_t Image::getSequence(void) {
+    return sequence;
+}
+
+/**
+ * @brief Get the amount of dropped frames
+ *
+ * This is the amount of frames the camera captured between the previous delivered frame and
+ * this frame, which were never delivered.
+ * @return The amount of frames dropped right before this frame
+ */
+uint32_t Image::getDropped(void) {
+    return dropped;
+}
+
+/**
+ * @brief Set the capture information
+ *
+ * This is set by the camera when the frame is captured.
+ * @param[in] timestamp The capture time in microseconds on CLOCK_MONOTONIC (0 when unknown)
+ * @param[in] sequence The capture sequence number
+ * @param[in] dropped The amount of frames dropped right before this frame
+ */
+void Image::setCaptureInfo(uint64_t timestamp, uint32_t sequence, uint32_t dropped) {
+    this->timestamp = timestamp;
+    this->sequence = sequence;
+    this->dropped = dropped;
+}
+
+/**
+ * @brief Copy the capture information of another image
+ *
+ * This is used by the encoders and views, so the derived image carries the capture time of its
+ * source.
+ * @param[in] src The image to copy the capture information from
+ */
+void Image::copyCaptureInfo(Ptr src) {
+    setCaptureInfo(src->timestamp, src->sequence, src->dropped);
+}
+
 /**
  * @brief Return the image data
  *
@@ -111,33 +260,564 @@ void *Image::getData(void) {
  * @brief Downsample the image
  *
  * This will downsample the image by dividing both the width and height by the downsample
- * factor. This is only implemented for YUV 422 images and the width must be even. The
- * result is saved in the same image.
- * @param downsample The downsample factor
+ * factor. This is only implemented for YUV 422 images, where the width must be even, and
+ * GRAY8 images. The result is saved in the same image. The new width of YUV422 images is
+ * rounded down to an even amount of pixels. Factors of 2 and 4 (and 2 for box averaging of
+ * GRAY8) use the vectorized kernels selected by the SIMD class. Packed images stay packed,
+ * while images with a larger stride (views) keep their stride so the result stays inside the
+ * original rows.
+ * @param[in] downsample The downsample factor
+ * @param[in] method The downsample method (point sampling or box averaging)
  */
-void Image::downsample(uint16_t downsample) {
-    assert(pixel_format == FMT_UYVY || pixel_format == FMT_YUYV);
-    assert(width%2 == 0);
+void Image::downsample(uint16_t downsample, enum downsample_methods method) {
+    assert(pixel_format == FMT_UYVY || pixel_format == FMT_YUYV || pixel_format == FMT_GRAY8);
+    assert(pixel_format == FMT_GRAY8 || width%2 == 0);
     assert(downsample > 1);
 
-    uint8_t *src = (uint8_t *)data;
-    uint8_t *dst = (uint8_t *)data;
-    uint32_t new_width = width / downsample;
+    uint8_t *src = (uint8_t *)getData();
+    uint8_t *dst = (uint8_t *)getData();
+    uint32_t src_stride = stride;
+    uint32_t new_width = (pixel_format == FMT_GRAY8)? width / downsample : (width / downsample) & ~1;
     uint32_t new_height = height / downsample;
-    uint32_t pixel_skip = (downsample - 1) * 2;
-
-    for(uint32_t y = 0; y < new_height; y++) {
-        for(uint32_t x = 0; x < new_width; x += 2) {
-            *dst++ = *src++;
-            *dst++ = *src++;
-            *dst++ = *src++;
-            src += pixel_skip;
-            *dst++ = *src++;
-            src += pixel_skip;
-        }
-        src += pixel_skip * width;
-    }
+    uint32_t dst_stride = isContiguous()? new_width * getPixelSize() : stride;
+    bool uyvy = (pixel_format == FMT_UYVY);
+
+    if(pixel_format == FMT_GRAY8)
+        downsampleGray(src, src_stride, dst, dst_stride, new_width, new_height, downsample, method);
+    else if(method == DOWNSAMPLE_POINT)
+        downsampleYUV422Point(src, src_stride, dst, dst_stride, new_width, new_height, downsample, uyvy);
+    else
+        downsampleYUV422Box(src, src_stride, dst, dst_stride, new_width, new_height, downsample, uyvy);
 
     width = new_width;
     height = new_height;
+    stride = dst_stride;
+    size = (new_height > 0)? (new_height - 1) * dst_stride + new_width * getPixelSize() : 0;
+}
+
+/**
+ * @brief Downsample the image into another image
+ *
+ * This will downsample the image in the same way as the in place downsample, but writes the
+ * result into the output image. The source image is not modified, so it can still be used
+ * (for example by an encoder) while the downsampled image is used for vision. The output
+ * must have the same pixel format and a width of (width / downsample), rounded down to an
+ * even number for YUV422, and a height of (height / downsample). Both images can have any
+ * stride, so the output can also be a view on a larger image.
+ * @param[out] output The output image (for example a preallocated ImageBuffer or ImageView)
+ * @param[in] downsample The downsample factor
+ * @param[in] method The downsample method (point sampling or box averaging)
+ */
+void Image::downsample(Ptr output, uint16_t downsample, enum downsample_methods method) {
+    assert(pixel_format == FMT_UYVY || pixel_format == FMT_YUYV || pixel_format == FMT_GRAY8);
+    assert(pixel_format == FMT_GRAY8 || width%2 == 0);
+    assert(downsample > 1);
+
+    uint32_t new_width = (pixel_format == FMT_GRAY8)? width / downsample : (width / downsample) & ~1;
+    uint32_t new_height = height / downsample;
+    if(output->pixel_format != pixel_format || output->width != new_width || output->height != new_height) {
+        throw std::runtime_error("Downsample output must be " + std::to_string(new_width) + "x" + std::to_string(new_height)
+                                 + " with pixel format " + std::to_string(pixel_format));
+    }
+
+    const uint8_t *src = (const uint8_t *)getData();
+    uint8_t *dst = (uint8_t *)output->getData();
+    bool uyvy = (pixel_format == FMT_UYVY);
+
+    if(pixel_format == FMT_GRAY8)
+        downsampleGray(src, stride, dst, output->stride, new_width, new_height, downsample, method);
+    else if(method == DOWNSAMPLE_POINT)
+        downsampleYUV422Point(src, stride, dst, output->stride, new_width, new_height, downsample, uyvy);
+    else
+        downsampleYUV422Box(src, stride, dst, output->stride, new_width, new_height, downsample, uyvy);
+}
+
+/**
+ * @brief Convert the image into another pixel format
+ *
+ * This will convert a YUV422 image into the pixel format of the output image. The output must
+ * have the same width and height and can be FMT_GRAY8 (luma only), FMT_NV12 or FMT_I420 (the
+ * chroma of two rows is averaged), FMT_RGB24 or FMT_BGR24 (BT.601 video range) or the other
+ * YUV422 order. A FMT_RGB24 or FMT_BGR24 image can be converted back into FMT_UYVY or FMT_YUYV,
+ * where the chroma of two neighbouring pixels is averaged. Both images can have any stride,
+ * except that planar outputs must be packed (the stride equals the width and the chroma planes
+ * directly follow the luma plane), otherwise an exception is thrown.
+ * @param[out] output The output image
+ */
+void Image::convert(Ptr output) {
+    if(output->width != width || output->height != height) {
+        throw std::runtime_error("Convert output must be " + std::to_string(width) + "x" + std::to_string(height));
+    }
+
+    switch(pixel_format) {
+    case FMT_UYVY:
+    case FMT_YUYV:
+        convertYUV422((const uint8_t *)getData(), stride, (pixel_format == FMT_UYVY), output.get());
+        break;
+
+    case FMT_RGB24:
+    case FMT_BGR24:
+        convertRGB24((const uint8_t *)getData(), stride, (pixel_format == FMT_BGR24), output.get());
+        break;
+
+    default:
+        throw std::runtime_error("Converting is only implemented for YUV422 and RGB images and not for " + std::to_string(pixel_format));
+    }
+}
+
+/**
+ * @brief Blur the image
+ *
+ * This will blur the image with a square window and save the result in the same image. This is
+ * implemented for FMT_UYVY, FMT_YUYV and FMT_GRAY8 images. The filter is separable and works
+ * directly on the packed pixels, where the chroma of YUV422 is filtered with the same window on
+ * its own samples. Pixels outside the image are replaced by the nearest border pixel. Box
+ * blurring uses sliding window sums, so the cost doesn't depend on the window height.
+ * @param[in] size The window size in pixels (odd, from 3 up to 15)
+ * @param[in] method The blur method (box or gaussian)
+ */
+void Image::blur(uint16_t size, enum blur_methods method) {
+    blurSeparable((const uint8_t *)getData(), stride, this, size, method);
+}
+
+/**
+ * @brief Blur the image into another image
+ *
+ * This will blur the image in the same way as the in place blur, but writes the result into the
+ * output image, which must have the same pixel format, width and height. The output can for
+ * example be an image from an ImageBufferPool or a view, but must not overlap the source.
+ * @param[out] output The output image
+ * @param[in] size The window size in pixels (odd, from 3 up to 15)
+ * @param[in] method The blur method (box or gaussian)
+ */
+void Image::blur(Ptr output, uint16_t size, enum blur_methods method) {
+    if(output->pixel_format != pixel_format || output->width != width || output->height != height) {
+        throw std::runtime_error("Blur output must be " + std::to_string(width) + "x" + std::to_string(height)
+                                 + " with pixel format " + std::to_string(pixel_format));
+    }
+
+    blurSeparable((const uint8_t *)getData(), stride, output.get(), size, method);
+}
+
+/**
+ * @brief Convert YUV422 pixels into the output image
+ *
+ * This selects the vectorized kernel for the current instruction set when one is available
+ * and falls back to the scalar implementation otherwise.
+ * @param[in] src The source pixels
+ * @param[in] src_stride The source row stride in bytes
+ * @param[in] uyvy If the pixel order is UYVY instead of YUYV
+ * @param[out] output The output image with the same width and height
+ */
+void Image::convertYUV422(const uint8_t *src, uint32_t src_stride, bool uyvy, Image *output) {
+    void (*extract_luma)(const uint8_t *, uint32_t, uint8_t *, uint32_t, uint32_t, uint32_t, bool) = extract_luma_yuv422_scalar;
+    void (*chroma_420)(const uint8_t *, uint32_t, uint8_t *, uint8_t *, uint32_t, uint32_t, uint32_t, bool) = chroma_yuv422_to_420_scalar;
+    void (*to_rgb24)(const uint8_t *, uint32_t, uint8_t *, uint32_t, uint32_t, uint32_t, bool, bool) = yuv422_to_rgb24_scalar;
+
+    switch(SIMD::getInstructionSet()) {
+#if defined(TUV_HAVE_SSE2)
+    case SIMD::ISA_AVX2:
+    case SIMD::ISA_SSE2:
+        extract_luma = extract_luma_yuv422_sse2;
+        chroma_420 = chroma_yuv422_to_420_sse2;
+        to_rgb24 = yuv422_to_rgb24_sse2;
+        break;
+#endif
+
+#if defined(TUV_HAVE_NEON)
+    case SIMD::ISA_NEON:
+        extract_luma = extract_luma_yuv422_neon;
+        chroma_420 = chroma_yuv422_to_420_neon;
+        to_rgb24 = yuv422_to_rgb24_neon;
+        break;
+#endif
+
+    default:
+        break;
+    }
+
+    uint8_t *dst = (uint8_t *)output->getData();
+    uint32_t width = output->width;
+    uint32_t height = output->height;
+    uint32_t dst_stride = output->stride;
+
+    switch(output->pixel_format) {
+    case FMT_GRAY8:
+        extract_luma(src, src_stride, dst, dst_stride, width, height, uyvy);
+        break;
+
+    case FMT_NV12:
+    case FMT_I420: {
+        assert(width % 2 == 0 && height % 2 == 0);
+        if(dst_stride != width || output->size < getBufferSize(output->pixel_format, width, height)) {
+            throw std::runtime_error("Planar convert output must be packed with a stride of " + std::to_string(width) + " and a size of "
+                                     + std::to_string(getBufferSize(output->pixel_format, width, height)) + " bytes");
+        }
+
+        uint8_t *u = dst + dst_stride * height;
+        extract_luma(src, src_stride, dst, dst_stride, width, height, uyvy);
+
+        if(output->pixel_format == FMT_NV12)
+            chroma_420(src, src_stride, u, NULL, dst_stride, width, height, uyvy);
+        else
+            chroma_420(src, src_stride, u, u + (dst_stride / 2) * (height / 2), dst_stride / 2, width, height, uyvy);
+        break;
+    }
+
+    case FMT_RGB24:
+    case FMT_BGR24:
+        to_rgb24(src, src_stride, dst, dst_stride, width, height, uyvy, (output->pixel_format == FMT_BGR24));
+        break;
+
+    case FMT_UYVY:
+    case FMT_YUYV:
+        // Swap the luma and chroma bytes when the order differs
+        for(uint32_t y = 0; y < height; ++y) {
+            const uint8_t *row = src + y * src_stride;
+            uint8_t *out = dst + y * dst_stride;
+            bool swap = ((output->pixel_format == FMT_UYVY) != uyvy);
+
+            for(uint32_t x = 0; x < width * 2; x += 2) {
+                uint8_t a = row[x];
+                out[x] = swap? row[x + 1] : a;
+                out[x + 1] = swap? a : row[x + 1];
+            }
+        }
+        break;
+
+    default:
+        throw std::runtime_error("Converting to pixel format " + std::to_string(output->pixel_format) + " is not implemented");
+    }
+}
+
+/**
+ * @brief Convert RGB24 or BGR24 pixels into the output image
+ *
+ * This selects the vectorized kernel for the current instruction set when one is available
+ * and falls back to the scalar implementation otherwise.
+ * @param[in] src The source pixels
+ * @param[in] src_stride The source row stride in bytes
+ * @param[in] bgr If the pixel order is BGR instead of RGB
+ * @param[out] output The output image with the same width and height
+ */
+void Image::convertRGB24(const uint8_t *src, uint32_t src_stride, bool bgr, Image *output) {
+    void (*to_yuv422)(const uint8_t *, uint32_t, uint8_t *, uint32_t, uint32_t, uint32_t, bool, bool) = rgb24_to_yuv422_scalar;
+
+    switch(SIMD::getInstructionSet()) {
+#if defined(TUV_HAVE_SSE2)
+    case SIMD::ISA_AVX2:
+    case SIMD::ISA_SSE2:
+        to_yuv422 = rgb24_to_yuv422_sse2;
+        break;
+#endif
+
+#if defined(TUV_HAVE_NEON)
+    case SIMD::ISA_NEON:
+        to_yuv422 = rgb24_to_yuv422_neon;
+        break;
+#endif
+
+    default:
+        break;
+    }
+
+    uint8_t *dst = (uint8_t *)output->getData();
+    uint32_t width = output->width;
+    uint32_t height = output->height;
+
+    switch(output->pixel_format) {
+    case FMT_UYVY:
+    case FMT_YUYV:
+        assert(width % 2 == 0);
+        to_yuv422(src, src_stride, dst, output->stride, width, height, (output->pixel_format == FMT_UYVY), bgr);
+        break;
+
+    default:
+        throw std::runtime_error("Converting RGB to pixel format " + std::to_string(output->pixel_format) + " is not implemented");
+    }
+}
+
+/**
+ * @brief Blur packed pixels with a separable filter into the output image
+ *
+ * Every output row is first filtered vertically into a padded temporary row, after which the
+ * padding is filled with the border samples of every channel and the row is filtered
+ * horizontally into the output. Both passes use 8 bit fixed-point weights, so the result is
+ * the same for every instruction set. When the source and output are the same, the original
+ * rows which are still needed are kept in a small ring buffer.
+ * @param[in] src The source pixels with the pixel format, width and height of the output
+ * @param[in] src_stride The source row stride in bytes
+ * @param[out] output The output image (can contain the source pixels)
+ * @param[in] size The window size in pixels
+ * @param[in] method The blur method
+ */
+void Image::blurSeparable(const uint8_t *src, uint32_t src_stride, Image *output, uint16_t size, enum blur_methods method) {
+    if(output->pixel_format != FMT_UYVY && output->pixel_format != FMT_YUYV && output->pixel_format != FMT_GRAY8) {
+        throw std::runtime_error("Blurring is only implemented for YUV422 and GRAY8 images and not for " + std::to_string(output->pixel_format));
+    }
+    if(size < 3 || size > KERNEL_MAX_TAPS || size % 2 == 0) {
+        throw std::runtime_error("Blur size must be odd and between 3 and " + std::to_string(KERNEL_MAX_TAPS) + " and not " + std::to_string(size));
+    }
+    assert(output->pixel_format == FMT_GRAY8 || output->width % 2 == 0);
+
+    // Distance between the samples of the even and odd bytes
+    uint8_t step_even = 1, step_odd = 1;
+    if(output->pixel_format == FMT_YUYV) {
+        step_even = 2;
+        step_odd = 4;
+    } else if(output->pixel_format == FMT_UYVY) {
+        step_even = 4;
+        step_odd = 2;
+    }
+
+    uint8_t *dst = (uint8_t *)output->getData();
+    uint32_t dst_stride = output->stride;
+    uint32_t length = output->width * output->getPixelSize();
+    uint32_t height = output->height;
+    void (*filter_rows)(const uint8_t *const *, const uint16_t *, uint16_t, uint16_t, uint16_t, uint8_t *, uint32_t) = filter_rows_u8_scalar;
+    void (*box_rows)(uint16_t *, const uint8_t *, const uint8_t *, uint8_t *, uint32_t, uint16_t, uint16_t) = box_rows_u8_scalar;
+    void (*filter_row)(const uint8_t *, uint8_t *, uint32_t, const uint16_t *, uint16_t, uint16_t, uint16_t, uint8_t, uint8_t) = filter_row_u8_scalar;
+
+    switch(SIMD::getInstructionSet()) {
+#if defined(TUV_HAVE_SSE2)
+    case SIMD::ISA_AVX2:
+    case SIMD::ISA_SSE2:
+        filter_rows = filter_rows_u8_sse2;
+        box_rows = box_rows_u8_sse2;
+        filter_row = filter_row_u8_sse2;
+        break;
+#endif
+
+#if defined(TUV_HAVE_NEON)
+    case SIMD::ISA_NEON:
+        filter_rows = filter_rows_u8_neon;
+        box_rows = box_rows_u8_neon;
+        filter_row = filter_row_u8_neon;
+        break;
+#endif
+
+    default:
+        break;
+    }
+
+    // Calculate the fixed-point weights, the results are scaled by ((sum + bias) * mul) >> 16
+    int32_t radius = size / 2;
+    uint16_t weights[KERNEL_MAX_TAPS];
+    uint16_t bias, mul;
+    if(method == BLUR_GAUSSIAN) {
+        // Same sigma as OpenCV uses for a given window size, with weights summing up to 256
+        double sigma = 0.3 * ((size - 1) * 0.5 - 1) + 0.8;
+        double gauss[KERNEL_MAX_TAPS], total = 0;
+        for(int32_t k = 0; k < size; ++k) {
+            gauss[k] = exp(-((k - radius) * (k - radius)) / (2 * sigma * sigma));
+            total += gauss[k];
+        }
+
+        uint16_t sum = 0;
+        for(int32_t k = 0; k < size; ++k) {
+            weights[k] = (uint16_t)(gauss[k] * 256 / total + 0.5);
+            sum += weights[k];
+        }
+        weights[radius] += 256 - sum;
+        bias = 128;
+        mul = 256;
+    } else {
+        for(int32_t k = 0; k < size; ++k)
+            weights[k] = 1;
+        bias = size / 2;
+        mul = (65536 + size - 1) / size;
+    }
+
+    // Temporary row with padding for the horizontal pass
+    uint32_t pad = radius * ((step_even > step_odd)? step_even : step_odd);
+    std::vector<uint8_t> tmp(length + 2 * pad);
+    uint8_t *row = tmp.data() + pad;
+
+    // Original rows which are overwritten when blurring in place
+    bool in_place = ((const uint8_t *)dst == src);
+    std::vector<uint8_t> ring(in_place? (radius + 1) * length : 0);
+    std::vector<uint16_t> sums(method == BLUR_BOX? length : 0, 0);
+
+    // Get an original source row where the rows outside the image are clamped to the border
+    auto getRow = [&](int32_t y, int32_t current) -> const uint8_t * {
+        if(y < 0)
+            y = 0;
+        if(y >= (int32_t)height)
+            y = height - 1;
+        if(in_place && y < current)
+            return ring.data() + (y % (radius + 1)) * length;
+        return src + y * src_stride;
+    };
+
+    for(int32_t y = 0; y < (int32_t)height; ++y) {
+        // Vertical pass
+        if(method == BLUR_GAUSSIAN) {
+            const uint8_t *rows[KERNEL_MAX_TAPS];
+            for(int32_t k = 0; k < size; ++k)
+                rows[k] = getRow(y + k - radius, y);
+            filter_rows(rows, weights, size, bias, mul, row, length);
+        } else if(y == 0) {
+            for(int32_t k = -radius; k < radius; ++k)
+                box_rows(sums.data(), getRow(k, y), NULL, NULL, length, bias, mul);
+            box_rows(sums.data(), getRow(radius, y), NULL, row, length, bias, mul);
+        } else {
+            box_rows(sums.data(), getRow(y + radius, y), getRow(y - radius - 1, y), row, length, bias, mul);
+        }
+
+        // Replicate the border samples of every channel into the padding
+        for(uint32_t i = 1; i <= pad; ++i) {
+            uint32_t left = (i & 1)? step_odd : step_even;
+            uint32_t right = ((length - 1 + i) & 1)? step_odd : step_even;
+            row[-(int32_t)i] = row[(left - i % left) % left];
+            row[length - 1 + i] = row[length - right + (right - 1 + i) % right];
+        }
+
+        // Keep the original row before it is overwritten
+        if(in_place)
+            memcpy(ring.data() + (y % (radius + 1)) * length, src + y * src_stride, length);
+
+        // Horizontal pass
+        filter_row(row, dst + y * dst_stride, length, weights, size, bias, mul, step_even, step_odd);
+    }
+}
+
+/**
+ * @brief Point sample YUV422 pixels
+ *
+ * This selects the vectorized kernel for the current instruction set when one is available
+ * for the downsample factor and falls back to the scalar implementation otherwise.
+ * @param[in] src The source pixels
+ * @param[in] src_stride The source row stride in bytes
+ * @param[out] dst The output pixels (can be the same as the source)
+ * @param[in] dst_stride The output row stride in bytes
+ * @param[in] dst_width The output width in pixels
+ * @param[in] dst_height The output height in pixels
+ * @param[in] factor The downsample factor
+ * @param[in] uyvy If the pixel order is UYVY instead of YUYV
+ */
+void Image::downsampleYUV422Point(const uint8_t *src, uint32_t src_stride, uint8_t *dst, uint32_t dst_stride, uint32_t dst_width, uint32_t dst_height, uint16_t factor, bool uyvy) {
+    switch(SIMD::getInstructionSet()) {
+#if defined(TUV_HAVE_AVX2)
+    case SIMD::ISA_AVX2:
+        if(factor == 2)
+            return downsample_yuv422_point2_avx2(src, src_stride, dst, dst_stride, dst_width, dst_height, uyvy);
+        if(factor == 4)
+            return downsample_yuv422_point4_avx2(src, src_stride, dst, dst_stride, dst_width, dst_height, uyvy);
+        break;
+#endif
+
+#if defined(TUV_HAVE_SSE2)
+    case SIMD::ISA_SSE2:
+        if(factor == 2)
+            return downsample_yuv422_point2_sse2(src, src_stride, dst, dst_stride, dst_width, dst_height, uyvy);
+        if(factor == 4)
+            return downsample_yuv422_point4_sse2(src, src_stride, dst, dst_stride, dst_width, dst_height, uyvy);
+        break;
+#endif
+
+#if defined(TUV_HAVE_NEON)
+    case SIMD::ISA_NEON:
+        if(factor == 2)
+            return downsample_yuv422_point2_neon(src, src_stride, dst, dst_stride, dst_width, dst_height, uyvy);
+        if(factor == 4)
+            return downsample_yuv422_point4_neon(src, src_stride, dst, dst_stride, dst_width, dst_height, uyvy);
+        break;
+#endif
+
+    default:
+        break;
+    }
+
+    downsample_yuv422_point_scalar(src, src_stride, dst, dst_stride, dst_width, dst_height, factor, uyvy);
+}
+
+/**
+ * @brief Box average YUV422 pixels
+ *
+ * This selects the vectorized kernel for the current instruction set when one is available
+ * for the downsample factor (2 or 4) and falls back to the scalar implementation otherwise.
+ * @param[in] src The source pixels
+ * @param[in] src_stride The source row stride in bytes
+ * @param[out] dst The output pixels (can be the same as the source)
+ * @param[in] dst_stride The output row stride in bytes
+ * @param[in] dst_width The output width in pixels
+ * @param[in] dst_height The output height in pixels
+ * @param[in] factor The downsample factor
+ * @param[in] uyvy If the pixel order is UYVY instead of YUYV
+ */
+void Image::downsampleYUV422Box(const uint8_t *src, uint32_t src_stride, uint8_t *dst, uint32_t dst_stride, uint32_t dst_width, uint32_t dst_height, uint16_t factor, bool uyvy) {
+    switch(SIMD::getInstructionSet()) {
+#if defined(TUV_HAVE_AVX2)
+    case SIMD::ISA_AVX2:
+        if(factor == 2)
+            return downsample_yuv422_box2_avx2(src, src_stride, dst, dst_stride, dst_width, dst_height, uyvy);
+        if(factor == 4)
+            return downsample_yuv422_box4_avx2(src, src_stride, dst, dst_stride, dst_width, dst_height, uyvy);
+        break;
+#endif
+
+#if defined(TUV_HAVE_SSE2)
+    case SIMD::ISA_SSE2:
+        if(factor == 2)
+            return downsample_yuv422_box2_sse2(src, src_stride, dst, dst_stride, dst_width, dst_height, uyvy);
+        if(factor == 4)
+            return downsample_yuv422_box4_sse2(src, src_stride, dst, dst_stride, dst_width, dst_height, uyvy);
+        break;
+#endif
+
+#if defined(TUV_HAVE_NEON)
+    case SIMD::ISA_NEON:
+        if(factor == 2)
+            return downsample_yuv422_box2_neon(src, src_stride, dst, dst_stride, dst_width, dst_height, uyvy);
+        if(factor == 4)
+            return downsample_yuv422_box4_neon(src, src_stride, dst, dst_stride, dst_width, dst_height, uyvy);
+        break;
+#endif
+
+    default:
+        break;
+    }
+
+    downsample_yuv422_box_scalar(src, src_stride, dst, dst_stride, dst_width, dst_height, factor, uyvy);
+}
+
+/**
+ * @brief Downsample GRAY8 pixels
+ *
+ * This selects the vectorized kernel for box averaging by a factor of 2, which is used for
+ * building image pyramids, and falls back to the scalar implementation otherwise.
+ * @param[in] src The source pixels
+ * @param[in] src_stride The source row stride in bytes
+ * @param[out] dst The output pixels (can be the same as the source)
+ * @param[in] dst_stride The output row stride in bytes
+ * @param[in] dst_width The output width in pixels
+ * @param[in] dst_height The output height in pixels
+ * @param[in] factor The downsample factor
+ * @param[in] method The downsample method
+ */
+void Image::downsampleGray(const uint8_t *src, uint32_t src_stride, uint8_t *dst, uint32_t dst_stride, uint32_t dst_width, uint32_t dst_height, uint16_t factor, enum downsample_methods method) {
+    if(method == DOWNSAMPLE_POINT)
+        return downsample_gray_point_scalar(src, src_stride, dst, dst_stride, dst_width, dst_height, factor);
+
+    switch(SIMD::getInstructionSet()) {
+#if defined(TUV_HAVE_SSE2)
+    case SIMD::ISA_AVX2:
+    case SIMD::ISA_SSE2:
+        if(factor == 2)
+            return downsample_gray_box2_sse2(src, src_stride, dst, dst_stride, dst_width, dst_height);
+        break;
+#endif
+
+#if defined(TUV_HAVE_NEON)
+    case SIMD::ISA_NEON:
+        if(factor == 2)
+            return downsample_gray_box2_neon(src, src_stride, dst, dst_stride, dst_width, dst_height);
+        break;
+#endif
+
+    default:
+        break;
+    }
+
+    downsample_gray_box_scalar(src, src_stride, dst, dst_stride, dst_width, dst_height, factor);
 }
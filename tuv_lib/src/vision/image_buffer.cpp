@@ -31,8 +31,8 @@
  */
 ImageBuffer::ImageBuffer(enum pixel_formats pixel_format, uint32_t width, uint32_t height):
     Image(pixel_format, width, height) {
+    this->size = getBufferSize(pixel_format, width, height);
     this->data = malloc(this->size);
-    this->size = (getPixelSize() * width * height);
 }
 
 /**
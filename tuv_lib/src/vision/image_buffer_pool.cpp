@@ -0,0 +1,259 @@
+/*
+ * This file is part of the TUV library (https://github.com/tudelft/tudelft_vision).
+ * Copyright (c) 2016 Freek van Tienen <freek.v.tienen@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "vision/image_buffer_pool.h"
+
+#include "drivers/clogger.h"
+#include <stdlib.h>
+#include <string>
+#include <stdexcept>
+#include <assert.h>
+
+/**
+ * @brief Create a new image buffer pool
+ *
+ * This will create a pool for raw images where the buffer size is determined by the pixel
+ * format.
+ * @param[in] pixel_format The pixel format of the images
+ * @param[in] width The width of the images in pixels
+ * @param[in] height The height of the images in pixels
+ * @param[in] count The amount of buffers to preallocate
+ */
+ImageBufferPool::ImageBufferPool(enum Image::pixel_formats pixel_format, uint32_t width, uint32_t height, uint16_t count):
+    ImageBufferPool(pixel_format, width, height, Image::getBufferSize(pixel_format, width, height), count) {
+
+}
+
+/**
+ * @brief Create a new image buffer pool
+ *
+ * This will create a pool with a specific buffer size. This should be used for formats where
+ * the size can't be determined by the pixel format, like encoded images.
+ * @param[in] pixel_format The pixel format of the images
+ * @param[in] width The width of the images in pixels
+ * @param[in] height The height of the images in pixels
+ * @param[in] size The size of every buffer in bytes
+ * @param[in] count The amount of buffers to preallocate
+ */
+ImageBufferPool::ImageBufferPool(enum Image::pixel_formats pixel_format, uint32_t width, uint32_t height, uint32_t size, uint16_t count):
+    pixel_format(pixel_format),
+    width(width),
+    height(height),
+    buffer_size(size),
+    stats(),
+    heap_cnt(0) {
+    assert(size > 0);
+
+    for(uint16_t i = 0; i < count; ++i)
+        createBuffer();
+}
+
+/**
+ * @brief Destroy the pool
+ *
+ * This will free all the buffers. Since every image keeps the pool alive, all images are
+ * already freed at this point.
+ */
+ImageBufferPool::~ImageBufferPool(void) {
+    for(auto &buf : buffers) {
+        assert(buf.is_free);
+        free(buf.data);
+    }
+}
+
+/**
+ * @brief Get a new image
+ *
+ * This will return an image with the geometry of the pool. The buffer is returned to the
+ * pool when the image is deleted.
+ * @return The image from the pool
+ */
+Image::Ptr ImageBufferPool::getImage(void) {
+    return getImage(acquire(), buffer_size);
+}
+
+/**
+ * @brief Acquire a free buffer
+ *
+ * This will reserve a free buffer of the pool, which can be filled before creating the image
+ * with getImage(index, size). This is used when the final size is not known beforehand, for
+ * example when encoding. When no image is created the buffer must be freed with freeImage.
+ * @return The index of the acquired buffer
+ */
+uint16_t ImageBufferPool::acquire(void) {
+    std::lock_guard<std::mutex> lock(mutex);
+    struct buffer_t *buf = getFreeBuffer();
+    buf->is_free = false;
+
+    // Update the statistics
+    stats.requests++;
+    stats.in_use++;
+    if(stats.in_use > stats.high_water)
+        stats.high_water = stats.in_use;
+
+    return buf->index;
+}
+
+/**
+ * @brief Get the data of a buffer
+ *
+ * @param[in] index The index of an acquired buffer
+ * @return Pointer to the buffer data
+ */
+void *ImageBufferPool::getData(uint16_t index) {
+    std::lock_guard<std::mutex> lock(mutex);
+    assert(index < buffers.size());
+    return buffers[index].data;
+}
+
+/**
+ * @brief Create an image from an acquired buffer
+ *
+ * This will create an image of an acquired buffer with a specific size. The image object is
+ * constructed in the slot of the buffer, so this doesn't allocate any memory. The image keeps
+ * the pool alive until it is deleted.
+ * @param[in] index The index of the acquired buffer
+ * @param[in] size The size of the image data in bytes
+ * @return The image from the pool
+ */
+Image::Ptr ImageBufferPool::getImage(uint16_t index, uint32_t size) {
+    struct buffer_t *buf;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        assert(index < buffers.size());
+        buf = &buffers[index];
+        assert(!buf->is_free);
+    }
+
+    if(size > buffer_size) {
+        freeImage(index);
+        throw std::runtime_error("Image size " + std::to_string(size) + " is larger then the pool buffer size " + std::to_string(buffer_size));
+    }
+
+    SlotAllocator<ImagePtr> alloc(shared_from_this(), buf, &heap_cnt);
+    return std::allocate_shared<ImagePtr>(alloc, this, index, pixel_format, width, height, buf->data, size);
+}
+
+/**
+ * @brief Return a buffer to the pool
+ *
+ * This will mark the buffer as free, so it can be reused. This is called by the image pointer
+ * when the image is deleted.
+ * @param[in] identifier The index of the buffer
+ */
+void ImageBufferPool::freeImage(uint16_t identifier) {
+    std::lock_guard<std::mutex> lock(mutex);
+    assert(identifier < buffers.size());
+    assert(!buffers[identifier].is_free);
+
+    buffers[identifier].is_free = true;
+    stats.in_use--;
+}
+
+/**
+ * @brief Get the pixel format of the images
+ *
+ * @return The pixel format of the images
+ */
+enum Image::pixel_formats ImageBufferPool::getPixelFormat(void) {
+    return pixel_format;
+}
+
+/**
+ * @brief Get the width of the images
+ *
+ * @return The width of the images in pixels
+ */
+uint32_t ImageBufferPool::getWidth(void) {
+    return width;
+}
+
+/**
+ * @brief Get the height of the images
+ *
+ * @return The height of the images in pixels
+ */
+uint32_t ImageBufferPool::getHeight(void) {
+    return height;
+}
+
+/**
+ * @brief Get the size of a buffer
+ *
+ * @return The size of a single buffer in bytes
+ */
+uint32_t ImageBufferPool::getBufferSize(void) {
+    return buffer_size;
+}
+
+/**
+ * @brief Get the pool statistics
+ *
+ * This returns the amount of buffers, the usage and the misses. In steady state the amount of
+ * misses and heap allocations should not increase.
+ * @return A copy of the current statistics
+ */
+struct ImageBufferPool::statistics_t ImageBufferPool::getStatistics(void) {
+    std::lock_guard<std::mutex> lock(mutex);
+    struct statistics_t res = stats;
+    res.heap_allocations = heap_cnt.load();
+    return res;
+}
+
+/**
+ * @brief Create a new buffer
+ *
+ * This will allocate a new aligned buffer and adds it to the pool. The mutex must be locked
+ * or the pool must not be shared yet.
+ * @return The newly created buffer
+ */
+struct ImageBufferPool::buffer_t *ImageBufferPool::createBuffer(void) {
+    void *data;
+    if(posix_memalign(&data, IMAGE_BUFFER_POOL_ALIGN, buffer_size) != 0) {
+        throw std::runtime_error("Could not allocate pool buffer of size " + std::to_string(buffer_size));
+    }
+
+    buffers.emplace_back();
+    struct buffer_t &buf = buffers.back();
+    buf.index = buffers.size() - 1;
+    buf.data = data;
+    buf.is_free = true;
+    buf.slot_used = false;
+    stats.buffers++;
+
+    CLOGGER_DEBUG("Created new pool buffer " << buf.index << " of size " << buffer_size);
+    return &buf;
+}
+
+/**
+ * @brief Get a free buffer
+ *
+ * This will search for a free buffer and create a new one when all buffers are in use. The
+ * mutex must be locked.
+ * @return A free buffer
+ */
+struct ImageBufferPool::buffer_t *ImageBufferPool::getFreeBuffer(void) {
+    // First check already created buffers
+    for(auto &buf : buffers) {
+        if(buf.is_free)
+            return &buf;
+    }
+
+    // Create a new buffer
+    stats.misses++;
+    return createBuffer();
+}
@@ -35,7 +35,7 @@ ImagePtr::ImagePtr(Handler *handler, uint16_t identifier, enum pixel_formats pix
     handler(handler),
     identifier(identifier) {
     this->data = data;
-    this->size = (getPixelSize() * width * height);
+    this->size = getBufferSize(pixel_format, width, height);
 }
 
 /**
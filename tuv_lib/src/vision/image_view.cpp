@@ -0,0 +1,82 @@
+/*
+ * This file is part of the TUV library (https://github.com/tudelft/tudelft_vision).
+ * Copyright (c) 2016 Freek van Tienen <freek.v.tienen@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "vision/image_view.h"
+
+#include <string>
+#include <stdexcept>
+
+/**
+ * @brief Create a new view on an image
+ *
+ * This will create a view on a region of the parent image without copying the data. Only raw
+ * images can be viewed and for YUV422 images the left offset and width must be even, since
+ * two pixels share the chroma. The view has the capture information of the parent.
+ * @param[in] parent The parent image
+ * @param[in] left The left offset in the parent in pixels
+ * @param[in] top The top offset in the parent in pixels
+ * @param[in] width The width of the view in pixels
+ * @param[in] height The height of the view in pixels
+ */
+ImageView::ImageView(Image::Ptr parent, uint32_t left, uint32_t top, uint32_t width, uint32_t height):
+    Image(parent->getPixelFormat(), width, height),
+    parent(parent),
+    left(left),
+    top(top) {
+    if(parent->getStride() == 0 || isPlanar(pixel_format)) {
+        throw std::runtime_error("Can only create a view on a raw image with a single plane");
+    }
+    if(left + width > parent->getWidth() || top + height > parent->getHeight()) {
+        throw std::runtime_error("View " + std::to_string(width) + "x" + std::to_string(height) + " at (" + std::to_string(left) + ", "
+                                 + std::to_string(top) + ") is outside the parent image");
+    }
+    if((pixel_format == FMT_UYVY || pixel_format == FMT_YUYV) && (left % 2 != 0 || width % 2 != 0)) {
+        throw std::runtime_error("The left offset and width of a YUV422 view must be even");
+    }
+
+    this->stride = parent->getStride();
+    this->data = (uint8_t *)parent->getData() + top * stride + left * getPixelSize();
+    this->size = (height > 0)? (height - 1) * stride + width * getPixelSize() : 0;
+    copyCaptureInfo(parent);
+}
+
+/**
+ * @brief Get the parent image
+ *
+ * @return The image this view points into
+ */
+Image::Ptr ImageView::getParent(void) {
+    return parent;
+}
+
+/**
+ * @brief Get the left offset
+ *
+ * @return The left offset in the parent image in pixels
+ */
+uint32_t ImageView::getLeft(void) {
+    return left;
+}
+
+/**
+ * @brief Get the top offset
+ *
+ * @return The top offset in the parent image in pixels
+ */
+uint32_t ImageView::getTop(void) {
+    return top;
+}
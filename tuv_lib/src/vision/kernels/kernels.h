@@ -0,0 +1,110 @@
+/*
+ * This file is part of the TUV library (https://github.com/tudelft/tudelft_vision).
+ * Copyright (c) 2016 Freek van Tienen <freek.v.tienen@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef VISION_KERNELS_H_
+#define VISION_KERNELS_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Internal vision kernels
+ *
+ * These are the low level pixel kernels used by the vision classes. Every kernel has a scalar
+ * reference implementation and optionally vectorized implementations for the different
+ * instruction sets. The vectorized implementations are compiled in separate files with their
+ * own compiler flags and are selected at runtime through the SIMD class.
+ *
+ * Kernels only work on raw pointers and strides (in bytes), so that the instruction set specific
+ * files don't need any library headers. Widths and heights are always in output pixels and
+ * YUV422 widths must be even. The vectorized kernels process the complete image and fall back
+ * to the scalar implementation for the remaining pixels at the end of a row.
+ */
+
+/* Maximum amount of taps of the filter kernels */
+#define KERNEL_MAX_TAPS 15
+
+/* Scalar reference kernels (kernels_scalar.cpp) */
+extern const int8_t fast_ring_offsets[16][2];
+void downsample_yuv422_point_scalar(const uint8_t *src, uint32_t src_stride, uint8_t *dst, uint32_t dst_stride, uint32_t dst_width, uint32_t dst_height, uint16_t factor, bool uyvy);
+void downsample_yuv422_box_scalar(const uint8_t *src, uint32_t src_stride, uint8_t *dst, uint32_t dst_stride, uint32_t dst_width, uint32_t dst_height, uint16_t factor, bool uyvy);
+void downsample_gray_point_scalar(const uint8_t *src, uint32_t src_stride, uint8_t *dst, uint32_t dst_stride, uint32_t dst_width, uint32_t dst_height, uint16_t factor);
+void downsample_gray_box_scalar(const uint8_t *src, uint32_t src_stride, uint8_t *dst, uint32_t dst_stride, uint32_t dst_width, uint32_t dst_height, uint16_t factor);
+void extract_luma_yuv422_scalar(const uint8_t *src, uint32_t src_stride, uint8_t *dst, uint32_t dst_stride, uint32_t width, uint32_t height, bool uyvy);
+void chroma_yuv422_to_420_scalar(const uint8_t *src, uint32_t src_stride, uint8_t *u, uint8_t *v, uint32_t uv_stride, uint32_t width, uint32_t height, bool uyvy);
+void yuv422_to_rgb24_scalar(const uint8_t *src, uint32_t src_stride, uint8_t *dst, uint32_t dst_stride, uint32_t width, uint32_t height, bool uyvy, bool bgr);
+void rgb24_to_yuv422_scalar(const uint8_t *src, uint32_t src_stride, uint8_t *dst, uint32_t dst_stride, uint32_t width, uint32_t height, bool uyvy, bool bgr);
+void filter_rows_u8_scalar(const uint8_t *const *rows, const uint16_t *weights, uint16_t taps, uint16_t bias, uint16_t mul, uint8_t *dst, uint32_t length);
+void box_rows_u8_scalar(uint16_t *sums, const uint8_t *add, const uint8_t *sub, uint8_t *dst, uint32_t length, uint16_t bias, uint16_t mul);
+void filter_row_u8_scalar(const uint8_t *src, uint8_t *dst, uint32_t length, const uint16_t *weights, uint16_t taps, uint16_t bias, uint16_t mul, uint8_t step_even, uint8_t step_odd);
+void interpolate_u8_scalar(const uint8_t *src, uint32_t src_stride, uint8_t step, const int16_t *weights, int16_t *dst, uint32_t width, uint32_t height);
+void dot2_s16_scalar(const int16_t *a, const int16_t *b, const int16_t *d, uint32_t count, int64_t *sums);
+uint32_t fast_row_u8_scalar(const uint8_t *row, uint32_t stride, uint32_t x_start, uint32_t x_end, uint8_t threshold, uint8_t arc, uint16_t *corners);
+void edge_histogram_u8_scalar(const uint8_t *src, uint32_t stride, uint32_t x_start, uint32_t x_end, uint32_t height, uint32_t *hist_x, uint32_t *hist_y);
+uint32_t sad_u8_scalar(const uint8_t *a, uint32_t a_stride, const uint8_t *b, uint32_t b_stride, uint32_t width, uint32_t height);
+
+/* SSE2 kernels (kernels_sse2.cpp) */
+#if defined(TUV_HAVE_SSE2)
+void downsample_yuv422_point2_sse2(const uint8_t *src, uint32_t src_stride, uint8_t *dst, uint32_t dst_stride, uint32_t dst_width, uint32_t dst_height, bool uyvy);
+void downsample_yuv422_point4_sse2(const uint8_t *src, uint32_t src_stride, uint8_t *dst, uint32_t dst_stride, uint32_t dst_width, uint32_t dst_height, bool uyvy);
+void downsample_yuv422_box2_sse2(const uint8_t *src, uint32_t src_stride, uint8_t *dst, uint32_t dst_stride, uint32_t dst_width, uint32_t dst_height, bool uyvy);
+void downsample_yuv422_box4_sse2(const uint8_t *src, uint32_t src_stride, uint8_t *dst, uint32_t dst_stride, uint32_t dst_width, uint32_t dst_height, bool uyvy);
+void downsample_gray_box2_sse2(const uint8_t *src, uint32_t src_stride, uint8_t *dst, uint32_t dst_stride, uint32_t dst_width, uint32_t dst_height);
+void extract_luma_yuv422_sse2(const uint8_t *src, uint32_t src_stride, uint8_t *dst, uint32_t dst_stride, uint32_t width, uint32_t height, bool uyvy);
+void chroma_yuv422_to_420_sse2(const uint8_t *src, uint32_t src_stride, uint8_t *u, uint8_t *v, uint32_t uv_stride, uint32_t width, uint32_t height, bool uyvy);
+void yuv422_to_rgb24_sse2(const uint8_t *src, uint32_t src_stride, uint8_t *dst, uint32_t dst_stride, uint32_t width, uint32_t height, bool uyvy, bool bgr);
+void rgb24_to_yuv422_sse2(const uint8_t *src, uint32_t src_stride, uint8_t *dst, uint32_t dst_stride, uint32_t width, uint32_t height, bool uyvy, bool bgr);
+void filter_rows_u8_sse2(const uint8_t *const *rows, const uint16_t *weights, uint16_t taps, uint16_t bias, uint16_t mul, uint8_t *dst, uint32_t length);
+void box_rows_u8_sse2(uint16_t *sums, const uint8_t *add, const uint8_t *sub, uint8_t *dst, uint32_t length, uint16_t bias, uint16_t mul);
+void filter_row_u8_sse2(const uint8_t *src, uint8_t *dst, uint32_t length, const uint16_t *weights, uint16_t taps, uint16_t bias, uint16_t mul, uint8_t step_even, uint8_t step_odd);
+void interpolate_u8_sse2(const uint8_t *src, uint32_t src_stride, uint8_t step, const int16_t *weights, int16_t *dst, uint32_t width, uint32_t height);
+void dot2_s16_sse2(const int16_t *a, const int16_t *b, const int16_t *d, uint32_t count, int64_t *sums);
+uint32_t fast_row_u8_sse2(const uint8_t *row, uint32_t stride, uint32_t x_start, uint32_t x_end, uint8_t threshold, uint8_t arc, uint16_t *corners);
+void edge_histogram_u8_sse2(const uint8_t *src, uint32_t stride, uint32_t x_start, uint32_t x_end, uint32_t height, uint32_t *hist_x, uint32_t *hist_y);
+uint32_t sad_u8_sse2(const uint8_t *a, uint32_t a_stride, const uint8_t *b, uint32_t b_stride, uint32_t width, uint32_t height);
+#endif
+
+/* AVX2 kernels (kernels_avx2.cpp) */
+#if defined(TUV_HAVE_AVX2)
+void downsample_yuv422_point2_avx2(const uint8_t *src, uint32_t src_stride, uint8_t *dst, uint32_t dst_stride, uint32_t dst_width, uint32_t dst_height, bool uyvy);
+void downsample_yuv422_point4_avx2(const uint8_t *src, uint32_t src_stride, uint8_t *dst, uint32_t dst_stride, uint32_t dst_width, uint32_t dst_height, bool uyvy);
+void downsample_yuv422_box2_avx2(const uint8_t *src, uint32_t src_stride, uint8_t *dst, uint32_t dst_stride, uint32_t dst_width, uint32_t dst_height, bool uyvy);
+void downsample_yuv422_box4_avx2(const uint8_t *src, uint32_t src_stride, uint8_t *dst, uint32_t dst_stride, uint32_t dst_width, uint32_t dst_height, bool uyvy);
+#endif
+
+/* NEON kernels (kernels_neon.cpp) */
+#if defined(TUV_HAVE_NEON)
+void downsample_yuv422_point2_neon(const uint8_t *src, uint32_t src_stride, uint8_t *dst, uint32_t dst_stride, uint32_t dst_width, uint32_t dst_height, bool uyvy);
+void downsample_yuv422_point4_neon(const uint8_t *src, uint32_t src_stride, uint8_t *dst, uint32_t dst_stride, uint32_t dst_width, uint32_t dst_height, bool uyvy);
+void downsample_yuv422_box2_neon(const uint8_t *src, uint32_t src_stride, uint8_t *dst, uint32_t dst_stride, uint32_t dst_width, uint32_t dst_height, bool uyvy);
+void downsample_yuv422_box4_neon(const uint8_t *src, uint32_t src_stride, uint8_t *dst, uint32_t dst_stride, uint32_t dst_width, uint32_t dst_height, bool uyvy);
+void downsample_gray_box2_neon(const uint8_t *src, uint32_t src_stride, uint8_t *dst, uint32_t dst_stride, uint32_t dst_width, uint32_t dst_height);
+void extract_luma_yuv422_neon(const uint8_t *src, uint32_t src_stride, uint8_t *dst, uint32_t dst_stride, uint32_t width, uint32_t height, bool uyvy);
+void chroma_yuv422_to_420_neon(const uint8_t *src, uint32_t src_stride, uint8_t *u, uint8_t *v, uint32_t uv_stride, uint32_t width, uint32_t height, bool uyvy);
+void yuv422_to_rgb24_neon(const uint8_t *src, uint32_t src_stride, uint8_t *dst, uint32_t dst_stride, uint32_t width, uint32_t height, bool uyvy, bool bgr);
+void rgb24_to_yuv422_neon(const uint8_t *src, uint32_t src_stride, uint8_t *dst, uint32_t dst_stride, uint32_t width, uint32_t height, bool uyvy, bool bgr);
+void filter_rows_u8_neon(const uint8_t *const *rows, const uint16_t *weights, uint16_t taps, uint16_t bias, uint16_t mul, uint8_t *dst, uint32_t length);
+void box_rows_u8_neon(uint16_t *sums, const uint8_t *add, const uint8_t *sub, uint8_t *dst, uint32_t length, uint16_t bias, uint16_t mul);
+void filter_row_u8_neon(const uint8_t *src, uint8_t *dst, uint32_t length, const uint16_t *weights, uint16_t taps, uint16_t bias, uint16_t mul, uint8_t step_even, uint8_t step_odd);
+void interpolate_u8_neon(const uint8_t *src, uint32_t src_stride, uint8_t step, const int16_t *weights, int16_t *dst, uint32_t width, uint32_t height);
+void dot2_s16_neon(const int16_t *a, const int16_t *b, const int16_t *d, uint32_t count, int64_t *sums);
+uint32_t fast_row_u8_neon(const uint8_t *row, uint32_t stride, uint32_t x_start, uint32_t x_end, uint8_t threshold, uint8_t arc, uint16_t *corners);
+void edge_histogram_u8_neon(const uint8_t *src, uint32_t stride, uint32_t x_start, uint32_t x_end, uint32_t height, uint32_t *hist_x, uint32_t *hist_y);
+uint32_t sad_u8_neon(const uint8_t *a, uint32_t a_stride, const uint8_t *b, uint32_t b_stride, uint32_t width, uint32_t height);
+#endif
+
+#endif /* VISION_KERNELS_H_ */
@@ -0,0 +1,237 @@
+/*
+ * This file is part of the TUV library (https://github.com/tudelft/tudelft_vision).
+ * Copyright (c) 2016 Freek van Tienen <freek.v.tienen@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "vision/kernels/kernels.h"
+
+#include <immintrin.h>
+
+/*
+ * The AVX2 kernels use the same algorithms as the SSE2 kernels. Since most AVX2 instructions
+ * work on two separate 128 bit lanes, the results are reordered at the end with a single
+ * permute instruction.
+ */
+
+/**
+ * @brief Select the first and third pixel of four macro pixels (AVX2)
+ *
+ * @see select_yuv422_sse2
+ */
+static inline __m256i select_yuv422_avx2(__m256i a, __m256i b, bool uyvy) {
+    if(uyvy) {
+        a = _mm256_and_si256(a, _mm256_set1_epi32(0x00FFFFFF));
+        b = _mm256_slli_epi32(_mm256_and_si256(b, _mm256_set1_epi32(0x0000FF00)), 16);
+    } else {
+        a = _mm256_and_si256(a, _mm256_set1_epi32(0xFF00FFFF));
+        b = _mm256_slli_epi32(_mm256_and_si256(b, _mm256_set1_epi32(0x000000FF)), 16);
+    }
+    return _mm256_or_si256(a, b);
+}
+
+/**
+ * @brief Interleave luma and chroma words into YUV422 bytes (AVX2)
+ *
+ * @see interleave_yuv422_sse2
+ */
+static inline __m256i interleave_yuv422_avx2(__m256i luma, __m256i chroma, bool uyvy) {
+    if(uyvy)
+        return _mm256_or_si256(chroma, _mm256_slli_epi16(luma, 8));
+    else
+        return _mm256_or_si256(luma, _mm256_slli_epi16(chroma, 8));
+}
+
+/**
+ * @brief Point sample a YUV422 image by a factor of 2 (AVX2)
+ *
+ * @see downsample_yuv422_point_scalar
+ */
+void downsample_yuv422_point2_avx2(const uint8_t *src, uint32_t src_stride, uint8_t *dst, uint32_t dst_stride, uint32_t dst_width, uint32_t dst_height, bool uyvy) {
+    uint32_t blocks = dst_width / 16;
+
+    for(uint32_t y = 0; y < dst_height; ++y) {
+        const uint8_t *row = src + y * 2 * src_stride;
+        uint8_t *out = dst + y * dst_stride;
+
+        for(uint32_t i = 0; i < blocks; ++i) {
+            __m256i v0 = _mm256_loadu_si256((const __m256i *)(row + i * 64));
+            __m256i v1 = _mm256_loadu_si256((const __m256i *)(row + i * 64 + 32));
+
+            // Split the even and odd macro pixels (per lane)
+            __m256i t0 = _mm256_shuffle_epi32(v0, _MM_SHUFFLE(3, 1, 2, 0));
+            __m256i t1 = _mm256_shuffle_epi32(v1, _MM_SHUFFLE(3, 1, 2, 0));
+            __m256i even = _mm256_unpacklo_epi64(t0, t1);
+            __m256i odd = _mm256_unpackhi_epi64(t0, t1);
+
+            __m256i res = select_yuv422_avx2(even, odd, uyvy);
+            res = _mm256_permute4x64_epi64(res, _MM_SHUFFLE(3, 1, 2, 0));
+            _mm256_storeu_si256((__m256i *)(out + i * 32), res);
+        }
+
+        // Process the remaining pixels
+        if(blocks * 16 < dst_width)
+            downsample_yuv422_point_scalar(row + blocks * 64, src_stride, out + blocks * 32, dst_stride, dst_width - blocks * 16, 1, 2, uyvy);
+    }
+}
+
+/**
+ * @brief Point sample a YUV422 image by a factor of 4 (AVX2)
+ *
+ * @see downsample_yuv422_point_scalar
+ */
+void downsample_yuv422_point4_avx2(const uint8_t *src, uint32_t src_stride, uint8_t *dst, uint32_t dst_stride, uint32_t dst_width, uint32_t dst_height, bool uyvy) {
+    const __m256i idx = _mm256_setr_epi32(0, 4, 2, 6, 0, 4, 2, 6);
+    uint32_t blocks = dst_width / 16;
+
+    for(uint32_t y = 0; y < dst_height; ++y) {
+        const uint8_t *row = src + y * 4 * src_stride;
+        uint8_t *out = dst + y * dst_stride;
+
+        for(uint32_t i = 0; i < blocks; ++i) {
+            __m256i v[4];
+            for(uint8_t j = 0; j < 4; ++j) {
+                v[j] = _mm256_loadu_si256((const __m256i *)(row + i * 128 + j * 32));
+                v[j] = _mm256_permutevar8x32_epi32(v[j], idx);
+            }
+
+            // Gather the macro pixels 0, 4, 2, 6 of every register
+            __m256i a01 = _mm256_permute2x128_si256(v[0], v[1], 0x20);
+            __m256i a23 = _mm256_permute2x128_si256(v[2], v[3], 0x20);
+            __m256i first = _mm256_unpacklo_epi64(a01, a23);
+            __m256i second = _mm256_unpackhi_epi64(a01, a23);
+
+            __m256i res = select_yuv422_avx2(first, second, uyvy);
+            res = _mm256_permute4x64_epi64(res, _MM_SHUFFLE(3, 1, 2, 0));
+            _mm256_storeu_si256((__m256i *)(out + i * 32), res);
+        }
+
+        // Process the remaining pixels
+        if(blocks * 16 < dst_width)
+            downsample_yuv422_point_scalar(row + blocks * 128, src_stride, out + blocks * 32, dst_stride, dst_width - blocks * 16, 1, 4, uyvy);
+    }
+}
+
+/**
+ * @brief Box average a YUV422 image by a factor of 2 (AVX2)
+ *
+ * @see downsample_yuv422_box_scalar
+ */
+void downsample_yuv422_box2_avx2(const uint8_t *src, uint32_t src_stride, uint8_t *dst, uint32_t dst_stride, uint32_t dst_width, uint32_t dst_height, bool uyvy) {
+    const __m256i mask = _mm256_set1_epi16(0x00FF);
+    const __m256i ones = _mm256_set1_epi16(1);
+    const __m256i round = _mm256_set1_epi16(2);
+    uint32_t blocks = dst_width / 16;
+
+    for(uint32_t y = 0; y < dst_height; ++y) {
+        const uint8_t *row0 = src + y * 2 * src_stride;
+        const uint8_t *row1 = row0 + src_stride;
+        uint8_t *out = dst + y * dst_stride;
+
+        for(uint32_t i = 0; i < blocks; ++i) {
+            __m256i a0 = _mm256_loadu_si256((const __m256i *)(row0 + i * 64));
+            __m256i a1 = _mm256_loadu_si256((const __m256i *)(row0 + i * 64 + 32));
+            __m256i b0 = _mm256_loadu_si256((const __m256i *)(row1 + i * 64));
+            __m256i b1 = _mm256_loadu_si256((const __m256i *)(row1 + i * 64 + 32));
+
+            // Vertical sums of the even and odd bytes
+            __m256i e0 = _mm256_add_epi16(_mm256_and_si256(a0, mask), _mm256_and_si256(b0, mask));
+            __m256i e1 = _mm256_add_epi16(_mm256_and_si256(a1, mask), _mm256_and_si256(b1, mask));
+            __m256i o0 = _mm256_add_epi16(_mm256_srli_epi16(a0, 8), _mm256_srli_epi16(b0, 8));
+            __m256i o1 = _mm256_add_epi16(_mm256_srli_epi16(a1, 8), _mm256_srli_epi16(b1, 8));
+            __m256i l0 = uyvy? o0 : e0, l1 = uyvy? o1 : e1;
+            __m256i c0 = uyvy? e0 : o0, c1 = uyvy? e1 : o1;
+
+            // Horizontal sums of 2 luma pixels
+            __m256i luma = _mm256_packs_epi32(_mm256_madd_epi16(l0, ones), _mm256_madd_epi16(l1, ones));
+
+            // Horizontal sums of 2 chroma macro pixels
+            __m256i t0 = _mm256_shuffle_epi32(c0, _MM_SHUFFLE(3, 1, 2, 0));
+            __m256i t1 = _mm256_shuffle_epi32(c1, _MM_SHUFFLE(3, 1, 2, 0));
+            t0 = _mm256_add_epi16(t0, _mm256_unpackhi_epi64(t0, t0));
+            t1 = _mm256_add_epi16(t1, _mm256_unpackhi_epi64(t1, t1));
+            __m256i chroma = _mm256_unpacklo_epi64(t0, t1);
+
+            // Divide by 4, interleave and fix the lane order
+            luma = _mm256_srli_epi16(_mm256_add_epi16(luma, round), 2);
+            chroma = _mm256_srli_epi16(_mm256_add_epi16(chroma, round), 2);
+            __m256i res = interleave_yuv422_avx2(luma, chroma, uyvy);
+            res = _mm256_permute4x64_epi64(res, _MM_SHUFFLE(3, 1, 2, 0));
+            _mm256_storeu_si256((__m256i *)(out + i * 32), res);
+        }
+
+        // Process the remaining pixels
+        if(blocks * 16 < dst_width)
+            downsample_yuv422_box_scalar(row0 + blocks * 64, src_stride, out + blocks * 32, dst_stride, dst_width - blocks * 16, 1, 2, uyvy);
+    }
+}
+
+/**
+ * @brief Box average a YUV422 image by a factor of 4 (AVX2)
+ *
+ * @see downsample_yuv422_box_scalar
+ */
+void downsample_yuv422_box4_avx2(const uint8_t *src, uint32_t src_stride, uint8_t *dst, uint32_t dst_stride, uint32_t dst_width, uint32_t dst_height, bool uyvy) {
+    const __m256i mask = _mm256_set1_epi16(0x00FF);
+    const __m256i ones = _mm256_set1_epi16(1);
+    const __m256i round = _mm256_set1_epi16(8);
+    const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+    uint32_t blocks = dst_width / 16;
+
+    for(uint32_t y = 0; y < dst_height; ++y) {
+        const uint8_t *rows = src + y * 4 * src_stride;
+        uint8_t *out = dst + y * dst_stride;
+
+        for(uint32_t i = 0; i < blocks; ++i) {
+            __m256i l[4], c[4];
+
+            // Vertical sums of the even and odd bytes over 4 rows
+            for(uint8_t j = 0; j < 4; ++j) {
+                __m256i e = _mm256_setzero_si256();
+                __m256i o = _mm256_setzero_si256();
+                for(uint8_t r = 0; r < 4; ++r) {
+                    __m256i v = _mm256_loadu_si256((const __m256i *)(rows + r * src_stride + i * 128 + j * 32));
+                    e = _mm256_add_epi16(e, _mm256_and_si256(v, mask));
+                    o = _mm256_add_epi16(o, _mm256_srli_epi16(v, 8));
+                }
+                l[j] = uyvy? o : e;
+                c[j] = uyvy? e : o;
+            }
+
+            // Horizontal sums of 4 luma pixels
+            __m256i p01 = _mm256_packs_epi32(_mm256_madd_epi16(l[0], ones), _mm256_madd_epi16(l[1], ones));
+            __m256i p23 = _mm256_packs_epi32(_mm256_madd_epi16(l[2], ones), _mm256_madd_epi16(l[3], ones));
+            __m256i luma = _mm256_packs_epi32(_mm256_madd_epi16(p01, ones), _mm256_madd_epi16(p23, ones));
+
+            // Horizontal sums of 4 chroma macro pixels
+            for(uint8_t j = 0; j < 4; ++j) {
+                __m256i t = _mm256_shuffle_epi32(c[j], _MM_SHUFFLE(3, 1, 2, 0));
+                t = _mm256_add_epi16(t, _mm256_unpackhi_epi64(t, t));
+                c[j] = _mm256_add_epi16(t, _mm256_srli_si256(t, 4));
+            }
+            __m256i chroma = _mm256_unpacklo_epi64(_mm256_unpacklo_epi32(c[0], c[1]), _mm256_unpacklo_epi32(c[2], c[3]));
+
+            // Divide by 16, interleave and fix the lane order
+            luma = _mm256_srli_epi16(_mm256_add_epi16(luma, round), 4);
+            chroma = _mm256_srli_epi16(_mm256_add_epi16(chroma, round), 4);
+            __m256i res = interleave_yuv422_avx2(luma, chroma, uyvy);
+            res = _mm256_permutevar8x32_epi32(res, order);
+            _mm256_storeu_si256((__m256i *)(out + i * 32), res);
+        }
+
+        // Process the remaining pixels
+        if(blocks * 16 < dst_width)
+            downsample_yuv422_box_scalar(rows + blocks * 128, src_stride, out + blocks * 32, dst_stride, dst_width - blocks * 16, 1, 4, uyvy);
+    }
+}
@@ -0,0 +1,769 @@
+/*
+ * This file is part of the TUV library (https://github.com/tudelft/tudelft_vision).
+ * Copyright (c) 2016 Freek van Tienen <freek.v.tienen@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "vision/kernels/kernels.h"
+
+#include <arm_neon.h>
+
+/*
+ * The NEON kernels load the YUV422 macro pixels deinterleaved (vld4), so every register
+ * contains one of the four bytes of 16 macro pixels. The byte positions are different for
+ * YUYV and UYVY, but the calculations are the same.
+ */
+
+/**
+ * @brief Point sample a YUV422 image by a factor of 2 (NEON)
+ *
+ * @see downsample_yuv422_point_scalar
+ */
+void downsample_yuv422_point2_neon(const uint8_t *src, uint32_t src_stride, uint8_t *dst, uint32_t dst_stride, uint32_t dst_width, uint32_t dst_height, bool uyvy) {
+    const uint8_t y0 = uyvy? 1 : 0;     // Position of the first luma
+    const uint8_t y1 = uyvy? 3 : 2;     // Position of the second luma
+    uint32_t blocks = dst_width / 16;
+
+    for(uint32_t y = 0; y < dst_height; ++y) {
+        const uint8_t *row = src + y * 2 * src_stride;
+        uint8_t *out = dst + y * dst_stride;
+
+        for(uint32_t i = 0; i < blocks; ++i) {
+            uint8x16x4_t v = vld4q_u8(row + i * 64);
+            uint8x8x4_t res;
+
+            // Take the even macro pixels and the first luma of the odd macro pixels
+            for(uint8_t j = 0; j < 4; ++j)
+                res.val[j] = vuzp_u8(vget_low_u8(v.val[j]), vget_high_u8(v.val[j])).val[0];
+            res.val[y1] = vuzp_u8(vget_low_u8(v.val[y0]), vget_high_u8(v.val[y0])).val[1];
+
+            vst4_u8(out + i * 32, res);
+        }
+
+        // Process the remaining pixels
+        if(blocks * 16 < dst_width)
+            downsample_yuv422_point_scalar(row + blocks * 64, src_stride, out + blocks * 32, dst_stride, dst_width - blocks * 16, 1, 2, uyvy);
+    }
+}
+
+/**
+ * @brief Point sample a YUV422 image by a factor of 4 (NEON)
+ *
+ * @see downsample_yuv422_point_scalar
+ */
+void downsample_yuv422_point4_neon(const uint8_t *src, uint32_t src_stride, uint8_t *dst, uint32_t dst_stride, uint32_t dst_width, uint32_t dst_height, bool uyvy) {
+    const uint8_t y0 = uyvy? 1 : 0;     // Position of the first luma
+    const uint8_t y1 = uyvy? 3 : 2;     // Position of the second luma
+    uint32_t blocks = dst_width / 16;
+
+    for(uint32_t y = 0; y < dst_height; ++y) {
+        const uint8_t *row = src + y * 4 * src_stride;
+        uint8_t *out = dst + y * dst_stride;
+
+        for(uint32_t i = 0; i < blocks; ++i) {
+            uint8x16x4_t a = vld4q_u8(row + i * 128);
+            uint8x16x4_t b = vld4q_u8(row + i * 128 + 64);
+            uint8x8x2_t sel[4];
+            uint8x8x4_t res;
+
+            // Split the even macro pixels in the macro pixels 0, 4, 8, .. and 2, 6, 10, ..
+            for(uint8_t j = 0; j < 4; ++j) {
+                uint8x16_t even = vuzpq_u8(a.val[j], b.val[j]).val[0];
+                sel[j] = vuzp_u8(vget_low_u8(even), vget_high_u8(even));
+                res.val[j] = sel[j].val[0];
+            }
+            res.val[y1] = sel[y0].val[1];
+
+            vst4_u8(out + i * 32, res);
+        }
+
+        // Process the remaining pixels
+        if(blocks * 16 < dst_width)
+            downsample_yuv422_point_scalar(row + blocks * 128, src_stride, out + blocks * 32, dst_stride, dst_width - blocks * 16, 1, 4, uyvy);
+    }
+}
+
+/**
+ * @brief Box average a YUV422 image by a factor of 2 (NEON)
+ *
+ * @see downsample_yuv422_box_scalar
+ */
+void downsample_yuv422_box2_neon(const uint8_t *src, uint32_t src_stride, uint8_t *dst, uint32_t dst_stride, uint32_t dst_width, uint32_t dst_height, bool uyvy) {
+    const uint8_t y0 = uyvy? 1 : 0;     // Position of the first luma
+    const uint8_t y1 = uyvy? 3 : 2;     // Position of the second luma
+    const uint8_t u = uyvy? 0 : 1;      // Position of the U chroma
+    const uint8_t v = uyvy? 2 : 3;      // Position of the V chroma
+    uint32_t blocks = dst_width / 16;
+
+    for(uint32_t y = 0; y < dst_height; ++y) {
+        const uint8_t *row0 = src + y * 2 * src_stride;
+        const uint8_t *row1 = row0 + src_stride;
+        uint8_t *out = dst + y * dst_stride;
+
+        for(uint32_t i = 0; i < blocks; ++i) {
+            uint8x16x4_t a = vld4q_u8(row0 + i * 64);
+            uint8x16x4_t b = vld4q_u8(row1 + i * 64);
+            uint8x8x4_t res;
+
+            // Sum the 4 luma pixels of every macro pixel
+            uint16x8_t lo = vaddq_u16(vaddl_u8(vget_low_u8(a.val[y0]), vget_low_u8(a.val[y1])),
+                                      vaddl_u8(vget_low_u8(b.val[y0]), vget_low_u8(b.val[y1])));
+            uint16x8_t hi = vaddq_u16(vaddl_u8(vget_high_u8(a.val[y0]), vget_high_u8(a.val[y1])),
+                                      vaddl_u8(vget_high_u8(b.val[y0]), vget_high_u8(b.val[y1])));
+            uint16x8x2_t luma = vuzpq_u16(lo, hi);
+            res.val[y0] = vrshrn_n_u16(luma.val[0], 2);
+            res.val[y1] = vrshrn_n_u16(luma.val[1], 2);
+
+            // Sum the chroma of 2 macro pixels
+            res.val[u] = vrshrn_n_u16(vpadalq_u8(vpaddlq_u8(a.val[u]), b.val[u]), 2);
+            res.val[v] = vrshrn_n_u16(vpadalq_u8(vpaddlq_u8(a.val[v]), b.val[v]), 2);
+
+            vst4_u8(out + i * 32, res);
+        }
+
+        // Process the remaining pixels
+        if(blocks * 16 < dst_width)
+            downsample_yuv422_box_scalar(row0 + blocks * 64, src_stride, out + blocks * 32, dst_stride, dst_width - blocks * 16, 1, 2, uyvy);
+    }
+}
+
+/**
+ * @brief Box average a YUV422 image by a factor of 4 (NEON)
+ *
+ * @see downsample_yuv422_box_scalar
+ */
+void downsample_yuv422_box4_neon(const uint8_t *src, uint32_t src_stride, uint8_t *dst, uint32_t dst_stride, uint32_t dst_width, uint32_t dst_height, bool uyvy) {
+    const uint8_t y0 = uyvy? 1 : 0;     // Position of the first luma
+    const uint8_t y1 = uyvy? 3 : 2;     // Position of the second luma
+    const uint8_t u = uyvy? 0 : 1;      // Position of the U chroma
+    const uint8_t v = uyvy? 2 : 3;      // Position of the V chroma
+    uint32_t blocks = dst_width / 16;
+
+    for(uint32_t y = 0; y < dst_height; ++y) {
+        const uint8_t *rows = src + y * 4 * src_stride;
+        uint8_t *out = dst + y * dst_stride;
+
+        for(uint32_t i = 0; i < blocks; ++i) {
+            uint16x8_t sa[4], sb[4];
+            uint8x8x4_t res;
+
+            // Vertical sums over 4 rows of every 2 macro pixels
+            for(uint8_t r = 0; r < 4; ++r) {
+                uint8x16x4_t a = vld4q_u8(rows + r * src_stride + i * 128);
+                uint8x16x4_t b = vld4q_u8(rows + r * src_stride + i * 128 + 64);
+                for(uint8_t j = 0; j < 4; ++j) {
+                    sa[j] = (r == 0)? vpaddlq_u8(a.val[j]) : vpadalq_u8(sa[j], a.val[j]);
+                    sb[j] = (r == 0)? vpaddlq_u8(b.val[j]) : vpadalq_u8(sb[j], b.val[j]);
+                }
+            }
+
+            // Every output luma covers 2 macro pixels
+            uint16x8x2_t luma = vuzpq_u16(vaddq_u16(sa[y0], sa[y1]), vaddq_u16(sb[y0], sb[y1]));
+            res.val[y0] = vrshrn_n_u16(luma.val[0], 4);
+            res.val[y1] = vrshrn_n_u16(luma.val[1], 4);
+
+            // Every output chroma covers 4 macro pixels
+            uint16x8_t cu = vcombine_u16(vpadd_u16(vget_low_u16(sa[u]), vget_high_u16(sa[u])),
+                                         vpadd_u16(vget_low_u16(sb[u]), vget_high_u16(sb[u])));
+            uint16x8_t cv = vcombine_u16(vpadd_u16(vget_low_u16(sa[v]), vget_high_u16(sa[v])),
+                                         vpadd_u16(vget_low_u16(sb[v]), vget_high_u16(sb[v])));
+            res.val[u] = vrshrn_n_u16(cu, 4);
+            res.val[v] = vrshrn_n_u16(cv, 4);
+
+            vst4_u8(out + i * 32, res);
+        }
+
+        // Process the remaining pixels
+        if(blocks * 16 < dst_width)
+            downsample_yuv422_box_scalar(rows + blocks * 128, src_stride, out + blocks * 32, dst_stride, dst_width - blocks * 16, 1, 4, uyvy);
+    }
+}
+
+/**
+ * @brief Box average a GRAY8 image by a factor of 2 (NEON)
+ *
+ * @see downsample_gray_box_scalar
+ */
+void downsample_gray_box2_neon(const uint8_t *src, uint32_t src_stride, uint8_t *dst, uint32_t dst_stride, uint32_t dst_width, uint32_t dst_height) {
+    uint32_t blocks = dst_width / 16;
+
+    for(uint32_t y = 0; y < dst_height; ++y) {
+        const uint8_t *row0 = src + y * 2 * src_stride;
+        const uint8_t *row1 = row0 + src_stride;
+        uint8_t *out = dst + y * dst_stride;
+
+        for(uint32_t i = 0; i < blocks; ++i) {
+            // Sum neighbouring pixels of both rows and divide by 4
+            uint16x8_t lo = vpadalq_u8(vpaddlq_u8(vld1q_u8(row0 + i * 32)), vld1q_u8(row1 + i * 32));
+            uint16x8_t hi = vpadalq_u8(vpaddlq_u8(vld1q_u8(row0 + i * 32 + 16)), vld1q_u8(row1 + i * 32 + 16));
+            vst1q_u8(out + i * 16, vcombine_u8(vrshrn_n_u16(lo, 2), vrshrn_n_u16(hi, 2)));
+        }
+
+        // Process the remaining pixels
+        if(blocks * 16 < dst_width)
+            downsample_gray_box_scalar(row0 + blocks * 32, src_stride, out + blocks * 16, dst_stride, dst_width - blocks * 16, 1, 2);
+    }
+}
+
+/**
+ * @brief Extract the luma of a YUV422 image (NEON)
+ *
+ * @see extract_luma_yuv422_scalar
+ */
+void extract_luma_yuv422_neon(const uint8_t *src, uint32_t src_stride, uint8_t *dst, uint32_t dst_stride, uint32_t width, uint32_t height, bool uyvy) {
+    const uint8_t y0 = uyvy? 1 : 0;     // Position of the luma
+    uint32_t blocks = width / 16;
+
+    for(uint32_t y = 0; y < height; ++y) {
+        const uint8_t *row = src + y * src_stride;
+        uint8_t *out = dst + y * dst_stride;
+
+        for(uint32_t i = 0; i < blocks; ++i) {
+            uint8x16x2_t v = vld2q_u8(row + i * 32);
+            vst1q_u8(out + i * 16, v.val[y0]);
+        }
+
+        // Process the remaining pixels
+        if(blocks * 16 < width)
+            extract_luma_yuv422_scalar(row + blocks * 32, src_stride, out + blocks * 16, dst_stride, width - blocks * 16, 1, uyvy);
+    }
+}
+
+/**
+ * @brief Convert the chroma of a YUV422 image to YUV420 (NEON)
+ *
+ * @see chroma_yuv422_to_420_scalar
+ */
+void chroma_yuv422_to_420_neon(const uint8_t *src, uint32_t src_stride, uint8_t *u, uint8_t *v, uint32_t uv_stride, uint32_t width, uint32_t height, bool uyvy) {
+    const uint8_t cu = uyvy? 0 : 1;     // Position of the U chroma
+    const uint8_t cv = uyvy? 2 : 3;     // Position of the V chroma
+    uint32_t blocks = width / 32;
+
+    for(uint32_t y = 0; y < height / 2; ++y) {
+        const uint8_t *row0 = src + y * 2 * src_stride;
+        const uint8_t *row1 = row0 + src_stride;
+        uint8_t *out_u = u + y * uv_stride;
+        uint8_t *out_v = (v == NULL)? NULL : v + y * uv_stride;
+
+        for(uint32_t i = 0; i < blocks; ++i) {
+            uint8x16x4_t a = vld4q_u8(row0 + i * 64);
+            uint8x16x4_t b = vld4q_u8(row1 + i * 64);
+
+            // Average the two rows (rounded up like the scalar implementation)
+            uint8x16x2_t uv;
+            uv.val[0] = vrhaddq_u8(a.val[cu], b.val[cu]);
+            uv.val[1] = vrhaddq_u8(a.val[cv], b.val[cv]);
+
+            if(out_v == NULL) {
+                vst2q_u8(out_u + i * 32, uv);
+            } else {
+                vst1q_u8(out_u + i * 16, uv.val[0]);
+                vst1q_u8(out_v + i * 16, uv.val[1]);
+            }
+        }
+
+        // Process the remaining pixels
+        if(blocks * 32 < width) {
+            uint32_t offset = (out_v == NULL)? blocks * 32 : blocks * 16;
+            chroma_yuv422_to_420_scalar(row0 + blocks * 64, src_stride, out_u + offset, (out_v == NULL)? NULL : out_v + offset,
+                                        uv_stride, width - blocks * 32, 2, uyvy);
+        }
+    }
+}
+
+/**
+ * @brief Convert a YUV422 image to RGB24 or BGR24 (NEON)
+ *
+ * @see yuv422_to_rgb24_scalar
+ */
+void yuv422_to_rgb24_neon(const uint8_t *src, uint32_t src_stride, uint8_t *dst, uint32_t dst_stride, uint32_t width, uint32_t height, bool uyvy, bool bgr) {
+    const uint8_t y0 = uyvy? 1 : 0;     // Position of the first luma
+    const uint8_t y1 = uyvy? 3 : 2;     // Position of the second luma
+    const uint8_t u = uyvy? 0 : 1;      // Position of the U chroma
+    const uint8_t v = uyvy? 2 : 3;      // Position of the V chroma
+    uint32_t blocks = width / 16;
+
+    for(uint32_t y = 0; y < height; ++y) {
+        const uint8_t *row = src + y * src_stride;
+        uint8_t *out = dst + y * dst_stride;
+
+        for(uint32_t i = 0; i < blocks; ++i) {
+            uint8x8x4_t p = vld4_u8(row + i * 32);
+
+            // Chroma contributions for both pixels
+            int16x8_t d = vreinterpretq_s16_u16(vsubl_u8(p.val[u], vdup_n_u8(128)));
+            int16x8_t e = vreinterpretq_s16_u16(vsubl_u8(p.val[v], vdup_n_u8(128)));
+            int16x8_t rv = vmulq_n_s16(e, 102);
+            int16x8_t guv = vaddq_s16(vmulq_n_s16(d, 25), vmulq_n_s16(e, 52));
+            int16x8_t bu = vmulq_n_s16(d, 129);
+
+            // Scale the luma of the even and odd pixels
+            uint8x8x2_t r, g, b;
+            const uint8_t ly[2] = {y0, y1};
+            for(uint8_t j = 0; j < 2; ++j) {
+                uint16x8_t lu = vshrq_n_u16(vmull_u8(vqsub_u8(p.val[ly[j]], vdup_n_u8(16)), vdup_n_u8(149)), 1);
+                int16x8_t l = vaddq_s16(vreinterpretq_s16_u16(lu), vdupq_n_s16(32));
+                r.val[j] = vqshrun_n_s16(vqaddq_s16(l, rv), 6);
+                g.val[j] = vqshrun_n_s16(vqsubq_s16(l, guv), 6);
+                b.val[j] = vqshrun_n_s16(vqaddq_s16(l, bu), 6);
+            }
+
+            // Interleave the even and odd pixels and store as RGB
+            uint8x8x2_t rz = vzip_u8(r.val[0], r.val[1]);
+            uint8x8x2_t gz = vzip_u8(g.val[0], g.val[1]);
+            uint8x8x2_t bz = vzip_u8(b.val[0], b.val[1]);
+            uint8x16x3_t rgb;
+            rgb.val[bgr? 2 : 0] = vcombine_u8(rz.val[0], rz.val[1]);
+            rgb.val[1] = vcombine_u8(gz.val[0], gz.val[1]);
+            rgb.val[bgr? 0 : 2] = vcombine_u8(bz.val[0], bz.val[1]);
+            vst3q_u8(out + i * 48, rgb);
+        }
+
+        // Process the remaining pixels
+        if(blocks * 16 < width)
+            yuv422_to_rgb24_scalar(row + blocks * 32, src_stride, out + blocks * 48, dst_stride, width - blocks * 16, 1, uyvy, bgr);
+    }
+}
+
+/**
+ * @brief Convert a RGB24 or BGR24 image to YUV422 (NEON)
+ *
+ * @see rgb24_to_yuv422_scalar
+ */
+void rgb24_to_yuv422_neon(const uint8_t *src, uint32_t src_stride, uint8_t *dst, uint32_t dst_stride, uint32_t width, uint32_t height, bool uyvy, bool bgr) {
+    const uint8_t lo = uyvy? 1 : 0;     // Luma offset in a pixel
+    const uint8_t co = uyvy? 0 : 1;     // Chroma offset in a pixel
+    uint32_t blocks = width / 16;
+
+    for(uint32_t y = 0; y < height; ++y) {
+        const uint8_t *row = src + y * src_stride;
+        uint8_t *out = dst + y * dst_stride;
+
+        for(uint32_t i = 0; i < blocks; ++i) {
+            uint8x16x3_t p = vld3q_u8(row + i * 48);
+            uint8x16_t r = p.val[bgr? 2 : 0];
+            uint8x16_t g = p.val[1];
+            uint8x16_t b = p.val[bgr? 0 : 2];
+
+            // Luma of every pixel (the sum fits in 16 bit unsigned)
+            uint16x8_t ll = vmull_u8(vget_low_u8(r), vdup_n_u8(66));
+            uint16x8_t lh = vmull_u8(vget_high_u8(r), vdup_n_u8(66));
+            ll = vmlal_u8(ll, vget_low_u8(g), vdup_n_u8(129));
+            lh = vmlal_u8(lh, vget_high_u8(g), vdup_n_u8(129));
+            ll = vmlal_u8(ll, vget_low_u8(b), vdup_n_u8(25));
+            lh = vmlal_u8(lh, vget_high_u8(b), vdup_n_u8(25));
+            uint8x16_t luma = vaddq_u8(vcombine_u8(vrshrn_n_u16(ll, 8), vrshrn_n_u16(lh, 8)), vdupq_n_u8(16));
+
+            // Average color of both pixels
+            uint8x8x2_t rs = vuzp_u8(vget_low_u8(r), vget_high_u8(r));
+            uint8x8x2_t gs = vuzp_u8(vget_low_u8(g), vget_high_u8(g));
+            uint8x8x2_t bs = vuzp_u8(vget_low_u8(b), vget_high_u8(b));
+            int16x8_t ra = vreinterpretq_s16_u16(vmovl_u8(vrhadd_u8(rs.val[0], rs.val[1])));
+            int16x8_t ga = vreinterpretq_s16_u16(vmovl_u8(vrhadd_u8(gs.val[0], gs.val[1])));
+            int16x8_t ba = vreinterpretq_s16_u16(vmovl_u8(vrhadd_u8(bs.val[0], bs.val[1])));
+
+            // Chroma of both pixels
+            int16x8_t cu = vsubq_s16(vmulq_n_s16(ba, 112), vaddq_s16(vmulq_n_s16(ra, 38), vmulq_n_s16(ga, 74)));
+            int16x8_t cv = vsubq_s16(vmulq_n_s16(ra, 112), vaddq_s16(vmulq_n_s16(ga, 94), vmulq_n_s16(ba, 18)));
+            cu = vaddq_s16(vshrq_n_s16(vaddq_s16(cu, vdupq_n_s16(128)), 8), vdupq_n_s16(128));
+            cv = vaddq_s16(vshrq_n_s16(vaddq_s16(cv, vdupq_n_s16(128)), 8), vdupq_n_s16(128));
+
+            // Store the even and odd luma with the chroma as YUV422
+            uint8x16x2_t ls = vuzpq_u8(luma, luma);
+            uint8x8x4_t res;
+            res.val[lo] = vget_low_u8(ls.val[0]);
+            res.val[lo + 2] = vget_low_u8(ls.val[1]);
+            res.val[co] = vmovn_u16(vreinterpretq_u16_s16(cu));
+            res.val[co + 2] = vmovn_u16(vreinterpretq_u16_s16(cv));
+            vst4_u8(out + i * 32, res);
+        }
+
+        // Process the remaining pixels
+        if(blocks * 16 < width)
+            rgb24_to_yuv422_scalar(row + blocks * 48, src_stride, out + blocks * 32, dst_stride, width - blocks * 16, 1, uyvy, bgr);
+    }
+}
+
+/**
+ * @brief Scale 8 fixed-point sums to bytes (NEON)
+ *
+ * @param[in] acc The sums
+ * @param[in] bias The rounding bias
+ * @param[in] mul The fixed-point multiplier
+ * @return The 8 scaled bytes
+ */
+static inline uint8x8_t scale_u16_neon(uint16x8_t acc, uint16_t bias, uint16_t mul) {
+    acc = vaddq_u16(acc, vdupq_n_u16(bias));
+    uint16x4_t lo = vshrn_n_u32(vmull_n_u16(vget_low_u16(acc), mul), 16);
+    uint16x4_t hi = vshrn_n_u32(vmull_n_u16(vget_high_u16(acc), mul), 16);
+    return vmovn_u16(vcombine_u16(lo, hi));
+}
+
+/**
+ * @brief Filter multiple rows with fixed-point weights (NEON)
+ *
+ * @see filter_rows_u8_scalar
+ */
+void filter_rows_u8_neon(const uint8_t *const *rows, const uint16_t *weights, uint16_t taps, uint16_t bias, uint16_t mul, uint8_t *dst, uint32_t length) {
+    uint32_t blocks = length / 16;
+
+    for(uint32_t i = 0; i < blocks; ++i) {
+        uint16x8_t lo = vdupq_n_u16(0);
+        uint16x8_t hi = vdupq_n_u16(0);
+
+        for(uint16_t k = 0; k < taps; ++k) {
+            uint8x16_t v = vld1q_u8(rows[k] + i * 16);
+            lo = vmlaq_n_u16(lo, vmovl_u8(vget_low_u8(v)), weights[k]);
+            hi = vmlaq_n_u16(hi, vmovl_u8(vget_high_u8(v)), weights[k]);
+        }
+
+        vst1q_u8(dst + i * 16, vcombine_u8(scale_u16_neon(lo, bias, mul), scale_u16_neon(hi, bias, mul)));
+    }
+
+    // Process the remaining bytes
+    if(blocks * 16 < length) {
+        const uint8_t *tail[KERNEL_MAX_TAPS];
+        for(uint16_t k = 0; k < taps; ++k)
+            tail[k] = rows[k] + blocks * 16;
+        filter_rows_u8_scalar(tail, weights, taps, bias, mul, dst + blocks * 16, length - blocks * 16);
+    }
+}
+
+/**
+ * @brief Update the sliding window sums of a box filter (NEON)
+ *
+ * @see box_rows_u8_scalar
+ */
+void box_rows_u8_neon(uint16_t *sums, const uint8_t *add, const uint8_t *sub, uint8_t *dst, uint32_t length, uint16_t bias, uint16_t mul) {
+    uint32_t blocks = length / 16;
+
+    for(uint32_t i = 0; i < blocks; ++i) {
+        uint8x16_t a = vld1q_u8(add + i * 16);
+        uint16x8_t lo = vaddw_u8(vld1q_u16(sums + i * 16), vget_low_u8(a));
+        uint16x8_t hi = vaddw_u8(vld1q_u16(sums + i * 16 + 8), vget_high_u8(a));
+
+        if(sub != NULL) {
+            uint8x16_t s = vld1q_u8(sub + i * 16);
+            lo = vsubw_u8(lo, vget_low_u8(s));
+            hi = vsubw_u8(hi, vget_high_u8(s));
+        }
+
+        vst1q_u16(sums + i * 16, lo);
+        vst1q_u16(sums + i * 16 + 8, hi);
+
+        if(dst != NULL)
+            vst1q_u8(dst + i * 16, vcombine_u8(scale_u16_neon(lo, bias, mul), scale_u16_neon(hi, bias, mul)));
+    }
+
+    // Process the remaining bytes
+    if(blocks * 16 < length) {
+        uint32_t offset = blocks * 16;
+        box_rows_u8_scalar(sums + offset, add + offset, (sub == NULL)? NULL : sub + offset, (dst == NULL)? NULL : dst + offset,
+                           length - offset, bias, mul);
+    }
+}
+
+/**
+ * @brief Filter a row with fixed-point weights (NEON)
+ *
+ * The even and odd bytes are loaded with their own step for every tap and merged before
+ * widening, so the luma and chroma of YUV422 are filtered in the same registers.
+ * @see filter_row_u8_scalar
+ */
+void filter_row_u8_neon(const uint8_t *src, uint8_t *dst, uint32_t length, const uint16_t *weights, uint16_t taps, uint16_t bias, uint16_t mul, uint8_t step_even, uint8_t step_odd) {
+    const uint8x16_t even = vreinterpretq_u8_u16(vdupq_n_u16(0x00FF));
+    const int32_t radius = taps / 2;
+    uint32_t blocks = length / 16;
+
+    for(uint32_t i = 0; i < blocks; ++i) {
+        const uint8_t *p = src + i * 16;
+        uint16x8_t lo = vdupq_n_u16(0);
+        uint16x8_t hi = vdupq_n_u16(0);
+
+        for(int32_t k = 0; k < taps; ++k) {
+            uint8x16_t v = vld1q_u8(p + (k - radius) * step_even);
+            if(step_odd != step_even)
+                v = vbslq_u8(even, v, vld1q_u8(p + (k - radius) * step_odd));
+
+            lo = vmlaq_n_u16(lo, vmovl_u8(vget_low_u8(v)), weights[k]);
+            hi = vmlaq_n_u16(hi, vmovl_u8(vget_high_u8(v)), weights[k]);
+        }
+
+        vst1q_u8(dst + i * 16, vcombine_u8(scale_u16_neon(lo, bias, mul), scale_u16_neon(hi, bias, mul)));
+    }
+
+    // Process the remaining bytes
+    if(blocks * 16 < length)
+        filter_row_u8_scalar(src + blocks * 16, dst + blocks * 16, length - blocks * 16, weights, taps, bias, mul, step_even, step_odd);
+}
+
+/**
+ * @brief Load 8 samples as 16 bit values (NEON)
+ *
+ * @param[in] src The first sample
+ * @param[in] step The distance between samples in bytes (1 or 2)
+ * @return The 8 samples
+ */
+static inline int16x8_t load_samples_neon(const uint8_t *src, uint8_t step) {
+    if(step == 1)
+        return vreinterpretq_s16_u16(vmovl_u8(vld1_u8(src)));
+    else
+        return vreinterpretq_s16_u16(vmovl_u8(vld2_u8(src).val[0]));
+}
+
+/**
+ * @brief Bilinear interpolation of a patch with fixed-point weights (NEON)
+ *
+ * @see interpolate_u8_scalar
+ */
+void interpolate_u8_neon(const uint8_t *src, uint32_t src_stride, uint8_t step, const int16_t *weights, int16_t *dst, uint32_t width, uint32_t height) {
+    uint32_t blocks = (width > 0)? (width - 1) / 8 : 0;
+
+    for(uint32_t y = 0; y < height; ++y) {
+        const uint8_t *row0 = src + y * src_stride;
+        const uint8_t *row1 = row0 + src_stride;
+        int16_t *out = dst + y * width;
+
+        for(uint32_t i = 0; i < blocks; ++i) {
+            const uint8_t *p0 = row0 + i * 8 * step;
+            const uint8_t *p1 = row1 + i * 8 * step;
+            int16x8_t a0 = load_samples_neon(p0, step);
+            int16x8_t b0 = load_samples_neon(p0 + step, step);
+            int16x8_t a1 = load_samples_neon(p1, step);
+            int16x8_t b1 = load_samples_neon(p1 + step, step);
+
+            // Weighted sums of the left and right neighbours of both rows
+            int32x4_t lo = vmull_n_s16(vget_low_s16(a0), weights[0]);
+            lo = vmlal_n_s16(lo, vget_low_s16(b0), weights[1]);
+            lo = vmlal_n_s16(lo, vget_low_s16(a1), weights[2]);
+            lo = vmlal_n_s16(lo, vget_low_s16(b1), weights[3]);
+            int32x4_t hi = vmull_n_s16(vget_high_s16(a0), weights[0]);
+            hi = vmlal_n_s16(hi, vget_high_s16(b0), weights[1]);
+            hi = vmlal_n_s16(hi, vget_high_s16(a1), weights[2]);
+            hi = vmlal_n_s16(hi, vget_high_s16(b1), weights[3]);
+
+            vst1q_s16(out + i * 8, vcombine_s16(vrshrn_n_s32(lo, 10), vrshrn_n_s32(hi, 10)));
+        }
+
+        // Process the remaining pixels
+        if(blocks * 8 < width)
+            interpolate_u8_scalar(row0 + blocks * 8 * step, src_stride, step, weights, out + blocks * 8, width - blocks * 8, 1);
+    }
+}
+
+/**
+ * @brief Calculate two dot products with the same vector (NEON)
+ *
+ * @see dot2_s16_scalar
+ */
+void dot2_s16_neon(const int16_t *a, const int16_t *b, const int16_t *d, uint32_t count, int64_t *sums) {
+    int64x2_t sa = vdupq_n_s64(0);
+    int64x2_t sb = vdupq_n_s64(0);
+    uint32_t blocks = count / 8;
+
+    for(uint32_t i = 0; i < blocks; i += 8) {
+        int32x4_t acc_a = vdupq_n_s32(0);
+        int32x4_t acc_b = vdupq_n_s32(0);
+
+        // Accumulate at most 64 values in 32 bit
+        uint32_t end = (i + 8 < blocks)? i + 8 : blocks;
+        for(uint32_t j = i; j < end; ++j) {
+            int16x8_t vd = vld1q_s16(d + j * 8);
+            int16x8_t va = vld1q_s16(a + j * 8);
+            int16x8_t vb = vld1q_s16(b + j * 8);
+            acc_a = vmlal_s16(acc_a, vget_low_s16(vd), vget_low_s16(va));
+            acc_a = vmlal_s16(acc_a, vget_high_s16(vd), vget_high_s16(va));
+            acc_b = vmlal_s16(acc_b, vget_low_s16(vd), vget_low_s16(vb));
+            acc_b = vmlal_s16(acc_b, vget_high_s16(vd), vget_high_s16(vb));
+        }
+
+        sa = vpadalq_s32(sa, acc_a);
+        sb = vpadalq_s32(sb, acc_b);
+    }
+
+    // Process the remaining values
+    int64_t ra = vgetq_lane_s64(sa, 0) + vgetq_lane_s64(sa, 1);
+    int64_t rb = vgetq_lane_s64(sb, 0) + vgetq_lane_s64(sb, 1);
+    if(blocks * 8 < count) {
+        dot2_s16_scalar(a + blocks * 8, b + blocks * 8, d + blocks * 8, count - blocks * 8, sums);
+        ra += sums[0];
+        rb += sums[1];
+    }
+
+    sums[0] = ra;
+    sums[1] = rb;
+}
+
+/**
+ * @brief Test the pixels of a row for FAST corners (NEON)
+ *
+ * This tests 16 pixels at once with saturating thresholds, so the results are the same as the
+ * scalar kernel. Blocks where no two neighbouring compass pixels (0, 4, 8 and 12) pass are
+ * skipped, since every arc of 9 or more pixels contains two of them.
+ * @see fast_row_u8_scalar
+ */
+uint32_t fast_row_u8_neon(const uint8_t *row, uint32_t stride, uint32_t x_start, uint32_t x_end, uint8_t threshold, uint8_t arc, uint16_t *corners) {
+    int32_t offsets[16];
+    for(uint8_t i = 0; i < 16; ++i)
+        offsets[i] = fast_ring_offsets[i][0] + fast_ring_offsets[i][1] * (int32_t)stride;
+
+    const uint8x16_t thres = vdupq_n_u8(threshold);
+    const uint8x16_t min_arc = vdupq_n_u8(arc - 1);
+    uint8_t flags[16];
+    uint32_t cnt = 0;
+    uint32_t x = x_start;
+
+    for(; x + 16 <= x_end; x += 16) {
+        const uint8_t *p = row + x;
+        uint8x16_t center = vld1q_u8(p);
+        uint8x16_t bright = vqaddq_u8(center, thres);
+        uint8x16_t dark = vqsubq_u8(center, thres);
+
+        // Quick rejection with the compass pixels
+        uint8x16_t b[4], d[4];
+        for(uint8_t i = 0; i < 4; ++i) {
+            uint8x16_t v = vld1q_u8(p + offsets[i * 4]);
+            b[i] = vcgtq_u8(v, bright);
+            d[i] = vcltq_u8(v, dark);
+        }
+        uint8x16_t pass = vorrq_u8(vorrq_u8(vandq_u8(b[0], b[1]), vandq_u8(b[1], b[2])),
+                                   vorrq_u8(vandq_u8(b[2], b[3]), vandq_u8(b[3], b[0])));
+        pass = vorrq_u8(pass, vorrq_u8(vorrq_u8(vandq_u8(d[0], d[1]), vandq_u8(d[1], d[2])),
+                                       vorrq_u8(vandq_u8(d[2], d[3]), vandq_u8(d[3], d[0]))));
+        uint64x2_t pass64 = vreinterpretq_u64_u8(pass);
+        if((vgetq_lane_u64(pass64, 0) | vgetq_lane_u64(pass64, 1)) == 0)
+            continue;
+
+        // Count the contiguous brighter and darker pixels, including the wrap around
+        uint8x16_t bright_cnt = vdupq_n_u8(0), dark_cnt = vdupq_n_u8(0);
+        uint8x16_t max_cnt = vdupq_n_u8(0);
+        for(uint8_t i = 0; i < 16 + arc - 1; ++i) {
+            uint8x16_t v = vld1q_u8(p + offsets[i % 16]);
+            uint8x16_t mb = vcgtq_u8(v, bright);
+            uint8x16_t md = vcltq_u8(v, dark);
+            bright_cnt = vandq_u8(vsubq_u8(bright_cnt, mb), mb);
+            dark_cnt = vandq_u8(vsubq_u8(dark_cnt, md), md);
+            max_cnt = vmaxq_u8(max_cnt, vmaxq_u8(bright_cnt, dark_cnt));
+        }
+
+        uint8x16_t result = vcgtq_u8(max_cnt, min_arc);
+        uint64x2_t result64 = vreinterpretq_u64_u8(result);
+        if((vgetq_lane_u64(result64, 0) | vgetq_lane_u64(result64, 1)) == 0)
+            continue;
+
+        vst1q_u8(flags, result);
+        for(uint8_t i = 0; i < 16; ++i) {
+            if(flags[i])
+                corners[cnt++] = x + i;
+        }
+    }
+
+    // Process the remaining pixels
+    if(x < x_end)
+        cnt += fast_row_u8_scalar(row, stride, x, x_end, threshold, arc, corners + cnt);
+    return cnt;
+}
+
+/**
+ * @brief Calculate the edge histograms of a range of columns (NEON)
+ *
+ * This processes 16 columns at once over all rows. The column sums are kept in 16 bit
+ * registers for at most 256 rows before they are added to the histogram, and the row sums are
+ * calculated with pairwise additions.
+ * @see edge_histogram_u8_scalar
+ */
+void edge_histogram_u8_neon(const uint8_t *src, uint32_t stride, uint32_t x_start, uint32_t x_end, uint32_t height, uint32_t *hist_x, uint32_t *hist_y) {
+    uint16_t tmp[16];
+    uint32_t x = x_start;
+
+    for(; x + 16 <= x_end; x += 16) {
+        for(uint32_t i = 0; i < 16; ++i)
+            hist_x[x + i] = 0;
+
+        for(uint32_t y = 1; y + 1 < height; y += 256) {
+            uint32_t end = (y + 256 < height - 1)? y + 256 : height - 1;
+            uint16x8_t acc_lo = vdupq_n_u16(0), acc_hi = vdupq_n_u16(0);
+
+            for(uint32_t r = y; r < end; ++r) {
+                const uint8_t *p = src + r * stride + x;
+                uint8x16_t dx = vabdq_u8(vld1q_u8(p + 1), vld1q_u8(p - 1));
+                acc_lo = vaddw_u8(acc_lo, vget_low_u8(dx));
+                acc_hi = vaddw_u8(acc_hi, vget_high_u8(dx));
+
+                uint8x16_t dy = vabdq_u8(vld1q_u8(p + stride), vld1q_u8(p - stride));
+                uint64x2_t sum = vpaddlq_u32(vpaddlq_u16(vpaddlq_u8(dy)));
+                hist_y[r] += vgetq_lane_u64(sum, 0) + vgetq_lane_u64(sum, 1);
+            }
+
+            vst1q_u16(tmp, acc_lo);
+            vst1q_u16(tmp + 8, acc_hi);
+            for(uint32_t i = 0; i < 16; ++i)
+                hist_x[x + i] += tmp[i];
+        }
+    }
+
+    // Process the remaining columns
+    if(x < x_end)
+        edge_histogram_u8_scalar(src, stride, x, x_end, height, hist_x, hist_y);
+}
+
+/**
+ * @brief Calculate the sum of absolute differences of two blocks (NEON)
+ *
+ * Rows are processed 16 or 8 pixels at once with absolute difference accumulation into 16 bit,
+ * which is widened before it can overflow.
+ * @see sad_u8_scalar
+ */
+uint32_t sad_u8_neon(const uint8_t *a, uint32_t a_stride, const uint8_t *b, uint32_t b_stride, uint32_t width, uint32_t height) {
+    uint32x4_t total = vdupq_n_u32(0);
+    uint32_t blocks = width / 16;
+    uint32_t x8 = blocks * 16;
+    bool half = (width - x8 >= 8);
+    if(blocks == 0 && !half)
+        return sad_u8_scalar(a, a_stride, b, b_stride, width, height);
+
+    // Amount of rows of which the absolute differences per lane fit in 16 bit
+    uint32_t chunk = 257 / (2 * blocks + (half? 1 : 0));
+    if(chunk == 0)
+        chunk = 1;
+
+    for(uint32_t y = 0; y < height; y += chunk) {
+        uint32_t end = (y + chunk < height)? y + chunk : height;
+        uint16x8_t acc = vdupq_n_u16(0);
+
+        for(uint32_t r = y; r < end; ++r) {
+            const uint8_t *ra = a + r * a_stride;
+            const uint8_t *rb = b + r * b_stride;
+            for(uint32_t i = 0; i < blocks; ++i) {
+                uint8x16_t va = vld1q_u8(ra + i * 16);
+                uint8x16_t vb = vld1q_u8(rb + i * 16);
+                acc = vabal_u8(acc, vget_low_u8(va), vget_low_u8(vb));
+                acc = vabal_u8(acc, vget_high_u8(va), vget_high_u8(vb));
+            }
+            if(half)
+                acc = vabal_u8(acc, vld1_u8(ra + x8), vld1_u8(rb + x8));
+        }
+        total = vpadalq_u16(total, acc);
+    }
+
+    uint64x2_t sum64 = vpaddlq_u32(total);
+    uint32_t sum = vgetq_lane_u64(sum64, 0) + vgetq_lane_u64(sum64, 1);
+
+    // Process the remaining pixels
+    if(half)
+        x8 += 8;
+    if(x8 < width)
+        sum += sad_u8_scalar(a + x8, a_stride, b + x8, b_stride, width - x8, height);
+    return sum;
+}
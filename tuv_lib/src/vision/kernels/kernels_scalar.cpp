@@ -0,0 +1,562 @@
+/*
+ * This file is part of the TUV library (https://github.com/tudelft/tudelft_vision).
+ * Copyright (c) 2016 Freek van Tienen <freek.v.tienen@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "vision/kernels/kernels.h"
+
+/**
+ * @brief Point sample a YUV422 image
+ *
+ * Every output pixel takes the luma of the top left source pixel in its block. The chroma of an
+ * output macro pixel (2 pixels) is taken from the first source macro pixel of the block. This
+ * can be executed in place, since the output is never ahead of the input.
+ * @param[in] src The source image
+ * @param[in] src_stride The source row stride in bytes
+ * @param[out] dst The output image
+ * @param[in] dst_stride The output row stride in bytes
+ * @param[in] dst_width The output width in pixels (must be even)
+ * @param[in] dst_height The output height in pixels
+ * @param[in] factor The downsample factor
+ * @param[in] uyvy If the pixel order is UYVY instead of YUYV
+ */
+void downsample_yuv422_point_scalar(const uint8_t *src, uint32_t src_stride, uint8_t *dst, uint32_t dst_stride, uint32_t dst_width, uint32_t dst_height, uint16_t factor, bool uyvy) {
+    const uint8_t lo = uyvy? 1 : 0;     // Luma offset in a pixel
+    const uint8_t co = uyvy? 0 : 1;     // Chroma offset in a pixel
+
+    const uint32_t skip = factor * 4;   // Source bytes per output macro pixel
+
+    for(uint32_t y = 0; y < dst_height; ++y) {
+        const uint8_t *in = src + y * factor * src_stride;
+        uint8_t *out = dst + y * dst_stride;
+
+        for(uint32_t x = 0; x < dst_width; x += 2) {
+            uint8_t y0 = in[lo];
+            uint8_t y1 = in[factor * 2 + lo];
+            uint8_t u = in[co];
+            uint8_t v = in[co + 2];
+
+            out[lo] = y0;
+            out[co] = u;
+            out[2 + lo] = y1;
+            out[2 + co] = v;
+            in += skip;
+            out += 4;
+        }
+    }
+}
+
+/**
+ * @brief Box average a YUV422 image
+ *
+ * Every output pixel is the rounded average of all the factor x factor source pixels in its
+ * block. The chroma is averaged over all source macro pixels covered by the output macro pixel.
+ * This can be executed in place, since the output is never ahead of the input.
+ * @param[in] src The source image
+ * @param[in] src_stride The source row stride in bytes
+ * @param[out] dst The output image
+ * @param[in] dst_stride The output row stride in bytes
+ * @param[in] dst_width The output width in pixels (must be even)
+ * @param[in] dst_height The output height in pixels
+ * @param[in] factor The downsample factor
+ * @param[in] uyvy If the pixel order is UYVY instead of YUYV
+ */
+void downsample_yuv422_box_scalar(const uint8_t *src, uint32_t src_stride, uint8_t *dst, uint32_t dst_stride, uint32_t dst_width, uint32_t dst_height, uint16_t factor, bool uyvy) {
+    const uint8_t lo = uyvy? 1 : 0;     // Luma offset in a pixel
+    const uint8_t co = uyvy? 0 : 1;     // Chroma offset in a pixel
+    const uint32_t count = factor * factor;
+
+    for(uint32_t y = 0; y < dst_height; ++y) {
+        const uint8_t *rows = src + y * factor * src_stride;
+        uint8_t *out = dst + y * dst_stride;
+
+        for(uint32_t x = 0; x < dst_width; x += 2) {
+            uint32_t y0 = 0, y1 = 0, u = 0, v = 0;
+
+            for(uint16_t r = 0; r < factor; ++r) {
+                const uint8_t *row = rows + r * src_stride;
+                for(uint16_t i = 0; i < factor; ++i) {
+                    y0 += row[(x * factor + i) * 2 + lo];
+                    y1 += row[((x + 1) * factor + i) * 2 + lo];
+                    u += row[((x / 2) * factor + i) * 4 + co];
+                    v += row[((x / 2) * factor + i) * 4 + co + 2];
+                }
+            }
+
+            out[x * 2 + lo] = (y0 + count / 2) / count;
+            out[x * 2 + co] = (u + count / 2) / count;
+            out[x * 2 + 2 + lo] = (y1 + count / 2) / count;
+            out[x * 2 + 2 + co] = (v + count / 2) / count;
+        }
+    }
+}
+
+/**
+ * @brief Point sample a GRAY8 image
+ *
+ * Every output pixel is the top left pixel of its factor x factor block. This can be executed
+ * in place, since the output is never ahead of the input.
+ * @param[in] src The source image
+ * @param[in] src_stride The source row stride in bytes
+ * @param[out] dst The output image
+ * @param[in] dst_stride The output row stride in bytes
+ * @param[in] dst_width The output width in pixels
+ * @param[in] dst_height The output height in pixels
+ * @param[in] factor The downsample factor
+ */
+void downsample_gray_point_scalar(const uint8_t *src, uint32_t src_stride, uint8_t *dst, uint32_t dst_stride, uint32_t dst_width, uint32_t dst_height, uint16_t factor) {
+    for(uint32_t y = 0; y < dst_height; ++y) {
+        const uint8_t *row = src + y * factor * src_stride;
+        uint8_t *out = dst + y * dst_stride;
+
+        for(uint32_t x = 0; x < dst_width; ++x)
+            out[x] = row[x * factor];
+    }
+}
+
+/**
+ * @brief Box average a GRAY8 image
+ *
+ * Every output pixel is the rounded average of all the factor x factor source pixels in its
+ * block. This can be executed in place, since the output is never ahead of the input.
+ * @param[in] src The source image
+ * @param[in] src_stride The source row stride in bytes
+ * @param[out] dst The output image
+ * @param[in] dst_stride The output row stride in bytes
+ * @param[in] dst_width The output width in pixels
+ * @param[in] dst_height The output height in pixels
+ * @param[in] factor The downsample factor
+ */
+void downsample_gray_box_scalar(const uint8_t *src, uint32_t src_stride, uint8_t *dst, uint32_t dst_stride, uint32_t dst_width, uint32_t dst_height, uint16_t factor) {
+    const uint32_t count = factor * factor;
+
+    for(uint32_t y = 0; y < dst_height; ++y) {
+        const uint8_t *rows = src + y * factor * src_stride;
+        uint8_t *out = dst + y * dst_stride;
+
+        for(uint32_t x = 0; x < dst_width; ++x) {
+            uint32_t sum = 0;
+            for(uint16_t r = 0; r < factor; ++r) {
+                const uint8_t *row = rows + r * src_stride + x * factor;
+                for(uint16_t i = 0; i < factor; ++i)
+                    sum += row[i];
+            }
+            out[x] = (sum + count / 2) / count;
+        }
+    }
+}
+
+/**
+ * @brief Extract the luma of a YUV422 image
+ *
+ * @param[in] src The source image
+ * @param[in] src_stride The source row stride in bytes
+ * @param[out] dst The output gray image
+ * @param[in] dst_stride The output row stride in bytes
+ * @param[in] width The width in pixels
+ * @param[in] height The height in pixels
+ * @param[in] uyvy If the pixel order is UYVY instead of YUYV
+ */
+void extract_luma_yuv422_scalar(const uint8_t *src, uint32_t src_stride, uint8_t *dst, uint32_t dst_stride, uint32_t width, uint32_t height, bool uyvy) {
+    const uint8_t lo = uyvy? 1 : 0;     // Luma offset in a pixel
+
+    for(uint32_t y = 0; y < height; ++y) {
+        const uint8_t *row = src + y * src_stride;
+        uint8_t *out = dst + y * dst_stride;
+
+        for(uint32_t x = 0; x < width; ++x)
+            out[x] = row[x * 2 + lo];
+    }
+}
+
+/**
+ * @brief Convert the chroma of a YUV422 image to YUV420
+ *
+ * The chroma of every two rows is averaged (rounded up) to get the vertically subsampled chroma.
+ * The output is either interleaved (NV12) or written to two separate planes (I420).
+ * @param[in] src The source image
+ * @param[in] src_stride The source row stride in bytes
+ * @param[out] u The output U plane or the interleaved UV plane
+ * @param[out] v The output V plane (NULL for interleaved UV output)
+ * @param[in] uv_stride The output row stride in bytes
+ * @param[in] width The source width in pixels (must be even)
+ * @param[in] height The source height in pixels (must be even)
+ * @param[in] uyvy If the pixel order is UYVY instead of YUYV
+ */
+void chroma_yuv422_to_420_scalar(const uint8_t *src, uint32_t src_stride, uint8_t *u, uint8_t *v, uint32_t uv_stride, uint32_t width, uint32_t height, bool uyvy) {
+    const uint8_t co = uyvy? 0 : 1;     // Chroma offset in a pixel
+
+    for(uint32_t y = 0; y < height / 2; ++y) {
+        const uint8_t *row0 = src + y * 2 * src_stride;
+        const uint8_t *row1 = row0 + src_stride;
+        uint8_t *out_u = u + y * uv_stride;
+        uint8_t *out_v = (v == NULL)? NULL : v + y * uv_stride;
+
+        for(uint32_t x = 0; x < width / 2; ++x) {
+            uint8_t cu = (row0[x * 4 + co] + row1[x * 4 + co] + 1) >> 1;
+            uint8_t cv = (row0[x * 4 + co + 2] + row1[x * 4 + co + 2] + 1) >> 1;
+
+            if(out_v == NULL) {
+                out_u[x * 2] = cu;
+                out_u[x * 2 + 1] = cv;
+            } else {
+                out_u[x] = cu;
+                out_v[x] = cv;
+            }
+        }
+    }
+}
+
+/**
+ * @brief Clamp a value to a byte
+ *
+ * @param[in] value The value to clamp
+ * @return The value clamped between 0 and 255
+ */
+static inline uint8_t clamp_u8(int32_t value) {
+    return (value < 0)? 0 : ((value > 255)? 255 : value);
+}
+
+/**
+ * @brief Convert a YUV422 image to RGB24 or BGR24
+ *
+ * This uses the BT.601 video range conversion in fixed point with 6 fractional bits. The
+ * vectorized kernels use exactly the same calculation:
+ *  - y = (max(Y - 16, 0) * 149) >> 1
+ *  - R = (y + 102 * (V - 128) + 32) >> 6
+ *  - G = (y - 25 * (U - 128) - 52 * (V - 128) + 32) >> 6
+ *  - B = (y + 129 * (U - 128) + 32) >> 6
+ * @param[in] src The source image
+ * @param[in] src_stride The source row stride in bytes
+ * @param[out] dst The output RGB image
+ * @param[in] dst_stride The output row stride in bytes
+ * @param[in] width The width in pixels (must be even)
+ * @param[in] height The height in pixels
+ * @param[in] uyvy If the pixel order is UYVY instead of YUYV
+ * @param[in] bgr If the output order is BGR instead of RGB
+ */
+void yuv422_to_rgb24_scalar(const uint8_t *src, uint32_t src_stride, uint8_t *dst, uint32_t dst_stride, uint32_t width, uint32_t height, bool uyvy, bool bgr) {
+    const uint8_t lo = uyvy? 1 : 0;     // Luma offset in a pixel
+    const uint8_t co = uyvy? 0 : 1;     // Chroma offset in a pixel
+    const uint8_t ro = bgr? 2 : 0;      // Red offset in a pixel
+    const uint8_t bo = bgr? 0 : 2;      // Blue offset in a pixel
+
+    for(uint32_t y = 0; y < height; ++y) {
+        const uint8_t *row = src + y * src_stride;
+        uint8_t *out = dst + y * dst_stride;
+
+        for(uint32_t x = 0; x < width; x += 2) {
+            int32_t d = row[x * 2 + co] - 128;
+            int32_t e = row[x * 2 + co + 2] - 128;
+            int32_t rv = 102 * e + 32;
+            int32_t guv = -25 * d - 52 * e + 32;
+            int32_t bu = 129 * d + 32;
+
+            for(uint8_t i = 0; i < 2; ++i) {
+                int32_t c = row[(x + i) * 2 + lo] - 16;
+                int32_t l = ((c < 0)? 0 : c) * 149 >> 1;
+
+                out[(x + i) * 3 + ro] = clamp_u8((l + rv) >> 6);
+                out[(x + i) * 3 + 1] = clamp_u8((l + guv) >> 6);
+                out[(x + i) * 3 + bo] = clamp_u8((l + bu) >> 6);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Convert a RGB24 image to YUV422
+ *
+ * This uses the BT.601 video range conversion in fixed point with 8 fractional bits. The
+ * chroma is calculated from the rounded average color of both pixels. The vectorized kernels
+ * use exactly the same calculation:
+ *  - Y = ((66 * R + 129 * G + 25 * B + 128) >> 8) + 16
+ *  - U = ((-38 * R - 74 * G + 112 * B + 128) >> 8) + 128
+ *  - V = ((112 * R - 94 * G - 18 * B + 128) >> 8) + 128
+ * @param[in] src The source RGB image
+ * @param[in] src_stride The source row stride in bytes
+ * @param[out] dst The output YUV422 image
+ * @param[in] dst_stride The output row stride in bytes
+ * @param[in] width The width in pixels (must be even)
+ * @param[in] height The height in pixels
+ * @param[in] uyvy If the output pixel order is UYVY instead of YUYV
+ * @param[in] bgr If the input order is BGR instead of RGB
+ */
+void rgb24_to_yuv422_scalar(const uint8_t *src, uint32_t src_stride, uint8_t *dst, uint32_t dst_stride, uint32_t width, uint32_t height, bool uyvy, bool bgr) {
+    const uint8_t lo = uyvy? 1 : 0;     // Luma offset in a pixel
+    const uint8_t co = uyvy? 0 : 1;     // Chroma offset in a pixel
+    const uint8_t ro = bgr? 2 : 0;      // Red offset in a pixel
+    const uint8_t bo = bgr? 0 : 2;      // Blue offset in a pixel
+
+    for(uint32_t y = 0; y < height; ++y) {
+        const uint8_t *row = src + y * src_stride;
+        uint8_t *out = dst + y * dst_stride;
+
+        for(uint32_t x = 0; x < width; x += 2) {
+            const uint8_t *p0 = row + x * 3;
+            const uint8_t *p1 = p0 + 3;
+
+            out[x * 2 + lo] = ((66 * p0[ro] + 129 * p0[1] + 25 * p0[bo] + 128) >> 8) + 16;
+            out[x * 2 + 2 + lo] = ((66 * p1[ro] + 129 * p1[1] + 25 * p1[bo] + 128) >> 8) + 16;
+
+            int32_t r = (p0[ro] + p1[ro] + 1) >> 1;
+            int32_t g = (p0[1] + p1[1] + 1) >> 1;
+            int32_t b = (p0[bo] + p1[bo] + 1) >> 1;
+            out[x * 2 + co] = ((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128;
+            out[x * 2 + 2 + co] = ((112 * r - 94 * g - 18 * b + 128) >> 8) + 128;
+        }
+    }
+}
+
+/**
+ * @brief Filter multiple rows with fixed-point weights
+ *
+ * This is the vertical pass of a separable filter. For every byte the weighted sum of the
+ * rows is calculated and scaled with ((sum + bias) * mul) >> 16. The weighted sum plus the
+ * bias must fit in 16 bits.
+ * @param[in] rows The input rows (one for every tap, rows may be repeated at the borders)
+ * @param[in] weights The weight of every tap
+ * @param[in] taps The amount of taps (at most KERNEL_MAX_TAPS)
+ * @param[in] bias The rounding bias added to the weighted sum
+ * @param[in] mul The fixed-point multiplier (65536 / divisor)
+ * @param[out] dst The output row
+ * @param[in] length The amount of bytes in a row
+ */
+void filter_rows_u8_scalar(const uint8_t *const *rows, const uint16_t *weights, uint16_t taps, uint16_t bias, uint16_t mul, uint8_t *dst, uint32_t length) {
+    for(uint32_t i = 0; i < length; ++i) {
+        uint32_t acc = bias;
+        for(uint16_t k = 0; k < taps; ++k)
+            acc += weights[k] * rows[k][i];
+        dst[i] = (acc * mul) >> 16;
+    }
+}
+
+/**
+ * @brief Update the sliding window sums of a box filter
+ *
+ * This is the vertical pass of a box filter. The row entering the window is added to the
+ * sums and the row leaving the window is subtracted, so the cost doesn't depend on the size
+ * of the window. When an output row is given the sums are scaled with
+ * ((sum + bias) * mul) >> 16.
+ * @param[in,out] sums The sliding window sums of every byte
+ * @param[in] add The row entering the window
+ * @param[in] sub The row leaving the window (NULL while filling the window)
+ * @param[out] dst The output row (NULL while filling the window)
+ * @param[in] length The amount of bytes in a row
+ * @param[in] bias The rounding bias added to the sum
+ * @param[in] mul The fixed-point multiplier (65536 / window size)
+ */
+void box_rows_u8_scalar(uint16_t *sums, const uint8_t *add, const uint8_t *sub, uint8_t *dst, uint32_t length, uint16_t bias, uint16_t mul) {
+    for(uint32_t i = 0; i < length; ++i) {
+        uint16_t sum = sums[i] + add[i];
+        if(sub != NULL)
+            sum -= sub[i];
+        sums[i] = sum;
+
+        if(dst != NULL)
+            dst[i] = ((uint32_t)(sum + bias) * mul) >> 16;
+    }
+}
+
+/**
+ * @brief Filter a row with fixed-point weights
+ *
+ * This is the horizontal pass of a separable filter on packed pixels. The distance between
+ * neighbouring samples of the same channel is given separately for the even and odd bytes,
+ * which is 1 for both in GRAY8 and 2 for luma and 4 for chroma in YUV422. The input must be
+ * padded with (taps / 2) * step bytes on both sides.
+ * @param[in] src The padded input row
+ * @param[out] dst The output row
+ * @param[in] length The amount of bytes in a row
+ * @param[in] weights The weight of every tap
+ * @param[in] taps The amount of taps (odd and at most KERNEL_MAX_TAPS)
+ * @param[in] bias The rounding bias added to the weighted sum
+ * @param[in] mul The fixed-point multiplier (65536 / divisor)
+ * @param[in] step_even The distance in bytes between samples of even bytes
+ * @param[in] step_odd The distance in bytes between samples of odd bytes
+ */
+void filter_row_u8_scalar(const uint8_t *src, uint8_t *dst, uint32_t length, const uint16_t *weights, uint16_t taps, uint16_t bias, uint16_t mul, uint8_t step_even, uint8_t step_odd) {
+    for(uint32_t i = 0; i < length; ++i) {
+        int32_t step = (i & 1)? step_odd : step_even;
+        const uint8_t *p = src + i - (taps / 2) * step;
+
+        uint32_t acc = bias;
+        for(uint16_t k = 0; k < taps; ++k)
+            acc += weights[k] * p[k * step];
+        dst[i] = (acc * mul) >> 16;
+    }
+}
+
+/**
+ * @brief Bilinear interpolation of a patch with fixed-point weights
+ *
+ * Every output value is the weighted sum of 2x2 neighbouring pixels, where the weights have 14
+ * fractional bits and sum up to 1 << 14. The result has 4 fractional bits, so the output is
+ * in the range 0 to 4080. The samples are step bytes apart, which is 1 for GRAY8 and 2 for the
+ * luma of YUV422. One pixel more then the output width and one row more then the output height
+ * must be readable.
+ * @param[in] src The first sample of the top left pixel
+ * @param[in] src_stride The source row stride in bytes
+ * @param[in] step The distance between samples in bytes (1 or 2)
+ * @param[in] weights The weights of the top left, top right, bottom left and bottom right pixels
+ * @param[out] dst The output patch (width * height values)
+ * @param[in] width The width of the output patch
+ * @param[in] height The height of the output patch
+ */
+void interpolate_u8_scalar(const uint8_t *src, uint32_t src_stride, uint8_t step, const int16_t *weights, int16_t *dst, uint32_t width, uint32_t height) {
+    for(uint32_t y = 0; y < height; ++y) {
+        const uint8_t *row0 = src + y * src_stride;
+        const uint8_t *row1 = row0 + src_stride;
+        int16_t *out = dst + y * width;
+
+        for(uint32_t x = 0; x < width; ++x) {
+            int32_t sum = weights[0] * row0[x * step] + weights[1] * row0[(x + 1) * step]
+                          + weights[2] * row1[x * step] + weights[3] * row1[(x + 1) * step];
+            out[x] = (sum + (1 << 9)) >> 10;
+        }
+    }
+}
+
+/**
+ * @brief Calculate two dot products with the same vector
+ *
+ * This calculates the sum of d * a and the sum of d * b, which are the sums used for the
+ * gradient matrix and mismatch vector of Lucas-Kanade. All values must be in the range of
+ * -8192 to 8192, which are accumulated in 32 bits for at most 64 values at a time.
+ * @param[in] a The first vector
+ * @param[in] b The second vector
+ * @param[in] d The vector multiplied with both
+ * @param[in] count The amount of values in the vectors
+ * @param[out] sums The sum of d * a and the sum of d * b
+ */
+void dot2_s16_scalar(const int16_t *a, const int16_t *b, const int16_t *d, uint32_t count, int64_t *sums) {
+    int64_t sa = 0, sb = 0;
+    for(uint32_t i = 0; i < count; ++i) {
+        sa += d[i] * a[i];
+        sb += d[i] * b[i];
+    }
+    sums[0] = sa;
+    sums[1] = sb;
+}
+
+/**
+ * @brief Offsets of the FAST ring pixels
+ *
+ * The 16 pixels on a Bresenham circle with a radius of 3 pixels, starting above the center and
+ * going clockwise.
+ */
+const int8_t fast_ring_offsets[16][2] = {
+    {0, -3}, {1, -3}, {2, -2}, {3, -1}, {3, 0}, {3, 1}, {2, 2}, {1, 3},
+    {0, 3}, {-1, 3}, {-2, 2}, {-3, 1}, {-3, 0}, {-3, -1}, {-2, -2}, {-1, -3}
+};
+
+/**
+ * @brief Test the pixels of a row for FAST corners
+ *
+ * A pixel is a corner when at least arc contiguous pixels of the ring are all brighter then the
+ * center plus the threshold or all darker then the center minus the threshold. The three rows
+ * above and below the row must be readable.
+ * @param[in] row The row to test
+ * @param[in] stride The row stride in bytes
+ * @param[in] x_start The first pixel to test (at least 3)
+ * @param[in] x_end The end of the pixels to test (at most the width minus 3)
+ * @param[in] threshold The minimum difference with the center
+ * @param[in] arc The minimum amount of contiguous pixels (9 or 12)
+ * @param[out] corners The horizontal positions of the corners
+ * @return The amount of corners found
+ */
+uint32_t fast_row_u8_scalar(const uint8_t *row, uint32_t stride, uint32_t x_start, uint32_t x_end, uint8_t threshold, uint8_t arc, uint16_t *corners) {
+    int32_t offsets[16];
+    for(uint8_t i = 0; i < 16; ++i)
+        offsets[i] = fast_ring_offsets[i][0] + fast_ring_offsets[i][1] * (int32_t)stride;
+
+    uint32_t cnt = 0;
+    for(uint32_t x = x_start; x < x_end; ++x) {
+        const uint8_t *p = row + x;
+        int32_t bright = p[0] + threshold;
+        int32_t dark = p[0] - threshold;
+
+        // Count the contiguous brighter and darker pixels, including the wrap around
+        uint8_t bright_cnt = 0, dark_cnt = 0, max_cnt = 0;
+        for(uint8_t i = 0; i < 16 + arc - 1 && max_cnt < arc; ++i) {
+            int32_t v = p[offsets[i % 16]];
+            bright_cnt = (v > bright)? bright_cnt + 1 : 0;
+            dark_cnt = (v < dark)? dark_cnt + 1 : 0;
+            if(bright_cnt > max_cnt)
+                max_cnt = bright_cnt;
+            if(dark_cnt > max_cnt)
+                max_cnt = dark_cnt;
+        }
+
+        if(max_cnt >= arc)
+            corners[cnt++] = x;
+    }
+    return cnt;
+}
+
+/**
+ * @brief Calculate the edge histograms of a range of columns
+ *
+ * The horizontal histogram contains the summed absolute horizontal gradient of every column and
+ * the vertical histogram the summed absolute vertical gradient of every row. Only the rows
+ * 1 until height - 1 are used. The vertical histogram is accumulated, so it must be cleared
+ * before the first range of columns.
+ * @param[in] src The luma of the image
+ * @param[in] stride The row stride in bytes
+ * @param[in] x_start The first column (at least 1)
+ * @param[in] x_end The end of the columns (at most the width minus 1)
+ * @param[in] height The height of the image
+ * @param[out] hist_x The horizontal histogram indexed by column
+ * @param[in,out] hist_y The vertical histogram indexed by row
+ */
+void edge_histogram_u8_scalar(const uint8_t *src, uint32_t stride, uint32_t x_start, uint32_t x_end, uint32_t height, uint32_t *hist_x, uint32_t *hist_y) {
+    for(uint32_t x = x_start; x < x_end; ++x)
+        hist_x[x] = 0;
+
+    for(uint32_t y = 1; y + 1 < height; ++y) {
+        const uint8_t *row = src + y * stride;
+        const uint8_t *above = row - stride;
+        const uint8_t *below = row + stride;
+        uint32_t sum_y = 0;
+        for(uint32_t x = x_start; x < x_end; ++x) {
+            uint8_t l = row[x - 1], r = row[x + 1], t = above[x], b = below[x];
+            hist_x[x] += (r > l)? r - l : l - r;
+            sum_y += (b > t)? b - t : t - b;
+        }
+        hist_y[y] += sum_y;
+    }
+}
+
+/**
+ * @brief Calculate the sum of absolute differences of two blocks
+ *
+ * @param[in] a The first block
+ * @param[in] a_stride The row stride of the first block in bytes
+ * @param[in] b The second block
+ * @param[in] b_stride The row stride of the second block in bytes
+ * @param[in] width The width of the blocks in pixels
+ * @param[in] height The height of the blocks in pixels
+ * @return The sum of absolute differences
+ */
+uint32_t sad_u8_scalar(const uint8_t *a, uint32_t a_stride, const uint8_t *b, uint32_t b_stride, uint32_t width, uint32_t height) {
+    uint32_t sum = 0;
+    for(uint32_t y = 0; y < height; ++y) {
+        const uint8_t *ra = a + y * a_stride;
+        const uint8_t *rb = b + y * b_stride;
+        for(uint32_t x = 0; x < width; ++x)
+            sum += (ra[x] > rb[x])? ra[x] - rb[x] : rb[x] - ra[x];
+    }
+    return sum;
+}
@@ -0,0 +1,916 @@
+/*
+ * This file is part of the TUV library (https://github.com/tudelft/tudelft_vision).
+ * Copyright (c) 2016 Freek van Tienen <freek.v.tienen@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "vision/kernels/kernels.h"
+
+#include <emmintrin.h>
+
+/**
+ * @brief Select the first and third pixel of four macro pixels (SSE2)
+ *
+ * Combines the luma of the first pixel and the chroma of macro pixel a with the luma of the
+ * first pixel of macro pixel b, for every 32 bit lane.
+ * @param[in] a The macro pixels containing the first luma and the chroma
+ * @param[in] b The macro pixels containing the second luma
+ * @param[in] uyvy If the pixel order is UYVY instead of YUYV
+ * @return The combined macro pixels
+ */
+static inline __m128i select_yuv422_sse2(__m128i a, __m128i b, bool uyvy) {
+    if(uyvy) {
+        a = _mm_and_si128(a, _mm_set1_epi32(0x00FFFFFF));
+        b = _mm_slli_epi32(_mm_and_si128(b, _mm_set1_epi32(0x0000FF00)), 16);
+    } else {
+        a = _mm_and_si128(a, _mm_set1_epi32(0xFF00FFFF));
+        b = _mm_slli_epi32(_mm_and_si128(b, _mm_set1_epi32(0x000000FF)), 16);
+    }
+    return _mm_or_si128(a, b);
+}
+
+/**
+ * @brief Interleave luma and chroma words into YUV422 bytes (SSE2)
+ *
+ * @param[in] luma The luma values (8 x 16 bit, must be smaller then 256)
+ * @param[in] chroma The chroma values (8 x 16 bit, must be smaller then 256)
+ * @param[in] uyvy If the pixel order is UYVY instead of YUYV
+ * @return The 16 output bytes
+ */
+static inline __m128i interleave_yuv422_sse2(__m128i luma, __m128i chroma, bool uyvy) {
+    if(uyvy)
+        return _mm_or_si128(chroma, _mm_slli_epi16(luma, 8));
+    else
+        return _mm_or_si128(luma, _mm_slli_epi16(chroma, 8));
+}
+
+/**
+ * @brief Point sample a YUV422 image by a factor of 2 (SSE2)
+ *
+ * @see downsample_yuv422_point_scalar
+ */
+void downsample_yuv422_point2_sse2(const uint8_t *src, uint32_t src_stride, uint8_t *dst, uint32_t dst_stride, uint32_t dst_width, uint32_t dst_height, bool uyvy) {
+    uint32_t blocks = dst_width / 8;
+
+    for(uint32_t y = 0; y < dst_height; ++y) {
+        const uint8_t *row = src + y * 2 * src_stride;
+        uint8_t *out = dst + y * dst_stride;
+
+        for(uint32_t i = 0; i < blocks; ++i) {
+            __m128i v0 = _mm_loadu_si128((const __m128i *)(row + i * 32));
+            __m128i v1 = _mm_loadu_si128((const __m128i *)(row + i * 32 + 16));
+
+            // Split the even and odd macro pixels
+            __m128i t0 = _mm_shuffle_epi32(v0, _MM_SHUFFLE(3, 1, 2, 0));
+            __m128i t1 = _mm_shuffle_epi32(v1, _MM_SHUFFLE(3, 1, 2, 0));
+            __m128i even = _mm_unpacklo_epi64(t0, t1);
+            __m128i odd = _mm_unpackhi_epi64(t0, t1);
+
+            _mm_storeu_si128((__m128i *)(out + i * 16), select_yuv422_sse2(even, odd, uyvy));
+        }
+
+        // Process the remaining pixels
+        if(blocks * 8 < dst_width)
+            downsample_yuv422_point_scalar(row + blocks * 32, src_stride, out + blocks * 16, dst_stride, dst_width - blocks * 8, 1, 2, uyvy);
+    }
+}
+
+/**
+ * @brief Point sample a YUV422 image by a factor of 4 (SSE2)
+ *
+ * @see downsample_yuv422_point_scalar
+ */
+void downsample_yuv422_point4_sse2(const uint8_t *src, uint32_t src_stride, uint8_t *dst, uint32_t dst_stride, uint32_t dst_width, uint32_t dst_height, bool uyvy) {
+    uint32_t blocks = dst_width / 8;
+
+    for(uint32_t y = 0; y < dst_height; ++y) {
+        const uint8_t *row = src + y * 4 * src_stride;
+        uint8_t *out = dst + y * dst_stride;
+
+        for(uint32_t i = 0; i < blocks; ++i) {
+            __m128i v0 = _mm_loadu_si128((const __m128i *)(row + i * 64));
+            __m128i v1 = _mm_loadu_si128((const __m128i *)(row + i * 64 + 16));
+            __m128i v2 = _mm_loadu_si128((const __m128i *)(row + i * 64 + 32));
+            __m128i v3 = _mm_loadu_si128((const __m128i *)(row + i * 64 + 48));
+
+            // Keep the even macro pixels
+            __m128i p01 = _mm_unpacklo_epi64(_mm_shuffle_epi32(v0, _MM_SHUFFLE(3, 1, 2, 0)), _mm_shuffle_epi32(v1, _MM_SHUFFLE(3, 1, 2, 0)));
+            __m128i p23 = _mm_unpacklo_epi64(_mm_shuffle_epi32(v2, _MM_SHUFFLE(3, 1, 2, 0)), _mm_shuffle_epi32(v3, _MM_SHUFFLE(3, 1, 2, 0)));
+
+            // Split the macro pixels 0, 4, 8, 12 and 2, 6, 10, 14
+            __m128i t0 = _mm_shuffle_epi32(p01, _MM_SHUFFLE(3, 1, 2, 0));
+            __m128i t1 = _mm_shuffle_epi32(p23, _MM_SHUFFLE(3, 1, 2, 0));
+            __m128i first = _mm_unpacklo_epi64(t0, t1);
+            __m128i second = _mm_unpackhi_epi64(t0, t1);
+
+            _mm_storeu_si128((__m128i *)(out + i * 16), select_yuv422_sse2(first, second, uyvy));
+        }
+
+        // Process the remaining pixels
+        if(blocks * 8 < dst_width)
+            downsample_yuv422_point_scalar(row + blocks * 64, src_stride, out + blocks * 16, dst_stride, dst_width - blocks * 8, 1, 4, uyvy);
+    }
+}
+
+/**
+ * @brief Box average a YUV422 image by a factor of 2 (SSE2)
+ *
+ * @see downsample_yuv422_box_scalar
+ */
+void downsample_yuv422_box2_sse2(const uint8_t *src, uint32_t src_stride, uint8_t *dst, uint32_t dst_stride, uint32_t dst_width, uint32_t dst_height, bool uyvy) {
+    const __m128i mask = _mm_set1_epi16(0x00FF);
+    const __m128i ones = _mm_set1_epi16(1);
+    const __m128i round = _mm_set1_epi16(2);
+    uint32_t blocks = dst_width / 8;
+
+    for(uint32_t y = 0; y < dst_height; ++y) {
+        const uint8_t *row0 = src + y * 2 * src_stride;
+        const uint8_t *row1 = row0 + src_stride;
+        uint8_t *out = dst + y * dst_stride;
+
+        for(uint32_t i = 0; i < blocks; ++i) {
+            __m128i a0 = _mm_loadu_si128((const __m128i *)(row0 + i * 32));
+            __m128i a1 = _mm_loadu_si128((const __m128i *)(row0 + i * 32 + 16));
+            __m128i b0 = _mm_loadu_si128((const __m128i *)(row1 + i * 32));
+            __m128i b1 = _mm_loadu_si128((const __m128i *)(row1 + i * 32 + 16));
+
+            // Vertical sums of the even and odd bytes
+            __m128i e0 = _mm_add_epi16(_mm_and_si128(a0, mask), _mm_and_si128(b0, mask));
+            __m128i e1 = _mm_add_epi16(_mm_and_si128(a1, mask), _mm_and_si128(b1, mask));
+            __m128i o0 = _mm_add_epi16(_mm_srli_epi16(a0, 8), _mm_srli_epi16(b0, 8));
+            __m128i o1 = _mm_add_epi16(_mm_srli_epi16(a1, 8), _mm_srli_epi16(b1, 8));
+            __m128i l0 = uyvy? o0 : e0, l1 = uyvy? o1 : e1;
+            __m128i c0 = uyvy? e0 : o0, c1 = uyvy? e1 : o1;
+
+            // Horizontal sums of 2 luma pixels
+            __m128i luma = _mm_packs_epi32(_mm_madd_epi16(l0, ones), _mm_madd_epi16(l1, ones));
+
+            // Horizontal sums of 2 chroma macro pixels
+            __m128i t0 = _mm_shuffle_epi32(c0, _MM_SHUFFLE(3, 1, 2, 0));
+            __m128i t1 = _mm_shuffle_epi32(c1, _MM_SHUFFLE(3, 1, 2, 0));
+            t0 = _mm_add_epi16(t0, _mm_unpackhi_epi64(t0, t0));
+            t1 = _mm_add_epi16(t1, _mm_unpackhi_epi64(t1, t1));
+            __m128i chroma = _mm_unpacklo_epi64(t0, t1);
+
+            // Divide by 4 and interleave
+            luma = _mm_srli_epi16(_mm_add_epi16(luma, round), 2);
+            chroma = _mm_srli_epi16(_mm_add_epi16(chroma, round), 2);
+            _mm_storeu_si128((__m128i *)(out + i * 16), interleave_yuv422_sse2(luma, chroma, uyvy));
+        }
+
+        // Process the remaining pixels
+        if(blocks * 8 < dst_width)
+            downsample_yuv422_box_scalar(row0 + blocks * 32, src_stride, out + blocks * 16, dst_stride, dst_width - blocks * 8, 1, 2, uyvy);
+    }
+}
+
+/**
+ * @brief Box average a YUV422 image by a factor of 4 (SSE2)
+ *
+ * @see downsample_yuv422_box_scalar
+ */
+void downsample_yuv422_box4_sse2(const uint8_t *src, uint32_t src_stride, uint8_t *dst, uint32_t dst_stride, uint32_t dst_width, uint32_t dst_height, bool uyvy) {
+    const __m128i mask = _mm_set1_epi16(0x00FF);
+    const __m128i ones = _mm_set1_epi16(1);
+    const __m128i round = _mm_set1_epi16(8);
+    uint32_t blocks = dst_width / 8;
+
+    for(uint32_t y = 0; y < dst_height; ++y) {
+        const uint8_t *rows = src + y * 4 * src_stride;
+        uint8_t *out = dst + y * dst_stride;
+
+        for(uint32_t i = 0; i < blocks; ++i) {
+            __m128i l[4], c[4];
+
+            // Vertical sums of the even and odd bytes over 4 rows
+            for(uint8_t j = 0; j < 4; ++j) {
+                __m128i e = _mm_setzero_si128();
+                __m128i o = _mm_setzero_si128();
+                for(uint8_t r = 0; r < 4; ++r) {
+                    __m128i v = _mm_loadu_si128((const __m128i *)(rows + r * src_stride + i * 64 + j * 16));
+                    e = _mm_add_epi16(e, _mm_and_si128(v, mask));
+                    o = _mm_add_epi16(o, _mm_srli_epi16(v, 8));
+                }
+                l[j] = uyvy? o : e;
+                c[j] = uyvy? e : o;
+            }
+
+            // Horizontal sums of 4 luma pixels
+            __m128i p01 = _mm_packs_epi32(_mm_madd_epi16(l[0], ones), _mm_madd_epi16(l[1], ones));
+            __m128i p23 = _mm_packs_epi32(_mm_madd_epi16(l[2], ones), _mm_madd_epi16(l[3], ones));
+            __m128i luma = _mm_packs_epi32(_mm_madd_epi16(p01, ones), _mm_madd_epi16(p23, ones));
+
+            // Horizontal sums of 4 chroma macro pixels
+            for(uint8_t j = 0; j < 4; ++j) {
+                __m128i t = _mm_shuffle_epi32(c[j], _MM_SHUFFLE(3, 1, 2, 0));
+                t = _mm_add_epi16(t, _mm_unpackhi_epi64(t, t));
+                c[j] = _mm_add_epi16(t, _mm_srli_si128(t, 4));
+            }
+            __m128i chroma = _mm_unpacklo_epi64(_mm_unpacklo_epi32(c[0], c[1]), _mm_unpacklo_epi32(c[2], c[3]));
+
+            // Divide by 16 and interleave
+            luma = _mm_srli_epi16(_mm_add_epi16(luma, round), 4);
+            chroma = _mm_srli_epi16(_mm_add_epi16(chroma, round), 4);
+            _mm_storeu_si128((__m128i *)(out + i * 16), interleave_yuv422_sse2(luma, chroma, uyvy));
+        }
+
+        // Process the remaining pixels
+        if(blocks * 8 < dst_width)
+            downsample_yuv422_box_scalar(rows + blocks * 64, src_stride, out + blocks * 16, dst_stride, dst_width - blocks * 8, 1, 4, uyvy);
+    }
+}
+
+/**
+ * @brief Box average a GRAY8 image by a factor of 2 (SSE2)
+ *
+ * @see downsample_gray_box_scalar
+ */
+void downsample_gray_box2_sse2(const uint8_t *src, uint32_t src_stride, uint8_t *dst, uint32_t dst_stride, uint32_t dst_width, uint32_t dst_height) {
+    const __m128i mask = _mm_set1_epi16(0x00FF);
+    const __m128i round = _mm_set1_epi16(2);
+    uint32_t blocks = dst_width / 16;
+
+    for(uint32_t y = 0; y < dst_height; ++y) {
+        const uint8_t *row0 = src + y * 2 * src_stride;
+        const uint8_t *row1 = row0 + src_stride;
+        uint8_t *out = dst + y * dst_stride;
+
+        for(uint32_t i = 0; i < blocks; ++i) {
+            __m128i a0 = _mm_loadu_si128((const __m128i *)(row0 + i * 32));
+            __m128i a1 = _mm_loadu_si128((const __m128i *)(row0 + i * 32 + 16));
+            __m128i b0 = _mm_loadu_si128((const __m128i *)(row1 + i * 32));
+            __m128i b1 = _mm_loadu_si128((const __m128i *)(row1 + i * 32 + 16));
+
+            // Sum the even and odd bytes of both rows
+            __m128i s0 = _mm_add_epi16(_mm_add_epi16(_mm_and_si128(a0, mask), _mm_srli_epi16(a0, 8)),
+                                       _mm_add_epi16(_mm_and_si128(b0, mask), _mm_srli_epi16(b0, 8)));
+            __m128i s1 = _mm_add_epi16(_mm_add_epi16(_mm_and_si128(a1, mask), _mm_srli_epi16(a1, 8)),
+                                       _mm_add_epi16(_mm_and_si128(b1, mask), _mm_srli_epi16(b1, 8)));
+
+            // Divide by 4
+            s0 = _mm_srli_epi16(_mm_add_epi16(s0, round), 2);
+            s1 = _mm_srli_epi16(_mm_add_epi16(s1, round), 2);
+            _mm_storeu_si128((__m128i *)(out + i * 16), _mm_packus_epi16(s0, s1));
+        }
+
+        // Process the remaining pixels
+        if(blocks * 16 < dst_width)
+            downsample_gray_box_scalar(row0 + blocks * 32, src_stride, out + blocks * 16, dst_stride, dst_width - blocks * 16, 1, 2);
+    }
+}
+
+/**
+ * @brief Extract the luma of a YUV422 image (SSE2)
+ *
+ * @see extract_luma_yuv422_scalar
+ */
+void extract_luma_yuv422_sse2(const uint8_t *src, uint32_t src_stride, uint8_t *dst, uint32_t dst_stride, uint32_t width, uint32_t height, bool uyvy) {
+    const __m128i mask = _mm_set1_epi16(0x00FF);
+    uint32_t blocks = width / 16;
+
+    for(uint32_t y = 0; y < height; ++y) {
+        const uint8_t *row = src + y * src_stride;
+        uint8_t *out = dst + y * dst_stride;
+
+        for(uint32_t i = 0; i < blocks; ++i) {
+            __m128i v0 = _mm_loadu_si128((const __m128i *)(row + i * 32));
+            __m128i v1 = _mm_loadu_si128((const __m128i *)(row + i * 32 + 16));
+
+            if(uyvy) {
+                v0 = _mm_srli_epi16(v0, 8);
+                v1 = _mm_srli_epi16(v1, 8);
+            } else {
+                v0 = _mm_and_si128(v0, mask);
+                v1 = _mm_and_si128(v1, mask);
+            }
+            _mm_storeu_si128((__m128i *)(out + i * 16), _mm_packus_epi16(v0, v1));
+        }
+
+        // Process the remaining pixels
+        if(blocks * 16 < width)
+            extract_luma_yuv422_scalar(row + blocks * 32, src_stride, out + blocks * 16, dst_stride, width - blocks * 16, 1, uyvy);
+    }
+}
+
+/**
+ * @brief Convert the chroma of a YUV422 image to YUV420 (SSE2)
+ *
+ * @see chroma_yuv422_to_420_scalar
+ */
+void chroma_yuv422_to_420_sse2(const uint8_t *src, uint32_t src_stride, uint8_t *u, uint8_t *v, uint32_t uv_stride, uint32_t width, uint32_t height, bool uyvy) {
+    const __m128i mask = _mm_set1_epi16(0x00FF);
+    uint32_t blocks = width / 16;
+
+    for(uint32_t y = 0; y < height / 2; ++y) {
+        const uint8_t *row0 = src + y * 2 * src_stride;
+        const uint8_t *row1 = row0 + src_stride;
+        uint8_t *out_u = u + y * uv_stride;
+        uint8_t *out_v = (v == NULL)? NULL : v + y * uv_stride;
+
+        for(uint32_t i = 0; i < blocks; ++i) {
+            // Average the two rows (rounded up like the scalar implementation)
+            __m128i a0 = _mm_avg_epu8(_mm_loadu_si128((const __m128i *)(row0 + i * 32)), _mm_loadu_si128((const __m128i *)(row1 + i * 32)));
+            __m128i a1 = _mm_avg_epu8(_mm_loadu_si128((const __m128i *)(row0 + i * 32 + 16)), _mm_loadu_si128((const __m128i *)(row1 + i * 32 + 16)));
+
+            // Keep only the chroma as UVUV..
+            if(uyvy) {
+                a0 = _mm_and_si128(a0, mask);
+                a1 = _mm_and_si128(a1, mask);
+            } else {
+                a0 = _mm_srli_epi16(a0, 8);
+                a1 = _mm_srli_epi16(a1, 8);
+            }
+            __m128i uv = _mm_packus_epi16(a0, a1);
+
+            if(out_v == NULL) {
+                _mm_storeu_si128((__m128i *)(out_u + i * 16), uv);
+            } else {
+                __m128i uu = _mm_packus_epi16(_mm_and_si128(uv, mask), _mm_setzero_si128());
+                __m128i vv = _mm_packus_epi16(_mm_srli_epi16(uv, 8), _mm_setzero_si128());
+                _mm_storel_epi64((__m128i *)(out_u + i * 8), uu);
+                _mm_storel_epi64((__m128i *)(out_v + i * 8), vv);
+            }
+        }
+
+        // Process the remaining pixels
+        if(blocks * 16 < width) {
+            uint32_t offset = (out_v == NULL)? blocks * 16 : blocks * 8;
+            chroma_yuv422_to_420_scalar(row0 + blocks * 32, src_stride, out_u + offset, (out_v == NULL)? NULL : out_v + offset,
+                                        uv_stride, width - blocks * 16, 2, uyvy);
+        }
+    }
+}
+
+/**
+ * @brief Convert 8 YUV422 pixels to RGB words (SSE2)
+ *
+ * @param[in] v The 8 YUV422 pixels
+ * @param[in] uyvy If the pixel order is UYVY instead of YUYV
+ * @param[out] r The red values (8 x 16 bit, before clamping)
+ * @param[out] g The green values (8 x 16 bit, before clamping)
+ * @param[out] b The blue values (8 x 16 bit, before clamping)
+ */
+static inline void yuv422_to_rgb_words_sse2(__m128i v, bool uyvy, __m128i &r, __m128i &g, __m128i &b) {
+    const __m128i mask = _mm_set1_epi16(0x00FF);
+    __m128i luma = uyvy? _mm_srli_epi16(v, 8) : _mm_and_si128(v, mask);
+    __m128i chroma = uyvy? _mm_and_si128(v, mask) : _mm_srli_epi16(v, 8);
+
+    // Duplicate the chroma for both pixels
+    __m128i cu = _mm_and_si128(chroma, _mm_set1_epi32(0x0000FFFF));
+    __m128i cv = _mm_srli_epi32(chroma, 16);
+    __m128i d = _mm_sub_epi16(_mm_or_si128(cu, _mm_slli_epi32(cu, 16)), _mm_set1_epi16(128));
+    __m128i e = _mm_sub_epi16(_mm_or_si128(cv, _mm_slli_epi32(cv, 16)), _mm_set1_epi16(128));
+
+    // Scale the luma (fits in 16 bit unsigned)
+    __m128i l = _mm_subs_epu16(luma, _mm_set1_epi16(16));
+    l = _mm_srli_epi16(_mm_mullo_epi16(l, _mm_set1_epi16(149)), 1);
+    l = _mm_add_epi16(l, _mm_set1_epi16(32));
+
+    __m128i guv = _mm_add_epi16(_mm_mullo_epi16(d, _mm_set1_epi16(25)), _mm_mullo_epi16(e, _mm_set1_epi16(52)));
+    r = _mm_srai_epi16(_mm_adds_epi16(l, _mm_mullo_epi16(e, _mm_set1_epi16(102))), 6);
+    g = _mm_srai_epi16(_mm_subs_epi16(l, guv), 6);
+    b = _mm_srai_epi16(_mm_adds_epi16(l, _mm_mullo_epi16(d, _mm_set1_epi16(129))), 6);
+}
+
+/**
+ * @brief Pack 4 RGB0 pixels into 12 bytes (SSE2)
+ *
+ * @param[in] p The 4 pixels with 4 bytes per pixel
+ * @return The 4 pixels with 3 bytes per pixel in the lower 12 bytes
+ */
+static inline __m128i pack_rgb0_sse2(__m128i p) {
+    // Remove the padding byte in every 64 bit half
+    __m128i q = _mm_or_si128(_mm_and_si128(p, _mm_set_epi32(0, 0x00FFFFFF, 0, 0x00FFFFFF)),
+                             _mm_srli_epi64(_mm_and_si128(p, _mm_set_epi32(0x00FFFFFF, 0, 0x00FFFFFF, 0)), 8));
+
+    // Combine the two 6 byte halves
+    __m128i lo = _mm_and_si128(q, _mm_set_epi32(0, 0, 0x0000FFFF, 0xFFFFFFFF));
+    return _mm_or_si128(lo, _mm_slli_si128(_mm_srli_si128(q, 8), 6));
+}
+
+/**
+ * @brief Convert a YUV422 image to RGB24 or BGR24 (SSE2)
+ *
+ * @see yuv422_to_rgb24_scalar
+ */
+void yuv422_to_rgb24_sse2(const uint8_t *src, uint32_t src_stride, uint8_t *dst, uint32_t dst_stride, uint32_t width, uint32_t height, bool uyvy, bool bgr) {
+    const __m128i zero = _mm_setzero_si128();
+    uint32_t blocks = width / 16;
+
+    for(uint32_t y = 0; y < height; ++y) {
+        const uint8_t *row = src + y * src_stride;
+        uint8_t *out = dst + y * dst_stride;
+
+        for(uint32_t i = 0; i < blocks; ++i) {
+            __m128i r0, g0, b0, r1, g1, b1;
+            yuv422_to_rgb_words_sse2(_mm_loadu_si128((const __m128i *)(row + i * 32)), uyvy, r0, g0, b0);
+            yuv422_to_rgb_words_sse2(_mm_loadu_si128((const __m128i *)(row + i * 32 + 16)), uyvy, r1, g1, b1);
+
+            // Clamp to bytes
+            __m128i r = _mm_packus_epi16(bgr? b0 : r0, bgr? b1 : r1);
+            __m128i g = _mm_packus_epi16(g0, g1);
+            __m128i b = _mm_packus_epi16(bgr? r0 : b0, bgr? r1 : b1);
+
+            // Interleave into RGB0 pixels
+            __m128i rg_lo = _mm_unpacklo_epi8(r, g);
+            __m128i rg_hi = _mm_unpackhi_epi8(r, g);
+            __m128i b_lo = _mm_unpacklo_epi8(b, zero);
+            __m128i b_hi = _mm_unpackhi_epi8(b, zero);
+            __m128i c0 = pack_rgb0_sse2(_mm_unpacklo_epi16(rg_lo, b_lo));
+            __m128i c1 = pack_rgb0_sse2(_mm_unpackhi_epi16(rg_lo, b_lo));
+            __m128i c2 = pack_rgb0_sse2(_mm_unpacklo_epi16(rg_hi, b_hi));
+            __m128i c3 = pack_rgb0_sse2(_mm_unpackhi_epi16(rg_hi, b_hi));
+
+            // Combine the 12 byte chunks into 48 bytes
+            _mm_storeu_si128((__m128i *)(out + i * 48), _mm_or_si128(c0, _mm_slli_si128(c1, 12)));
+            _mm_storeu_si128((__m128i *)(out + i * 48 + 16), _mm_or_si128(_mm_srli_si128(c1, 4), _mm_slli_si128(c2, 8)));
+            _mm_storeu_si128((__m128i *)(out + i * 48 + 32), _mm_or_si128(_mm_srli_si128(c2, 8), _mm_slli_si128(c3, 4)));
+        }
+
+        // Process the remaining pixels
+        if(blocks * 16 < width)
+            yuv422_to_rgb24_scalar(row + blocks * 32, src_stride, out + blocks * 48, dst_stride, width - blocks * 16, 1, uyvy, bgr);
+    }
+}
+
+/**
+ * @brief Deinterleave 16 pixels with 3 bytes per pixel (SSE2)
+ *
+ * This splits 48 bytes into the three channels by repeatedly interleaving the lower and upper
+ * halves, since SSE2 has no byte shuffle.
+ * @param[in] src The 48 input bytes
+ * @param[out] a The first channel of the 16 pixels
+ * @param[out] b The second channel of the 16 pixels
+ * @param[out] c The third channel of the 16 pixels
+ */
+static inline void load_deinterleave3_sse2(const uint8_t *src, __m128i &a, __m128i &b, __m128i &c) {
+    __m128i t00 = _mm_loadu_si128((const __m128i *)src);
+    __m128i t01 = _mm_loadu_si128((const __m128i *)(src + 16));
+    __m128i t02 = _mm_loadu_si128((const __m128i *)(src + 32));
+
+    __m128i t10 = _mm_unpacklo_epi8(t00, _mm_unpackhi_epi64(t01, t01));
+    __m128i t11 = _mm_unpacklo_epi8(_mm_unpackhi_epi64(t00, t00), t02);
+    __m128i t12 = _mm_unpacklo_epi8(t01, _mm_unpackhi_epi64(t02, t02));
+
+    __m128i t20 = _mm_unpacklo_epi8(t10, _mm_unpackhi_epi64(t11, t11));
+    __m128i t21 = _mm_unpacklo_epi8(_mm_unpackhi_epi64(t10, t10), t12);
+    __m128i t22 = _mm_unpacklo_epi8(t11, _mm_unpackhi_epi64(t12, t12));
+
+    __m128i t30 = _mm_unpacklo_epi8(t20, _mm_unpackhi_epi64(t21, t21));
+    __m128i t31 = _mm_unpacklo_epi8(_mm_unpackhi_epi64(t20, t20), t22);
+    __m128i t32 = _mm_unpacklo_epi8(t21, _mm_unpackhi_epi64(t22, t22));
+
+    a = _mm_unpacklo_epi8(t30, _mm_unpackhi_epi64(t31, t31));
+    b = _mm_unpacklo_epi8(_mm_unpackhi_epi64(t30, t30), t32);
+    c = _mm_unpacklo_epi8(t31, _mm_unpackhi_epi64(t32, t32));
+}
+
+/**
+ * @brief Convert 8 RGB pixels to YUV422 (SSE2)
+ *
+ * @param[in] r The red values (8 x 16 bit)
+ * @param[in] g The green values (8 x 16 bit)
+ * @param[in] b The blue values (8 x 16 bit)
+ * @param[in] uyvy If the output pixel order is UYVY instead of YUYV
+ * @return The 8 YUV422 pixels
+ */
+static inline __m128i rgb_words_to_yuv422_sse2(__m128i r, __m128i g, __m128i b, bool uyvy) {
+    const __m128i low = _mm_set1_epi32(0x0000FFFF);
+
+    // Luma of every pixel (the sum fits in 16 bit unsigned)
+    __m128i luma = _mm_add_epi16(_mm_mullo_epi16(r, _mm_set1_epi16(66)), _mm_mullo_epi16(g, _mm_set1_epi16(129)));
+    luma = _mm_add_epi16(luma, _mm_add_epi16(_mm_mullo_epi16(b, _mm_set1_epi16(25)), _mm_set1_epi16(128)));
+    luma = _mm_add_epi16(_mm_srli_epi16(luma, 8), _mm_set1_epi16(16));
+
+    // Average color of both pixels in the lower word of every 32 bit
+    __m128i ra = _mm_avg_epu16(_mm_and_si128(r, low), _mm_srli_epi32(r, 16));
+    __m128i ga = _mm_avg_epu16(_mm_and_si128(g, low), _mm_srli_epi32(g, 16));
+    __m128i ba = _mm_avg_epu16(_mm_and_si128(b, low), _mm_srli_epi32(b, 16));
+
+    // Chroma of both pixels
+    __m128i cu = _mm_sub_epi16(_mm_mullo_epi16(ba, _mm_set1_epi16(112)),
+                               _mm_add_epi16(_mm_mullo_epi16(ra, _mm_set1_epi16(38)), _mm_mullo_epi16(ga, _mm_set1_epi16(74))));
+    __m128i cv = _mm_sub_epi16(_mm_mullo_epi16(ra, _mm_set1_epi16(112)),
+                               _mm_add_epi16(_mm_mullo_epi16(ga, _mm_set1_epi16(94)), _mm_mullo_epi16(ba, _mm_set1_epi16(18))));
+    cu = _mm_add_epi16(_mm_srai_epi16(_mm_add_epi16(cu, _mm_set1_epi16(128)), 8), _mm_set1_epi16(128));
+    cv = _mm_add_epi16(_mm_srai_epi16(_mm_add_epi16(cv, _mm_set1_epi16(128)), 8), _mm_set1_epi16(128));
+    __m128i chroma = _mm_or_si128(_mm_and_si128(cu, low), _mm_slli_epi32(cv, 16));
+
+    return interleave_yuv422_sse2(luma, chroma, uyvy);
+}
+
+/**
+ * @brief Convert a RGB24 or BGR24 image to YUV422 (SSE2)
+ *
+ * @see rgb24_to_yuv422_scalar
+ */
+void rgb24_to_yuv422_sse2(const uint8_t *src, uint32_t src_stride, uint8_t *dst, uint32_t dst_stride, uint32_t width, uint32_t height, bool uyvy, bool bgr) {
+    const __m128i zero = _mm_setzero_si128();
+    uint32_t blocks = width / 16;
+
+    for(uint32_t y = 0; y < height; ++y) {
+        const uint8_t *row = src + y * src_stride;
+        uint8_t *out = dst + y * dst_stride;
+
+        for(uint32_t i = 0; i < blocks; ++i) {
+            __m128i c0, c1, c2;
+            load_deinterleave3_sse2(row + i * 48, c0, c1, c2);
+            __m128i r = bgr? c2 : c0;
+            __m128i b = bgr? c0 : c2;
+
+            __m128i lo = rgb_words_to_yuv422_sse2(_mm_unpacklo_epi8(r, zero), _mm_unpacklo_epi8(c1, zero), _mm_unpacklo_epi8(b, zero), uyvy);
+            __m128i hi = rgb_words_to_yuv422_sse2(_mm_unpackhi_epi8(r, zero), _mm_unpackhi_epi8(c1, zero), _mm_unpackhi_epi8(b, zero), uyvy);
+            _mm_storeu_si128((__m128i *)(out + i * 32), lo);
+            _mm_storeu_si128((__m128i *)(out + i * 32 + 16), hi);
+        }
+
+        // Process the remaining pixels
+        if(blocks * 16 < width)
+            rgb24_to_yuv422_scalar(row + blocks * 48, src_stride, out + blocks * 32, dst_stride, width - blocks * 16, 1, uyvy, bgr);
+    }
+}
+
+/**
+ * @brief Scale 16 fixed-point sums to bytes (SSE2)
+ *
+ * @param[in] lo The first 8 sums
+ * @param[in] hi The last 8 sums
+ * @param[in] bias The rounding bias
+ * @param[in] mul The fixed-point multiplier
+ * @return The 16 scaled bytes
+ */
+static inline __m128i scale_u16_sse2(__m128i lo, __m128i hi, __m128i bias, __m128i mul) {
+    lo = _mm_mulhi_epu16(_mm_add_epi16(lo, bias), mul);
+    hi = _mm_mulhi_epu16(_mm_add_epi16(hi, bias), mul);
+    return _mm_packus_epi16(lo, hi);
+}
+
+/**
+ * @brief Filter multiple rows with fixed-point weights (SSE2)
+ *
+ * @see filter_rows_u8_scalar
+ */
+void filter_rows_u8_sse2(const uint8_t *const *rows, const uint16_t *weights, uint16_t taps, uint16_t bias, uint16_t mul, uint8_t *dst, uint32_t length) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i vbias = _mm_set1_epi16(bias);
+    const __m128i vmul = _mm_set1_epi16(mul);
+    uint32_t blocks = length / 16;
+
+    for(uint32_t i = 0; i < blocks; ++i) {
+        __m128i lo = _mm_setzero_si128();
+        __m128i hi = _mm_setzero_si128();
+
+        for(uint16_t k = 0; k < taps; ++k) {
+            __m128i w = _mm_set1_epi16(weights[k]);
+            __m128i v = _mm_loadu_si128((const __m128i *)(rows[k] + i * 16));
+            lo = _mm_add_epi16(lo, _mm_mullo_epi16(_mm_unpacklo_epi8(v, zero), w));
+            hi = _mm_add_epi16(hi, _mm_mullo_epi16(_mm_unpackhi_epi8(v, zero), w));
+        }
+
+        _mm_storeu_si128((__m128i *)(dst + i * 16), scale_u16_sse2(lo, hi, vbias, vmul));
+    }
+
+    // Process the remaining bytes
+    if(blocks * 16 < length) {
+        const uint8_t *tail[KERNEL_MAX_TAPS];
+        for(uint16_t k = 0; k < taps; ++k)
+            tail[k] = rows[k] + blocks * 16;
+        filter_rows_u8_scalar(tail, weights, taps, bias, mul, dst + blocks * 16, length - blocks * 16);
+    }
+}
+
+/**
+ * @brief Update the sliding window sums of a box filter (SSE2)
+ *
+ * @see box_rows_u8_scalar
+ */
+void box_rows_u8_sse2(uint16_t *sums, const uint8_t *add, const uint8_t *sub, uint8_t *dst, uint32_t length, uint16_t bias, uint16_t mul) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i vbias = _mm_set1_epi16(bias);
+    const __m128i vmul = _mm_set1_epi16(mul);
+    uint32_t blocks = length / 16;
+
+    for(uint32_t i = 0; i < blocks; ++i) {
+        __m128i a = _mm_loadu_si128((const __m128i *)(add + i * 16));
+        __m128i lo = _mm_add_epi16(_mm_loadu_si128((const __m128i *)(sums + i * 16)), _mm_unpacklo_epi8(a, zero));
+        __m128i hi = _mm_add_epi16(_mm_loadu_si128((const __m128i *)(sums + i * 16 + 8)), _mm_unpackhi_epi8(a, zero));
+
+        if(sub != NULL) {
+            __m128i s = _mm_loadu_si128((const __m128i *)(sub + i * 16));
+            lo = _mm_sub_epi16(lo, _mm_unpacklo_epi8(s, zero));
+            hi = _mm_sub_epi16(hi, _mm_unpackhi_epi8(s, zero));
+        }
+
+        _mm_storeu_si128((__m128i *)(sums + i * 16), lo);
+        _mm_storeu_si128((__m128i *)(sums + i * 16 + 8), hi);
+
+        if(dst != NULL)
+            _mm_storeu_si128((__m128i *)(dst + i * 16), scale_u16_sse2(lo, hi, vbias, vmul));
+    }
+
+    // Process the remaining bytes
+    if(blocks * 16 < length) {
+        uint32_t offset = blocks * 16;
+        box_rows_u8_scalar(sums + offset, add + offset, (sub == NULL)? NULL : sub + offset, (dst == NULL)? NULL : dst + offset,
+                           length - offset, bias, mul);
+    }
+}
+
+/**
+ * @brief Filter a row with fixed-point weights (SSE2)
+ *
+ * The even and odd bytes are loaded with their own step for every tap and merged before
+ * widening, so the luma and chroma of YUV422 are filtered in the same registers.
+ * @see filter_row_u8_scalar
+ */
+void filter_row_u8_sse2(const uint8_t *src, uint8_t *dst, uint32_t length, const uint16_t *weights, uint16_t taps, uint16_t bias, uint16_t mul, uint8_t step_even, uint8_t step_odd) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i even = _mm_set1_epi16(0x00FF);
+    const __m128i vbias = _mm_set1_epi16(bias);
+    const __m128i vmul = _mm_set1_epi16(mul);
+    const int32_t radius = taps / 2;
+    uint32_t blocks = length / 16;
+
+    for(uint32_t i = 0; i < blocks; ++i) {
+        const uint8_t *p = src + i * 16;
+        __m128i lo = _mm_setzero_si128();
+        __m128i hi = _mm_setzero_si128();
+
+        for(int32_t k = 0; k < taps; ++k) {
+            __m128i w = _mm_set1_epi16(weights[k]);
+            __m128i v = _mm_loadu_si128((const __m128i *)(p + (k - radius) * step_even));
+            if(step_odd != step_even) {
+                __m128i o = _mm_loadu_si128((const __m128i *)(p + (k - radius) * step_odd));
+                v = _mm_or_si128(_mm_and_si128(v, even), _mm_andnot_si128(even, o));
+            }
+
+            lo = _mm_add_epi16(lo, _mm_mullo_epi16(_mm_unpacklo_epi8(v, zero), w));
+            hi = _mm_add_epi16(hi, _mm_mullo_epi16(_mm_unpackhi_epi8(v, zero), w));
+        }
+
+        _mm_storeu_si128((__m128i *)(dst + i * 16), scale_u16_sse2(lo, hi, vbias, vmul));
+    }
+
+    // Process the remaining bytes
+    if(blocks * 16 < length)
+        filter_row_u8_scalar(src + blocks * 16, dst + blocks * 16, length - blocks * 16, weights, taps, bias, mul, step_even, step_odd);
+}
+
+/**
+ * @brief Load 8 samples as 16 bit values (SSE2)
+ *
+ * @param[in] src The first sample
+ * @param[in] step The distance between samples in bytes (1 or 2)
+ * @return The 8 samples
+ */
+static inline __m128i load_samples_sse2(const uint8_t *src, uint8_t step) {
+    if(step == 1)
+        return _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)src), _mm_setzero_si128());
+    else
+        return _mm_and_si128(_mm_loadu_si128((const __m128i *)src), _mm_set1_epi16(0x00FF));
+}
+
+/**
+ * @brief Bilinear interpolation of a patch with fixed-point weights (SSE2)
+ *
+ * @see interpolate_u8_scalar
+ */
+void interpolate_u8_sse2(const uint8_t *src, uint32_t src_stride, uint8_t step, const int16_t *weights, int16_t *dst, uint32_t width, uint32_t height) {
+    const __m128i w01 = _mm_unpacklo_epi16(_mm_set1_epi16(weights[0]), _mm_set1_epi16(weights[1]));
+    const __m128i w23 = _mm_unpacklo_epi16(_mm_set1_epi16(weights[2]), _mm_set1_epi16(weights[3]));
+    const __m128i round = _mm_set1_epi32(1 << 9);
+    uint32_t blocks = (width > 0)? (width - 1) / 8 : 0;
+
+    for(uint32_t y = 0; y < height; ++y) {
+        const uint8_t *row0 = src + y * src_stride;
+        const uint8_t *row1 = row0 + src_stride;
+        int16_t *out = dst + y * width;
+
+        for(uint32_t i = 0; i < blocks; ++i) {
+            const uint8_t *p0 = row0 + i * 8 * step;
+            const uint8_t *p1 = row1 + i * 8 * step;
+            __m128i a0 = load_samples_sse2(p0, step);
+            __m128i b0 = load_samples_sse2(p0 + step, step);
+            __m128i a1 = load_samples_sse2(p1, step);
+            __m128i b1 = load_samples_sse2(p1 + step, step);
+
+            // Weighted sums of the left and right neighbours of both rows
+            __m128i lo = _mm_add_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(a0, b0), w01), _mm_madd_epi16(_mm_unpacklo_epi16(a1, b1), w23));
+            __m128i hi = _mm_add_epi32(_mm_madd_epi16(_mm_unpackhi_epi16(a0, b0), w01), _mm_madd_epi16(_mm_unpackhi_epi16(a1, b1), w23));
+            lo = _mm_srai_epi32(_mm_add_epi32(lo, round), 10);
+            hi = _mm_srai_epi32(_mm_add_epi32(hi, round), 10);
+            _mm_storeu_si128((__m128i *)(out + i * 8), _mm_packs_epi32(lo, hi));
+        }
+
+        // Process the remaining pixels
+        if(blocks * 8 < width)
+            interpolate_u8_scalar(row0 + blocks * 8 * step, src_stride, step, weights, out + blocks * 8, width - blocks * 8, 1);
+    }
+}
+
+/**
+ * @brief Calculate two dot products with the same vector (SSE2)
+ *
+ * @see dot2_s16_scalar
+ */
+void dot2_s16_sse2(const int16_t *a, const int16_t *b, const int16_t *d, uint32_t count, int64_t *sums) {
+    int64_t sa = 0, sb = 0;
+    uint32_t blocks = count / 8;
+    int32_t tmp[4];
+
+    for(uint32_t i = 0; i < blocks; i += 8) {
+        __m128i acc_a = _mm_setzero_si128();
+        __m128i acc_b = _mm_setzero_si128();
+
+        // Accumulate at most 64 values in 32 bit
+        uint32_t end = (i + 8 < blocks)? i + 8 : blocks;
+        for(uint32_t j = i; j < end; ++j) {
+            __m128i vd = _mm_loadu_si128((const __m128i *)(d + j * 8));
+            acc_a = _mm_add_epi32(acc_a, _mm_madd_epi16(vd, _mm_loadu_si128((const __m128i *)(a + j * 8))));
+            acc_b = _mm_add_epi32(acc_b, _mm_madd_epi16(vd, _mm_loadu_si128((const __m128i *)(b + j * 8))));
+        }
+
+        _mm_storeu_si128((__m128i *)tmp, acc_a);
+        sa += (int64_t)tmp[0] + tmp[1] + tmp[2] + tmp[3];
+        _mm_storeu_si128((__m128i *)tmp, acc_b);
+        sb += (int64_t)tmp[0] + tmp[1] + tmp[2] + tmp[3];
+    }
+
+    // Process the remaining values
+    if(blocks * 8 < count) {
+        dot2_s16_scalar(a + blocks * 8, b + blocks * 8, d + blocks * 8, count - blocks * 8, sums);
+        sa += sums[0];
+        sb += sums[1];
+    }
+
+    sums[0] = sa;
+    sums[1] = sb;
+}
+
+/**
+ * @brief Test the pixels of a row for FAST corners (SSE2)
+ *
+ * This tests 16 pixels at once. The unsigned bytes are compared signed by flipping the sign bit,
+ * and the thresholds saturate, so the results are the same as the scalar kernel. Blocks where
+ * no two neighbouring compass pixels (0, 4, 8 and 12) pass are skipped, since every arc of 9 or
+ * more pixels contains two of them.
+ * @see fast_row_u8_scalar
+ */
+uint32_t fast_row_u8_sse2(const uint8_t *row, uint32_t stride, uint32_t x_start, uint32_t x_end, uint8_t threshold, uint8_t arc, uint16_t *corners) {
+    int32_t offsets[16];
+    for(uint8_t i = 0; i < 16; ++i)
+        offsets[i] = fast_ring_offsets[i][0] + fast_ring_offsets[i][1] * (int32_t)stride;
+
+    const __m128i sign = _mm_set1_epi8((char)0x80);
+    const __m128i thres = _mm_set1_epi8((char)threshold);
+    const __m128i min_arc = _mm_set1_epi8((char)(arc - 1));
+    uint32_t cnt = 0;
+    uint32_t x = x_start;
+
+    for(; x + 16 <= x_end; x += 16) {
+        const uint8_t *p = row + x;
+        __m128i center = _mm_loadu_si128((const __m128i *)p);
+        __m128i bright = _mm_xor_si128(_mm_adds_epu8(center, thres), sign);
+        __m128i dark = _mm_xor_si128(_mm_subs_epu8(center, thres), sign);
+
+        // Quick rejection with the compass pixels
+        __m128i b[4], d[4];
+        for(uint8_t i = 0; i < 4; ++i) {
+            __m128i v = _mm_xor_si128(_mm_loadu_si128((const __m128i *)(p + offsets[i * 4])), sign);
+            b[i] = _mm_cmpgt_epi8(v, bright);
+            d[i] = _mm_cmpgt_epi8(dark, v);
+        }
+        __m128i pass = _mm_or_si128(
+                           _mm_or_si128(_mm_and_si128(b[0], b[1]), _mm_and_si128(b[1], b[2])),
+                           _mm_or_si128(_mm_and_si128(b[2], b[3]), _mm_and_si128(b[3], b[0])));
+        pass = _mm_or_si128(pass, _mm_or_si128(
+                                _mm_or_si128(_mm_and_si128(d[0], d[1]), _mm_and_si128(d[1], d[2])),
+                                _mm_or_si128(_mm_and_si128(d[2], d[3]), _mm_and_si128(d[3], d[0]))));
+        if(_mm_movemask_epi8(pass) == 0)
+            continue;
+
+        // Count the contiguous brighter and darker pixels, including the wrap around
+        __m128i bright_cnt = _mm_setzero_si128(), dark_cnt = _mm_setzero_si128();
+        __m128i max_cnt = _mm_setzero_si128();
+        for(uint8_t i = 0; i < 16 + arc - 1; ++i) {
+            __m128i v = _mm_xor_si128(_mm_loadu_si128((const __m128i *)(p + offsets[i % 16])), sign);
+            __m128i mb = _mm_cmpgt_epi8(v, bright);
+            __m128i md = _mm_cmpgt_epi8(dark, v);
+            bright_cnt = _mm_and_si128(_mm_sub_epi8(bright_cnt, mb), mb);
+            dark_cnt = _mm_and_si128(_mm_sub_epi8(dark_cnt, md), md);
+            max_cnt = _mm_max_epu8(max_cnt, _mm_max_epu8(bright_cnt, dark_cnt));
+        }
+
+        int mask = _mm_movemask_epi8(_mm_cmpgt_epi8(max_cnt, min_arc));
+        while(mask != 0) {
+            int bit = __builtin_ctz(mask);
+            corners[cnt++] = x + bit;
+            mask &= mask - 1;
+        }
+    }
+
+    // Process the remaining pixels
+    if(x < x_end)
+        cnt += fast_row_u8_scalar(row, stride, x, x_end, threshold, arc, corners + cnt);
+    return cnt;
+}
+
+/**
+ * @brief Calculate the edge histograms of a range of columns (SSE2)
+ *
+ * This processes 16 columns at once over all rows. The column sums are kept in 16 bit
+ * registers for at most 256 rows before they are added to the histogram, and the row sums are
+ * calculated with the sum of absolute differences instruction.
+ * @see edge_histogram_u8_scalar
+ */
+void edge_histogram_u8_sse2(const uint8_t *src, uint32_t stride, uint32_t x_start, uint32_t x_end, uint32_t height, uint32_t *hist_x, uint32_t *hist_y) {
+    const __m128i zero = _mm_setzero_si128();
+    uint16_t tmp[16];
+    uint32_t x = x_start;
+
+    for(; x + 16 <= x_end; x += 16) {
+        for(uint32_t i = 0; i < 16; ++i)
+            hist_x[x + i] = 0;
+
+        for(uint32_t y = 1; y + 1 < height; y += 256) {
+            uint32_t end = (y + 256 < height - 1)? y + 256 : height - 1;
+            __m128i acc_lo = zero, acc_hi = zero;
+
+            for(uint32_t r = y; r < end; ++r) {
+                const uint8_t *p = src + r * stride + x;
+                __m128i left = _mm_loadu_si128((const __m128i *)(p - 1));
+                __m128i right = _mm_loadu_si128((const __m128i *)(p + 1));
+                __m128i top = _mm_loadu_si128((const __m128i *)(p - stride));
+                __m128i bottom = _mm_loadu_si128((const __m128i *)(p + stride));
+
+                __m128i dx = _mm_or_si128(_mm_subs_epu8(right, left), _mm_subs_epu8(left, right));
+                acc_lo = _mm_add_epi16(acc_lo, _mm_unpacklo_epi8(dx, zero));
+                acc_hi = _mm_add_epi16(acc_hi, _mm_unpackhi_epi8(dx, zero));
+
+                __m128i sad = _mm_sad_epu8(top, bottom);
+                hist_y[r] += _mm_cvtsi128_si32(sad) + _mm_extract_epi16(sad, 4);
+            }
+
+            _mm_storeu_si128((__m128i *)tmp, acc_lo);
+            _mm_storeu_si128((__m128i *)(tmp + 8), acc_hi);
+            for(uint32_t i = 0; i < 16; ++i)
+                hist_x[x + i] += tmp[i];
+        }
+    }
+
+    // Process the remaining columns
+    if(x < x_end)
+        edge_histogram_u8_scalar(src, stride, x, x_end, height, hist_x, hist_y);
+}
+
+/**
+ * @brief Calculate the sum of absolute differences of two blocks (SSE2)
+ *
+ * Rows are processed 16 pixels at once and the remaining 8 pixels of two rows are combined in a
+ * single register.
+ * @see sad_u8_scalar
+ */
+uint32_t sad_u8_sse2(const uint8_t *a, uint32_t a_stride, const uint8_t *b, uint32_t b_stride, uint32_t width, uint32_t height) {
+    __m128i acc = _mm_setzero_si128();
+    uint32_t blocks = width / 16;
+    uint32_t x8 = blocks * 16;
+    bool half = (width - x8 >= 8);
+
+    for(uint32_t y = 0; y < height; ++y) {
+        const uint8_t *ra = a + y * a_stride;
+        const uint8_t *rb = b + y * b_stride;
+        for(uint32_t i = 0; i < blocks; ++i)
+            acc = _mm_add_epi64(acc, _mm_sad_epu8(_mm_loadu_si128((const __m128i *)(ra + i * 16)), _mm_loadu_si128((const __m128i *)(rb + i * 16))));
+    }
+
+    // Combine the 8 pixel remainders of two rows
+    if(half) {
+        uint32_t y = 0;
+        for(; y + 2 <= height; y += 2) {
+            __m128i va = _mm_unpacklo_epi64(_mm_loadl_epi64((const __m128i *)(a + y * a_stride + x8)), _mm_loadl_epi64((const __m128i *)(a + (y + 1) * a_stride + x8)));
+            __m128i vb = _mm_unpacklo_epi64(_mm_loadl_epi64((const __m128i *)(b + y * b_stride + x8)), _mm_loadl_epi64((const __m128i *)(b + (y + 1) * b_stride + x8)));
+            acc = _mm_add_epi64(acc, _mm_sad_epu8(va, vb));
+        }
+        if(y < height)
+            acc = _mm_add_epi64(acc, _mm_sad_epu8(_mm_loadl_epi64((const __m128i *)(a + y * a_stride + x8)), _mm_loadl_epi64((const __m128i *)(b + y * b_stride + x8))));
+        x8 += 8;
+    }
+
+    uint32_t sum = _mm_cvtsi128_si32(acc) + _mm_cvtsi128_si32(_mm_unpackhi_epi64(acc, acc));
+
+    // Process the remaining pixels
+    if(x8 < width)
+        sum += sad_u8_scalar(a + x8, a_stride, b + x8, b_stride, width - x8, height);
+    return sum;
+}
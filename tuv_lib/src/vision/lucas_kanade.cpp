@@ -0,0 +1,351 @@
+/*
+ * This file is part of the TUV library (https://github.com/tudelft/tudelft_vision).
+ * Copyright (c) 2016 Freek van Tienen <freek.v.tienen@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "vision/lucas_kanade.h"
+
+#include "vision/simd.h"
+#include "vision/kernels/kernels.h"
+#include <string>
+#include <stdexcept>
+#include <stdlib.h>
+#include <math.h>
+
+/*
+ * The interpolated windows have 4 fractional bits (16 times the luma) and the gradients are
+ * central differences of the interpolated window (32 times the derivative). These scales are
+ * removed when calculating the update in floating point.
+ */
+#define LK_WINDOW_SCALE 16.0f       ///< Scale of the interpolated windows
+#define LK_GRADIENT_SCALE 32.0f     ///< Scale of the gradients
+#define LK_WEIGHT_BITS 14           ///< Fractional bits of the interpolation weights
+
+/**
+ * @brief Create a new Lucas-Kanade tracker
+ *
+ * @param[in] window_size The width and height of the window around a point in pixels (odd)
+ * @param[in] levels The maximum amount of pyramid levels to use
+ * @param[in] max_iterations The maximum amount of iterations per level
+ */
+LucasKanade::LucasKanade(uint16_t window_size, uint8_t levels, uint8_t max_iterations):
+    window_size(window_size),
+    levels(levels),
+    max_iterations(max_iterations),
+    epsilon(0.03f),
+    min_eigenvalue(0.1f),
+    max_error(0),
+    patch((window_size + 2) * (window_size + 2)),
+    prev_win(window_size * window_size),
+    grad_x(window_size * window_size),
+    grad_y(window_size * window_size),
+    cur_win(window_size * window_size),
+    prev_levels(levels),
+    cur_levels(levels) {
+    if(window_size < 3 || window_size % 2 == 0) {
+        throw std::runtime_error("The Lucas-Kanade window size must be odd and at least 3 and not " + std::to_string(window_size));
+    }
+    if(levels == 0 || max_iterations == 0) {
+        throw std::runtime_error("Lucas-Kanade needs at least one level and one iteration");
+    }
+    selectKernels();
+}
+
+/**
+ * @brief Track points from the previous to the current frame
+ *
+ * This tracks every point from the previous pyramid to the current pyramid. The result vector
+ * is resized to the amount of points and contains the displacement, status and error for every
+ * point in the same order. The amount of levels used is limited by the levels available in
+ * both pyramids.
+ * @param[in] prev The pyramid of the previous frame
+ * @param[in] cur The pyramid of the current frame
+ * @param[in] points The points in the previous frame
+ * @param[out] result The tracking result of every point
+ */
+void LucasKanade::track(Pyramid &prev, Pyramid &cur, const std::vector<struct point_t> &points, std::vector<struct flow_t> &result) {
+    uint8_t level_cnt = levels;
+    if(prev.getAvailableLevels() < level_cnt)
+        level_cnt = prev.getAvailableLevels();
+    if(cur.getAvailableLevels() < level_cnt)
+        level_cnt = cur.getAvailableLevels();
+    if(level_cnt == 0) {
+        throw std::runtime_error("Both pyramids must contain a frame for Lucas-Kanade tracking");
+    }
+
+    // Get the levels once and select the kernels for the current instruction set
+    selectKernels();
+    for(uint8_t l = 0; l < level_cnt; ++l) {
+        prev_levels[l] = prev.getLevel(l);
+        cur_levels[l] = cur.getLevel(l);
+    }
+
+    result.resize(points.size());
+    for(uint32_t i = 0; i < points.size(); ++i) {
+        struct flow_t &res = result[i];
+        res.pos = points[i];
+        res.flow.x = 0;
+        res.flow.y = 0;
+        res.status = STATUS_TRACKED;
+        res.error = 0;
+        res.iterations = 0;
+        trackPoint(level_cnt, res);
+    }
+
+    // Release the levels, so the buffers can be reused by the pyramids
+    for(uint8_t l = 0; l < level_cnt; ++l) {
+        prev_levels[l].reset();
+        cur_levels[l].reset();
+    }
+}
+
+/**
+ * @brief Set the minimum update
+ *
+ * @param[in] epsilon The iterations on a level stop when the update is smaller (in pixels)
+ */
+void LucasKanade::setEpsilon(float epsilon) {
+    this->epsilon = epsilon;
+}
+
+/**
+ * @brief Set the minimum eigenvalue
+ *
+ * Points where the smallest eigenvalue of the gradient matrix divided by the window area is
+ * smaller are not tracked, since the window doesn't contain enough texture. The eigenvalue is
+ * in squared luma per pixel.
+ * @param[in] min_eigenvalue The minimum eigenvalue
+ */
+void LucasKanade::setMinEigenvalue(float min_eigenvalue) {
+    this->min_eigenvalue = min_eigenvalue;
+}
+
+/**
+ * @brief Set the maximum error
+ *
+ * Points with a larger mean absolute luma difference between the windows get the
+ * STATUS_LARGE_ERROR status. A maximum error of 0 disables the check.
+ * @param[in] max_error The maximum error
+ */
+void LucasKanade::setMaxError(float max_error) {
+    this->max_error = max_error;
+}
+
+/**
+ * @brief Get the window size
+ *
+ * @return The width and height of the window in pixels
+ */
+uint16_t LucasKanade::getWindowSize(void) {
+    return window_size;
+}
+
+/**
+ * @brief Get the maximum amount of levels
+ *
+ * @return The maximum amount of pyramid levels used
+ */
+uint8_t LucasKanade::getLevels(void) {
+    return levels;
+}
+
+/**
+ * @brief Get the maximum amount of iterations
+ *
+ * @return The maximum amount of iterations per level
+ */
+uint8_t LucasKanade::getMaxIterations(void) {
+    return max_iterations;
+}
+
+/**
+ * @brief Select the kernels for the current instruction set
+ */
+void LucasKanade::selectKernels(void) {
+    interpolate = interpolate_u8_scalar;
+    dot2 = dot2_s16_scalar;
+
+    switch(SIMD::getInstructionSet()) {
+#if defined(TUV_HAVE_SSE2)
+    case SIMD::ISA_AVX2:
+    case SIMD::ISA_SSE2:
+        interpolate = interpolate_u8_sse2;
+        dot2 = dot2_s16_sse2;
+        break;
+#endif
+
+#if defined(TUV_HAVE_NEON)
+    case SIMD::ISA_NEON:
+        interpolate = interpolate_u8_neon;
+        dot2 = dot2_s16_neon;
+        break;
+#endif
+
+    default:
+        break;
+    }
+}
+
+/**
+ * @brief Interpolate a square window of the luma
+ *
+ * @param[in] img The image (GRAY8 or YUV422)
+ * @param[in] x The horizontal position of the top left pixel
+ * @param[in] y The vertical position of the top left pixel
+ * @param[in] size The width and height of the window
+ * @param[out] dst The interpolated window (size * size values)
+ * @return False when the window is (partly) outside the image
+ */
+bool LucasKanade::interpolateWindow(Image::Ptr img, float x, float y, uint16_t size, int16_t *dst) {
+    float fx = floorf(x);
+    float fy = floorf(y);
+    if(fx < 0 || fy < 0 || fx + size >= img->getWidth() || fy + size >= img->getHeight())
+        return false;
+
+    // Fixed-point weights of the 4 neighbouring pixels
+    float ax = x - fx;
+    float ay = y - fy;
+    int16_t weights[4];
+    weights[0] = (int16_t)roundf((1 - ax) * (1 - ay) * (1 << LK_WEIGHT_BITS));
+    weights[1] = (int16_t)roundf(ax * (1 - ay) * (1 << LK_WEIGHT_BITS));
+    weights[2] = (int16_t)roundf((1 - ax) * ay * (1 << LK_WEIGHT_BITS));
+    weights[3] = (1 << LK_WEIGHT_BITS) - weights[0] - weights[1] - weights[2];
+
+    // Luma position and distance between the samples
+    enum Image::pixel_formats fmt = img->getPixelFormat();
+    uint8_t step = (fmt == Image::FMT_GRAY8)? 1 : 2;
+    uint8_t offset = (fmt == Image::FMT_UYVY)? 1 : 0;
+    const uint8_t *src = (const uint8_t *)img->getData() + (uint32_t)fy * img->getStride() + (uint32_t)fx * step + offset;
+
+    interpolate(src, img->getStride(), step, weights, dst, size, size);
+    return true;
+}
+
+/**
+ * @brief Track a single point through the pyramid levels
+ *
+ * On every level the gradient matrix of the previous window is calculated once, after which
+ * the window in the current frame is moved iteratively until the update is smaller then
+ * epsilon or the maximum amount of iterations is reached. Levels where the window doesn't fit
+ * or doesn't contain enough texture are skipped, except for the finest level.
+ * @param[in] level_cnt The amount of levels to use
+ * @param[in,out] result The point to track and the tracking result
+ */
+void LucasKanade::trackPoint(uint8_t level_cnt, struct flow_t &result) {
+    const int32_t half = window_size / 2;
+    const uint32_t count = window_size * window_size;
+    const uint16_t patch_size = window_size + 2;
+    float gx = 0, gy = 0;
+    int64_t sums[2];
+
+    for(int32_t level = level_cnt - 1; level >= 0; --level) {
+        // Propagate the displacement of the coarser level
+        if(level != level_cnt - 1) {
+            gx *= 2;
+            gy *= 2;
+        }
+
+        float scale = 1.0f / (1 << level);
+        float px = result.pos.x * scale;
+        float py = result.pos.y * scale;
+
+        // Interpolate the previous window with a border for the gradients
+        if(!interpolateWindow(prev_levels[level], px - half - 1, py - half - 1, patch_size, patch.data())) {
+            if(level == 0) {
+                result.status = STATUS_OUT_OF_BOUNDS;
+                return;
+            }
+            continue;
+        }
+
+        for(int32_t y = 0; y < window_size; ++y) {
+            const int16_t *row = patch.data() + (y + 1) * patch_size + 1;
+            for(int32_t x = 0; x < window_size; ++x) {
+                prev_win[y * window_size + x] = row[x];
+                grad_x[y * window_size + x] = row[x + 1] - row[x - 1];
+                grad_y[y * window_size + x] = row[x + patch_size] - row[x - patch_size];
+            }
+        }
+
+        // Gradient matrix in squared luma per pixel
+        const float gscale = 1.0f / (LK_GRADIENT_SCALE * LK_GRADIENT_SCALE);
+        dot2(grad_x.data(), grad_y.data(), grad_x.data(), count, sums);
+        float a11 = sums[0] * gscale;
+        float a12 = sums[1] * gscale;
+        dot2(grad_x.data(), grad_y.data(), grad_y.data(), count, sums);
+        float a22 = sums[1] * gscale;
+
+        float det = a11 * a22 - a12 * a12;
+        float min_eig = (a11 + a22 - sqrtf((a11 - a22) * (a11 - a22) + 4 * a12 * a12)) / (2 * count);
+        if(min_eig < min_eigenvalue || det < 1e-6f) {
+            if(level == 0) {
+                result.status = STATUS_SMALL_EIGENVALUE;
+                return;
+            }
+            continue;
+        }
+
+        // Iteratively move the window in the current frame
+        const float bscale = 1.0f / (LK_WINDOW_SCALE * LK_GRADIENT_SCALE);
+        float dx = 0, dy = 0;
+        for(uint8_t i = 0; i < max_iterations; ++i) {
+            float nx = px + gx + dx;
+            float ny = py + gy + dy;
+            if(!interpolateWindow(cur_levels[level], nx - half, ny - half, window_size, cur_win.data())) {
+                if(level == 0) {
+                    result.status = STATUS_OUT_OF_BOUNDS;
+                    return;
+                }
+                break;
+            }
+
+            for(uint32_t j = 0; j < count; ++j)
+                cur_win[j] -= prev_win[j];
+
+            // Mismatch vector and the update
+            dot2(grad_x.data(), grad_y.data(), cur_win.data(), count, sums);
+            float b1 = sums[0] * bscale;
+            float b2 = sums[1] * bscale;
+            float ux = (a12 * b2 - a22 * b1) / det;
+            float uy = (a12 * b1 - a11 * b2) / det;
+            dx += ux;
+            dy += uy;
+            result.iterations++;
+
+            if(ux * ux + uy * uy < epsilon * epsilon)
+                break;
+        }
+
+        gx += dx;
+        gy += dy;
+    }
+
+    result.flow.x = gx;
+    result.flow.y = gy;
+
+    // Calculate the error at the final position
+    if(!interpolateWindow(cur_levels[0], result.pos.x + gx - half, result.pos.y + gy - half, window_size, cur_win.data())) {
+        result.status = STATUS_OUT_OF_BOUNDS;
+        return;
+    }
+
+    uint32_t error = 0;
+    for(uint32_t j = 0; j < count; ++j)
+        error += abs(cur_win[j] - prev_win[j]);
+    result.error = error / (count * LK_WINDOW_SCALE);
+
+    if(max_error > 0 && result.error > max_error)
+        result.status = STATUS_LARGE_ERROR;
+}
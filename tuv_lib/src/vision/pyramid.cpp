@@ -0,0 +1,185 @@
+/*
+ * This file is part of the TUV library (https://github.com/tudelft/tudelft_vision).
+ * Copyright (c) 2016 Freek van Tienen <freek.v.tienen@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "vision/pyramid.h"
+
+#include "vision/image_buffer.h"
+#include "drivers/clogger.h"
+#include <string>
+#include <stdexcept>
+#include <assert.h>
+
+/**
+ * @brief Create a new pyramid
+ *
+ * This will create an empty pyramid, where the frame must be set with setImage before the
+ * levels can be requested.
+ * @param[in] levels The maximum amount of levels (including the frame itself)
+ * @param[in] method The method used to reduce a level by a factor of 2
+ */
+Pyramid::Pyramid(uint8_t levels, enum Image::downsample_methods method):
+    levels(levels),
+    method(method),
+    frame_cnt(0),
+    images(levels),
+    pools(levels) {
+    assert(levels > 0);
+}
+
+/**
+ * @brief Create a new pyramid of a frame
+ *
+ * @param[in] img The frame (level 0)
+ * @param[in] levels The maximum amount of levels (including the frame itself)
+ * @param[in] method The method used to reduce a level by a factor of 2
+ */
+Pyramid::Pyramid(Image::Ptr img, uint8_t levels, enum Image::downsample_methods method):
+    Pyramid(levels, method) {
+    setImage(img);
+}
+
+/**
+ * @brief Set a new frame
+ *
+ * This will drop all the cached levels of the previous frame, after which the levels of the
+ * new frame are calculated when they are requested. Only YUV422 and GRAY8 frames are
+ * supported.
+ * @param[in] img The new frame (level 0)
+ */
+void Pyramid::setImage(Image::Ptr img) {
+    enum Image::pixel_formats fmt = img->getPixelFormat();
+    if(fmt != Image::FMT_UYVY && fmt != Image::FMT_YUYV && fmt != Image::FMT_GRAY8) {
+        throw std::runtime_error("A pyramid can only be built from YUV422 and GRAY8 images and not from " + std::to_string(fmt));
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    for(auto &level : images)
+        level.reset();
+    images[0] = img;
+    frame_cnt++;
+}
+
+/**
+ * @brief Get a level of the pyramid
+ *
+ * This will return the cached level or calculate it (and all the levels in between) from the
+ * previous level. The level images must not be modified, since they are shared.
+ * @param[in] level The level (0 is the frame itself)
+ * @return The image of the level
+ */
+Image::Ptr Pyramid::getLevel(uint8_t level) {
+    if(level >= levels) {
+        throw std::runtime_error("Pyramid level " + std::to_string(level) + " is larger then the maximum of " + std::to_string(levels - 1));
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if(images[0] == nullptr) {
+        throw std::runtime_error("No frame is set for the pyramid");
+    }
+
+    // Calculate the missing levels
+    for(uint8_t i = 1; i <= level; ++i) {
+        if(images[i] == nullptr)
+            images[i] = createLevel(i);
+    }
+
+    return images[level];
+}
+
+/**
+ * @brief Get the maximum amount of levels
+ *
+ * @return The maximum amount of levels, including the frame itself
+ */
+uint8_t Pyramid::getLevels(void) {
+    return levels;
+}
+
+/**
+ * @brief Get the amount of levels which can be calculated
+ *
+ * This is the amount of levels (at most the maximum) where the image still contains pixels,
+ * which depends on the size of the current frame.
+ * @return The amount of levels which can be requested
+ */
+uint8_t Pyramid::getAvailableLevels(void) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if(images[0] == nullptr)
+        return 0;
+
+    uint32_t width = images[0]->getWidth();
+    uint32_t height = images[0]->getHeight();
+    bool yuv422 = (images[0]->getPixelFormat() != Image::FMT_GRAY8);
+    uint8_t available = 1;
+    while(available < levels) {
+        width = yuv422? (width / 2) & ~1 : width / 2;
+        height = height / 2;
+        if(width == 0 || height == 0)
+            break;
+        available++;
+    }
+    return available;
+}
+
+/**
+ * @brief Get the amount of frames
+ *
+ * This can be used by consumers to check if the pyramid contains a new frame.
+ * @return The amount of frames set since the creation of the pyramid
+ */
+uint32_t Pyramid::getFrameCount(void) {
+    std::lock_guard<std::mutex> lock(mutex);
+    return frame_cnt;
+}
+
+/**
+ * @brief Calculate a level from the previous level
+ *
+ * The level image is taken from the pool of the level. When the geometry of the frames changes,
+ * the pool is recreated once all images of the old pool are freed. Until then the level is
+ * allocated separately. The mutex must be locked.
+ * @param[in] level The level to calculate (larger then 0)
+ * @return The new level image
+ */
+Image::Ptr Pyramid::createLevel(uint8_t level) {
+    Image::Ptr prev = images[level - 1];
+    enum Image::pixel_formats fmt = prev->getPixelFormat();
+    uint32_t width = (fmt == Image::FMT_GRAY8)? prev->getWidth() / 2 : (prev->getWidth() / 2) & ~1;
+    uint32_t height = prev->getHeight() / 2;
+    if(width == 0 || height == 0) {
+        throw std::runtime_error("Pyramid level " + std::to_string(level) + " of a " + std::to_string(images[0]->getWidth()) + "x"
+                                 + std::to_string(images[0]->getHeight()) + " frame doesn't contain any pixels");
+    }
+
+    // Create a new pool when the geometry changes and the old one is not used anymore
+    ImageBufferPool::Ptr &pool = pools[level];
+    if(pool == nullptr || ((pool->getPixelFormat() != fmt || pool->getWidth() != width || pool->getHeight() != height)
+                           && pool->getStatistics().in_use == 0)) {
+        pool = std::make_shared<ImageBufferPool>(fmt, width, height);
+    }
+
+    Image::Ptr img;
+    if(pool->getPixelFormat() == fmt && pool->getWidth() == width && pool->getHeight() == height) {
+        img = pool->getImage();
+    } else {
+        CLOGGER_WARN("Pyramid level " << (int)level << " is allocated outside the pool while the old pool is in use");
+        img = std::make_shared<ImageBuffer>(fmt, width, height);
+    }
+
+    prev->downsample(img, 2, method);
+    return img;
+}
@@ -0,0 +1,158 @@
+/*
+ * This file is part of the TUV library (https://github.com/tudelft/tudelft_vision).
+ * Copyright (c) 2016 Freek van Tienen <freek.v.tienen@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "vision/simd.h"
+
+#include "drivers/clogger.h"
+#include <string>
+#include <stdexcept>
+#include <stdio.h>
+
+#if defined(TUV_HAVE_NEON) && !defined(__aarch64__)
+#include <elf.h>
+#define HWCAP_ARM_NEON (1 << 12)    ///< NEON bit in the ARM AT_HWCAP auxiliary vector
+#endif
+
+// Initialize the instruction set selection
+std::atomic<enum SIMD::instruction_sets> SIMD::isa(SIMD::ISA_SCALAR);
+std::once_flag SIMD::detected;
+
+/**
+ * @brief Get the selected instruction set
+ *
+ * This returns the instruction set which is used by the vision kernels. On the first call
+ * the best supported instruction set is detected, unless it was forced before. This is safe to
+ * call from multiple threads.
+ * @return The selected instruction set
+ */
+enum SIMD::instruction_sets SIMD::getInstructionSet(void) {
+    std::call_once(detected, [] {
+        isa = detect();
+        CLOGGER_INFO("Selected " << toString(isa) << " vision kernels");
+    });
+
+    return isa;
+}
+
+/**
+ * @brief Force the instruction set
+ *
+ * This will force the vision kernels to use a specific instruction set. This can be used to
+ * run the scalar reference implementation or to compare different implementations.
+ * @param[in] isa The instruction set to use (must be supported)
+ */
+void SIMD::setInstructionSet(enum instruction_sets isa) {
+    if(!isSupported(isa)) {
+        throw std::runtime_error(std::string("Instruction set ") + toString(isa) + " is not supported on this CPU");
+    }
+
+    // Finish or skip the detection first, so it can't override the forced instruction set
+    std::call_once(detected, [] {});
+    SIMD::isa = isa;
+}
+
+/**
+ * @brief Check if an instruction set is supported
+ *
+ * An instruction set is only supported when the kernels are compiled in the library and the
+ * CPU we are currently running on supports it.
+ * @param[in] isa The instruction set to check
+ * @return True when the instruction set can be used
+ */
+bool SIMD::isSupported(enum instruction_sets isa) {
+    switch(isa) {
+    case ISA_SCALAR:
+        return true;
+
+#if defined(TUV_HAVE_SSE2)
+    case ISA_SSE2:
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("sse2");
+#endif
+
+#if defined(TUV_HAVE_AVX2)
+    case ISA_AVX2:
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2");
+#endif
+
+#if defined(TUV_HAVE_NEON) && defined(__aarch64__)
+    case ISA_NEON:
+        return true;
+#elif defined(TUV_HAVE_NEON)
+    case ISA_NEON: {
+        // Search the auxiliary vector for the hardware capabilities
+        FILE *fp = fopen("/proc/self/auxv", "r");
+        if(fp == NULL)
+            return false;
+
+        Elf32_auxv_t auxv;
+        bool neon = false;
+        while(fread(&auxv, sizeof(auxv), 1, fp) == 1) {
+            if(auxv.a_type == AT_HWCAP) {
+                neon = (auxv.a_un.a_val & HWCAP_ARM_NEON) != 0;
+                break;
+            }
+        }
+        fclose(fp);
+        return neon;
+    }
+#endif
+
+    default:
+        return false;
+    }
+}
+
+/**
+ * @brief Convert an instruction set to a string
+ *
+ * @param[in] isa The instruction set
+ * @return The name of the instruction set
+ */
+const char *SIMD::toString(enum instruction_sets isa) {
+    switch(isa) {
+    case ISA_SCALAR:
+        return "scalar";
+    case ISA_SSE2:
+        return "SSE2";
+    case ISA_AVX2:
+        return "AVX2";
+    case ISA_NEON:
+        return "NEON";
+    default:
+        return "unknown";
+    }
+}
+
+/**
+ * @brief Detect the best instruction set
+ *
+ * This will go trough all instruction sets from fast to slow and return the first one which
+ * is supported.
+ * @return The best supported instruction set
+ */
+enum SIMD::instruction_sets SIMD::detect(void) {
+    static const enum instruction_sets preference[] = {ISA_AVX2, ISA_SSE2, ISA_NEON};
+
+    for(auto const &pref : preference) {
+        if(isSupported(pref))
+            return pref;
+    }
+
+    return ISA_SCALAR;
+}